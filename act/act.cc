@@ -50,6 +50,7 @@ struct command_line_defs {
 int Act::max_recurse_depth;
 int Act::max_loop_iterations;
 int Act::emit_depend;
+int Act::demand_expand;
 
 #define WARNING_FLAG(x,y) \
   int Act::x;
@@ -60,6 +61,9 @@ list_t *Act::cmdline_args;
 
 L_A_DECL (struct command_line_defs, vars);
 
+/* -prof=<file>: expansion profile output */
+static char *prof_file = NULL;
+
 #define isid(x) (((x) == '_') || isalpha(x))
 
 const char *act_model_names[ACT_MODEL_TOTAL] =
@@ -119,6 +123,7 @@ void Act::Init (int *iargc, char ***iargv)
 #include "warn.def"  
   
   Act::emit_depend = 0;
+  Act::demand_expand = 0;
   Act::double_expand = 1;
 
   Log::OpenStderr ();
@@ -317,6 +322,19 @@ void Act::Init (int *iargc, char ***iargv)
     else if (strncmp (argv[i], "-lev=", 5) == 0) {
       Log::UpdateLogLevel(argv[i]+5);
     }
+    else if (strncmp (argv[i], "-prof=", 6) == 0) {
+      if (prof_file) {
+	FREE (prof_file);
+      }
+      if (!argv[i][6]) {
+	fatal_error ("-prof option needs a file name");
+      }
+      prof_file = Strdup (argv[i]+6);
+      act_prof_enabled = 1;
+    }
+    else if (strcmp (argv[i], "-dedup") == 0) {
+      act_dedup_enabled = 1;
+    }
     else {
       A_NEW (args_remain, int);
       A_NEXT (args_remain) = i;
@@ -691,7 +709,197 @@ void Act::Expand ()
 {
   Assert (gns, "Expand() called without an object?");
   /* expand each namespace! */
+  if (act_prof_enabled) {
+    act_prof_enter (NULL);
+  }
+  gns->Expand ();
+  if (act_prof_enabled) {
+    act_prof_leave (0);
+    act_prof_report (prof_file);
+  }
+  if (act_dedup_enabled) {
+    act_dedup (gns);
+  }
+}
+
+/*
+  Expand the process with the specified template parameters, after
+  expanding the namespaces without any of their process instances
+*/
+static Process *_demand_expand (ActNamespace *gns, Process *p,
+				int nt, Expr **params)
+{
+  InstType *it, *xit;
+  Process *xp;
+  ActNamespace *ns;
+
+  Assert (p && !p->isExpanded(), "Expand() needs an unexpanded process");
+
+  if (act_prof_enabled) {
+    act_prof_enter (NULL);
+  }
+  Act::demand_expand = 1;
   gns->Expand ();
+  Act::demand_expand = 0;
+
+  ns = p->getns();
+
+  /* same error context as a full expansion */
+  list_t *nsl = list_new ();
+  for (ActNamespace *tns = ns; tns; tns = tns->Parent()) {
+    stack_push (nsl, tns);
+  }
+  int depth = 0;
+  while (!stack_isempty (nsl)) {
+    ActNamespace *tns = (ActNamespace *) stack_pop (nsl);
+    if (tns == ActNamespace::Global()) {
+      act_error_push ("::<Global>", NULL, 0);
+    }
+    else {
+      act_error_push (tns->getName(), NULL, 0);
+    }
+    depth++;
+  }
+  list_free (nsl);
+
+  it = new InstType (ns->CurScope(), p, 0);
+  if (nt > 0) {
+    it->setNumParams (nt);
+    for (int i=0; i < nt; i++) {
+      it->setParam (i, params[i]);
+    }
+  }
+  xit = it->Expand (ns, ns->CurScope());
+  xp = dynamic_cast<Process *> (xit->BaseType());
+  Assert (xp, "What?");
+  delete xit;
+  while (depth > 0) {
+    act_error_pop ();
+    depth--;
+  }
+  if (act_prof_enabled) {
+    act_prof_leave (0);
+    act_prof_report (prof_file);
+  }
+  if (act_dedup_enabled) {
+    act_dedup (gns);
+  }
+  return xp;
+}
+
+Process *Act::Expand (Process *root)
+{
+  Assert (gns, "Expand() called without an object?");
+  return _demand_expand (gns, root, 0, NULL);
+}
+
+Process *Act::Expand (const char *s)
+{
+  char *tmp, *args;
+  Process *p;
+  Expr **params;
+  int nt, nspec;
+
+  Assert (gns, "Expand() called without an object?");
+  if (!s) return NULL;
+
+  tmp = Strdup (s);
+  args = strchr (tmp, '<');
+  if (args) {
+    *args = '\0';
+    args++;
+    if (strlen (args) == 0 || args[strlen (args)-1] != '>') {
+      FREE (tmp);
+      return NULL;
+    }
+    args[strlen (args)-1] = '\0';
+  }
+
+  p = findProcess (tmp);
+  if (!p || p->isExpanded() || p->getParent()) {
+    /* inherited template parameters are not handled here */
+    FREE (tmp);
+    return NULL;
+  }
+  nt = p->getNumParams();
+
+  /* the expanded name lists every template parameter, with the
+     unspecified ones left empty */
+  params = NULL;
+  nspec = 0;
+  if (nt > 0) {
+    char *arg, *next, buf[64];
+    int i;
+
+    if (!args) {
+      FREE (tmp);
+      return NULL;
+    }
+    MALLOC (params, Expr *, nt);
+    arg = args;
+    for (i=0; i < nt; i++) {
+      InstType *x;
+      long v;
+      char *end;
+
+      if (!arg) break;
+      next = strchr (arg, ',');
+      if (next) {
+	*next = '\0';
+	next++;
+      }
+      if (*arg == '\0') {
+	/* unspecified parameter: the rest must be unspecified as well */
+	arg = next;
+	continue;
+      }
+      if (nspec != i) break;
+
+      x = p->getPortType (-(i+1));
+      if (!x || x->arrayInfo()) break;
+      v = strtol (arg, &end, 10);
+      if (*end != '\0' || v != (long)(int)v) break;
+
+      /* the value must print back the same way, or the expanded
+	 name will not match */
+      snprintf (buf, 64, "%ld", v);
+      if (strcmp (buf, arg) != 0) break;
+      
+      if (TypeFactory::isPIntType (x->BaseType())) {
+	if (v < 0) break;
+	params[i] = const_expr (v);
+      }
+      else if (TypeFactory::isPIntsType (x->BaseType())) {
+	params[i] = const_expr (v);
+      }
+      else if (TypeFactory::isPBoolType (x->BaseType())) {
+	if (v != 0 && v != 1) break;
+	params[i] = const_expr_bool (v);
+      }
+      else {
+	break;
+      }
+      nspec++;
+      arg = next;
+    }
+    if (i != nt || arg) {
+      /* could not handle this parameter list; nothing expanded yet */
+      FREE (params);
+      FREE (tmp);
+      return NULL;
+    }
+  }
+  else if (args && *args) {
+    FREE (tmp);
+    return NULL;
+  }
+  FREE (tmp);
+
+  p = _demand_expand (gns, p, nspec, params);
+  if (params) {
+    FREE (params);
+  }
+  return p;
 }
 
 
@@ -92,6 +92,12 @@ class Act {
   static int x ;
 #include "warn.def"
   
+  /**
+   * Set during demand-driven expansion; namespace-level process
+   * instances (and connections to them) are skipped
+   */
+  static int demand_expand;
+
   /**
    * Command-line arguments if -opt= is used
    */
@@ -132,6 +138,30 @@ class Act {
    */
   void Expand ();
 
+  /**
+   * Demand-driven expansion rooted at a single process. Namespace
+   * parameters and global signals are expanded as usual, but
+   * namespace-level process instances are skipped; the only process
+   * types expanded are the root and the ones it transitively
+   * instantiates.
+   *
+   * @param root is the unexpanded process
+   * @return the expanded process, using default template parameters
+   */
+  Process *Expand (Process *root);
+
+  /**
+   * Demand-driven expansion given the name of the expanded process,
+   * e.g. "foo<>" or "lib::buf<4,>". Only integer and boolean template
+   * parameters are understood.
+   *
+   * @param s is the expanded process name
+   * @return the expanded process, or NULL if the name could not be
+   * handled; in that case nothing has been expanded and the caller
+   * should fall back to Expand()
+   */
+  Process *Expand (const char *s);
+
 
   /**
    * Install string mangling functionality
@@ -132,6 +132,7 @@ void ActBody_Inst::Expand (ActNamespace *ns, Scope *s)
     act_error_ctxt (stderr);
     fatal_error ("Instance `%s': zero-length array creation not permitted", id);
   }
+  ACT_PROF_COUNT (ACT_PROF_INST, it->arrayInfo() ? it->arrayInfo()->size() : 1);
   
   x = s->Lookup (id);
 
@@ -333,6 +334,7 @@ void ActBody_Inst::Expand (ActNamespace *ns, Scope *s)
 	      Assert (idx == oldstep->index(), "Hmm");
 	      if (vx->connection()->a[idx]) {
 		ca[newstep->index()] = vx->connection()->a[idx];
+		ca[newstep->index()]->off = newstep->index();
 	      }
 	      idx++;
 	      oldstep->step();
@@ -594,6 +596,28 @@ static void dump_conn (act_connection *c)
   printf("\n");
 }
 
+/*
+  Canonical connection for an identifier that is being stepped through
+  element by element. Slices and whole arrays return the same ActId for
+  every element, and connecting individual elements never changes the
+  root connection of a plain identifier; so the lookup is done once
+  per range instead of once per element.
+*/
+static act_connection *_range_canonical (Scope *s, ActId *id,
+					 ActId **cid, act_connection **cx)
+{
+  if (id == *cid && (*cx)->isPrimary()) {
+    return *cx;
+  }
+  if (id->Rest() || (id->arrayInfo() && id->arrayInfo()->isDeref())) {
+    *cid = NULL;
+    return id->Canonical (s);
+  }
+  *cid = id;
+  *cx = id->Canonical (s);
+  return *cx;
+}
+
 void ActBody_Conn::Expand (ActNamespace *ns, Scope *s)
 {
   Expr *e;
@@ -716,6 +740,8 @@ void ActBody_Conn::Expand (ActNamespace *ns, Scope *s)
       }
       if (!done_conn) {
 	Arraystep *lhsstep = tlhs->arrayInfo()->stepper (tid->arrayInfo());
+	ActId *lcid = NULL, *rcid = NULL;
+	act_connection *lroot = NULL, *rroot = NULL;
 	/* element by element array connection */
 
 	while (!lhsstep->isend()) {
@@ -731,8 +757,8 @@ void ActBody_Conn::Expand (ActNamespace *ns, Scope *s)
 
 	  rhsstep->getID (&rid, &ridx, &rsize);
 
-	  lx = lid->Canonical (s);
-	  rx = rid->Canonical (s);
+	  lx = _range_canonical (s, lid, &lcid, &lroot);
+	  rx = _range_canonical (s, rid, &rcid, &rroot);
 
 	  if (lidx != -1) {
 	    lx = lx->getsubconn (lidx, lsize);
@@ -891,12 +917,15 @@ void ActBody_Conn::Expand (ActNamespace *ns, Scope *s)
 			   rid->getName(), rx);
       }
       else {
+	ActId *lcid = NULL, *rcid = NULL;
+	act_connection *lroot = NULL, *rroot = NULL;
+
 	while (!aes->isend()) {
 	  aes->getID (&lid, &lidx, &lsize);
 	  bes->getID (&rid, &ridx, &rsize);
 
-	  lx = lid->Canonical (s);
-	  rx = rid->Canonical (s);
+	  lx = _range_canonical (s, lid, &lcid, &lroot);
+	  rx = _range_canonical (s, rid, &rcid, &rroot);
 
 	  if (lidx != -1) {
 	    lx = lx->getsubconn (lidx, lsize);
@@ -930,6 +959,38 @@ void ActBody_Conn::Expand (ActNamespace *ns, Scope *s)
   }
 }
 
+/*
+  Used by demand-driven expansion: returns 1 if the connection refers
+  to a namespace-level instance that was deferred in scope s
+*/
+static int _deferred_aexpr (Scope *s, AExpr *a)
+{
+  if (!a) {
+    return 0;
+  }
+  if (a->isBase()) {
+    Expr *e = (Expr *)a->GetLeft();
+    if (e && e->type == E_VAR) {
+      return s->isDeferred (((ActId *)e->u.e.l)->getName());
+    }
+    return 0;
+  }
+  return _deferred_aexpr (s, a->GetLeft()) ||
+    _deferred_aexpr (s, a->GetRight());
+}
+
+int ActBody_Conn::isDeferred (Scope *s)
+{
+  if (type == 0) {
+    return s->isDeferred (u.basic.lhs->getName()) ||
+      _deferred_aexpr (s, u.basic.rhs);
+  }
+  else {
+    return _deferred_aexpr (s, u.general.lhs) ||
+      _deferred_aexpr (s, u.general.rhs);
+  }
+}
+
 void ActBody_Conn::Print (FILE *fp)
 {
   if (type == 0) {
@@ -1042,6 +1103,9 @@ void ActBody_Loop::Expand (ActNamespace *ns, Scope *s)
 
   act_syn_loop_setup (ns, s, id, lo, hi, &vx, &ilo, &ihi);
 
+  if (ilo <= ihi) {
+    ACT_PROF_COUNT (ACT_PROF_LOOP, ihi - ilo + 1);
+  }
   for (; ilo <= ihi; ilo++) {
     s->setPInt (vx->u.idx, ilo);
     b->Expandlist (ns, s);
@@ -1148,6 +1212,7 @@ void ActBody_Genloop::Expand (ActNamespace *ns, Scope *s)
       fatal_error ("# of loop iterations exceeded limit (%d)", Act::max_loop_iterations);
     }
     flag = 0;
+    ACT_PROF_COUNT (ACT_PROF_LOOP, 1);
     for (igc = gc; igc; igc = igc->next) {
       if (!igc->g) {
 	fatal_error ("Should not be here!");
@@ -189,6 +189,8 @@ public:
 
   ActBody *Clone ();
 
+  const char *getName() { return inst; }
+
 private:
   const char *inst;
   act_attr *a;
@@ -214,6 +216,8 @@ class ActBody_Conn : public ActBody {
   void Expand (ActNamespace *, Scope *);
 
   ActBody *Clone();
+
+  int isDeferred (Scope *s); /**< refers to a deferred instance in s */
   
  private:
   union {
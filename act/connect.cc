@@ -36,6 +36,10 @@ int act_connection::suboffset (act_connection *c)
 {
   int i;
 
+  if (c->parent == this && c->off >= 0 && a[c->off] == c) {
+    return c->off;
+  }
+
   if (set_suboffset_limit == -1) {
     if (config_exists ("act.subconnection_limit")) {
       set_suboffset_limit = config_get_int ("act.subconnection_limit");
@@ -1364,6 +1368,7 @@ act_connection *act_connection::getsubconn(int idx, int sz)
   }
   if (!a[idx]) {
     a[idx] = new act_connection(this);
+    a[idx]->off = idx;
   }
   return a[idx];
 }
@@ -1373,6 +1378,8 @@ act_connection *act_connection::getsubconn(int idx, int sz)
 */
 act_connection::act_connection (act_connection *_parent)
 {
+  ACT_PROF_COUNT (ACT_PROF_CONN, 1);
+
   // value pointer
   vx = NULL;
 
@@ -1388,6 +1395,9 @@ act_connection::act_connection (act_connection *_parent)
   // no subconnection slots; lazy allocation
   // getsubconn() does the allocation as needed
   a = NULL;
+
+  // slot index, set by getsubconn()
+  off = -1;
 }
 
 
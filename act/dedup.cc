@@ -0,0 +1,251 @@
+/*************************************************************************
+ *
+ *  This file is part of the ACT library
+ *
+ *  Copyright (c) 2019 Rajit Manohar
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301, USA.
+ *
+ **************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <act/act.h>
+#include <act/iter.h>
+#include "misc.h"
+#include "hash.h"
+
+/*
+  Structural de-duplication, enabled by the -dedup act option.
+
+  Different template parameters can expand a process into bodies that
+  are identical. After expansion, each expanded process gets a key
+  that describes its ports, instances, connections, and language
+  bodies. Instance types in the key are the representative processes,
+  so processes are visited bottom-up. Processes with the same key are
+  merged: every instance of a duplicate is re-typed to the first
+  process found with that key. Passes then see one type per
+  structure.
+
+  Only expansions of the same unexpanded process are merged, so the
+  representative has the same ports and the same name prefix.
+  Cells, black boxes, and processes with interfaces or refinement
+  bodies are left alone; their identity matters beyond their body.
+*/
+
+int act_dedup_enabled = 0;
+
+static struct iHashtable *visited = NULL; /* Process * -> visited */
+static struct iHashtable *dups = NULL;	  /* Process * -> InstType * of
+					     its representative */
+static struct iHashtable *reps = NULL;	  /* Process * -> InstType * */
+static struct Hashtable *keys = NULL;	  /* key -> representative */
+static int merged;
+
+static void _dedup_scope (Scope *s);
+
+static int _can_merge (Process *p)
+{
+  Process *ux;
+
+  if (p->isCell() || p->isBlackBox() || p->hasIfaces()) {
+    return 0;
+  }
+  if (p->getlang()->getrefine()) {
+    return 0;
+  }
+  ux = dynamic_cast<Process *> (p->getUnexpanded());
+  if (!ux || ux->hasRefinment()) {
+    return 0;
+  }
+  return 1;
+}
+
+static void _key_type (FILE *fp, InstType *it)
+{
+  char buf[10240];
+  Array *a = it->arrayInfo();
+
+  if (TypeFactory::isUserType (it)) {
+    /* by identity: names need not be unique across namespaces */
+    fprintf (fp, "@%p", (void *)it->BaseType());
+  }
+  else {
+    it->clrArray ();
+    it->sPrint (buf, 10240, 1);
+    it->MkArray (a);
+    fprintf (fp, "%s", buf);
+  }
+  fprintf (fp, "/%d", (int)it->getDir());
+  if (a) {
+    a->Print (fp);
+  }
+}
+
+/* returns a malloc'ed string */
+static char *_proc_key (Process *p)
+{
+  char *buf = NULL;
+  size_t len = 0;
+  FILE *fp;
+
+  fp = open_memstream (&buf, &len);
+  if (!fp) {
+    fatal_error ("act_dedup(): could not create memory stream");
+  }
+  fprintf (fp, "%p %d\n", (void *)p->getUnexpanded(), p->IsExported());
+  if (p->getParent()) {
+    fprintf (fp, "<: ");
+    _key_type (fp, p->getParent());
+    fprintf (fp, "\n");
+  }
+  for (int i=0; i < p->getNumPorts(); i++) {
+    fprintf (fp, "%s ", p->getPortName (i));
+    _key_type (fp, p->getPortType (i));
+    fprintf (fp, "\n");
+  }
+  ActInstiter inst(p->CurScope());
+  for (inst = inst.begin(); inst != inst.end(); inst++) {
+    ValueIdx *vx = *inst;
+    if (TypeFactory::isParamType (vx->t)) continue;
+    fprintf (fp, "%s ", vx->getName());
+    _key_type (fp, vx->t);
+    fprintf (fp, "\n");
+  }
+  p->CurScope()->Print (fp);
+  p->getlang()->Print (fp);
+  fclose (fp);
+  return buf;
+}
+
+static void _visit (Process *p)
+{
+  hash_bucket_t *b;
+  char *key;
+
+  if (!p->isExpanded() || ihash_lookup (visited, (long)p)) {
+    return;
+  }
+  ihash_add (visited, (long)p);
+
+  _dedup_scope (p->CurScope());
+
+  if (!_can_merge (p)) {
+    return;
+  }
+  key = _proc_key (p);
+  b = hash_lookup (keys, key);
+  if (b) {
+    Process *rep = (Process *) b->v;
+    ihash_bucket_t *ib;
+
+    ib = ihash_lookup (reps, (long)rep);
+    if (!ib) {
+      InstType *it = new InstType (rep->CurScope(), rep, 0);
+      it->mkExpanded ();
+      it->MkCached ();
+      ib = ihash_add (reps, (long)rep);
+      ib->v = it;
+    }
+    ihash_add (dups, (long)p)->v = ib->v;
+    merged++;
+  }
+  else {
+    b = hash_add (keys, key);
+    b->v = p;
+  }
+  free (key);
+}
+
+/*
+  Visit the types of all process instances in the scope, then re-type
+  the instances of duplicates
+*/
+static void _dedup_scope (Scope *s)
+{
+  ActInstiter inst(s);
+
+  for (inst = inst.begin(); inst != inst.end(); inst++) {
+    ValueIdx *vx = *inst;
+    if (TypeFactory::isProcessType (vx->t)) {
+      _visit (dynamic_cast<Process *> (vx->t->BaseType()));
+    }
+  }
+
+  for (inst = inst.begin(); inst != inst.end(); inst++) {
+    ValueIdx *vx = *inst;
+    ihash_bucket_t *b;
+    InstType *x;
+    Array *a;
+
+    if (!TypeFactory::isProcessType (vx->t)) continue;
+    b = ihash_lookup (dups, (long)vx->t->BaseType());
+    if (!b) continue;
+
+    /* refineBaseType() copies the base type and parameters, but not
+       arrays */
+    a = vx->t->arrayInfo();
+    vx->t->clrArray ();
+    x = vx->t->refineBaseType ((InstType *)b->v);
+    if (x != vx->t) {
+      vx->t->MkArray (a);
+    }
+    x->MkArray (a);
+    vx->t = x;
+  }
+}
+
+static void _dedup_ns (ActNamespace *ns)
+{
+  ActNamespaceiter i(ns);
+  for (i = i.begin(); i != i.end(); i++) {
+    _dedup_ns (*i);
+  }
+
+  ActTypeiter it(ns);
+  for (it = it.begin(); it != it.end(); it++) {
+    Process *p = dynamic_cast<Process *> (*it);
+    if (p) {
+      _visit (p);
+    }
+  }
+
+  if (ns->CurScope()->isExpanded()) {
+    _dedup_scope (ns->CurScope());
+  }
+}
+
+int act_dedup (ActNamespace *gns)
+{
+  visited = ihash_new (32);
+  dups = ihash_new (32);
+  reps = ihash_new (32);
+  keys = hash_new (32);
+  merged = 0;
+
+  _dedup_ns (gns);
+
+  ihash_free (visited);
+  ihash_free (dups);
+  ihash_free (reps);
+  hash_free (keys);
+  visited = NULL;
+  dups = NULL;
+  reps = NULL;
+  keys = NULL;
+  return merged;
+}
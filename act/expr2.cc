@@ -838,6 +838,8 @@ Expr *expr_expand (Expr *e, ActNamespace *ns, Scope *s, int is_lval)
   
   if (!e) return NULL;
 
+  ACT_PROF_COUNT (ACT_PROF_EXPR, 1);
+
   NEW (ret, Expr);
   ret->type = e->type;
 
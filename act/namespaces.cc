@@ -392,6 +392,31 @@ int ActNamespace::findName (const char *s)
  *
  *------------------------------------------------------------------------
  */
+/*
+  Demand-driven expansion: namespace-level process instances, and any
+  connections or attributes that refer to them, are deferred. The
+  scope expands them if they are looked up later on.
+*/
+void ActNamespace::_demand_expandlist ()
+{
+  ActBody *b;
+
+  for (b = B; b; b = b->Next()) {
+    ActBody_Inst *bi = dynamic_cast<ActBody_Inst *> (b);
+    ActBody_Conn *bc = dynamic_cast<ActBody_Conn *> (b);
+    ActBody_Attribute *ba = dynamic_cast<ActBody_Attribute *> (b);
+
+    if ((bi && TypeFactory::isProcessType (bi->getType())) ||
+	(bc && bc->isDeferred (I)) ||
+	(ba && I->isDeferred (ba->getName()))) {
+      I->Defer (b);
+    }
+    else {
+      b->Expand (this, I);
+    }
+  }
+}
+
 void ActNamespace::Expand ()
 {
   int i;
@@ -436,7 +461,12 @@ void ActNamespace::Expand ()
 
   /* Expand all meta parameters at the top level of the namespace. */
   if (B) {
-    B->Expandlist (this, I);
+    if (Act::demand_expand) {
+      _demand_expandlist ();
+    }
+    else {
+      B->Expandlist (this, I);
+    }
   }
 
   act_error_pop ();
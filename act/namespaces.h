@@ -46,6 +46,7 @@ class act_languages;
 struct act_chp;
 struct act_prs;
 struct act_spec;
+struct act_scope_params;
 class Array;
 
 class Scope {
@@ -163,6 +164,14 @@ class Scope {
   void playBody (ActBody *b); /* create instances in the scope based
 				 on what is in the body */
 
+  /* 
+     demand-driven expansion: namespace-level items that were
+     skipped. They are expanded, in order, the first time one of the
+     skipped instances is looked up.
+  */
+  void Defer (ActBody *b);
+  int isDeferred (const char *s);
+
   const char *getName();
   
  private:
@@ -174,22 +183,13 @@ class Scope {
   unsigned int expanded:1;	/* if it is an expanded scope */
   ActNamespace *ns;		/* if it is a namespace scope */
 
-  /* values that are per scope, rather than per instance */
-  A_DECL (unsigned long, vpint);
-  bitset_t *vpint_set;
-
-  A_DECL (long, vpints);
-  bitset_t *vpints_set;
+  list_t *deferred;		/* skipped namespace-level items */
+  int expandDeferred (const char *s);
 
-  A_DECL (double, vpreal);
-  bitset_t *vpreal_set;
-
-  A_DECL (InstType *, vptype);
-  bitset_t *vptype_set;
-
-  unsigned long vpbool_len;
-  bitset_t *vpbool;
-  bitset_t *vpbool_set;
+  /* values that are per scope, rather than per instance; allocated
+     on first use */
+  struct act_scope_params *vp;
+  void _freeParams ();
 
   friend class ActInstiter;
 };
@@ -358,6 +358,9 @@ class ActNamespace {
  private:
   act_languages *lang;
 
+  void _demand_expandlist ();	/**< expansion with deferred process
+				   instances */
+
   /**
    * hash table entry for this namespace
    */
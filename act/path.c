@@ -26,6 +26,7 @@
 #include <pwd.h>
 #include <ctype.h>
 #include "misc.h"
+#include "hash.h"
 #include "path.h"
 
 static int first = 1;
@@ -249,6 +250,8 @@ struct import_list {
 
 static struct import_list *il = NULL;
 static struct import_list *pending = NULL;
+static struct Hashtable *ilH = NULL; /* files in il, checked on every
+					import statement */
 
 void act_push_import (char *file)
 {
@@ -262,12 +265,10 @@ void act_push_import (char *file)
 
 int act_isimported (char *file)
 {
-  struct import_list *t;
-
-  for (t = il; t; t = t->next) {
-    if (strcmp (t->file, file) == 0) return 1;
+  if (!ilH) {
+    return 0;
   }
-  return 0;
+  return hash_lookup (ilH, file) ? 1 : 0;
 }
 
 void act_pop_import (char *file)
@@ -280,6 +281,12 @@ void act_pop_import (char *file)
   pending = pending->next;
   t->next = il;
   il = t;
+  if (!ilH) {
+    ilH = hash_new (32);
+  }
+  if (!hash_lookup (ilH, t->file)) {
+    hash_add (ilH, t->file);
+  }
 }
 
 int act_pending_import (char *file)
@@ -0,0 +1,310 @@
+/*************************************************************************
+ *
+ *  This file is part of the ACT library
+ *
+ *  Copyright (c) 2019 Rajit Manohar
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301, USA.
+ *
+ **************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <act/act.h>
+#include "misc.h"
+#include "array.h"
+#include "hash.h"
+
+/*
+  Expansion profiler, enabled by the -prof=<file> act option.
+
+  Statistics are kept per unexpanded type. Each expansion of a type
+  that is not found in the cache pushes a frame; time, memory, and
+  the counters below are charged to the frame on top of the stack.
+  Expansion at namespace level is charged to the "<toplevel>" entry.
+*/
+
+int act_prof_enabled = 0;
+
+struct prof_entry {
+  char *name;
+  unsigned long expansions;	/* # of new expanded types */
+  unsigned long hits;		/* # of lookups found in the cache */
+  double self, total;		/* time in seconds */
+  long long self_bytes, bytes;	/* net change in heap usage */
+  unsigned long cnt[ACT_PROF_NUM];
+  int active;			/* # of frames on the stack */
+};
+
+struct prof_frame {
+  struct prof_entry *e;
+  double start;			/* start time */
+  double child;			/* time in nested expansions */
+  long long mstart;		/* heap usage at start */
+  long long mchild;		/* heap change in nested expansions */
+};
+
+static struct iHashtable *H = NULL; /* UserDef * -> prof_entry */
+static struct prof_entry *toplevel = NULL;
+
+L_A_DECL (struct prof_frame, stk);
+
+static double _now (void)
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+/* bytes of heap in use; 0 if the C library can't tell us */
+static long long _mem (void)
+{
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2,33)
+  struct mallinfo2 mi = mallinfo2 ();
+  return (long long)mi.uordblks + (long long)mi.hblkhd;
+#else
+  return 0;
+#endif
+#else
+  return 0;
+#endif
+}
+
+static struct prof_entry *_new_entry (char *name)
+{
+  struct prof_entry *e;
+
+  NEW (e, struct prof_entry);
+  e->name = name;
+  e->expansions = 0;
+  e->hits = 0;
+  e->self = 0;
+  e->total = 0;
+  e->self_bytes = 0;
+  e->bytes = 0;
+  for (int i=0; i < ACT_PROF_NUM; i++) {
+    e->cnt[i] = 0;
+  }
+  e->active = 0;
+  return e;
+}
+
+static struct prof_entry *_get_entry (UserDef *u)
+{
+  ihash_bucket_t *b;
+
+  if (!u) {
+    if (!toplevel) {
+      toplevel = _new_entry (Strdup ("<toplevel>"));
+    }
+    return toplevel;
+  }
+  if (!H) {
+    H = ihash_new (32);
+  }
+  b = ihash_lookup (H, (long)u);
+  if (!b) {
+    char *ns, *name;
+    ActNamespace *uns = u->getns();
+
+    ns = uns ? uns->Name() : Strdup ("::");
+    MALLOC (name, char, strlen (ns) + strlen (u->getName()) + 3);
+    if (!uns || uns == ActNamespace::Global()) {
+      sprintf (name, "::%s", u->getName());
+    }
+    else {
+      sprintf (name, "%s::%s", ns, u->getName());
+    }
+    FREE (ns);
+    b = ihash_add (H, (long)u);
+    b->v = _new_entry (name);
+  }
+  return (struct prof_entry *) b->v;
+}
+
+void act_prof_enter (UserDef *u)
+{
+  struct prof_frame *f;
+
+  A_NEW (stk, struct prof_frame);
+  f = &A_NEXT (stk);
+  f->e = _get_entry (u);
+  f->e->active++;
+  f->child = 0;
+  f->mchild = 0;
+  f->mstart = _mem ();
+  f->start = _now ();
+  A_INC (stk);
+}
+
+void act_prof_leave (int cache_hit)
+{
+  struct prof_frame *f;
+  double t;
+  long long m;
+
+  Assert (A_LEN (stk) > 0, "act_prof_leave() without act_prof_enter()");
+  f = &stk[A_LEN (stk)-1];
+  t = _now () - f->start;
+  m = _mem () - f->mstart;
+  f->e->active--;
+  A_LEN (stk)--;
+
+  if (cache_hit) {
+    /* the lookup cost stays with the caller */
+    f->e->hits++;
+    return;
+  }
+  if (f->e != toplevel) {
+    f->e->expansions++;
+  }
+  f->e->self += t - f->child;
+  f->e->self_bytes += m - f->mchild;
+  if (f->e->active == 0) {
+    /* recursive types: only the outermost frame counts toward the
+       total */
+    f->e->total += t;
+    f->e->bytes += m;
+  }
+  if (A_LEN (stk) > 0) {
+    stk[A_LEN (stk)-1].child += t;
+    stk[A_LEN (stk)-1].mchild += m;
+  }
+}
+
+void act_prof_count (int which, unsigned long n)
+{
+  struct prof_entry *e;
+  if (A_LEN (stk) > 0) {
+    e = stk[A_LEN (stk)-1].e;
+  }
+  else {
+    e = _get_entry (NULL);
+  }
+  e->cnt[which] += n;
+}
+
+static int _cmp_self (const void *a, const void *b)
+{
+  struct prof_entry *x = *(struct prof_entry **)a;
+  struct prof_entry *y = *(struct prof_entry **)b;
+  if (x->self > y->self) return -1;
+  if (x->self < y->self) return 1;
+  return strcmp (x->name, y->name);
+}
+
+static void _json_str (FILE *fp, const char *s)
+{
+  fputc ('"', fp);
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') {
+      fputc ('\\', fp);
+    }
+    fputc (*s, fp);
+  }
+  fputc ('"', fp);
+}
+
+/*
+  Write the sorted report to "file", and the same data as JSON to
+  "file.json"
+*/
+void act_prof_report (const char *file)
+{
+  struct prof_entry **all;
+  int n, i;
+  ihash_iter_t it;
+  ihash_bucket_t *b;
+  double total;
+  FILE *fp;
+  char *buf;
+
+  n = (H ? H->n : 0) + (toplevel ? 1 : 0);
+  if (n == 0) {
+    return;
+  }
+  MALLOC (all, struct prof_entry *, n);
+  i = 0;
+  if (toplevel) {
+    all[i++] = toplevel;
+  }
+  if (H) {
+    ihash_iter_init (H, &it);
+    while ((b = ihash_iter_next (H, &it))) {
+      all[i++] = (struct prof_entry *) b->v;
+    }
+  }
+  qsort (all, n, sizeof (struct prof_entry *), _cmp_self);
+
+  total = 0;
+  for (i=0; i < n; i++) {
+    total += all[i]->self;
+  }
+
+  fp = fopen (file, "w");
+  if (!fp) {
+    warning ("Could not open expansion profile `%s' for writing", file);
+  }
+  else {
+    fprintf (fp, "# expansion profile: %.3f s\n", total);
+    fprintf (fp, "# %6s %9s %9s %7s %7s %9s %9s %9s %10s %12s  %s\n",
+	     "self%", "self(s)", "total(s)", "expand", "hits", "insts",
+	     "conns", "loops", "exprs", "bytes", "type");
+    for (i=0; i < n; i++) {
+      struct prof_entry *e = all[i];
+      fprintf (fp, "  %6.2f %9.4f %9.4f %7lu %7lu %9lu %9lu %9lu %10lu %12lld  %s\n",
+	       total > 0 ? 100.0*e->self/total : 0.0, e->self, e->total,
+	       e->expansions, e->hits, e->cnt[ACT_PROF_INST],
+	       e->cnt[ACT_PROF_CONN], e->cnt[ACT_PROF_LOOP],
+	       e->cnt[ACT_PROF_EXPR], e->self_bytes, e->name);
+    }
+    fclose (fp);
+  }
+
+  MALLOC (buf, char, strlen (file) + 6);
+  sprintf (buf, "%s.json", file);
+  fp = fopen (buf, "w");
+  if (!fp) {
+    warning ("Could not open expansion profile `%s' for writing", buf);
+  }
+  else {
+    fprintf (fp, "{\n  \"total_time\": %.6f,\n  \"types\": [", total);
+    for (i=0; i < n; i++) {
+      struct prof_entry *e = all[i];
+      fprintf (fp, "%s\n    { \"name\": ", i == 0 ? "" : ",");
+      _json_str (fp, e->name);
+      fprintf (fp, ", \"self_time\": %.6f, \"total_time\": %.6f,"
+	       " \"expansions\": %lu, \"cache_hits\": %lu,"
+	       " \"instances\": %lu, \"connections\": %lu,"
+	       " \"loop_iterations\": %lu, \"expr_nodes\": %lu,"
+	       " \"self_bytes\": %lld, \"total_bytes\": %lld }",
+	       e->self, e->total, e->expansions, e->hits,
+	       e->cnt[ACT_PROF_INST], e->cnt[ACT_PROF_CONN],
+	       e->cnt[ACT_PROF_LOOP], e->cnt[ACT_PROF_EXPR],
+	       e->self_bytes, e->bytes);
+    }
+    fprintf (fp, "\n  ]\n}\n");
+    fclose (fp);
+  }
+  FREE (buf);
+  FREE (all);
+}
@@ -33,18 +33,8 @@ Scope::Scope (Scope *parent, int is_expanded)
   u = NULL;
   ns = NULL;
   up = parent;
-
-  A_INIT (vpint);
-  A_INIT (vpints);
-  A_INIT (vpreal);
-  A_INIT (vptype);
-  vpbool = NULL;
-
-  vpint_set = NULL;
-  vpints_set = NULL;
-  vpreal_set = NULL;
-  vptype_set = NULL;
-  vpbool_set = NULL;
+  deferred = NULL;
+  vp = NULL;
 }
 
 InstType *Scope::Lookup (const char *s)
@@ -52,6 +42,9 @@ InstType *Scope::Lookup (const char *s)
   hash_bucket_t *b;
 
   b = hash_lookup (H, s);
+  if (!b && deferred && expandDeferred (s)) {
+    b = hash_lookup (H, s);
+  }
   if (b) {
     if (!expanded) {
       return (InstType *)b->v;
@@ -74,12 +67,102 @@ ValueIdx *Scope::LookupVal (const char *s)
   }
 
   b = hash_lookup (H, s);
+  if (!b && deferred && expandDeferred (s)) {
+    b = hash_lookup (H, s);
+  }
   if (!b) {
     return NULL;
   }
   return (ValueIdx *)b->v;
 }
 
+void Scope::Defer (ActBody *b)
+{
+  if (!deferred) {
+    deferred = list_new ();
+  }
+  list_append (deferred, b);
+}
+
+int Scope::isDeferred (const char *s)
+{
+  listitem_t *li;
+
+  if (!deferred) {
+    return 0;
+  }
+  for (li = list_first (deferred); li; li = list_next (li)) {
+    ActBody *b = (ActBody *) list_value (li);
+    ActBody_Inst *bi = dynamic_cast<ActBody_Inst *> (b);
+    if (bi && strcmp (bi->getName(), s) == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+  A skipped namespace-level instance is needed after all: expand it,
+  followed by the skipped connections and attributes that no longer
+  refer to any skipped instance, in their original order.
+*/
+int Scope::expandDeferred (const char *s)
+{
+  list_t *l;
+  listitem_t *li;
+  ActBody *inst;
+  int demand;
+
+  inst = NULL;
+  for (li = list_first (deferred); li; li = list_next (li)) {
+    ActBody_Inst *bi = dynamic_cast<ActBody_Inst *> ((ActBody *) list_value (li));
+    if (bi && strcmp (bi->getName(), s) == 0) {
+      inst = bi;
+      break;
+    }
+  }
+  if (!inst) {
+    return 0;
+  }
+
+  /* remove the instance from the deferred list before expanding it */
+  l = deferred;
+  deferred = list_new ();
+  for (li = list_first (l); li; li = list_next (li)) {
+    if (list_value (li) != inst) {
+      list_append (deferred, list_value (li));
+    }
+  }
+  list_free (l);
+
+  demand = Act::demand_expand;
+  Act::demand_expand = 0;
+  inst->Expand (ns, this);
+
+  l = deferred;
+  deferred = list_new ();
+  for (li = list_first (l); li; li = list_next (li)) {
+    ActBody *b = (ActBody *) list_value (li);
+    ActBody_Conn *bc = dynamic_cast<ActBody_Conn *> (b);
+    ActBody_Attribute *ba = dynamic_cast<ActBody_Attribute *> (b);
+    if ((bc && !bc->isDeferred (this)) ||
+	(ba && !isDeferred (ba->getName()))) {
+      b->Expand (ns, this);
+    }
+    else {
+      list_append (deferred, b);
+    }
+  }
+  list_free (l);
+  Act::demand_expand = demand;
+
+  if (list_isempty (deferred)) {
+    list_free (deferred);
+    deferred = NULL;
+  }
+  return 1;
+}
+
 ValueIdx *Scope::FullLookupVal (const char *s)
 {
   ValueIdx *vx;
@@ -135,17 +218,11 @@ Scope::~Scope ()
   }
   hash_free (H);
   H = NULL;
+  if (deferred) {
+    list_free (deferred);
+  }
 
-  A_FREE (vpint);
-  A_FREE (vpints);
-  A_FREE (vpreal);
-  A_FREE (vptype);
-  if (vpbool) { bitset_free (vpbool); }
-  if (vpint_set) { bitset_free (vpint_set); }
-  if (vpints_set) { bitset_free (vpints_set); }
-  if (vpreal_set) { bitset_free (vpreal_set); }
-  if (vptype_set) { bitset_free (vptype_set); }
-  if (vpbool_set) { bitset_free (vpbool_set); }
+  _freeParams ();
 }
 
 InstType *Scope::Lookup (ActId *id, int err)
@@ -261,32 +338,16 @@ void Scope::FlushExpand ()
       }
       delete v;
     }
-    A_FREE (vpint);
-    A_FREE (vpints);
-    A_FREE (vpreal);
-    A_FREE (vptype);
-    if (vpbool) { bitset_free (vpbool); }
-    if (vpint_set) { bitset_free (vpint_set); }
-    if (vpints_set) { bitset_free (vpints_set); }
-    if (vpreal_set) { bitset_free (vpreal_set); }
-    if (vptype_set) { bitset_free (vptype_set); }
-    if (vpbool_set) { bitset_free (vpbool_set); }
   }
   hash_clear (H);
   expanded = 1;
+  if (deferred) {
+    list_free (deferred);
+    deferred = NULL;
+  }
 
   /* value storage */
-  A_INIT (vpint);
-  A_INIT (vpints);
-  A_INIT (vpreal);
-  A_INIT (vptype);
-  vpbool = NULL;
-
-  vpint_set = NULL;
-  vpints_set = NULL;
-  vpreal_set = NULL;
-  vptype_set = NULL;
-  vpbool_set = NULL;
+  _freeParams ();
 }
 
 /**
@@ -324,22 +385,205 @@ void Scope::Merge (Scope *s)
  *------------------------------------------------------------------------
  */
 
+/*
+  Parameter storage is allocated on first use, so scopes without
+  parameters only carry the "vp" pointer. Each kind of parameter has
+  its own slots and "set" bits. Slots released in the middle of the
+  range (loop variables, arrays that are re-sized) are kept in a list
+  of holes, and are handed out again by later allocations; slots
+  released at the end simply shrink the range.
+*/
+enum {
+  ACT_PK_INT = 0,
+  ACT_PK_INTS = 1,
+  ACT_PK_REAL = 2,
+  ACT_PK_TYPE = 3,
+  ACT_PK_BOOL = 4,
+  ACT_PK_NUM = 5
+};
+
+struct act_param_hole {
+  unsigned long idx;		/* first free slot */
+  unsigned long count;		/* # of free slots */
+};
+
+struct act_param_slots {
+  unsigned long len;		/* slots in use, including holes */
+  unsigned long max;		/* slots allocated */
+  char *vals;			/* values; NULL for pbool */
+  bitset_t *set;		/* slots that have a value */
+  A_DECL (struct act_param_hole, holes); /* sorted by index */
+};
+
+struct act_scope_params {
+  struct act_param_slots k[ACT_PK_NUM];
+  bitset_t *pbool;		/* pbool values */
+};
+
+static const int _param_sz[ACT_PK_NUM] = {
+  sizeof (unsigned long),
+  sizeof (long),
+  sizeof (double),
+  sizeof (InstType *),
+  0
+};
+
+#define PVAL(kind,type,id)  (((type *)vp->k[kind].vals)[id])
+
+void Scope::_freeParams ()
+{
+  if (!vp) {
+    return;
+  }
+  for (int i=0; i < ACT_PK_NUM; i++) {
+    if (vp->k[i].vals) {
+      FREE (vp->k[i].vals);
+    }
+    if (vp->k[i].set) {
+      bitset_free (vp->k[i].set);
+    }
+    A_FREE (vp->k[i].holes);
+  }
+  if (vp->pbool) {
+    bitset_free (vp->pbool);
+  }
+  FREE (vp);
+  vp = NULL;
+}
+
+static struct act_scope_params *_new_params (void)
+{
+  struct act_scope_params *p;
+
+  NEW (p, struct act_scope_params);
+  for (int i=0; i < ACT_PK_NUM; i++) {
+    p->k[i].len = 0;
+    p->k[i].max = 0;
+    p->k[i].vals = NULL;
+    p->k[i].set = NULL;
+    A_INIT (p->k[i].holes);
+  }
+  p->pbool = NULL;
+  return p;
+}
+
+/*
+  Reserve "count" consecutive slots of the specified kind, re-using
+  the first hole that is large enough
+*/
+static unsigned long _param_alloc (struct act_param_slots *p, int kind,
+				   int count)
+{
+  unsigned long ret;
+  int i;
+
+  for (i=0; i < A_LEN (p->holes); i++) {
+    if (p->holes[i].count >= (unsigned long)count) {
+      ret = p->holes[i].idx;
+      p->holes[i].idx += count;
+      p->holes[i].count -= count;
+      if (p->holes[i].count == 0) {
+	for (; i < A_LEN (p->holes)-1; i++) {
+	  p->holes[i] = p->holes[i+1];
+	}
+	A_LEN (p->holes)--;
+      }
+      return ret;
+    }
+  }
+
+  ret = p->len;
+  if (p->len + count > p->max) {
+    unsigned long m = (p->max == 0 ? 4 : p->max);
+    while (m < p->len + count) {
+      m *= 2;
+    }
+    if (_param_sz[kind] > 0) {
+      REALLOC (p->vals, char, m*_param_sz[kind]);
+    }
+    if (!p->set) {
+      p->set = bitset_new (m);
+    }
+    else {
+      bitset_expand (p->set, m);
+    }
+    p->max = m;
+  }
+  p->len += count;
+  return ret;
+}
+
+/*
+  Release slots: either shrink the range, or record a hole (merged
+  with its neighbours)
+*/
+static void _param_dealloc (struct act_param_slots *p,
+			    unsigned long idx, int count)
+{
+  int i, j;
+
+  for (unsigned long l = idx; l < idx + count; l++) {
+    bitset_clr (p->set, l);
+  }
+
+  if (idx + count == p->len) {
+    p->len = idx;
+    i = A_LEN (p->holes)-1;
+    if (i >= 0 && p->holes[i].idx + p->holes[i].count == p->len) {
+      p->len = p->holes[i].idx;
+      A_LEN (p->holes)--;
+    }
+    return;
+  }
+
+  for (i=0; i < A_LEN (p->holes); i++) {
+    if (p->holes[i].idx > idx) break;
+  }
+  Assert (i == 0 ||
+	  p->holes[i-1].idx + p->holes[i-1].count <= idx,
+	  "Parameter slots released twice?");
+  Assert (i == A_LEN (p->holes) || idx + count <= p->holes[i].idx,
+	  "Parameter slots released twice?");
+
+  if (i > 0 && p->holes[i-1].idx + p->holes[i-1].count == idx) {
+    /* extend the previous hole */
+    p->holes[i-1].count += count;
+    if (i < A_LEN (p->holes) &&
+	p->holes[i-1].idx + p->holes[i-1].count == p->holes[i].idx) {
+      p->holes[i-1].count += p->holes[i].count;
+      for (; i < A_LEN (p->holes)-1; i++) {
+	p->holes[i] = p->holes[i+1];
+      }
+      A_LEN (p->holes)--;
+    }
+  }
+  else if (i < A_LEN (p->holes) && idx + count == p->holes[i].idx) {
+    /* extend the next hole */
+    p->holes[i].idx = idx;
+    p->holes[i].count += count;
+  }
+  else {
+    A_NEW (p->holes, struct act_param_hole);
+    for (j = A_LEN (p->holes); j > i; j--) {
+      p->holes[j] = p->holes[j-1];
+    }
+    p->holes[i].idx = idx;
+    p->holes[i].count = count;
+    A_INC (p->holes);
+  }
+}
+
 /**----- pint -----**/
 
 unsigned long Scope::AllocPInt(int count)
 {
-  unsigned long ret;
   if (count <= 0) {
     fatal_error ("Scope::AllocPInt(): count must be >0!");
   }
-  A_NEWP (vpint, unsigned long, count);
-  ret = A_LEN (vpint);
-  if (!vpint_set) { vpint_set = bitset_new (count); }
-  else {
-    bitset_expand (vpint_set, ret + count);
+  if (!vp) {
+    vp = _new_params ();
   }
-  A_LEN (vpint) += count;
-  return ret;
+  return _param_alloc (&vp->k[ACT_PK_INT], ACT_PK_INT, count);
 }
 
 void Scope::DeallocPInt (unsigned long idx, int count)
@@ -347,19 +591,10 @@ void Scope::DeallocPInt (unsigned long idx, int count)
   if (count <= 0) {
     fatal_error ("Scope::DeallocPInt(): count must be >0!");
   }
-  if ((idx+count) > A_LEN (vpint)) {
+  if (!vp || (idx+count) > vp->k[ACT_PK_INT].len) {
     fatal_error ("Scope::DeallocPInt(): out of range");
   }
-  if (idx+count == A_LEN (vpint)) {
-    /* we can actually deallocate this! */
-    for (unsigned long i = idx; i < idx + count; i++) {
-      bitset_clr (vpint_set, i);
-    }
-    A_LEN (vpint) -= count;
-    
-    return;
-  }
-  /* otherwise, ignore it. too bad! */
+  _param_dealloc (&vp->k[ACT_PK_INT], idx, count);
 }
 
 void Scope::setPInt(unsigned long id, unsigned long val)
@@ -367,11 +602,11 @@ void Scope::setPInt(unsigned long id, unsigned long val)
 #if 0
   fprintf (stderr, "[%x] set %d to %d\n", this, id, val);
 #endif
-  if (id >= A_LEN (vpint)) {
+  if (!vp || id >= vp->k[ACT_PK_INT].len) {
     fatal_error ("Scope::setPInt(): invalid identifier!");
   }
-  vpint[id] = val;
-  bitset_set (vpint_set, id);
+  PVAL (ACT_PK_INT, unsigned long, id) = val;
+  bitset_set (vp->k[ACT_PK_INT].set, id);
 }
 
 int Scope::issetPInt(unsigned long id)
@@ -379,36 +614,31 @@ int Scope::issetPInt(unsigned long id)
 #if 0  
   fprintf (stderr, "[%x] check %d\n", this, id);
 #endif  
-  if (id >= A_LEN (vpint)) {
+  if (!vp || id >= vp->k[ACT_PK_INT].len) {
     fatal_error ("Scope::setPInt(): invalid identifier!");
   }
-  return bitset_tst (vpint_set, id);
+  return bitset_tst (vp->k[ACT_PK_INT].set, id);
 }
 
 unsigned long Scope::getPInt(unsigned long id)
 {
-  if (id >= A_LEN (vpint)) {
+  if (!vp || id >= vp->k[ACT_PK_INT].len) {
     fatal_error ("Scope::setPInt(): invalid identifier!");
   }
-  return vpint[id];
+  return PVAL (ACT_PK_INT, unsigned long, id);
 }
 
 /**----- pints -----**/
 
 unsigned long Scope::AllocPInts(int count)
 {
-  unsigned long ret;
   if (count <= 0) {
     fatal_error ("Scope::AllocPInts(): count must be >0!");
   }
-  A_NEWP (vpints, long, count);
-  ret = A_LEN (vpints);
-  if (!vpints_set) { vpints_set = bitset_new (count); }
-  else {
-    bitset_expand (vpints_set, A_LEN (vpints)+count);
+  if (!vp) {
+    vp = _new_params ();
   }
-  A_LEN (vpints) += count;
-  return ret;
+  return _param_alloc (&vp->k[ACT_PK_INTS], ACT_PK_INTS, count);
 }
 
 void Scope::DeallocPInts (unsigned long idx, int count)
@@ -416,63 +646,49 @@ void Scope::DeallocPInts (unsigned long idx, int count)
   if (count <= 0) {
     fatal_error ("Scope::DeallocPInts(): count must be >0!");
   }
-  if ((idx+count) > A_LEN (vpints)) {
+  if (!vp || (idx+count) > vp->k[ACT_PK_INTS].len) {
     fatal_error ("Scope::DeallocPInts(): out of range");
   }
-  if (idx+count == A_LEN (vpints)) {
-    /* we can actually deallocate this! */
-    for (unsigned long i = idx; i < idx + count; i++) {
-      bitset_clr (vpints_set, i);
-    }
-    A_LEN (vpints) -= count;
-    
-    return;
-  }
-  /* otherwise, ignore it. too bad! */
+  _param_dealloc (&vp->k[ACT_PK_INTS], idx, count);
 }
 
 
 void Scope::setPInts(unsigned long id, long val)
 {
-  if (id >= A_LEN (vpints)) {
+  if (!vp || id >= vp->k[ACT_PK_INTS].len) {
     fatal_error ("Scope::setPInts(): invalid identifier!");
   }
-  vpints[id] = val;
-  bitset_set (vpints_set, id);
+  PVAL (ACT_PK_INTS, long, id) = val;
+  bitset_set (vp->k[ACT_PK_INTS].set, id);
 }
 
 int Scope::issetPInts(unsigned long id)
 {
-  if (id >= A_LEN (vpints)) {
+  if (!vp || id >= vp->k[ACT_PK_INTS].len) {
     fatal_error ("Scope::setPInts(): invalid identifier!");
   }
-  return bitset_tst (vpints_set, id);
+  return bitset_tst (vp->k[ACT_PK_INTS].set, id);
 }
 
 long Scope::getPInts(unsigned long id)
 {
-  if (id >= A_LEN (vpints)) {
+  if (!vp || id >= vp->k[ACT_PK_INTS].len) {
     fatal_error ("Scope::setPInts(): invalid identifier!");
   }
-  return vpints[id];
+  return PVAL (ACT_PK_INTS, long, id);
 }
 
 /**----- preal -----**/
 
 unsigned long Scope::AllocPReal(int count)
 {
-  unsigned long ret;
   if (count <= 0) {
     fatal_error ("Scope::AllocPReal(): count must be >0!");
   }
-  A_NEWP (vpreal, double, count);
-  ret = A_LEN (vpreal);
-  if (!vpreal_set) { vpreal_set = bitset_new (count); }
-  else {
-    bitset_expand (vpreal_set, A_LEN (vpreal)+count);
+  if (!vp) {
+    vp = _new_params ();
   }
-  A_LEN (vpreal) += count;
-  return ret;
+  return _param_alloc (&vp->k[ACT_PK_REAL], ACT_PK_REAL, count);
 }
 
 void Scope::DeallocPReal (unsigned long idx, int count)
@@ -480,44 +696,36 @@ void Scope::DeallocPReal (unsigned long idx, int count)
   if (count <= 0) {
     fatal_error ("Scope::DeallocPReal(): count must be >0!");
   }
-  if ((idx+count) > A_LEN (vpreal)) {
+  if (!vp || (idx+count) > vp->k[ACT_PK_REAL].len) {
     fatal_error ("Scope::DeallocPReal(): out of range");
   }
-  if (idx+count == A_LEN (vpreal)) {
-    /* we can actually deallocate this! */
-    for (unsigned long i = idx; i < idx + count; i++) {
-      bitset_clr (vpreal_set, i);
-    }
-    A_LEN (vpreal) -= count;
-    return;
-  }
-  /* otherwise, ignore it. too bad! */
+  _param_dealloc (&vp->k[ACT_PK_REAL], idx, count);
 }
 
 
 void Scope::setPReal(unsigned long id, double val)
 {
-  if (id >= A_LEN (vpreal)) {
+  if (!vp || id >= vp->k[ACT_PK_REAL].len) {
     fatal_error ("Scope::setPPReal(): invalid identifier!");
   }
-  vpreal[id] = val;
-  bitset_set (vpreal_set, id);
+  PVAL (ACT_PK_REAL, double, id) = val;
+  bitset_set (vp->k[ACT_PK_REAL].set, id);
 }
 
 int Scope::issetPReal(unsigned long id)
 {
-  if (id >= A_LEN (vpreal)) {
+  if (!vp || id >= vp->k[ACT_PK_REAL].len) {
     fatal_error ("Scope::setPReal(): invalid identifier!");
   }
-  return bitset_tst (vpreal_set, id);
+  return bitset_tst (vp->k[ACT_PK_REAL].set, id);
 }
 
 double Scope::getPReal(unsigned long id)
 {
-  if (id >= A_LEN (vpreal)) {
+  if (!vp || id >= vp->k[ACT_PK_REAL].len) {
     fatal_error ("Scope::setPReal(): invalid identifier!");
   }
-  return vpreal[id];
+  return PVAL (ACT_PK_REAL, double, id);
 }
 
 
@@ -526,18 +734,13 @@ double Scope::getPReal(unsigned long id)
 
 unsigned long Scope::AllocPType(int count)
 {
-  unsigned long ret;
   if (count <= 0) {
     fatal_error ("Scope::AllocPType(): count must be >0!");
   }
-  A_NEWP (vptype, InstType *, count);
-  ret = A_LEN (vptype);
-  if (!vptype_set) { vptype_set = bitset_new (count); }
-  else {
-    bitset_expand (vptype_set, A_LEN (vptype)+count);
+  if (!vp) {
+    vp = _new_params ();
   }
-  A_LEN (vptype) += count;
-  return ret;
+  return _param_alloc (&vp->k[ACT_PK_TYPE], ACT_PK_TYPE, count);
 }
 
 void Scope::DeallocPType (unsigned long idx, int count)
@@ -545,43 +748,35 @@ void Scope::DeallocPType (unsigned long idx, int count)
   if (count <= 0) {
     fatal_error ("Scope::DeallocPType(): count must be >0!");
   }
-  if ((idx+count) > A_LEN (vptype)) {
-    fatal_error ("Scope::DeallocPReal(): out of range");
-  }
-  if (idx+count == A_LEN (vptype)) {
-    /* we can actually deallocate this! */
-    for (unsigned long i = idx; i < idx + count; i++) {
-      bitset_clr (vptype_set, i);
-    }
-    A_LEN (vptype) -= count;
-    return;
+  if (!vp || (idx+count) > vp->k[ACT_PK_TYPE].len) {
+    fatal_error ("Scope::DeallocPType(): out of range");
   }
-  /* otherwise, ignore it. too bad! */
+  _param_dealloc (&vp->k[ACT_PK_TYPE], idx, count);
 }
 
 void Scope::setPType(unsigned long id, InstType *val)
 {
-  if (id >= A_LEN (vptype)) {
+  if (!vp || id >= vp->k[ACT_PK_TYPE].len) {
     fatal_error ("Scope::setPPType(): invalid identifier!");
   }
-  vptype[id] = val;
-  bitset_set (vptype_set, id);
+  PVAL (ACT_PK_TYPE, InstType *, id) = val;
+  bitset_set (vp->k[ACT_PK_TYPE].set, id);
 }
 
 int Scope::issetPType(unsigned long id)
 {
-  if (id >= A_LEN (vptype)) {
+  if (!vp || id >= vp->k[ACT_PK_TYPE].len) {
     fatal_error ("Scope::setPType(): invalid identifier!");
   }
-  return bitset_tst (vptype_set, id);
+  return bitset_tst (vp->k[ACT_PK_TYPE].set, id);
 }
 
 InstType *Scope::getPType(unsigned long id)
 {
-  if (id >= A_LEN (vptype)) {
+  if (!vp || id >= vp->k[ACT_PK_TYPE].len) {
     fatal_error ("Scope::setPType(): invalid identifier!");
   }
-  return vptype[id];
+  return PVAL (ACT_PK_TYPE, InstType *, id);
 }
 
 
@@ -589,21 +784,21 @@ InstType *Scope::getPType(unsigned long id)
 
 unsigned long Scope::AllocPBool(int count)
 {
+  unsigned long ret;
   if (count <= 0) {
     fatal_error ("Scope::AllocPBool(): count must be >0!");
   }
-  if (!vpbool) {
-    vpbool = bitset_new (count);
-    vpbool_set = bitset_new (count);
-    vpbool_len = count;
-    return 0;
+  if (!vp) {
+    vp = _new_params ();
+  }
+  ret = _param_alloc (&vp->k[ACT_PK_BOOL], ACT_PK_BOOL, count);
+  if (!vp->pbool) {
+    vp->pbool = bitset_new (vp->k[ACT_PK_BOOL].max);
   }
   else {
-    bitset_expand (vpbool, vpbool_len + count);
-    bitset_expand (vpbool_set, vpbool_len + count);
-    vpbool_len += count;
-    return vpbool_len - count;
+    bitset_expand (vp->pbool, vp->k[ACT_PK_BOOL].max);
   }
+  return ret;
 }
 
 void Scope::DeallocPBool (unsigned long idx, int count)
@@ -611,48 +806,40 @@ void Scope::DeallocPBool (unsigned long idx, int count)
   if (count <= 0) {
     fatal_error ("Scope::DeallocPBool(): count must be >0!");
   }
-  if ((idx+count) > vpbool_len) {
+  if (!vp || (idx+count) > vp->k[ACT_PK_BOOL].len) {
     fatal_error ("Scope::DeallocPBool(): out of range");
   }
-  if (idx+count == vpbool_len) {
-    /* we can actually deallocate this! */
-    for (unsigned long i = idx; i < idx + count; i++) {
-      bitset_clr (vpbool_set, i);
-    }
-    vpbool_len -= count;
-    return;
-  }
-  /* otherwise, ignore it. too bad! */
+  _param_dealloc (&vp->k[ACT_PK_BOOL], idx, count);
 }
 
 void Scope::setPBool(unsigned long id, int val)
 {
-  if (id >= vpbool_len) {
+  if (!vp || id >= vp->k[ACT_PK_BOOL].len) {
     fatal_error ("Scope::setPBool(): invalid identifier!");
   }
   if (val) {
-    bitset_set (vpbool, id);
+    bitset_set (vp->pbool, id);
   }
   else {
-    bitset_clr (vpbool, id);
+    bitset_clr (vp->pbool, id);
   }
-  bitset_set (vpbool_set, id);
+  bitset_set (vp->k[ACT_PK_BOOL].set, id);
 }
 
 int Scope::issetPBool(unsigned long id)
 {
-  if (id >= vpbool_len) {
+  if (!vp || id >= vp->k[ACT_PK_BOOL].len) {
     fatal_error ("Scope::setPBool(): invalid identifier!");
   }
-  return bitset_tst (vpbool_set, id);
+  return bitset_tst (vp->k[ACT_PK_BOOL].set, id);
 }
 
 int Scope::getPBool(unsigned long id)
 {
-  if (id >= vpbool_len) {
+  if (!vp || id >= vp->k[ACT_PK_BOOL].len) {
     fatal_error ("Scope::setPBool(): invalid identifier!");
   }
-  return bitset_tst (vpbool, id) ? 1 : 0;
+  return bitset_tst (vp->pbool, id) ? 1 : 0;
 }
 
 
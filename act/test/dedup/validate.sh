@@ -0,0 +1,23 @@
+#!/bin/sh
+
+ARCH=`$VLSI_TOOLS_SRC/scripts/getarch`
+OS=`$VLSI_TOOLS_SRC/scripts/getos`
+EXT=${ARCH}_${OS}
+ACT=../act-test.$EXT
+
+if [ $# -eq 0 ]
+then
+	list=*.act
+else
+	list="$@"
+fi
+
+if [ ! -d runs ]
+then
+	mkdir runs
+fi
+
+for i in $list
+do
+	$ACT -dedup -ep $i > runs/$i.stdout 2> runs/$i.stderr
+done
@@ -0,0 +1,27 @@
+#!/bin/sh
+
+ARCH=`$VLSI_TOOLS_SRC/scripts/getarch`
+OS=`$VLSI_TOOLS_SRC/scripts/getos`
+EXT=${ARCH}_${OS}
+
+fail=0
+
+if ! ../run_subdir.sh
+then
+	fail=1
+fi
+
+# parameter slot reuse, below the language level
+../scope-test.$EXT > runs/scope.t.stdout 2> runs/scope.t.stderr
+if ! cmp runs/scope.t.stdout runs/scope.stdout >/dev/null 2>/dev/null
+then
+	echo "** FAILED TEST scope-test: stdout **"
+	fail=1
+fi
+if [ -s runs/scope.t.stderr ]
+then
+	echo "** FAILED TEST scope-test: stderr **"
+	fail=1
+fi
+
+exit $fail
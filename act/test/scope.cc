@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <act/act.h>
+
+/*
+  Parameter slot reuse in an expanded Scope.
+
+  Two pint arrays are grown in alternation, one element at a time,
+  the way ActBody_Inst::Expand() extends an array: the values are
+  saved, the old block is released, and a larger block is allocated.
+  A short-lived block is also released in the middle of the slots in
+  use, as loop variables are. After every step all live values must
+  be intact (no two live parameters may share a slot), and the slots
+  in use must stay within a small multiple of the live ones.
+*/
+
+#define N 2000
+
+struct parr {
+  unsigned long idx;
+  int len;
+  unsigned long base;		/* value of element i is base + i */
+};
+
+static unsigned long peak = 0;
+
+static void note (unsigned long idx, int count)
+{
+  if (idx + count > peak) {
+    peak = idx + count;
+  }
+}
+
+static void grow (Scope *s, struct parr *p)
+{
+  unsigned long *vals;
+  int i;
+
+  MALLOC (vals, unsigned long, p->len);
+  for (i=0; i < p->len; i++) {
+    vals[i] = s->getPInt (p->idx + i);
+  }
+  s->DeallocPInt (p->idx, p->len);
+  p->len++;
+  p->idx = s->AllocPInt (p->len);
+  note (p->idx, p->len);
+  for (i=0; i < p->len-1; i++) {
+    s->setPInt (p->idx + i, vals[i]);
+  }
+  s->setPInt (p->idx + p->len - 1, p->base + p->len - 1);
+  FREE (vals);
+}
+
+static int check (Scope *s, struct parr *p)
+{
+  int i;
+
+  for (i=0; i < p->len; i++) {
+    if (!s->issetPInt (p->idx + i)
+	|| s->getPInt (p->idx + i) != p->base + i) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int main (int argc, char **argv)
+{
+  Scope *s;
+  struct parr a, b;
+  unsigned long tmp;
+  int i, bad;
+
+  s = new Scope (NULL, 1);
+
+  a.base = 0;
+  a.len = 1;
+  a.idx = s->AllocPInt (1);
+  s->setPInt (a.idx, a.base);
+
+  b.base = 100000;
+  b.len = 1;
+  b.idx = s->AllocPInt (1);
+  s->setPInt (b.idx, b.base);
+  note (b.idx, 1);
+
+  bad = 0;
+  for (i=1; i < N; i++) {
+    tmp = s->AllocPInt (3);
+    note (tmp, 3);
+    s->setPInt (tmp, 7);
+    grow (s, &a);
+    s->DeallocPInt (tmp, 3);
+    grow (s, &b);
+    if (!check (s, &a) || !check (s, &b)) {
+      bad++;
+    }
+  }
+  printf ("steps with a lost value: %d\n", bad);
+  printf ("live slots: %d\n", a.len + b.len);
+  printf ("peak slots: %lu\n", peak);
+  printf ("slots used: %s\n", peak <= 4*(unsigned long)(a.len + b.len)
+	  ? "bounded" : "unbounded");
+
+  delete s;
+  return 0;
+}
@@ -1244,6 +1244,9 @@ UserDef *UserDef::Expand (ActNamespace *ns, Scope *s, int spec_nt, inst_param *u
     act_error_ctxt (stderr);
     fatal_error ("Exceeded maximum recursion depth of %d\n", Act::max_recurse_depth);
   }
+  if (act_prof_enabled) {
+    act_prof_enter (this);
+  }
 
   /* nt = # of specified parameters
      u = expanded instance paramters
@@ -1592,6 +1595,9 @@ UserDef *UserDef::Expand (ActNamespace *ns, Scope *s, int spec_nt, inst_param *u
     delete ux;
     recursion_depth--;
     *cache_hit = 1;
+    if (act_prof_enabled) {
+      act_prof_leave (1);
+    }
     return uy;
   }
   *cache_hit = 0;
@@ -1673,6 +1679,9 @@ UserDef *UserDef::Expand (ActNamespace *ns, Scope *s, int spec_nt, inst_param *u
 
   ux->pending = 0;
   recursion_depth--;
+  if (act_prof_enabled) {
+    act_prof_leave (0);
+  }
   return ux;
 }
 
@@ -166,6 +166,7 @@ class UserDef : public Type {
   void MkExported () { exported = 1; }
 
   int isExpanded() { return expanded; }
+  UserDef *getUnexpanded() { return unexpanded; }
   
 
   /**
@@ -394,6 +395,7 @@ class Process : public UserDef {
   list_t *findMap (InstType *iface);
   void mkRefined() { has_refinement = 1; }
   int hasRefinment() { return has_refinement; }
+  int hasIfaces() { return ifaces ? 1 : 0; }
   
  private:
   unsigned int is_cell:1;	/**< 1 if this is a defcell, 0 otherwise  */
@@ -882,6 +884,35 @@ const char *act_error_top ();
 
 void typecheck_err (const char *s, ...);
 
+/*
+  Expansion profiler (act option -prof=<file>). The counters are
+  charged to the type currently being expanded.
+*/
+enum act_prof_counter {
+  ACT_PROF_INST,		/* instances created */
+  ACT_PROF_CONN,		/* act_connection objects */
+  ACT_PROF_LOOP,		/* loop iterations */
+  ACT_PROF_EXPR,		/* expression nodes expanded */
+  ACT_PROF_NUM
+};
+extern int act_prof_enabled;
+void act_prof_enter (UserDef *u); // NULL = namespace-level expansion
+void act_prof_leave (int cache_hit);
+void act_prof_count (int which, unsigned long n);
+void act_prof_report (const char *file);
+#define ACT_PROF_COUNT(which,n)				\
+  do {							\
+    if (act_prof_enabled) act_prof_count ((which), (n));	\
+  } while (0)
+
+/*
+  Structural de-duplication of expanded processes (act option
+  -dedup). Returns the number of processes that were merged into
+  another one.
+*/
+extern int act_dedup_enabled;
+int act_dedup (ActNamespace *gns);
+
 extern "C" {
 
 Expr *act_parse_expr_syn_loop_bool (LFILE *l);
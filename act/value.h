@@ -47,6 +47,7 @@ public:
   act_connection *up;
   act_connection *next;
   act_connection **a;	// slots for root arrays and root userdefs
+  int off;			// my slot index within parent->a[]
 
 
   act_connection(act_connection *_parent = NULL);
@@ -71,8 +72,9 @@ public:
   /* return offset of subconnection c within current connection object */
   int suboffset (act_connection *c);
 
-  /* return my offset within my parent */
-  int myoffset () { return parent->suboffset (this); }
+  /* return my offset within my parent; slots keep their index when
+     subtrees are merged, so this is recorded when the slot is created */
+  int myoffset () { return off; }
   
   // returns true when there are other things connected to
   // the object directly
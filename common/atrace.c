@@ -1381,6 +1381,32 @@ void atrace_init_time (atrace *a)
   }
 }
 
+/*------------------------------------------------------------------------
+ *
+ *  atrace_rewind_time --
+ *
+ *   Go back to step 0, as if atrace_init_time() was just called, so
+ *   that the trace can be read again.
+ *
+ *------------------------------------------------------------------------
+ */
+void atrace_rewind_time (atrace *a)
+{
+  int n;
+
+  Assert (a->read_mode, "atrace_rewind_time called in write mode");
+
+  for (n=0; n < a->Nnodes; n++) {
+    a->N[n]->v = 0.0;
+    a->N[n]->chg_next = NULL;
+  }
+  a->hd_chglist = NULL;
+  seek_after_header (a, 0);
+  a->curt = -1;
+  a->rec_type = -2;
+  atrace_init_time (a);
+}
+
 void atrace_advance_time (atrace *a, int nsteps)
 {
   int n;
@@ -1843,6 +1869,28 @@ void atrace_signal_change (atrace *a, name_t *n, float t, float v)
   }
 }
 
+/* a batch of signal changes, in order */
+void atrace_signal_changes (atrace *a, int num, name_t **n, float *t, float *v)
+{
+  int i;
+  name_t *m;
+
+  emit_header_aux (a);
+
+  if (ATRACE_FMT(a->fmt) != ATRACE_DELTA) {
+    for (i=0; i < num; i++) {
+      atrace_signal_change (a, n[i], t[i], v[i]);
+    }
+    return;
+  }
+  for (i=0; i < num; i++) {
+    m = n[i];
+    while (m->up)
+      m = m->up;
+    _sig_change_delta (a, m, t[i], v[i]);
+  }
+}
+
 /* signal change */
 void atrace_signal_change_cause (atrace *a, name_t *n, float t, float v, name_t *c)
 {
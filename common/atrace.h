@@ -234,6 +234,8 @@ void atrace_readall_node_c (atrace *, name_t *, float *M, int *C);
 */
 void atrace_init_time (atrace *);
 void atrace_advance_time (atrace *, int nstep);
+void atrace_rewind_time (atrace *);
+  /* back to step 0, to read the trace again */
 
 #define ATRACE_NAME(a,n) ((a)->N[n])
 #define ATRACE_GET_NAME(a,n) ATRACE_NAME(a,n)->b->key
@@ -249,6 +251,11 @@ void  atrace_signal_change (atrace *, name_t *, float t, float v);
      for this function are non-decreasing.
   */
 
+void  atrace_signal_changes (atrace *, int num, name_t **n, float *t, float *v);
+  /* Record "num" signal changes n[i] := v[i] at time t[i], in order.
+     Same as calling atrace_signal_change() for each one.
+  */
+
 name_t *atrace_create_node (atrace *, const char *);
   /* create a node; if exists, return old value */
 #define atrace_mk_digital(n) ((n)->type = 1)
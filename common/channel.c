@@ -42,6 +42,13 @@ static void _ch_trecv (ch_t *c, void *msg);
 
 typedef void (*FUNC)(ch_t*,void*);
 
+#define CH_NOTE_SEND(c,t)			\
+  do {						\
+    if ((c)->nsend == 0) (c)->tfirst = (t);	\
+    (c)->tlast = (t);				\
+    (c)->nsend++;				\
+  } while (0)
+
 static int channel_timing = 0;
 
 static FILE *timer_fp = NULL;
@@ -252,6 +259,14 @@ ch_t *ch_newl (int slack, int sz, int lat, int cycle)
   c->sender = NULL;
   c->receiver = NULL;
 
+  c->nsend = 0;
+  c->nrecv = 0;
+  c->sblock = 0;
+  c->rblock = 0;
+  c->nbatch = 0;
+  time_init (c->tfirst);
+  time_init (c->tlast);
+
   if (channel_timing) {
     c->send = (FUNC)_ch_tsend;
     c->recv = (FUNC)_ch_trecv;
@@ -309,10 +324,28 @@ void _ch_free (ch_t *c, char *file, int line)
       }
     }
   }
+  if (channel_timing) {
+    ch_stats (timer_fp, c);
+  }
+  free (c->tm);
+  free (c->msgbuf);
   free (c);
   context_enable ();
 }
 
+/* channel statistics */
+void ch_stats (FILE *fp, ch_t *c)
+{
+  fprintf (fp, "channel %8lx: sent %lu (%lu blocked), recv %lu (%lu blocked), %lu batched calls",
+	   (unsigned long)c, c->nsend, c->sblock, c->nrecv, c->rblock,
+	   c->nbatch);
+  if (c->nsend > 1 && c->tlast > c->tfirst) {
+    fprintf (fp, ", throughput %g msgs/time unit",
+	     (double)(c->nsend-1)/(double)(c->tlast - c->tfirst));
+  }
+  fputc ('\n', fp);
+}
+
 void ch_dump (ch_t *c, char *msg)
 {
   int i, cs, cr;
@@ -510,6 +543,7 @@ static void _ch_frecvul (ch_t *c, unsigned long *msg)
   int id, id2;
 
   context_disable ();
+  c->nrecv++;
   id = c->recvid % (1+c->slack);
   c->receiver = (lthread_t*)current_process;
 
@@ -536,6 +570,7 @@ static void _ch_frecvul (ch_t *c, unsigned long *msg)
     context_enable ();
   }
   else if (c->sendid == c->recvid) {
+    c->rblock++;
     c->msgptr = msg;
     q_ins (c->qr.hd, c->qr.tl, current_process);
     DO_SELECTION (c);
@@ -558,6 +593,7 @@ static void _ch_fsendul (ch_t *c, unsigned long *msg)
   int delay;
 
   context_disable ();
+  CH_NOTE_SEND (c, ((lthread_t*)current_process)->time);
 
   t = (lthread_t*)current_process;
   c->sender = t;
@@ -579,7 +615,7 @@ static void _ch_fsendul (ch_t *c, unsigned long *msg)
     q_del (c->qr.hd, c->qr.tl, t);
     q_ins (readyQh, readyQt, t);
     t->in_readyq = 1;
-    *((int*)c->msgptr) = *msg;
+    *((unsigned long*)c->msgptr) = *msg;
     id = c->recvid % (1+c->slack);
     t->time = time_max (t->time, c->tm[id]);
     c->tm[id] = t->time;
@@ -588,6 +624,7 @@ static void _ch_fsendul (ch_t *c, unsigned long *msg)
     context_enable ();
   }
   else if (Abs (c->sendid - c->recvid) == c->slack) {
+    c->sblock++;
     q_ins (c->qs.hd, c->qs.tl, current_process);
     DO_SELECTION (c);
     context_switch (context_select ());
@@ -608,6 +645,7 @@ static void _ch_frecv (ch_t *c, void *msg)
   int id, id2;
   
   context_disable ();
+  c->nrecv++;
   id = c->recvid % (1+c->slack);
   c->receiver = (lthread_t*)current_process;
 
@@ -633,6 +671,7 @@ static void _ch_frecv (ch_t *c, void *msg)
     context_enable ();
   }
   else if (c->sendid == c->recvid) {
+    c->rblock++;
     c->msgptr = msg;
     q_ins (c->qr.hd, c->qr.tl, current_process);
     DO_SELECTION (c);
@@ -655,6 +694,7 @@ static void _ch_fsend (ch_t *c, void *msg)
   int delay;
 
   context_disable ();
+  CH_NOTE_SEND (c, ((lthread_t*)current_process)->time);
   
   delay = Abs(c->sendid - c->recvid)*c->overhead + c->fifodelay;
 
@@ -683,6 +723,7 @@ static void _ch_fsend (ch_t *c, void *msg)
     context_enable ();
   }
   else if (Abs (c->sendid - c->recvid) == c->slack) {
+    c->sblock++;
     q_ins (c->qs.hd, c->qs.tl, current_process);
     DO_SELECTION (c);
     context_switch (context_select ());
@@ -697,6 +738,81 @@ static void _ch_fsend (ch_t *c, void *msg)
 }  
 
 
+/*
+ *  Batched send/receive
+ *
+ *  While the channel has free slack (send) or buffered messages
+ *  (receive) and nobody is suspended on the other end, messages are
+ *  moved directly through the slot buffer with a single
+ *  disable/enable pair and no context switch. The timing is the same
+ *  as a sequence of individual non-blocking transfers. Once the fast
+ *  path is exhausted the next message goes through the normal
+ *  (possibly blocking) path.
+ */
+int ch_send_n (ch_t *c, void *msgs, int n)
+{
+  lthread_t *t;
+  int i, id, id2;
+  int delay;
+
+  i = 0;
+  while (i < n) {
+    if (!channel_timing) {
+      context_disable ();
+      t = (lthread_t*)current_process;
+      c->sender = t;
+      c->nbatch++;
+      while (i < n && !c->qr.hd && Abs (c->sendid - c->recvid) != c->slack) {
+	CH_NOTE_SEND (c, t->time);
+	delay = Abs(c->sendid - c->recvid)*c->overhead + c->fifodelay;
+	id = c->sendid % (c->slack+1);
+	id2 = (c->sendid+1) % (c->slack+1);
+	bcopy ((char *)msgs + i*c->sz, (char *)c->msgbuf + id*c->sz, c->sz);
+	t->time = time_max (t->time, c->tm[id2]);
+	c->tm[id] = t->time + delay;
+	c->sendid++;
+	i++;
+      }
+      context_enable ();
+      if (i == n) break;
+    }
+    ch_send (c, (char *)msgs + i*c->sz);
+    i++;
+  }
+  return n;
+}
+
+int ch_recv_n (ch_t *c, void *msgs, int n)
+{
+  lthread_t *t;
+  int i, id;
+
+  i = 0;
+  while (i < n) {
+    if (!channel_timing) {
+      context_disable ();
+      t = (lthread_t*)current_process;
+      c->receiver = t;
+      c->nbatch++;
+      while (i < n && !c->qs.hd && c->sendid != c->recvid) {
+	c->nrecv++;
+	id = c->recvid % (1+c->slack);
+	bcopy ((char *)c->msgbuf + id*c->sz, (char *)msgs + i*c->sz, c->sz);
+	t->time = time_max (t->time, c->tm[id]);
+	c->tm[id] = t->time;
+	c->recvid++;
+	i++;
+      }
+      context_enable ();
+      if (i == n) break;
+    }
+    ch_recv (c, (char *)msgs + i*c->sz);
+    i++;
+  }
+  return n;
+}
+
+
 void ch_dump_time (ch_t *c, char *type)
 {
   lthread_t *t = (lthread_t*)current_process;
@@ -727,6 +843,7 @@ static void _ch_tsend (ch_t *c, void *msg)
   int dumped = 0;
 
   context_disable ();
+  CH_NOTE_SEND (c, ((lthread_t*)current_process)->time);
 
   delay = Abs(c->sendid - c->recvid)*c->overhead + c->fifodelay;
 
@@ -756,6 +873,7 @@ static void _ch_tsend (ch_t *c, void *msg)
     c->sendid++;
   }
   else if (Abs (c->sendid - c->recvid) == c->slack) {
+    c->sblock++;
     q_ins (c->qs.hd, c->qs.tl, current_process);
     DO_SELECTION (c);
 
@@ -802,6 +920,7 @@ static void _ch_trecv (ch_t *c, void *msg)
   int dumped = 0;
   
   context_disable ();
+  c->nrecv++;
 
   dump_time (c, "ER");
 
@@ -829,6 +948,7 @@ static void _ch_trecv (ch_t *c, void *msg)
     c->recvid++;
   }
   else if (c->sendid == c->recvid) {
+    c->rblock++;
     q_ins (c->qr.hd, c->qr.tl, current_process);
     DO_SELECTION (c);
     context_switch (context_select ());
@@ -57,6 +57,12 @@ typedef struct chan {
   struct {
     struct selection_stmt *hd, *tl;
   } ss;				/* select suspension */
+
+  /* statistics */
+  unsigned long nsend, nrecv;	/* messages sent/received */
+  unsigned long sblock, rblock;	/* sends/receives that suspended */
+  unsigned long nbatch;		/* batched calls */
+  Time_t tfirst, tlast;		/* time of first and last send */
 } ch_t;
 
 typedef struct selection_stmt {
@@ -77,7 +83,16 @@ int ch_rprobe (ch_t *c);
 
 #define ch_free(c) _ch_free(c,__FILE__,__LINE__)
 
+  /* batched send/receive of n messages of size c->sz to/from a
+     contiguous caller-owned buffer. Messages that fit in the channel
+     slack are transferred without a context switch. */
+int ch_send_n (ch_t *c, void *msgs, int n);
+int ch_recv_n (ch_t *c, void *msgs, int n);
+
 void ch_trace (FILE *fp);
+void ch_stats (FILE *fp, ch_t *c);
+  /* print message counts and throughput for a channel; with ch_trace
+     enabled this is also printed when the channel is freed */
 
   /* selections */
 void ch_clearsel (selqueue_t *q);
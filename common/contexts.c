@@ -23,7 +23,9 @@
  */
 #include <stdio.h>
 #include <signal.h>
+#include <unistd.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include "contexts.h"
 
 struct process_record {
@@ -214,12 +216,114 @@ void context_disable (void)
  *
  *------------------------------------------------------------------------
  */
+#ifdef CONTEXT_ASM
+
+/*
+ * _context_swap (void **save_sp, void *new_sp)
+ *
+ *   Push the callee-saved registers on the current stack, store the
+ *   stack pointer in *save_sp, switch to new_sp, and pop the
+ *   callee-saved registers saved there. The frame layout must match
+ *   the one built by context_init().
+ */
+void _context_swap (void **save_sp, void *new_sp);
+
+#if defined(__x86_64__)
+
+/* frame: mxcsr/x87 cw, r15, r14, r13, r12, rbx, rbp, return address */
+#define SWAP_FRAME_SIZE (8*8)
+
+__asm__ (
+  ".text\n"
+  ".globl _context_swap\n"
+  ".type _context_swap,@function\n"
+  "_context_swap:\n"
+  "  pushq %rbp\n"
+  "  pushq %rbx\n"
+  "  pushq %r12\n"
+  "  pushq %r13\n"
+  "  pushq %r14\n"
+  "  pushq %r15\n"
+  "  subq $8,%rsp\n"
+  "  stmxcsr (%rsp)\n"
+  "  fnstcw 4(%rsp)\n"
+  "  movq %rsp,(%rdi)\n"
+  "  movq %rsi,%rsp\n"
+  "  ldmxcsr (%rsp)\n"
+  "  fldcw 4(%rsp)\n"
+  "  addq $8,%rsp\n"
+  "  popq %r15\n"
+  "  popq %r14\n"
+  "  popq %r13\n"
+  "  popq %r12\n"
+  "  popq %rbx\n"
+  "  popq %rbp\n"
+  "  ret\n"
+  ".size _context_swap,.-_context_swap\n"
+);
+
+#elif defined(__aarch64__)
+
+/* frame: x19-x28, x29 (fp), x30 (lr), d8-d15, padding */
+#define SWAP_FRAME_SIZE (22*8)
+
+__asm__ (
+  ".text\n"
+  ".globl _context_swap\n"
+  ".type _context_swap,%function\n"
+  "_context_swap:\n"
+  "  sub sp, sp, #176\n"
+  "  stp x19, x20, [sp, #0]\n"
+  "  stp x21, x22, [sp, #16]\n"
+  "  stp x23, x24, [sp, #32]\n"
+  "  stp x25, x26, [sp, #48]\n"
+  "  stp x27, x28, [sp, #64]\n"
+  "  stp x29, x30, [sp, #80]\n"
+  "  stp d8, d9, [sp, #96]\n"
+  "  stp d10, d11, [sp, #112]\n"
+  "  stp d12, d13, [sp, #128]\n"
+  "  stp d14, d15, [sp, #144]\n"
+  "  mov x2, sp\n"
+  "  str x2, [x0]\n"
+  "  mov sp, x1\n"
+  "  ldp x19, x20, [sp, #0]\n"
+  "  ldp x21, x22, [sp, #16]\n"
+  "  ldp x23, x24, [sp, #32]\n"
+  "  ldp x25, x26, [sp, #48]\n"
+  "  ldp x27, x28, [sp, #64]\n"
+  "  ldp x29, x30, [sp, #80]\n"
+  "  ldp d8, d9, [sp, #96]\n"
+  "  ldp d10, d11, [sp, #112]\n"
+  "  ldp d12, d13, [sp, #128]\n"
+  "  ldp d14, d15, [sp, #144]\n"
+  "  add sp, sp, #176\n"
+  "  ret\n"
+  ".size _context_swap,.-_context_swap\n"
+);
+
+#endif
+
+#endif /* CONTEXT_ASM */
+
 void context_switch (process_t *p)
 {
+#ifdef CONTEXT_ASM
+  static void *main_sp;		/* never resumed */
+  process_t *old = current_process;
+
+  current_process = p;
+  if (!old) {
+    _context_swap (&main_sp, p->c.sp);
+  }
+  else if (old != p) {
+    _context_swap (&old->c.sp, p->c.sp);
+  }
+#else
   if (!current_process || !_setjmp (current_process->c.buf)) {
     current_process = p;
     _longjmp (p->c.buf,1);
   }
+#endif
   if (terminated_process) {
     context_destroy (terminated_process);
     terminated_process = NULL;
@@ -283,6 +387,129 @@ void context_exit (void)
   context_switch (context_select ());
 }
 
+#ifdef CONTEXT_MMAP_STACK
+/*------------------------------------------------------------------------
+ *
+ *  Thread stacks: carved out of large mmap'ed slabs, with a PROT_NONE
+ *  guard page at the low end of each stack so a stack overflow faults
+ *  instead of corrupting the neighbor. MAP_NORESERVE means only the
+ *  pages actually touched are committed, so stacks grow lazily.
+ *
+ *  Each guard page splits the mapping, and the kernel limits the
+ *  number of mappings per process (vm.max_map_count). Guard pages are
+ *  only added while within a budget derived from that limit; stacks
+ *  beyond it are unguarded, which lets us create millions of threads.
+ *
+ *  Freed stacks are returned to the kernel with madvise() and kept on
+ *  a free list for reuse by a stack of the same size.
+ *
+ *------------------------------------------------------------------------
+ */
+#define STACKS_PER_SLAB 64
+
+struct free_stack {
+  struct free_stack *next;
+  size_t len;
+};
+
+static struct free_stack *stack_freeq = NULL;
+static char *slab_next = NULL;	/* next free stack in the current slab */
+static size_t slab_stride = 0;	/* stack + guard size for the slab */
+static int slab_left = 0;	/* stacks left in the current slab */
+static long guard_budget = -1;	/* guard pages we are allowed to add */
+
+static size_t _stack_round (int sz, size_t *pg)
+{
+  static size_t pagesz = 0;
+
+  if (pagesz == 0) {
+    pagesz = sysconf (_SC_PAGESIZE);
+  }
+  *pg = pagesz;
+  return ((size_t)sz + pagesz - 1) & ~(pagesz - 1);
+}
+
+static void _init_guard_budget (void)
+{
+  FILE *fp;
+  long max = 0;
+
+  fp = fopen ("/proc/sys/vm/max_map_count", "r");
+  if (fp) {
+    if (fscanf (fp, "%ld", &max) != 1) {
+      max = 0;
+    }
+    fclose (fp);
+  }
+  if (max <= 0) {
+    max = 65530;
+  }
+  /* each guard page costs up to two mappings; leave half the limit for
+     everything else */
+  guard_budget = max/4;
+}
+
+char *context_stack_alloc (int sz)
+{
+  struct free_stack *f, *prev;
+  size_t len, pg;
+  char *m;
+
+  len = _stack_round (sz, &pg);
+
+  prev = NULL;
+  for (f = stack_freeq; f; f = f->next) {
+    if (f->len == len) {
+      if (prev) {
+	prev->next = f->next;
+      }
+      else {
+	stack_freeq = f->next;
+      }
+      return (char *)f;
+    }
+    prev = f;
+  }
+
+  if (slab_left == 0 || slab_stride != len + pg) {
+    m = (char *) mmap (NULL, STACKS_PER_SLAB*(len + pg),
+		       PROT_READ|PROT_WRITE,
+		       MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (m == (char *)MAP_FAILED) {
+      return NULL;
+    }
+    slab_next = m;
+    slab_stride = len + pg;
+    slab_left = STACKS_PER_SLAB;
+  }
+  m = slab_next;
+  slab_next += slab_stride;
+  slab_left--;
+
+  if (guard_budget < 0) {
+    _init_guard_budget ();
+  }
+  if (guard_budget > 0 && mprotect (m, pg, PROT_NONE) == 0) {
+    guard_budget--;
+  }
+  return m + pg;
+}
+
+void context_stack_free (char *stack, int sz)
+{
+  struct free_stack *f;
+  size_t len, pg;
+
+  if (!stack) return;
+  len = _stack_round (sz, &pg);
+  madvise (stack, len, MADV_DONTNEED);
+  f = (struct free_stack *)stack;
+  f->len = len;
+  f->next = stack_freeq;
+  stack_freeq = f;
+}
+#endif /* CONTEXT_MMAP_STACK */
+
 /*
  * Crazy Ubuntu jmpbuf encoder/decoder functions
  */
@@ -357,7 +584,9 @@ void context_init (process_t *p, void (*f)(void))
   stack = p->c.stack;
   n = p->c.sz;
 
+#ifndef CONTEXT_ASM
   _setjmp (p->c.buf);
+#endif
 
 #if 0
   printf ("%llx context_init, %llx stack\n", (unsigned long long)context_init, 
@@ -375,7 +604,38 @@ void context_init (process_t *p, void (*f)(void))
   p->c.interrupted = 0;
 #endif
 
-#if defined(__sparc__) && !defined(__svr4__)
+#if defined(CONTEXT_ASM)
+
+#define INIT_SP(p) (unsigned long)((char*)(p)->c.stack + (p)->c.sz)
+#define CURR_SP(p) (unsigned long)(p)->c.sp
+#define SET_CURR_SP(p,v) ((p)->c.sp = (void *)(v))
+
+  /* build an initial frame for _context_swap that "returns" into
+     context_stub with an ABI-aligned stack */
+  {
+    unsigned long *sp;
+    unsigned long top = ((unsigned long)stack + n) & ~15UL;
+
+#if defined(__x86_64__)
+    /* rsp must be 8 mod 16 on function entry: leave a fake return
+       address slot above context_stub */
+    sp = (unsigned long *)(top - SWAP_FRAME_SIZE - 8);
+    for (i=0; i < SWAP_FRAME_SIZE/8 + 1; i++) {
+      sp[i] = 0;
+    }
+    sp[0] = 0x1f80UL | (0x037fUL << 32); /* default mxcsr, x87 cw */
+    sp[7] = (unsigned long)context_stub;
+#elif defined(__aarch64__)
+    sp = (unsigned long *)(top - SWAP_FRAME_SIZE);
+    for (i=0; i < SWAP_FRAME_SIZE/8; i++) {
+      sp[i] = 0;
+    }
+    sp[11] = (unsigned long)context_stub; /* x30 */
+#endif
+    p->c.sp = sp;
+  }
+
+#elif defined(__sparc__) && !defined(__svr4__)
 
 #define INIT_SP(p) (int)((double*)(p)->c.stack + (p)->c.sz/sizeof(double)-11)
 #define CURR_SP(p) (p)->c.buf[2]
@@ -436,7 +696,8 @@ void context_init (process_t *p, void (*f)(void))
 #define SET_CURR_SP(p,v) (p)->c.buf[0].__jmpbuf[6] = EncodeJBRHEL((unsigned long long)v)
 
   p->c.buf[0].__jmpbuf[7] = EncodeJBRHEL((unsigned long long)context_stub);
-  SET_CURR_SP(p,((unsigned long long)((char*)stack+n-8)));
+  /* rsp must be 8 mod 16 on function entry */
+  SET_CURR_SP(p,((((unsigned long long)((char*)stack+n)) & ~15ULL) - 8));
 
 #else
 
@@ -38,6 +38,27 @@
 #define LARGE_STACK_SIZE (0x1000 * 16)
 #endif
 
+/*
+ * Context switch backend.
+ *
+ *  CONTEXT_ASM: hand-written register save/restore (x86-64 and aarch64
+ *  on Linux). This is the default on those platforms; define
+ *  CONTEXT_SETJMP to force the portable setjmp/longjmp backend.
+ *
+ *  CONTEXT_MMAP_STACK: thread stacks are allocated with mmap() with a
+ *  guard page below the stack. Pages are only committed when touched,
+ *  so large numbers of threads only pay for the stack they use. Define
+ *  CONTEXT_INLINE_STACK to keep the stack inside the process record.
+ */
+#if !defined(CONTEXT_SETJMP) && defined(__linux__) && \
+    (defined(__x86_64__) || defined(__aarch64__))
+#define CONTEXT_ASM
+#endif
+
+#ifndef CONTEXT_INLINE_STACK
+#define CONTEXT_MMAP_STACK
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -68,6 +89,9 @@ typedef struct process_record process_t;
  */
 typedef struct {
   jmp_buf buf;			/* state  */
+#ifdef CONTEXT_ASM
+  void *sp;			/* saved stack pointer */
+#endif
   char *stack;			/* stack  */
   int sz;			/* stack size */
   void (*start) ();		/* entry point */
@@ -166,6 +190,15 @@ extern void context_set_timer (process_t *p);
  */
 extern void context_destroy (process_t *);
 
+/*
+ * Allocate/free a thread stack of "sz" bytes, with a guard page
+ * below it. Only available with CONTEXT_MMAP_STACK.
+ */
+#ifdef CONTEXT_MMAP_STACK
+extern char *context_stack_alloc (int sz);
+extern void context_stack_free (char *stack, int sz);
+#endif
+
 /*
  *  Save context to file. Modifies stack state. NEVER call this function
  *  when p == current_process.
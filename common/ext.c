@@ -22,11 +22,13 @@
  **************************************************************************
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <pwd.h>
 #include <ctype.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "ext.h"
-#include "lex.h"
 #include "config.h"
 #include "hash.h"
 #include "misc.h"
@@ -186,16 +188,8 @@ void read_dotmagic (char *file)
 }
 
 
-static
-FILE *mag_path_open (const char *name, FILE **dumpfile)
+static void mag_path_init (void)
 {
-  struct pathlist *p;
-  char *file, *try;
-  FILE *fp;
-
-  if (dumpfile) {
-    *dumpfile = NULL;
-  }
   if (path_first_time) {
     addpath(Strdup("\".\""), 0);
     read_dotmagic (Strdup("~cad/lib/magic/sys/.magicrc"));
@@ -203,6 +197,22 @@ FILE *mag_path_open (const char *name, FILE **dumpfile)
     read_dotmagic (Strdup(".magicrc"));
   }
   path_first_time = 0;
+}
+
+static pthread_mutex_t path_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Return the path to cell "name" along the magic search path, or NULL
+ * if it can't be found. The result must be freed by the caller.
+ */
+static char *mag_path_find (const char *name)
+{
+  struct pathlist *p;
+  char *file, *try;
+  FILE *fp;
+
+  pthread_mutex_lock (&path_lock);
+  mag_path_init ();
   p = hd;
 
   while (p) {
@@ -215,99 +225,307 @@ FILE *mag_path_open (const char *name, FILE **dumpfile)
 
     fp = fopen (try, "r");
     if (fp) {
-      if (dumpfile) {
-	sprintf (try + strlen (try) - 3, "hxt");
-	*dumpfile = fopen (try, "r");
-      }
-      FREE (try);
-      return fp; 
+      fclose (fp);
+      pthread_mutex_unlock (&path_lock);
+      return try;
     }
     strcat (try, ".ext");
     fp = fopen (try, "r");
     if (fp) {
-      if (dumpfile) {
-	sprintf (try + strlen(try)-3, "hxt");
-	*dumpfile = fopen (try, "r");
-      }
-      FREE (try);
-      return fp;
+      fclose (fp);
+      pthread_mutex_unlock (&path_lock);
+      return try;
     }
     FREE (try);
     p = p->next;
   }
-  fatal_error ("Could not find cell %s", name);
+  pthread_mutex_unlock (&path_lock);
   return NULL;
 }
 
+static
+FILE *mag_path_open (const char *name, FILE **dumpfile)
+{
+  char *try;
+  FILE *fp;
 
-/*
+  if (dumpfile) {
+    *dumpfile = NULL;
+  }
+  try = mag_path_find (name);
+  if (!try || !(fp = fopen (try, "r"))) {
+    fatal_error ("Could not find cell %s", name);
+  }
+  if (dumpfile) {
+    sprintf (try + strlen (try) - 3, "hxt");
+    *dumpfile = fopen (try, "r");
+  }
+  FREE (try);
+  return fp;
+}
+
+/*------------------------------------------------------------------------
  *
- * Mixed integer/floating-point
+ *  ext_locate --
  *
+ *    Return the path to the extract file for cell "name" using the
+ *    same search path as ext_read(), or NULL if it can't be found.
+ *    The result is allocated, and must be freed by the caller.
+ *
+ *------------------------------------------------------------------------
  */
-static
-double lex_mustbe_number (LEX_T *L)
+char *ext_locate (const char *name)
+{
+  struct pathlist *p;
+  char *file, *try;
+  FILE *fp;
+
+  if ((fp = fopen (name, "r"))) {
+    fclose (fp);
+    return Strdup (name);
+  }
+  mag_path_init ();
+  for (p = hd; p; p = p->next) {
+    MALLOC (file, char, strlen (p->path)+strlen(name)+6);
+    strcpy (file, p->path);
+    strcat (file, "/");
+    strcat (file, name);
+    try = expand (file);
+    FREE (file);
+    if ((fp = fopen (try, "r"))) {
+      fclose (fp);
+      return try;
+    }
+    FREE (try);
+  }
+  return NULL;
+}
+
+
+/*------------------------------------------------------------------------
+ *
+ *  Reader state
+ *
+ *    Extract files are read by a small pool of threads. Each cell is
+ *    parsed by exactly one thread into its own struct ext_file. The
+ *    shared state is the table of cells and the work queue (both
+ *    protected by ext_lock), and the table of node names. Node names
+ *    are interned once for all cells and never freed; fets, caps,
+ *    aliases and the like are carved out of per-thread pools, so a
+ *    cell's records sit next to each other in memory.
+ *
+ *------------------------------------------------------------------------
+ */
+#define EXT_HASH_INIT  14695981039346656037UL
+#define EXT_HASH_MULT  1099511628211UL
+
+static unsigned long _ext_hash_mix (unsigned long h, const char *s)
 {
-  double x, y;
-  x = lex_integer (L);
-  y = lex_real (L);
-  if (lex_have (L, l_integer))
-    return x;
-  else if (lex_have (L, l_real))
-    return y;
-  else
-    fatal_error ("Expected number.");
-  return 0;
+  while (*s) {
+    h ^= (unsigned char)*s;
+    h *= EXT_HASH_MULT;
+    s++;
+  }
+  return h;
 }
 
-static
-char *lex_mustbe_string_id (LEX_T *L, const char *name, int line)
+#define EXT_NSTRIPE 64
+#define EXT_POOL_SIZE 65536
+
+static int use_summaries = 1;	/* read .hxt summaries in ext_read() */
+static int names_init = 0;
+static struct Hashtable *names[EXT_NSTRIPE];
+static pthread_mutex_t names_lock[EXT_NSTRIPE];
+
+struct ext_pool {
+  char *buf;
+  int left;
+};
+
+struct ext_reader {
+  struct ext_file *ext;
+  const char *name;		/* file being read */
+  int line;			/* current line */
+  char *s;			/* current position in the line */
+  struct ext_pool *pool;
+};
+
+static char *ext_intern (const char *s)
 {
-  char *s;
-  if (lex_have (L, l_id)) {
-    return lex_prev (L);
+  hash_bucket_t *b;
+  int i;
+
+  /* not hash_function(): the stripe tables use that, and must see
+     different bits than the stripe index */
+  i = _ext_hash_mix (EXT_HASH_INIT, s) & (EXT_NSTRIPE-1);
+  pthread_mutex_lock (&names_lock[i]);
+  b = hash_lookup (names[i], s);
+  if (!b) {
+    b = hash_add (names[i], s);
   }
-  else if (lex_have (L, l_string)) {
-    s = lex_prev (L);
-    s[strlen(s)-1] = '\0';
-    return s+1;
+  pthread_mutex_unlock (&names_lock[i]);
+  return b->key;
+}
+
+static void *_pool_alloc (struct ext_pool *p, int sz)
+{
+  char *ret;
+
+  sz = (sz + 7) & ~7;
+  if (sz > EXT_POOL_SIZE/4) {
+    MALLOC (ret, char, sz);
+    return ret;
   }
-  else {
-    fatal_error ("Error in file %s:%d, expected string/id.", name, line);
+  if (p->left < sz) {
+    MALLOC (p->buf, char, EXT_POOL_SIZE);
+    p->left = EXT_POOL_SIZE;
+  }
+  ret = p->buf;
+  p->buf += sz;
+  p->left -= sz;
+  return ret;
+}
+
+#define POOL_NEW(p,type) ((type *) _pool_alloc ((p), sizeof (type)))
+
+/*
+ *
+ * Fields: whitespace-separated, with quoted strings kept together
+ *
+ */
+static
+char *_field (struct ext_reader *R)
+{
+  char *s, *ret;
+  int q = 0;
+
+  s = R->s;
+  while (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n')
+    s++;
+  if (!*s) {
+    R->s = s;
     return NULL;
   }
+  ret = s;
+  while (*s && (q || (*s != ' ' && *s != '\t' && *s != '\r' && *s != '\n'))) {
+    if (*s == '"') q = !q;
+    s++;
+  }
+  if (*s) {
+    *s = '\0';
+    s++;
+  }
+  R->s = s;
+  return ret;
+}
+
+static
+char *_unquote (char *s)
+{
+  char *t, *u;
+
+  for (t = u = s; *t; t++)
+    if (*t != '"')
+      *u++ = *t;
+  *u = '\0';
+  return s;
 }
 
 static
-char *lex_shouldbe_string_id (LEX_T *L)
+char *_field_id (struct ext_reader *R)
 {
   char *s;
-  if (lex_have (L, l_id)) {
-    return lex_prev (L);
-  }
-  else if (lex_have (L, l_string)) {
-    s = lex_prev (L);
-    s[strlen(s)-1] = '\0';
-    return s+1;
+
+  if (!(s = _field (R))) {
+    fatal_error ("Error in file %s:%d, expected string/id.", R->name, R->line);
   }
-  else
-    return NULL;
+  return _unquote (s);
 }
 
+/*
+ * Numbers in .ext files are almost always short plain decimals. Those
+ * are converted as (integer mantissa)/10^k, which is exact in the
+ * same cases strtod() is; everything else falls back to strtod().
+ */
+static const double ext_pow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+  1e13, 1e14, 1e15
+};
 
 static
-void lex_mustbe_string_contiguous_id (LEX_T *L)
+double _field_num (struct ext_reader *R)
 {
-  if (lex_have (L, l_string)) {
-    ;
+  char *s, *t;
+  unsigned long m;
+  int digits, frac;
+  double x;
+
+  s = _field (R);
+  if (!s) {
+    fatal_error ("Error in file %s:%d, expected number.", R->name, R->line);
   }
-  else if (lex_have (L, l_id)) {
-    while (lex_whitespace (L)[0] == '\0' && !lex_eof (L)) {
-      lex_getsym (L);
+  t = s;
+  if (*t == '-') t++;
+  m = 0;
+  digits = 0;
+  frac = -1;
+  while (digits < 16) {
+    if (*t >= '0' && *t <= '9') {
+      m = m*10 + (*t - '0');
+      digits++;
+      if (frac >= 0) frac++;
+    }
+    else if (*t == '.' && frac < 0) {
+      frac = 0;
+    }
+    else {
+      break;
     }
+    t++;
+  }
+  if (!*t && digits > 0 && digits < 16) {
+    x = (double)m;
+    if (frac > 0) x /= ext_pow10[frac];
+    return (*s == '-') ? -x : x;
   }
-  else 
-    fatal_error ("Error in file, expected string or id");
+  x = strtod (s, &t);
+  if (*t) {
+    fatal_error ("Error in file %s:%d, expected number.", R->name, R->line);
+  }
+  return x;
+}
+
+/* skip a field whose value is not used */
+static
+void _field_skip (struct ext_reader *R)
+{
+  if (!_field (R)) {
+    fatal_error ("Error in file %s:%d, line too short.", R->name, R->line);
+  }
+}
+
+/*
+ * Terminal attribute list: either "0" or a comma-separated list of
+ * strings. Returns 1 if "weak" is one of them.
+ */
+static
+int _field_attrs (struct ext_reader *R)
+{
+  char *s, *t, *save;
+  int weak = 0;
+  int more;
+
+  s = _field (R);
+  if (!s || strcmp (s, "0") == 0)
+    return 0;
+  do {
+    more = (s[strlen(s)-1] == ',');
+    for (t = strtok_r (s, ",", &save); t; t = strtok_r (NULL, ",", &save)) {
+      if (strcmp (t, "\"weak\"") == 0)
+	weak = 1;
+    }
+  } while (more && (s = _field (R)));
+  return weak;
 }
 
 
@@ -334,37 +552,38 @@ char *getint (char *s, int *i)
  *------------------------------------------------------------------------
  */
 static
-void addcap (struct ext_file *ext, char *a, char *b, double cap, int type)
+void addcap (struct ext_reader *R, char *a, char *b, double cap, int type)
 {
   struct ext_cap *c;
-  MALLOC (c, struct ext_cap, 1);
+  c = POOL_NEW (R->pool, struct ext_cap);
   c->type = type;
   c->cap = cap*1e-18;		/* capacitance in aF; convert to F */
   c->n1 = a;
   c->n2 = b;
-  c->next = ext->cap;
-  ext->cap = c;
+  c->next = R->ext->cap;
+  R->ext->cap = c;
 }
 
-struct ext_ap *add_ap_empty (struct ext_file *ext, char *s)
+static
+struct ext_ap *add_ap_empty (struct ext_reader *R, char *s)
 {
   struct ext_ap *a;
-  MALLOC (a, struct ext_ap, 1);
+  a = POOL_NEW (R->pool, struct ext_ap);
   a->node = s;
   a->perim = NULL;
   a->area = NULL;
-  a->next = ext->ap;
-  ext->ap = a;
+  a->next = R->ext->ap;
+  R->ext->ap = a;
 
   return a;
 }
 
 static
-void addattr (struct ext_file *ext, char *n, char *attr)
+void addattr (struct ext_reader *R, char *n, char *attr)
 {
   struct ext_attr *a;
   
-  MALLOC (a, struct ext_attr, 1);
+  a = POOL_NEW (R->pool, struct ext_attr);
   a->n = n;
   a->attr = 0;
   if (strcmp (attr, "pchg") == 0) {
@@ -385,22 +604,36 @@ void addattr (struct ext_file *ext, char *n, char *attr)
   else if (strcmp (attr, "voltage_converter") == 0) {
     a->attr |= EXT_ATTR_VC;
   }
-  a->next = ext->attr;
-  ext->attr = a;
+  a->next = R->ext->attr;
+  R->ext->attr = a;
+}
+
+static
+void addalias (struct ext_reader *R, char *a, char *b, double cap)
+{
+  struct ext_alias *alias;
+
+  alias = POOL_NEW (R->pool, struct ext_alias);
+  alias->n1 = ext_intern (a);
+  alias->n2 = ext_intern (b);
+  alias->next = R->ext->aliases;
+  R->ext->aliases = alias;
+  if (cap != 0) 
+    addcap (R, alias->n1, alias->n2, cap, CAP_CORRECT);
 }
 
 /*------------------------------------------------------------------------
  *
- *  Expands alias lists out
+ *  Expands alias lists out. The strings a and b are modified.
  *
  *------------------------------------------------------------------------
  */
 static
-void expand_aliases (char *a, char *b, struct ext_file *ext, double cap)
+void expand_aliases (struct ext_reader *R, char *a, char *b, double cap)
 {
   char *s, *t;
-  struct ext_alias *alias;
   char *sta, *stb;
+  char *na, *nb;
   int i, j;
   int xrange, yrange;
   int xloa, yloa, xlob, ylob;
@@ -415,13 +648,7 @@ void expand_aliases (char *a, char *b, struct ext_file *ext, double cap)
   t = b;
   while (*t && *t != '[') t++;
   if (!*s || !*t) {
-    MALLOC (alias, struct ext_alias, 1);
-    alias->n1 = Strdup(a);
-    alias->n2 = Strdup(b);
-    alias->next = ext->aliases;
-    ext->aliases = alias;
-    if (cap != 0) 
-      addcap (ext,Strdup(alias->n1), Strdup(alias->n2), cap, CAP_CORRECT);
+    addalias (R, a, b, cap);
   }
   else {
     sta = s+1;
@@ -454,16 +681,7 @@ void expand_aliases (char *a, char *b, struct ext_file *ext, double cap)
     if (xrange == 0 && yrange <= 0) {
       *(sta-1) = '[';
       *(stb-1) = '[';
-      MALLOC (alias, struct ext_alias, 1);
-      alias->n1 = Strdup(a);
-      alias->n2 = Strdup(b);
-      alias->next = ext->aliases;
-      ext->aliases = alias;
-      if (cap != 0) 
-	addcap (ext,
-		Strdup(alias->n1), Strdup(alias->n2), cap, CAP_CORRECT);
-      FREE (a);
-      FREE (b);
+      addalias (R, a, b, cap);
       return;
     }
     if (xrange == 0) xrange = 1;
@@ -504,37 +722,25 @@ void expand_aliases (char *a, char *b, struct ext_file *ext, double cap)
       fatal_error ("Error on merge line");
     t++;
 
+    MALLOC (na, char, lena);
+    MALLOC (nb, char, lenb);
     if (yrange == 0)
       for (i = 0; i < xrange; i++) {
-	MALLOC (alias, struct ext_alias, 1);
-	MALLOC (alias->n1, char, lena);
-	sprintf (alias->n1, "%s[%d]%s", a, xloa+i, s);
-	MALLOC (alias->n2, char, lenb);
-	sprintf (alias->n2, "%s[%d]%s", b, xlob+i, t);
-	alias->next = ext->aliases;
-	ext->aliases = alias;
-	if (cap != 0) 
-	  addcap (ext,
-		  Strdup(alias->n1), Strdup(alias->n2), cap, CAP_CORRECT);
+	sprintf (na, "%s[%d]%s", a, xloa+i, s);
+	sprintf (nb, "%s[%d]%s", b, xlob+i, t);
+	addalias (R, na, nb, cap);
       }
     else {
       for (i=0; i < xrange; i++)
 	for (j=0; j < yrange; j++) {
-	  MALLOC (alias, struct ext_alias, 1);
-	  MALLOC (alias->n1, char, lena);
-	  sprintf (alias->n1, "%s[%d,%d]%s", a, xloa+i, yloa+j, s);
-	  MALLOC (alias->n2, char, lenb);
-	  sprintf (alias->n2, "%s[%d,%d]%s", b, xlob+i, ylob+j, t);
-	  alias->next = ext->aliases;
-	  ext->aliases = alias;
-	  if (cap != 0) 
-	    addcap (ext,
-		    Strdup(alias->n1), Strdup(alias->n2), cap,CAP_CORRECT);
+	  sprintf (na, "%s[%d,%d]%s", a, xloa+i, yloa+j, s);
+	  sprintf (nb, "%s[%d,%d]%s", b, xlob+i, ylob+j, t);
+	  addalias (R, na, nb, cap);
 	}
     }
+    FREE (na);
+    FREE (nb);
   }
-  FREE (a);
-  FREE (b);
 }
 
 
@@ -580,6 +786,205 @@ void _check_ext_timestamp (FILE *fp, unsigned long tm)
 }
 
 
+/*------------------------------------------------------------------------
+ *
+ *  Content hashes
+ *
+ *    The content hash of a cell covers every line of its .ext file
+ *    except the timestamp, the content hashes of all its subcells, the
+ *    input file next to the .ext file named by ext_hash_inputs() (if
+ *    any), and the option string set by the tool that uses the
+ *    summary. The file is found the same way ext_read() finds it. A .hxt
+ *    summary that records a content hash stays valid as long as the
+ *    hash matches, regardless of timestamps; so re-extracting a cell
+ *    that did not change doesn't force it to be checked again, while
+ *    a change anywhere below a cell does.
+ *
+ *------------------------------------------------------------------------
+ */
+static struct Hashtable *chash = NULL;
+static pthread_mutex_t chash_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long hash_salt = 0;
+static char *hash_input = NULL;
+
+/*
+ * Fold the input file with suffix hash_input that sits next to the
+ * extract file "path" into h
+ */
+static unsigned long _ext_hash_input (unsigned long h, const char *path)
+{
+  char buf[MAXLINE];
+  char *file;
+  FILE *fp;
+  int len;
+
+  len = strlen (path);
+  if (!hash_input || len < 4 || strcmp (path + len - 4, ".ext") != 0) {
+    return h;
+  }
+  MALLOC (file, char, len - 3 + strlen (hash_input) + 1);
+  strcpy (file, path);
+  strcpy (file + len - 3, hash_input);
+  fp = fopen (file, "r");
+  FREE (file);
+  if (!fp) {
+    return _ext_hash_mix (h, "-noinput-");
+  }
+  h = _ext_hash_mix (h, "-input-");
+  while (fgets (buf, MAXLINE, fp)) {
+    h = _ext_hash_mix (h, buf);
+  }
+  fclose (fp);
+  return h;
+}
+
+/*
+ * Content hash of cell "name". A top-level cell is looked for in the
+ * current directory first, like ext_read() does; subcells are only
+ * looked for along the search path.
+ */
+static unsigned long _ext_content_hash (const char *name, int top)
+{
+  FILE *fp;
+  char buf[MAXLINE];
+  char cell[MAXLINE];
+  char *s, *path;
+  unsigned long h;
+  hash_bucket_t *b;
+
+  path = NULL;
+  if (top && (fp = fopen (name, "r"))) {
+    /* resolved differently from a subcell of the same name: not
+       cached */
+    fclose (fp);
+    path = Strdup (name);
+  }
+  else {
+    /* chash_lock is only held around the table: subcells are hashed
+       without it, so the reader threads don't wait on each other */
+    top = 0;
+    pthread_mutex_lock (&chash_lock);
+    b = hash_lookup (chash, name);
+    if (b) {
+      h = (unsigned long) b->l;
+    }
+    pthread_mutex_unlock (&chash_lock);
+    if (b) {
+      return h;
+    }
+    path = mag_path_find (name);
+  }
+  if (!path || !(fp = fopen (path, "r"))) {
+    fatal_error ("Could not find cell %s", name);
+  }
+  h = EXT_HASH_INIT;
+  buf[MAXLINE-1] = '\n';
+  /* skip timestamp */
+  if (fgets (buf, MAXLINE, fp)) {
+    while (fgets (buf, MAXLINE, fp)) {
+      h = _ext_hash_mix (h, buf);
+      if (strncmp (buf, "use ", 4) == 0) {
+	strcpy (cell, buf+4);
+	for (s = cell; *s && *s != ' ' && *s != '\n'; s++)
+	  ;
+	strcpy (s, ".ext");
+	h ^= _ext_content_hash (cell, 0);
+	h *= EXT_HASH_MULT;
+      }
+    }
+  }
+  fclose (fp);
+  h = _ext_hash_input (h, path);
+  FREE (path);
+  if (top) {
+    return h;
+  }
+  pthread_mutex_lock (&chash_lock);
+  if (!hash_lookup (chash, name)) {
+    b = hash_add (chash, name);
+    b->l = (long) h;
+  }
+  pthread_mutex_unlock (&chash_lock);
+  return h;
+}
+
+/*------------------------------------------------------------------------
+ *
+ *  ext_hash_options --
+ *
+ *    Set the option string that is folded into every content hash.
+ *
+ *------------------------------------------------------------------------
+ */
+void ext_hash_options (const char *opts)
+{
+  hash_salt = _ext_hash_mix (EXT_HASH_INIT, opts);
+  if (chash) {
+    hash_free (chash);
+    chash = NULL;
+  }
+}
+
+/*------------------------------------------------------------------------
+ *
+ *  ext_hash_inputs --
+ *
+ *    The file with the given suffix next to a cell's .ext file (e.g.
+ *    its .prs file) is part of the cell's content hash.
+ *
+ *------------------------------------------------------------------------
+ */
+void ext_hash_inputs (const char *suffix)
+{
+  if (hash_input) {
+    FREE (hash_input);
+  }
+  hash_input = suffix ? Strdup (suffix) : NULL;
+  if (chash) {
+    hash_free (chash);
+    chash = NULL;
+  }
+}
+
+/*------------------------------------------------------------------------
+ *
+ *  ext_use_summaries --
+ *
+ *    If turned off, ext_read() reads every cell in full and ignores
+ *    its .hxt summary; ext_read_summary() can load it later.
+ *
+ *------------------------------------------------------------------------
+ */
+void ext_use_summaries (int use)
+{
+  use_summaries = use;
+}
+
+/*------------------------------------------------------------------------
+ *
+ *  ext_content_hash --
+ *
+ *    Return the content hash of cell "name", found the same way as
+ *    ext_read() finds its top-level cell
+ *
+ *------------------------------------------------------------------------
+ */
+static unsigned long _ext_salted_hash (const char *name, int top)
+{
+  pthread_mutex_lock (&chash_lock);
+  if (!chash) {
+    chash = hash_new (16);
+  }
+  pthread_mutex_unlock (&chash_lock);
+  return (_ext_content_hash (name, top) ^ hash_salt) * EXT_HASH_MULT;
+}
+
+unsigned long ext_content_hash (const char *name)
+{
+  return _ext_salted_hash (name, 1);
+}
+
+
 void
 ext_validate_timestamp (const char *file)
 {
@@ -604,185 +1009,327 @@ ext_validate_timestamp (const char *file)
 
 /*------------------------------------------------------------------------
  *
- *  Parse .ext file hierarchically
+ *  Read the rest of a file into memory
  *
  *------------------------------------------------------------------------
  */
-struct ext_file *ext_read (const char *name)
+static char *_ext_slurp (FILE *fp)
 {
-  FILE *fp, *dump;
-  static char buf[MAXLINE];
-  static char tok1[MAXLINE], tok2[MAXLINE];
-  struct ext_file *ext = NULL;
-  LEX_T *l;
-  struct ext_fets *fet;
-  struct ext_list *subcell;
-  int l_comma;
-  char *s, *t;
-  int line = 0;
-  unsigned long timestamp;
-  double cscale, rscale;
-  double lscale;
-  double x;
-  static int depth = 0;
-  static struct Hashtable *ehash;
-  hash_bucket_t *eb;
-
-  dump = NULL;
-  fp = NULL;
-  if (depth == 0) {
-    ehash = hash_new (2);
-    fp = fopen (name, "r");
+  char *buf;
+  size_t len, max, n;
+
+  max = 65536;
+  len = 0;
+  MALLOC (buf, char, max);
+  while ((n = fread (buf + len, 1, max - len - 1, fp)) > 0) {
+    len += n;
+    if (len == max - 1) {
+      max *= 2;
+      REALLOC (buf, char, max);
+    }
+  }
+  buf[len] = '\0';
+  return buf;
+}
 
-    if (!device_names) {
-      config_read ("extract.conf");
-      if (config_exists ("net.ext_devs")) {
-	num_devices = config_get_table_size ("net.ext_devs");
-	device_names = config_get_table_string ("net.ext_devs");
+/*------------------------------------------------------------------------
+ *
+ *  Read the .hxt summary for a cell. Returns 1 if the summary was
+ *  used, 0 if the .ext file has to be read instead. Closes dump.
+ *
+ *------------------------------------------------------------------------
+ */
+static int _ext_read_summary (struct ext_file *ext, const char *name,
+			      FILE *dump)
+{
+  char hdr[MAXLINE];
+  struct ext_reader R;
+  hash_bucket_t *b, *root;
+  struct hier_cell_val *hc;
+  unsigned long timestamp, hash;
+  char *buf, *s;
+  int line;
+
+  if (!fgets (hdr, MAXLINE, dump)) {
+    warning ("summary file for `%s' not used [empty]", name);
+    fclose (dump);
+    return 0;
+  }
+  if (strncmp (hdr, "timestamp ", 10) != 0) {
+    if (strncmp (hdr, "timestampF ", 11) != 0) {
+      fclose (dump);
+      warning ("summary file for `%s' not used [format err]", name);
+      return 0;
+    }
+    warning ("summary file for `%s' may have unconnected globals", name);
+  }
+  if (sscanf (hdr+11, "%lu hash %lx", &timestamp, &hash) == 2) {
+    /* content hash recorded: it supersedes the timestamp */
+    if (hash != _ext_salted_hash (name, 0)) {
+      fclose (dump);
+      warning ("summary file out-of-date for cell `%s'", name);
+      return 0;
+    }
+  }
+  else if (timestamp < ext->timestamp) {
+    fclose (dump);
+    warning ("summary file out-of-date for cell `%s'", name);
+    return 0;
+  }
+  buf = _ext_slurp (dump);
+  fclose (dump);
+
+  R.ext = ext;
+  R.name = name;
+  R.line = 1;
+  R.s = buf;
+  R.pool = NULL;
+
+  ext->h = hash_new (8);
+  line = 0;
+  root = NULL;
+  while ((s = _field (&R))) {
+    if (strcmp (s, "i") == 0 || strcmp (s, "o") == 0) {
+      line = (s[0] == 'i');
+      root = NULL;
+    }
+    else if (s[0] == '"') {
+      _unquote (s);
+      if (!hash_lookup (ext->h, s)) {
+	b = hash_add (ext->h, s);
+	NEW (hc, struct hier_cell_val);
+	b->v = hc;
+	hc->root = root;
+	hc->flags = line ? HIER_IS_INPUT : 0;
+	if (!root)
+	  root = b;
       }
     }
+    else {
+      fatal_error ("%s.hxt: near `%s'\n\t.hxt file corrupted!\n", name, s);
+    }
   }
+  FREE (buf);
+  return 1;
+}
+
+/*------------------------------------------------------------------------
+ *
+ *  Work queue for the reader threads
+ *
+ *------------------------------------------------------------------------
+ */
+struct ext_job {
+  struct ext_file *ext;
+  const char *name;
+  int top;
+  struct ext_job *next;
+};
+
+static pthread_mutex_t ext_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ext_cond = PTHREAD_COND_INITIALIZER;
+static struct ext_job *job_hd = NULL, *job_tl;
+static int job_busy = 0;
+static struct Hashtable *ehash;
+
+static void _ext_parse (struct ext_file *ext, const char *name, int top,
+			struct ext_pool *pool);
+
+/* caller holds ext_lock */
+static struct ext_file *_ext_schedule (const char *name, int top)
+{
+  hash_bucket_t *eb;
+  struct ext_file *ext;
+  struct ext_job *j;
 
   eb = hash_lookup (ehash, name);
   if (eb) {
     return (struct ext_file *)eb->v;
   }
   eb = hash_add (ehash, name);
-  
-  if (!fp) {
-    fp = mag_path_open (name, &dump);
-  }
-  if (!fp) {
-    fatal_error ("Could not find extract file for `%s'", name);
-  }
-  depth++;
-
-
-  l = lex_string ("boo");
-  l_comma = lex_addtoken (l, ",");
 
   MALLOC (ext, struct ext_file, 1);
   ext->fet = NULL;
   ext->subcells = NULL;
   ext->aliases = NULL;
   ext->mark = 0;
+  ext->timestamp = 0;
   ext->h = NULL;
   ext->cap = NULL;
   ext->attr = NULL;
   ext->ap = NULL;
   eb->v = ext;
 
-  buf[MAXLINE-1] = '\n';
-
-  if (fgets (buf, MAXLINE, fp)) {
-    /* first line in ext file is the timestamp */
-    l = lex_restring (l, buf);
-    lex_getsym (l);
-    lex_mustbe_keyw (l, "timestamp");
-    sscanf (buf+10, "%lu", &ext->timestamp);
+  NEW (j, struct ext_job);
+  j->ext = ext;
+  j->name = eb->key;
+  j->top = top;
+  j->next = NULL;
+  if (!job_hd) {
+    job_hd = j;
   }
   else {
-    fclose (fp);
-    if (dump) fclose (dump);
-    lex_free (l);
-    depth--;
-
-    if (depth == 0) {
-      hash_free (ehash);
-      ehash = NULL;
-    }
-    return ext;
-  }
-
-  if (dump) {
-    hash_bucket_t *b, *root;
-    struct hier_cell_val *hc;
-    if (fgets (buf, MAXLINE, dump)) {
-      l = lex_restring (l, buf);
-      lex_getsym (l);
-      if (!lex_have_keyw (l, "timestamp")) {
-	if (!lex_have_keyw (l, "timestampF")) {
-	  fclose (dump);
-	  warning ("summary file for `%s' not used [format err]", name);
-	  goto readext;
-	}
-	warning ("summary file for `%s' may have unconnected globals", name);
-      }
-      sscanf (buf+11, "%lu", &timestamp);
-      if (timestamp < ext->timestamp) {
-	fclose (dump);
-	warning ("summary file out-of-date for cell `%s'", name);
-	goto readext;
-      }
-      fclose (fp);
-      lex_free (l);
-      l = lex_file (dump);
-      lex_getsym (l);
-      ext->h = hash_new (8);
-      while (lex_sym (l) == l_id) {
-	if (strcmp (lex_id (l), "i") == 0)
-	  line = 1;
-	else if (strcmp (lex_id (l), "o") == 0)
-	  line = 0;
-	else
-	  fatal_error ("%s\n\t.hxt file corrupted!\n",
-		       lex_errstring (l));
-	lex_getsym (l);
-	root = NULL;
-	while (lex_sym (l) == l_string) {
-	  lex_tokenstring(l)[strlen(lex_tokenstring(l))-1] = '\0';
-	  if (!hash_lookup (ext->h, lex_tokenstring(l)+1)) {
-	    b = hash_add (ext->h, lex_tokenstring(l)+1);
-	    NEW (hc, struct hier_cell_val);
-	    b->v = hc;
-	    hc->root = root;
-	    hc->flags = line ? HIER_IS_INPUT : 0;
-	    if (!root)
-	      root = b;
-	  }
-	  lex_getsym (l);
-	}
-      }
-      lex_free (l);
-      depth--;
-      if (depth == 0) {
-	hash_free (ehash);
-	ehash = NULL;
-      }
-      return ext;
+    job_tl->next = j;
+  }
+  job_tl = j;
+  pthread_cond_signal (&ext_cond);
+  return ext;
+}
+
+static struct ext_file *_ext_subcell (const char *name)
+{
+  struct ext_file *ext;
+
+  pthread_mutex_lock (&ext_lock);
+  ext = _ext_schedule (name, 0);
+  pthread_mutex_unlock (&ext_lock);
+  return ext;
+}
+
+static void *_ext_worker (void *arg)
+{
+  struct ext_pool pool;
+  struct ext_job *j;
+
+  pool.buf = NULL;
+  pool.left = 0;
+
+  pthread_mutex_lock (&ext_lock);
+  while (1) {
+    while (!job_hd && job_busy > 0) {
+      pthread_cond_wait (&ext_cond, &ext_lock);
     }
-    else {
-      warning ("summary file for `%s' not used [empty]", name);
-      fclose (dump);
+    if (!job_hd) break;
+    j = job_hd;
+    job_hd = j->next;
+    job_busy++;
+    pthread_mutex_unlock (&ext_lock);
+
+    _ext_parse (j->ext, j->name, j->top, &pool);
+    FREE (j);
+
+    pthread_mutex_lock (&ext_lock);
+    job_busy--;
+    if (!job_hd && job_busy == 0) {
+      pthread_cond_broadcast (&ext_cond);
     }
   }
-  /* dump file is closed */
-readext:
+  pthread_mutex_unlock (&ext_lock);
+  return NULL;
+}
+
+static int _ext_threads (void)
+{
+  long n;
+
+  if (config_exists ("net.ext_threads")) {
+    n = config_get_int ("net.ext_threads");
+  }
+  else {
+    n = sysconf (_SC_NPROCESSORS_ONLN);
+    if (n > 8) n = 8;
+  }
+  if (n < 1) n = 1;
+  return n;
+}
+
+/*------------------------------------------------------------------------
+ *
+ *  Parse one .ext file. Subcells are scheduled on the work queue, and
+ *  filled in by whichever thread picks them up.
+ *
+ *------------------------------------------------------------------------
+ */
+static void _ext_parse (struct ext_file *ext, const char *name, int top,
+			struct ext_pool *pool)
+{
+  FILE *fp, *dump;
+  struct ext_reader R;
+  struct ext_fets *fet;
+  struct ext_list *subcell;
+  char *buf, *next, *kw;
+  char *s, *t;
+  double cscale, rscale;
+  double lscale;
+  double x;
+  int i;
+
+  dump = NULL;
+  fp = NULL;
+  if (top) {
+    fp = fopen (name, "r");
+  }
+  if (!fp) {
+    fp = mag_path_open (name, &dump);
+  }
+  if (!fp) {
+    fatal_error ("Could not find extract file for `%s'", name);
+  }
+  buf = _ext_slurp (fp);
+  fclose (fp);
+
+  R.ext = ext;
+  R.name = name;
+  R.line = 1;
+  R.pool = pool;
+
+  if (!buf[0]) {
+    /* empty file */
+    if (dump) fclose (dump);
+    FREE (buf);
+    return;
+  }
+
+  /* first line in ext file is the timestamp */
+  next = strchr (buf, '\n');
+  if (next) *next++ = '\0';
+  R.s = buf;
+  kw = _field (&R);
+  if (!kw || strcmp (kw, "timestamp") != 0) {
+    fatal_error ("Error in file %s:1, expected timestamp.", name);
+  }
+  sscanf (R.s, "%lu", &ext->timestamp);
+
+  if (dump && !use_summaries) {
+    fclose (dump);
+    dump = NULL;
+  }
+  if (dump && _ext_read_summary (ext, name, dump)) {
+    FREE (buf);
+    return;
+  }
+
   cscale = 1;
   rscale = 1;
   lscale = 1e-8;		/* 1 centimicron */
-  while (fgets (buf, MAXLINE, fp)) {
-    line++;
-    if (buf[MAXLINE-1] == '\0')
-      fatal_error ("This needs to be fixed!");      /* FIXME */
-    l = lex_restring (l, buf);
-    lex_getsym (l);
-    if (lex_have_keyw (l, "scale")) {
-      rscale = lex_integer (l);
-      lex_mustbe (l, l_integer);
-      cscale = lex_integer (l);
-      lex_mustbe (l, l_integer);
-      lscale = lex_integer (l)*1e-8;
-      lex_mustbe (l, l_integer);
-    }
-    else if (lex_have_keyw (l, "use")) {
-      int i;
-      MALLOC (subcell, struct ext_list, 1);
-      sscanf (buf+4, "%s%s", tok1, tok2);
-      MALLOC (subcell->file, char, strlen(tok1)+5);
-      strcpy (subcell->file, tok1);
+  while (next) {
+    R.s = next;
+    R.line++;
+    next = strchr (next, '\n');
+    if (next) *next++ = '\0';
+
+    kw = _field (&R);
+    if (!kw) continue;
+
+    if (strcmp (kw, "scale") == 0) {
+      rscale = (int) _field_num (&R);
+      cscale = (int) _field_num (&R);
+      lscale = ((int) _field_num (&R))*1e-8;
+    }
+    else if (strcmp (kw, "use") == 0) {
+      s = _field (&R);
+      t = _field (&R);
+      if (!s || !t)
+	fatal_error ("Error parsing line %s:%d, use", name, R.line);
+      subcell = POOL_NEW (pool, struct ext_list);
+      MALLOC (subcell->file, char, strlen(s)+5);
+      strcpy (subcell->file, s);
       strcat (subcell->file, ".ext");
-      subcell->id = Strdup (tok2);
+      s = subcell->file;
+      subcell->file = ext_intern (s);
+      FREE (s);
+      subcell->id = (char *) _pool_alloc (pool, strlen (t)+1);
+      strcpy (subcell->id, t);
       subcell->xlo = 0; subcell->xhi = 0;
       subcell->ylo = 0; subcell->yhi = 0;
       for (s=subcell->id; *s; s++)
@@ -791,37 +1338,37 @@ readext:
 	  t = s+1;
 	  while (*t && *t != ':') t++;
 	  if (!*t)
-	    fatal_error ("Error parsing line %s:%d, array syntax", name, line);
+	    fatal_error ("Error parsing line %s:%d, array syntax", name, R.line);
 	  *t = '\0'; subcell->xlo = atoi (s+1);
 	  s = t;
 	  t++;
 	  while (*t && *t != ':') t++;
 	  if (!*t)
-	    fatal_error ("Error parsing line %s:%d, array syntax", name, line);
+	    fatal_error ("Error parsing line %s:%d, array syntax", name, R.line);
 	  *t = '\0'; subcell->xhi = atoi (s+1);
 	  s = t;
 	  t++;
 	  while (*t && *t != ']') t++;
 	  if (!*t)
-	    fatal_error ("Error parsing line %s:%d, array syntax", name, line);
+	    fatal_error ("Error parsing line %s:%d, array syntax", name, R.line);
 	  t++;
 	  if (*t != '[')
-	    fatal_error ("Error parsing line %s:%d, array syntax", name, line);
+	    fatal_error ("Error parsing line %s:%d, array syntax", name, R.line);
 	  s = t;
 	  while (*t && *t != ':') t++;
 	  if (!*t)
-	    fatal_error ("Error parsing line %s:%d, array syntax", name, line);
+	    fatal_error ("Error parsing line %s:%d, array syntax", name, R.line);
 	  *t = '\0'; subcell->ylo = atoi (s+1);
 	  s = t;
 	  t++;
 	  while (*t && *t != ':') t++;
 	  if (!*t)
-	    fatal_error ("Error parsing line %s:%d, array syntax", name, line);
+	    fatal_error ("Error parsing line %s:%d, array syntax", name, R.line);
 	  *t = '\0'; subcell->yhi = atoi (s+1);
 	  t++;
 	  while (*t && *t != ']') t++;
 	  if (!*t)
-	    fatal_error ("Error parsing line %s:%d, array syntax", name, line);
+	    fatal_error ("Error parsing line %s:%d, array syntax", name, R.line);
 	  break;
 	}
       /* 
@@ -840,68 +1387,59 @@ readext:
       }
       subcell->next = ext->subcells;
       ext->subcells = subcell;
-      subcell->ext = ext_read (subcell->file);
+      subcell->ext = _ext_subcell (subcell->file);
     }
-    else if (lex_have_keyw (l, "fet")) {
+    else if (strcmp (kw, "fet") == 0) {
       double gperim, t1perim, t2perim;
       int dev;
 
-      MALLOC (fet, struct ext_fets, 1);
+      fet = POOL_NEW (pool, struct ext_fets);
+      kw = _field (&R);
+      if (!kw) kw = "";
       if (device_names) {
 	for (dev = 0; dev < num_devices; dev++) {
-	  if (lex_have_keyw (l, device_names[dev])) {
+	  if (strcmp (kw, device_names[dev]) == 0) {
 	    break;
 	  }
 	}
 	if (dev == num_devices) {
 	  fatal_error ("fet %s: unknown device type at %s:%d\n",
-		       lex_tokenstring (l), name, line);
+		       kw, name, R.line);
 	}
 	fet->type = dev;
       }
       else {
-	if (lex_have_keyw (l, "nfet"))
+	if (strcmp (kw, "nfet") == 0)
 	  fet->type = EXT_FET_NTYPE;
-	else {
-	  lex_mustbe_keyw (l, "pfet");
+	else if (strcmp (kw, "pfet") == 0)
 	  fet->type = EXT_FET_PTYPE;
-	}
+	else
+	  fatal_error ("Error in file %s:%d, expected pfet.", name, R.line);
       }
-      lex_mustbe_number (l); lex_mustbe_number (l); lex_mustbe_number (l);
-      lex_mustbe_number (l); lex_mustbe_number (l); lex_mustbe_number (l);
+      for (i=0; i < 6; i++)
+	_field_skip (&R);
 
       /* substrate */
-      fet->sub = Strdup (lex_mustbe_string_id (l, name, line));
+      fet->sub = ext_intern (_field_id (&R));
 
       /* gate */
-      fet->g = Strdup(lex_mustbe_string_id (l, name, line));
+      fet->g = ext_intern (_field_id (&R));
 
-      gperim = lex_mustbe_number (l)*lscale; /* convert to SI units */
-      fet->isweak = 0;
-      if (strcmp (lex_tokenstring(l), "0") == 0)
-	lex_getsym (l);
-      else
-	do {
-	  lex_mustbe (l, l_string);
-	  if (strcmp (lex_prev(l), "\"weak\"") == 0)
-	    fet->isweak = 1;
-	} while (lex_have (l,l_comma));
+      gperim = _field_num (&R)*lscale; /* convert to SI units */
+      fet->isweak = _field_attrs (&R);
 
       /* t1 */
-      fet->t1 = Strdup(lex_mustbe_string_id (l, name, line));
-      t1perim = lex_mustbe_number (l)*lscale; /* convert to SI units */
-      if (strcmp (lex_tokenstring (l), "0") == 0)
-	lex_getsym (l);
-      else
-	do lex_mustbe (l, l_string); while (lex_have (l,l_comma));
+      fet->t1 = ext_intern (_field_id (&R));
+      t1perim = _field_num (&R)*lscale; /* convert to SI units */
+      _field_attrs (&R);
 
       /* t2 */
-      fet->t2 = lex_shouldbe_string_id (l);
-      if (!fet->t2) {
+      s = _field (&R);
+      if (!s) {
 	fatal_error ("fet in layout does not have enough terminals; t=%s; gate=%s", fet->t1, fet->g);
       }
-      fet->t2 = Strdup(fet->t2);
-      t2perim = lex_mustbe_number (l)*lscale; /* convert to SI unitS */
+      fet->t2 = ext_intern (_unquote (s));
+      t2perim = _field_num (&R)*lscale; /* convert to SI unitS */
 
       fet->width = (t1perim + t2perim)/2;
       fet->length = gperim/2;
@@ -910,86 +1448,156 @@ readext:
       fet->next = ext->fet;
       ext->fet = fet;
     }
-    else if (lex_have_keyw (l, "equiv")) {
-      s = Strdup(lex_mustbe_string_id (l, name, line));
-      t = Strdup(lex_mustbe_string_id (l, name, line));
-      expand_aliases (s, t, ext, 0);
+    else if (strcmp (kw, "equiv") == 0) {
+      s = _field_id (&R);
+      t = _field_id (&R);
+      expand_aliases (&R, s, t, 0);
     }
-    else if (lex_have_keyw (l, "merge")) {
-      s = Strdup(lex_mustbe_string_id (l, name, line));
-      t = Strdup(lex_mustbe_string_id (l, name, line));
-      if (lex_sym (l) == l_integer || lex_sym (l) == l_real)
-	x = cscale*lex_mustbe_number (l);
-      else
-	x = 0;
-      expand_aliases (s, t, ext, x);
+    else if (strcmp (kw, "merge") == 0) {
+      s = _field_id (&R);
+      t = _field_id (&R);
+      kw = _field (&R);
+      x = 0;
+      if (kw) {
+	x = strtod (kw, &kw);
+	x = (*kw ? 0 : cscale*x);
+      }
+      expand_aliases (&R, s, t, x);
     }
-    else if (lex_have_keyw (l, "node") || lex_have_keyw (l, "substrate")) {
+    else if (strcmp (kw, "node") == 0 || strcmp (kw, "substrate") == 0) {
       struct ext_ap *ap;
-      s = Strdup (lex_mustbe_string_id (l, name, line));
-      lex_mustbe_number (l); /* R */
-      x = lex_mustbe_number(l)*cscale; /* C */
+      int ndev;
+      s = _field_id (&R);
+      _field_skip (&R); /* R */
+      x = _field_num(&R)*cscale; /* C */
       /* FIXME: resistclass 1 = ndiff, 2 = pdiff -- hardcoded */
-      lex_mustbe_number (l); /* x */
-      lex_mustbe_number (l); /* y */
-      lex_mustbe_string_contiguous_id (l); /* type */
-
-      addcap (ext, Strdup (s), NULL, x, CAP_GND);
-
-      ap = add_ap_empty (ext, Strdup (s));
-      if (device_names) {
-	int j;
-	MALLOC (ap->area, double, num_devices);
-	MALLOC (ap->perim, double, num_devices);
-	for (j = 0; j < num_devices; j++) {
-	  ap->area[j] = lex_mustbe_number(l)*lscale*lscale;
-	  ap->perim[j] = lex_mustbe_number (l)*lscale;
-	}
-      }
-      else {
-	MALLOC (ap->area, double, 2);
-	MALLOC (ap->perim, double, 2);
-	ap->area[0] = lex_mustbe_number(l)*lscale*lscale;
-	ap->perim[0] = lex_mustbe_number (l)*lscale;
-
-	ap->area[1] = lex_mustbe_number(l)*lscale*lscale;
-	ap->perim[1] = lex_mustbe_number (l)*lscale;
+      _field_skip (&R); /* x */
+      _field_skip (&R); /* y */
+      _field_skip (&R); /* type */
+
+      addcap (&R, ext_intern (s), NULL, x, CAP_GND);
+
+      ap = add_ap_empty (&R, ext_intern (s));
+      ndev = device_names ? num_devices : 2;
+      ap->area = (double *) _pool_alloc (pool, sizeof (double)*ndev);
+      ap->perim = (double *) _pool_alloc (pool, sizeof (double)*ndev);
+      for (i = 0; i < ndev; i++) {
+	ap->area[i] = _field_num(&R)*lscale*lscale;
+	ap->perim[i] = _field_num (&R)*lscale;
       }
-      expand_aliases (s, Strdup(s), ext, 0);
+      t = Strdup (s);
+      expand_aliases (&R, s, t, 0);
+      FREE (t);
     }
-    else if (lex_have_keyw (l, "cap")) {
-      s = Strdup (lex_mustbe_string_id (l, name, line));
-      t = Strdup (lex_mustbe_string_id (l, name, line));
-      x = lex_mustbe_number (l)*cscale;
-      addcap (ext, s, t, x, CAP_INTERNODE);
+    else if (strcmp (kw, "cap") == 0) {
+      s = ext_intern (_field_id (&R));
+      t = ext_intern (_field_id (&R));
+      x = _field_num (&R)*cscale;
+      addcap (&R, s, t, x, CAP_INTERNODE);
     }
-    else if (lex_have_keyw (l, "subcap")) {
+    else if (strcmp (kw, "subcap") == 0) {
       /* figure out what to do */
-      s = Strdup (lex_mustbe_string_id (l, name, line));
-      x = lex_mustbe_number (l)*cscale;
-      addcap (ext, s, NULL, x, CAP_SUBSTRATE);
-    }
-    else if (lex_have_keyw (l, "attr")) {
-      s = Strdup (lex_mustbe_string_id (l, name, line));
-      while (lex_whitespace (l)[0] == '\0' && !lex_eof (l)) {
-	REALLOC (s, char, strlen(s)+strlen(lex_tokenstring(l))+1);
-	strcat (s, lex_tokenstring (l));
-	lex_getsym (l);
-      }
-      lex_mustbe_number (l);
-      lex_mustbe_number (l);
-      lex_mustbe_number (l);
-      lex_mustbe_number (l);
-      lex_mustbe_string_id (l, name, line);
-      addattr (ext, s, lex_mustbe_string_id (l, name, line));
+      s = ext_intern (_field_id (&R));
+      x = _field_num (&R)*cscale;
+      addcap (&R, s, NULL, x, CAP_SUBSTRATE);
+    }
+    else if (strcmp (kw, "attr") == 0) {
+      s = ext_intern (_field_id (&R));
+      for (i=0; i < 5; i++)
+	_field_skip (&R);
+      addattr (&R, s, _field_id (&R));
     }
   }
-  fclose (fp);
-  lex_free (l);
-  depth--;
-  if (depth == 0) {
-    hash_free (ehash);
-    ehash = NULL;
+  FREE (buf);
+}
+
+/*------------------------------------------------------------------------
+ *
+ *  Parse .ext file hierarchically
+ *
+ *------------------------------------------------------------------------
+ */
+struct ext_file *ext_read (const char *name)
+{
+  struct ext_file *ext;
+  pthread_t *tids;
+  int i, nthreads;
+
+  if (!device_names) {
+    config_read ("extract.conf");
+    if (config_exists ("net.ext_devs")) {
+      num_devices = config_get_table_size ("net.ext_devs");
+      device_names = config_get_table_string ("net.ext_devs");
+    }
+  }
+  if (!names_init) {
+    for (i=0; i < EXT_NSTRIPE; i++) {
+      names[i] = hash_new (64);
+      pthread_mutex_init (&names_lock[i], NULL);
+    }
+    names_init = 1;
+  }
+  mag_path_init ();
+
+  ehash = hash_new (2);
+  ext = _ext_schedule (name, 1);
+
+  nthreads = _ext_threads ();
+  MALLOC (tids, pthread_t, nthreads);
+  for (i=1; i < nthreads; i++) {
+    if (pthread_create (&tids[i], NULL, _ext_worker, NULL) != 0)
+      fatal_error ("ext_read: could not create reader thread");
   }
+  _ext_worker (NULL);
+  for (i=1; i < nthreads; i++) {
+    pthread_join (tids[i], NULL);
+  }
+  FREE (tids);
+
+  hash_free (ehash);
+  ehash = NULL;
   return ext;
 }
+
+/*------------------------------------------------------------------------
+ *
+ *  ext_read_summary --
+ *
+ *    Use the .hxt summary of a cell that has already been read. The
+ *    rest of the cell is left alone, but is ignored once ext->h is
+ *    set. Returns 1 if the summary was used.
+ *
+ *------------------------------------------------------------------------
+ */
+int ext_read_summary (struct ext_file *ext, const char *name)
+{
+  FILE *fp, *dump;
+
+  if (ext->h) return 1;
+  dump = NULL;
+  fp = mag_path_open (name, &dump);
+  if (fp) fclose (fp);
+  if (!dump) return 0;
+  return _ext_read_summary (ext, name, dump);
+}
+
+/*------------------------------------------------------------------------
+ *
+ *  ext_free_summary --
+ *
+ *    Drop the summary of a cell, so that it is flattened again
+ *
+ *------------------------------------------------------------------------
+ */
+void ext_free_summary (struct ext_file *ext)
+{
+  hash_bucket_t *b;
+  int i;
+
+  if (!ext->h) return;
+  for (i=0; i < ext->h->size; i++)
+    for (b = ext->h->head[i]; b; b = b->next)
+      FREE (b->v);
+  hash_free (ext->h);
+  ext->h = NULL;
+}
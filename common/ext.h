@@ -122,6 +122,17 @@ struct ext_file {
 /* parse hierarchical extract file */
 extern struct ext_file *ext_read (const char *name);
 extern void ext_validate_timestamp (const char *name);
+extern char *ext_locate (const char *name);
+
+/* load or drop the .hxt summary of a cell that has been read */
+extern void ext_use_summaries (int use);
+extern int ext_read_summary (struct ext_file *ext, const char *name);
+extern void ext_free_summary (struct ext_file *ext);
+
+/* content hash of a cell, used to validate .hxt summaries */
+extern void ext_hash_options (const char *opts);
+extern void ext_hash_inputs (const char *suffix);
+extern unsigned long ext_content_hash (const char *name);
 
 #ifdef __cplusplus
 }
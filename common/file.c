@@ -41,7 +41,7 @@ typedef struct __el__ {
   struct __el__ *next;
 } elist;
 
-L_A_DECL(char *, string_tab);
+static struct Hashtable *string_tab = NULL;
 
 static struct Hashtable *ERRMSG = NULL;
 
@@ -57,19 +57,20 @@ struct _file_ {
 };
 
 
-/* Cache file names! */
+/* Cache file names! Looked up for every parse tree position, so use
+   a hash table rather than scanning all names seen so far. */
 static char *string_to_string (const char *s)
 {
-  int i;
+  hash_bucket_t *b;
 
-  for (i=0; i < A_LEN (string_tab); i++) {
-    if (strcmp (s, string_tab[i]) == 0)
-      return string_tab[i];
+  if (!string_tab) {
+    string_tab = hash_new (32);
+  }
+  b = hash_lookup (string_tab, s);
+  if (!b) {
+    b = hash_add (string_tab, s);
   }
-  A_NEW (string_tab, char *);
-  A_NEXT (string_tab) = Strdup (s);
-  A_INC (string_tab);
-  return string_tab[A_LEN(string_tab)-1];
+  return b->key;
 }
 
 /*
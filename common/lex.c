@@ -25,6 +25,8 @@
 #include <ctype.h>
 #include <assert.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "lex.h"
 #include "misc.h"
 #include "lzw.h"
@@ -54,51 +56,71 @@ static const char *fixed_toks[] = {
 #define contiguous_tok(c)  (isalnum(c) || (c) == '_')
 
 
+/*
+  Input is read LEX_BLOCK characters at a time (a line at a time from
+  terminals and pipes). When the buffer is refilled, the last LEX_KEEP
+  characters are kept in front of the new input, so that ungetch()
+  just moves the buffer pointer back.
+*/
+#define LEX_BLOCK  65536
+#define LEX_KEEP   256
+
 /*-------------------------------------------------------------------------
- * get next character from input stream
+ * refill input buffer
  *-----------------------------------------------------------------------*/
-static void getch (LEX_T *l)
+static void refill (LEX_T *l)
 {
-  int pos;
-  if (l->changed)
-    l->colno = 0;
-  if (l->bufptr < l->buflen && l->buf[l->bufptr])
-    l->ch = l->buf[l->bufptr++];
+  int pos, n;
+
+  if (l->pos) {
+    /* saved positions point into the buffer, so keep all of it */
+    pos = l->bufptr;
+  }
   else {
-    pos = 0;
-    if (l->pos) {
-      if (l->bufptr == l->buflen-1) {
-	l->buflen *= 2;
-	l->buf = (char *)realloc(l->buf, l->buflen);
-	if (!l->buf)
-	  fatal_error ("getch: realloc failed, size=%d", l->buflen);
-      }
-      pos = l->bufptr;
+    pos = (l->bufptr < LEX_KEEP) ? l->bufptr : LEX_KEEP;
+    memmove (l->buf, l->buf + l->bufptr - pos, pos);
+  }
+  while (l->buflen - pos < LEX_BLOCK + 2) {
+    l->buflen *= 2;
+    l->buf = (char *)realloc(l->buf, l->buflen);
+    if (!l->buf)
+      fatal_error ("getch: realloc failed, size=%d", l->buflen);
+  }
+  if (l->file) {
+    if (l->cfile) {
+      n = c_fread (l->buf+pos, 1, LEX_BLOCK, l->inp.fp);
     }
-    if (l->file) {
-      l->buf[pos] = '\0';
-      if (l->cfile) {
-	c_fgets (l->buf+pos, l->buflen-pos, l->inp.fp);
-      }
-      else {
-	fgets (l->buf+pos, l->buflen-pos, l->inp.fp);
-      }
-      l->bufptr = pos;
+    else if (l->block) {
+      n = fread (l->buf+pos, 1, LEX_BLOCK, l->inp.fp);
+    }
+    else if (fgets (l->buf+pos, LEX_BLOCK+1, l->inp.fp)) {
+      n = strlen (l->buf+pos);
     }
     else {
-      int foo;
-      strncpy (l->buf+pos, l->inp.string, l->buflen-pos);
-      l->bufptr = pos;
-      foo = strlen (l->buf + pos);
-      if (foo < l->buflen - pos) {
-          l->inp.string += foo;
-      }
-      else {
-          l->inp.string += l->buflen - pos;
-      }
+      n = 0;
     }
-    l->ch = l->buf[l->bufptr++];
   }
+  else {
+    n = strnlen (l->inp.string, LEX_BLOCK);
+    memcpy (l->buf+pos, l->inp.string, n);
+    l->inp.string += n;
+  }
+  /* two terminators, in case getch() is called again at the end */
+  l->buf[pos+n] = '\0';
+  l->buf[pos+n+1] = '\0';
+  l->bufptr = pos;
+}
+
+/*-------------------------------------------------------------------------
+ * get next character from input stream
+ *-----------------------------------------------------------------------*/
+static void getch (LEX_T *l)
+{
+  if (l->changed)
+    l->colno = 0;
+  if (!(l->bufptr < l->buflen && l->buf[l->bufptr]))
+    refill (l);
+  l->ch = l->buf[l->bufptr++];
   l->colno++;
   if (l->ch == '\n') {
     l->lineno++;
@@ -118,11 +140,12 @@ static void ungetch (LEX_T *l)
   if (l->bufptr > 0)
     l->bufptr--;
   else {
+    /* went back past the LEX_KEEP window */
     l->buf = (char *) realloc (l->buf, sizeof(char)*(l->buflen+1));
     l->buflen ++;
     if (!l->buf)
       fatal_error ("ungetch:: realloc failed, size=%d", sizeof(char));
-    for (i=l->buflen; i > 0; i--)
+    for (i=l->buflen-1; i > 0; i--)
       l->buf[i] = l->buf[i-1];
     l->buf[0] = l->ch;
   }
@@ -221,8 +244,22 @@ static void linit (LEX_T *l)
   l->saving = 0;
 
   l->cfile = 0;
+  l->block = 0;
   
   l->pos = NULL;
+  l->posfree = NULL;
+}
+
+/*------------------------------------------------------------------------
+ * read regular files in blocks; anything else a line at a time
+ *------------------------------------------------------------------------
+ */
+static void setblock (LEX_T *l)
+{
+  struct stat st;
+
+  if (fstat (fileno (l->inp.fp), &st) == 0 && S_ISREG (st.st_mode))
+    l->block = 1;
 }
 
 static LEX_T *lmalloc (void)
@@ -251,6 +288,9 @@ static LEX_T *lmalloc (void)
   linit (l);
 
   l->ntokens = 0;
+  l->dfa = NULL;
+  l->dfa_tok = NULL;
+  l->dfa_free = NULL;
 
   return l;
 }
@@ -435,6 +475,7 @@ extern LEX_T *lex_file (FILE *fp)
   l = lmalloc ();
   l->file = 1;
   l->inp.fp = fp;
+  setblock (l);
   if (fp == stdin) {
     MALLOC(l->filename,char,8);
     strcpy (l->filename,"-stdin-");
@@ -459,6 +500,7 @@ extern LEX_T *lex_fopen (const char *name)
   l = lmalloc ();
   l->file = 1;
   l->inp.fp = fp;
+  setblock (l);
   MALLOC(l->filename,char,strlen(name)+1);
   strcpy (l->filename,name);
   getch (l);
@@ -517,12 +559,113 @@ extern LEX_T *lex_restring (LEX_T *l, char *s)
 }
 
 
+/*------------------------------------------------------------------------
+ * Token recognizer: a DFA for the trie of tokens[], with characters
+ * mapped to classes (class 0 = not used by any token). State 0 is the
+ * start state; a transition to 0 means there is no match. Accepting
+ * states hold the token value.
+ *
+ * Parsers add a token and delete it again around sub-parses (e.g. ">>"
+ * for each expression), so the table is updated in place: adding a
+ * token extends the trie, and deleting the last token removes its
+ * accepting state and any states only it used. Removed states go on
+ * a free list and are reused by the next token added. A full rebuild
+ * is only needed when a token uses a character that has no class yet.
+ *------------------------------------------------------------------------
+ */
+static void lex_freedfa (LEX_T *l)
+{
+  if (l->dfa) {
+    FREE (l->dfa);
+    FREE (l->dfa_tok);
+    FREE (l->dfa_free);
+    l->dfa = NULL;
+    l->dfa_tok = NULL;
+    l->dfa_free = NULL;
+  }
+}
+
+/* add token "s" with value "v" to the trie; returns 0 if the table
+   has to be rebuilt */
+static int lex_dfa_add (LEX_T *l, const char *s, int v)
+{
+  const unsigned char *t;
+  int k, st, nc, len;
+
+  nc = l->dfa_nclass;
+  len = 0;
+  for (t = (const unsigned char *)s; *t; t++) {
+    if (!l->dfa_class[*t])
+      return 0;
+    len++;
+  }
+  if (l->dfa_nstates + len > l->dfa_maxstates) {
+    int n = l->dfa_maxstates;
+    while (l->dfa_nstates + len > n)
+      n *= 2;
+    REALLOC (l->dfa, int, n*nc);
+    REALLOC (l->dfa_tok, int, n);
+    REALLOC (l->dfa_free, int, n);
+    memset (l->dfa + l->dfa_maxstates*nc, 0,
+	    sizeof (int)*(n - l->dfa_maxstates)*nc);
+    for (k=l->dfa_maxstates; k < n; k++)
+      l->dfa_tok[k] = -1;
+    l->dfa_maxstates = n;
+  }
+  st = 0;
+  for (t = (const unsigned char *)s; *t; t++) {
+    k = st*nc + l->dfa_class[*t];
+    if (!l->dfa[k]) {
+      if (l->dfa_nfree > 0)
+	l->dfa[k] = l->dfa_free[--l->dfa_nfree];
+      else
+	l->dfa[k] = l->dfa_nstates++;
+    }
+    st = l->dfa[k];
+  }
+  l->dfa_tok[st] = v;
+  return 1;
+}
+
+static void lex_mkdfa (LEX_T *l)
+{
+  int i, nstates, nc;
+  const unsigned char *t;
+
+  lex_freedfa (l);
+  memset (l->dfa_class, 0, sizeof (l->dfa_class));
+  nc = 1;
+  nstates = 1;
+  for (i=0; i < l->ntokens; i++)
+    for (t = (const unsigned char *)l->tokens[i]; *t; t++) {
+      nstates++;
+      if (!l->dfa_class[*t])
+	l->dfa_class[*t] = nc++;
+    }
+  l->dfa_nclass = nc;
+
+  /* leave room for a few tokens to be added later */
+  nstates += 16;
+  MALLOC (l->dfa, int, nstates*nc);
+  MALLOC (l->dfa_tok, int, nstates);
+  MALLOC (l->dfa_free, int, nstates);
+  memset (l->dfa, 0, sizeof (int)*nstates*nc);
+  for (i=0; i < nstates; i++)
+    l->dfa_tok[i] = -1;
+  l->dfa_maxstates = nstates;
+  l->dfa_nstates = 1;
+  l->dfa_nfree = 0;
+
+  for (i=0; i < l->ntokens; i++)
+    lex_dfa_add (l, l->tokens[i], l->tokenvals[i]);
+}
+
 /*-------------------------------------------------------------------------
  * add a token to the list of currently recognized tokens
  *-----------------------------------------------------------------------*/
 extern int lex_addtoken (LEX_T *l, const char *s)
 {
-  int i, j;
+  int i, j, lo, hi, c;
 
   if (*s == '\0')
     fatal_error ("lex_addtoken: received empty token!");
@@ -537,13 +680,21 @@ extern int lex_addtoken (LEX_T *l, const char *s)
 		   sizeof(int)*l->toksize);
     l->toksize *= 2;
   }
-  
-  for (i=0; i < l->ntokens && (strcmp (l->tokens[i], s) < 0); i++) 
-    /* empty */
-    ;
-  
-  if (i < l->ntokens && (strcmp (l->tokens[i], s) == 0))
-    return l->tokenvals[i];
+
+  /* tokens[] is sorted: binary search for the insertion point */
+  lo = 0;
+  hi = l->ntokens;
+  while (lo < hi) {
+    i = (lo + hi)/2;
+    c = strcmp (l->tokens[i], s);
+    if (c == 0)
+      return l->tokenvals[i];
+    if (c < 0)
+      lo = i + 1;
+    else
+      hi = i;
+  }
+  i = lo;
   
   for (j = l->ntokens; j > i; j--) {
     l->tokens[j] = l->tokens[j-1];
@@ -554,6 +705,8 @@ extern int lex_addtoken (LEX_T *l, const char *s)
   l->tokenvals[i] = l->ntokens+l_offset;
   strcpy (l->tokens[i], s);
   l->ntokens++;
+  if (l->dfa && !lex_dfa_add (l, s, l->tokenvals[i]))
+    lex_freedfa (l);
   return l->ntokens-1+l_offset;
 }
 
@@ -574,6 +727,35 @@ extern void lex_deltoken (LEX_T *l, int tok)
       break;
   if (i == l->ntokens)
     fatal_error ("lex_deltoken: What on earth is going on here . . .");
+  if (l->dfa) {
+    /* clear the accepting state, and prune states on the path that
+       no longer lead anywhere */
+    const unsigned char *t = (const unsigned char *)l->tokens[i];
+    int nc = l->dfa_nclass;
+    int len = strlen ((char *)t);
+    int *path, k, c;
+
+    MALLOC (path, int, len+1);
+    path[0] = 0;
+    for (k=0; k < len; k++)
+      path[k+1] = l->dfa[path[k]*nc + l->dfa_class[t[k]]];
+    l->dfa_tok[path[len]] = -1;
+    for (k=len; k > 0; k--) {
+      if (l->dfa_tok[path[k]] >= 0)
+	break;
+      for (c=1; c < nc; c++)
+	if (l->dfa[path[k]*nc + c])
+	  break;
+      if (c != nc)
+	break;
+      l->dfa[path[k-1]*nc + l->dfa_class[t[k-1]]] = 0;
+      if (path[k] == l->dfa_nstates-1)
+	l->dfa_nstates--;
+      else
+	l->dfa_free[l->dfa_nfree++] = path[k];
+    }
+    FREE (path);
+  }
   FREE (l->tokens[i]);
   for (j=i; j < l->ntokens-1; j++) {
     l->tokens[j] = l->tokens[j+1];
@@ -598,14 +780,23 @@ extern void lex_deltokens (LEX_T *l, int m)
 
 /*------------------------------------------------------------------------
  * Is this token already defined? 
- *  FIXME: binary search
  *------------------------------------------------------------------------
  */
 extern int lex_istoken (LEX_T *l, const char *s)
 {
-  int i;
-  for (i=0; i < l->ntokens; i++)
-    if (strcmp (l->tokens[i], s) == 0) return 1;
+  int i, j, m, c;
+
+  i = 0;
+  j = l->ntokens-1;
+  while (i <= j) {
+    m = (i+j)/2;
+    c = strcmp (l->tokens[m], s);
+    if (c == 0) return 1;
+    if (c < 0)
+      i = m+1;
+    else
+      j = m-1;
+  }
   return 0;
 }
 
@@ -614,10 +805,10 @@ extern int lex_istoken (LEX_T *l, const char *s)
  *-----------------------------------------------------------------------*/
 extern int lex_getsym (LEX_T *l)
 {
-  int i, j, m, oldi, ilimit, jlimit;
+  int i, j, m, oldi, oldlen, state;
   int found = 0;
-  int depth = 0;
   int flag;
+  char last;
 
   strcpy (l->tokprev, l->token);
   l->whitespace_loc = 0;
@@ -629,11 +820,13 @@ extern int lex_getsym (LEX_T *l)
   if (lex_eof (l))
     return l->sym = l_eof;
 
-  ilimit = 0; jlimit = l->ntokens-1;
-  i = 0; j = l->ntokens-1;
   oldi = -1;
-  if (j >= 0) 
+  oldlen = 0;
+  if (l->ntokens > 0) {
     /* there are some registered tokens */
+    if (!l->dfa)
+      lex_mkdfa (l);
+    state = 0;
     while (!found) {
 
       /* I haven't found a match yet */
@@ -648,45 +841,19 @@ extern int lex_getsym (LEX_T *l)
 	  return l->sym = l_eof;
 	}
       }
-      if (i != j) {
-	/* do a binary search for character at this depth */
-	while ((i+1) != j) {
-	  m = (i+j)/2;
-	  if (l->tokens[m][depth] <= l->ch)
-	    i = m;
-	  else
-	    j = m;
-	}
+      state = l->dfa[state*l->dfa_nclass +
+		     l->dfa_class[(unsigned char)l->ch]];
+      if (!state) {
+	/* can't match at this depth, check previous depth for 
+	   an exact match.
+	   "xy" can be self-delimiting iff both x and y are not
+	   alphanumeric.
+	*/
+	found = (oldi >= 0) ? 1 : 0;
+	break;
       }
-      /* check if character was found */
-      if (l->tokens[i][depth] != l->ch)
-	if (l->tokens[j][depth] != l->ch) {
-	  /* can't match at this depth, check previous depth for 
-	     an exact match.
-	     "xy" can be self-delimiting iff both x and y are not
-	     alphanumeric.
-	  */
-	  found = (oldi >= 0) ? 1 : 0;
-	  break;
-	}
-	else
-	  /* found character at position j */
-	  m = j;
-      else
-	/* found character at position i */
-	m = i;
+      last = l->ch;
       addtok (l, l->ch);
-      i = j = m;
-
-      /* move i, j to boundary of matching range */
-
-      while (i > ilimit && (l->tokens[i-1][depth] == l->ch)) i--;
-      while (j < jlimit && (l->tokens[j+1][depth] == l->ch)) j++;
-
-      /* increase depth by one */
-      ilimit = i;
-      jlimit = j;
-      depth++;
 
       getch (l);
       flag = 0;
@@ -702,10 +869,11 @@ extern int lex_getsym (LEX_T *l)
 	l->ch = '/';
       }
       if (flag) {
-	/* delimited token, check if there is a match at previous depth */
-	if (l->tokens[i][depth] == '\0') {
+	/* delimited token, check if there is a match at this depth */
+	if (l->dfa_tok[state] >= 0) {
 	  found = 1;
-	  oldi = i;
+	  oldi = l->dfa_tok[state];
+	  oldlen = l->token_loc;
 	  break;
 	}
 	else {
@@ -714,11 +882,14 @@ extern int lex_getsym (LEX_T *l)
 	}
       }
       /* check if this could be a legal end-of-token */
-      if (!(contiguous_tok(l->tokens[i][depth-1]) && contiguous_tok(l->ch)) &&
-	  l->tokens[i][depth] == '\0')
-	oldi = i;
+      if (!(contiguous_tok(last) && contiguous_tok(l->ch)) &&
+	  l->dfa_tok[state] >= 0) {
+	oldi = l->dfa_tok[state];
+	oldlen = l->token_loc;
+      }
     }
-  if (found && (strcmp (l->tokens[oldi], ".") == 0) &&
+  }
+  if (found && oldlen == 1 && l->token[0] == '.' &&
       (lex_flags (l) & LEX_FLAGS_NODOTS) &&
       !(lex_flags (l) & LEX_FLAGS_NOREAL)) {
     found = 0;
@@ -949,7 +1120,7 @@ extern int lex_getsym (LEX_T *l)
   }
   else {
     /* put back any characters that were not matched */
-    i = strlen (l->tokens[oldi]);
+    i = oldlen;
     j = l->token_loc;
     while (j > i) {
       unsave (l);
@@ -959,7 +1130,7 @@ extern int lex_getsym (LEX_T *l)
       j--;
     }
     l->token[l->token_loc] = '\0';
-    return l->sym = l->tokenvals[oldi];
+    return l->sym = oldi;
   }
 }
 
@@ -993,8 +1164,20 @@ extern void lex_free (LEX_T *l)
     }
   }
   free (l->tokens);
+  lex_freedfa (l);
   free (l->whitespace);
   free (l->token);
+  while (l->pos)
+    lex_pop_position (l);
+  while (l->posfree) {
+    lex_position_t *tmp = l->posfree;
+    l->posfree = tmp->next;
+    if (tmp->ws) free (tmp->ws);
+    if (tmp->tok) free (tmp->tok);
+    if (tmp->prev) free (tmp->prev);
+    if (tmp->save) free (tmp->save);
+    free (tmp);
+  }
   free (l);
 }
 
@@ -1252,13 +1435,38 @@ extern void lex_mustbe_ckeyw (LEX_T *l, const char *s)
  */
 #define ASSIGN(a,b,field) a->field = b->field
 
+static void possave (char **buf, int *sz, const char *s, int len)
+{
+  if (len + 1 > *sz) {
+    *sz = (len < 64) ? 64 : len + 1;
+    if (*buf)
+      free (*buf);
+    *buf = (char *) malloc (*sz);
+    if (!*buf)
+      fatal_error ("lex_save_position: malloc failed, size=%d\n", *sz);
+  }
+  memcpy (*buf, s, len);
+  (*buf)[len] = '\0';
+}
+
 extern void lex_push_position (LEX_T *l)
 {
   lex_position_t *cur;
-  cur = (lex_position_t*)malloc (sizeof(lex_position_t));
-  if (!cur)
-    fatal_error ("lex_save_position: malloc failed, size=%d\n",
-		 sizeof(lex_position_t));
+
+  /* the parser pushes a position for almost every token it tries, so
+     popped entries (and their string buffers) are recycled */
+  if (l->posfree) {
+    cur = l->posfree;
+    l->posfree = cur->next;
+  }
+  else {
+    cur = (lex_position_t*)malloc (sizeof(lex_position_t));
+    if (!cur)
+      fatal_error ("lex_save_position: malloc failed, size=%d\n",
+		   sizeof(lex_position_t));
+    cur->ws = cur->tok = cur->save = cur->prev = NULL;
+    cur->ws_len = cur->tok_len = cur->save_len = cur->prev_len = 0;
+  }
   ASSIGN(cur,l,bufptr);
   ASSIGN(cur,l,lineno);
   ASSIGN(cur,l,colno);
@@ -1267,18 +1475,15 @@ extern void lex_push_position (LEX_T *l)
   ASSIGN(cur,l,sym);
   ASSIGN(cur,l,integer);
   ASSIGN(cur,l,real);
-  cur->ws = (char *)malloc(l->whitespace_loc+1);
-  strcpy (cur->ws, l->whitespace);
-  cur->tok = (char*)malloc (l->token_loc+1);
-  strcpy (cur->tok, l->token);
-  cur->prev = (char*)malloc(strlen(l->tokprev)+1);
-  strcpy (cur->prev, l->tokprev);
+  possave (&cur->ws, &cur->ws_len, l->whitespace, l->whitespace_loc);
+  possave (&cur->tok, &cur->tok_len, l->token, l->token_loc);
+  possave (&cur->prev, &cur->prev_len, l->tokprev, strlen (l->tokprev));
   if (l->saving) {
-    cur->save = (char*)malloc (l->saved_loc+1);
-    strcpy (cur->save, l->saved);
+    possave (&cur->save, &cur->save_len, l->saved, l->saved_loc);
+    cur->has_save = 1;
   }
   else
-    cur->save = NULL;
+    cur->has_save = 0;
   cur->next = l->pos;
   l->pos = cur;
 }
@@ -1295,12 +1500,8 @@ extern void lex_pop_position (LEX_T *l)
     fatal_error ("lex_pop_position: no positions to pop!");
   tos = l->pos;
   l->pos = l->pos->next;
-  free (tos->tok);
-  free (tos->ws);
-  free (tos->prev);
-  if (tos->save)
-    free (tos->save);
-  free (tos);
+  tos->next = l->posfree;
+  l->posfree = tos;
 }
 
 /*------------------------------------------------------------------------
@@ -1324,7 +1525,7 @@ extern void lex_set_position (LEX_T *l)
   strcpy (l->whitespace, tos->ws); l->whitespace_loc = strlen (tos->ws);
   strcpy (l->token, tos->tok); l->token_loc = strlen (tos->tok);
   strcpy (l->tokprev, tos->prev);
-  if (tos->save) {
+  if (tos->has_save) {
     strcpy (l->saved, tos->save);
     l->saved_loc = strlen (tos->save);
   }
@@ -50,6 +50,8 @@ extern "C" {
 
 typedef struct lex_position {
   char *ws, *tok, *save, *prev;
+  int ws_len, tok_len, save_len, prev_len; /* allocated sizes */
+  int has_save;			/* 1 if save[] holds saved input */
   int bufptr;
   int colno,lineno;
   int changed;
@@ -73,6 +75,7 @@ typedef struct {
   int buflen;			/* buffer size */
 
   lex_position_t *pos;		/* position stack */
+  lex_position_t *posfree;	/* popped positions, kept for reuse */
 
   unsigned int flags;		/* lexer flags */
 
@@ -81,6 +84,7 @@ typedef struct {
   unsigned int changed:1;	/* "1" if lineno was changed */
   unsigned int file:1;		/* "1" if input is a file */
   unsigned int cfile:1;		/* "1" if input is a compressed file */
+  unsigned int block:1;		/* "1" if input can be read in blocks */
 
   char ch;			/* next input character */
   int sym;			/* next input token */
@@ -93,6 +97,17 @@ typedef struct {
   int ntokens;			/* number of tokens */
   int toksize;			/* size of array */
 
+  int *dfa;			/* token recognizer built from tokens[],
+				   NULL if out of date */
+  int *dfa_tok;			/* value of token accepted in each state,
+				   or -1 */
+  int dfa_nstates;		/* # of states in use */
+  int *dfa_free;		/* states freed by lex_deltoken */
+  int dfa_nfree;		/* # of freed states */
+  int dfa_maxstates;		/* # of states allocated */
+  int dfa_nclass;		/* # of character classes */
+  unsigned char dfa_class[256];	/* character -> class */
+
   char *whitespace;		/* whitespace preceding this token */
   int whitespace_loc;		/* where I am */
   int whitespace_len;		/* currently allocated whitespace length */
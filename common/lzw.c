@@ -21,7 +21,7 @@
  */
 /****************************************************************************
  *
- *  An implementation of LZW Compression/Decompression
+ *  Compressed file streams
  *
  *  Author: Rajit Manohar
  *  Date: Thu Jul 28 20:29:01 PDT 1994
@@ -31,40 +31,55 @@
  *  interface that enables the user to read and write compressed files using
  *  a lossless compression scheme.
  *
- *  The compression scheme used is a modified version of the scheme outlined
- *  in the article:
- *  Welch, T. "A High Performance Algorithm for Data Compression", 
- *  Computer, June 1984. Pages 8-19.
+ *  Two stream formats are supported:
+ *
+ *   - C_FMT_LZW: the original 12-bit LZW scheme, a modified version of
+ *     the scheme outlined in the article:
+ *       Welch, T. "A High Performance Algorithm for Data Compression",
+ *       Computer, June 1984. Pages 8-19.
+ *
+ *   - C_FMT_GZIP: a gzip stream handled by zlib. It is both faster and
+ *     more compact than the LZW format, but older readers do not
+ *     understand it, so it has to be requested with c_fopen_w_fmt().
+ *
+ *  When a file is opened for reading, the format is determined from the
+ *  first bytes of the file: gzip streams start with a fixed magic
+ *  number, and anything else is treated as LZW. The file is opened
+ *  once and the bytes used for detection are handed to the decoder, so
+ *  pipes and FIFOs can be read as well.
+ *
+ *  All state is kept in the stream handle, so independent streams can be
+ *  used from different threads. A single stream must not be shared
+ *  between threads without external locking.
  *
  *  The following functions are provided:
  *
- *  void c_openread (int *file_handle, char *filename, int *len) 
- *     This function tries to open the file specifed by "filename" 
- *  for reading. The file is assumed to be saved using the routines
- *  provided by in this file. "*len" is the length of the string in 
- *  "filename". "*file_handle" will contain the file handle which is to
- *  be used to refer to the file. If an error occurred while opening the
- *  file, "*file_handle" will be -1. 
+ *  FILE *c_fopen_r (const char *filename)
+ *     Open a compressed file for reading. Returns NULL on error.
  *
- *  void c_openwrite (int *file_handle, char *filename, int *len)
- *     Similar to c_openread, only opens the file for writing. It destroys
- *  any existing file with the same name.
+ *  FILE *c_fopen_w (const char *filename)
+ *  FILE *c_fopen_w_fmt (const char *filename, int fmt)
+ *     Open a compressed file for writing, destroying any existing file
+ *  with the same name. The first form uses C_FMT_DEFAULT.
  *
- *  void c_close (int *file_handle)
+ *  void c_fclose (FILE *fp)
  *     Closes the file. THIS IS IMPORTANT! If the file is not closed, then
- *  the contents of the file may be lost. 
+ *  the contents of the file may be lost.
  *
- *  int c_read (int *file_handle, char *array, int *size)
- *     Tries to read in "*size" values into "array" from "file_handle". 
- *  Returns the number of values actually read in.
+ *  int c_fread (char *buf, int sz, int n, FILE *fp)
+ *  int c_fwrite (char *buf, int sz, int n, FILE *fp)
+ *     Read/write "n" items of size "sz". Returns the number of items
+ *  actually read/written. A gzip stream that ends in the middle of an
+ *  item is reported as an error.
  *
- *  int c_write (int *file_handle, char *array, int *size)
- *     Tries to write out "*size" values from "array" into "file_handle".
- *  It returns the number of values actually written to the file.
+ *  char *c_fgets (char *buf, int len, FILE *fp)
+ *     Compressed equivalent of fgets().
  *
  *****************************************************************************/
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include <zlib.h>
 #include "misc.h"
 #include "lzw.h"
 #include "avl.h"
@@ -101,153 +116,304 @@ typedef struct {
     struct {
       avl_t *forw[MAX_TABLE_SIZE]; /* forward links: used for compression */
                                     /* avl_t is a search tree ADT */
-      int location;		
+      int location;
     } c;			/* compression data structures */
   } u;
   int size;			/* sizeof used table */
 } Table;
 
-static Table *cbuf[MAX_OPEN_FILES]; /* compression table */
 
-static boolean used[MAX_OPEN_FILES]; /* true if used, false otherwise */
+/***** Stream handle *****/
+
+#define GZ_BUFSZ (128*1024)
+
+typedef struct {
+  FILE *fp;			/* compressed input */
+  z_stream zs;
+  byte *in, *out;		/* input and output buffers */
+  int outpos, outlen;		/* unread data in out[] */
+  boolean member;		/* true if inside a gzip member */
+  boolean eof;			/* true if input is exhausted */
+} GzRead;
+
+typedef struct {
+  int fmt;			/* C_FMT_LZW or C_FMT_GZIP */
+  boolean read;			/* true if opened for reading */
+  Table *t;			/* LZW state */
+  gzFile gz;			/* gzip state, writing */
+  GzRead *gr;			/* gzip state, reading */
+} cfile_t;
+
+#define GZIP_MAGIC0 0x1f
+#define GZIP_MAGIC1 0x8b
 
 
 /*------------------------------------------------------------------------
-  Returns a new slot from the compression table.
+  Convert between the opaque handle and the stream state
 ------------------------------------------------------------------------*/
-static int new_slot (void)
+static cfile_t *_cfile (FILE *fp, const char *who)
 {
-  int i;
-  for (i=0; i < MAX_OPEN_FILES; i++)
-    if (!used[i])
-      return i;
-  return -1;
+  if (!fp) {
+    fatal_error ("%s: Invalid file handle.", who);
+  }
+  return (cfile_t *)fp;
 }
 
 
 /*------------------------------------------------------------------------
-  Initializes all data structures.
+  LZW table setup
 ------------------------------------------------------------------------*/
-static void initialize_func (void)
+/* "hdr" holds the first "n" bytes of the file, already read from fp */
+static Table *lzw_open_r (FILE *fp, byte *hdr, int n)
 {
-  static int init = 0;
-  int i, j;
-  if (init) return;
-  if (!init) {
-    init = 1;
-    for (i=0; i < MAX_OPEN_FILES; i++)
-      used[i] = False;
+  Table *t;
+  int j;
+
+  NEW (t, Table);
+  t->fp = fp;
+  t->read = True;
+  for (j=0; j < 256; j++) {
+    t->tab[j] = j;
+    t->u.d.link[j] = -1;
   }
+  t->size = 256;
+  t->empty = True;
+  t->start = True;
+  t->eof = False;
+  for (j=0; j < n; j++) {
+    t->iobuf[j] = hdr[j];
+  }
+  if (n != 3)
+    if (n != 0)
+      t->empty = True;
+    else
+      t->eof = True;
+  else
+    t->empty = False;
+  return t;
 }
 
- 
-/*------------------------------------------------------------------------*/
-/*------------------------------------------------------------------------*/
-FILE *c_fopen_r (const char *s)
+/* "hdr" holds the first "n" bytes of the file, already read from fp */
+static GzRead *gz_open_r (FILE *fp, byte *hdr, int n)
 {
-  int i, j;
-
-  initialize_func ();
-  
-  if ((i = new_slot()) == -1) {
-    printf ("Warning: c_fopen_r: Too many open files. Maximum allowed: %d\n",
-	    MAX_OPEN_FILES);
+  GzRead *g;
+
+  NEW (g, GzRead);
+  g->fp = fp;
+  MALLOC (g->in, byte, GZ_BUFSZ);
+  MALLOC (g->out, byte, GZ_BUFSZ);
+  memcpy (g->in, hdr, n);
+  g->zs.zalloc = Z_NULL;
+  g->zs.zfree = Z_NULL;
+  g->zs.opaque = Z_NULL;
+  g->zs.next_in = g->in;
+  g->zs.avail_in = n;
+  if (inflateInit2 (&g->zs, 15 + 16) != Z_OK) {
+    FREE (g->in);
+    FREE (g->out);
+    FREE (g);
     return NULL;
   }
-  used[i] = True;
-  cbuf[i] = (Table *)malloc(sizeof(Table));
-  if (!cbuf[i]) {
-	printf ("MALLOC FAILED. size=%lu\n", sizeof(Table));
-	exit (1);
+  g->outpos = 0;
+  g->outlen = 0;
+  g->member = True;
+  g->eof = False;
+  return g;
+}
+
+static void gz_close_r (GzRead *g)
+{
+  inflateEnd (&g->zs);
+  fclose (g->fp);
+  FREE (g->in);
+  FREE (g->out);
+  FREE (g);
+}
+
+/*
+  Make decompressed data available in g->out. Returns the number of
+  unread bytes; 0 at end of file. Concatenated gzip members are read
+  as one stream, like gzread() does.
+*/
+static int gz_fill (GzRead *g)
+{
+  int r;
+
+  while (g->outpos == g->outlen) {
+    if (g->eof) {
+      return 0;
+    }
+    if (g->zs.avail_in == 0) {
+      g->zs.avail_in = fread (g->in, 1, GZ_BUFSZ, g->fp);
+      g->zs.next_in = g->in;
+      if (g->zs.avail_in == 0) {
+	g->eof = True;
+	if (g->member) {
+	  warning ("c_fread: gzip stream is truncated");
+	}
+	return 0;
+      }
+    }
+    g->member = True;
+    g->zs.next_out = g->out;
+    g->zs.avail_out = GZ_BUFSZ;
+    r = inflate (&g->zs, Z_NO_FLUSH);
+    g->outpos = 0;
+    g->outlen = GZ_BUFSZ - g->zs.avail_out;
+    if (r == Z_STREAM_END) {
+      g->member = False;
+      inflateReset (&g->zs);
+    }
+    else if (r != Z_OK && r != Z_BUF_ERROR) {
+      warning ("c_fread: corrupt gzip stream (%s)",
+	       g->zs.msg ? g->zs.msg : "unknown error");
+      g->eof = True;
+      g->member = False;
+    }
   }
-  if (!(cbuf[i]->fp = fopen(s, "rb"))) {
-    printf ("Warning: c_openread: Could not open file [%s] for reading.\n",
-	    s);
+  return g->outlen - g->outpos;
+}
+
+static Table *lzw_open_w (const char *s)
+{
+  Table *t;
+  int j;
+
+  NEW (t, Table);
+  if (!(t->fp = fopen(s, "wb"))) {
+    FREE (t);
     return NULL;
   }
-  cbuf[i]->read = True;
+  t->read = False;
   for (j=0; j < 256; j++) {
-    cbuf[i]->tab[j] = j;
-    cbuf[i]->u.d.link[j] = -1;
+    t->tab[j] = j;
+    t->u.c.forw[j] = NULL;
   }
-  cbuf[i]->size = 256;
-  cbuf[i]->empty = True;
-  cbuf[i]->start = True;
-  cbuf[i]->eof = False;
-  if ((j = fread (cbuf[i]->iobuf, 1, 3, cbuf[i]->fp)) != 3)
-    if (j != 0)
-      cbuf[i]->empty = True;
-    else
-      cbuf[i]->eof = True;
-  else
-    cbuf[i]->empty = False;
-
-  return (FILE *) (unsigned long) (i+1);
+  t->size = 256;
+  t->empty = True;
+  t->start = True;
+  t->eof = False;
+  t->u.c.location = -1;
+  return t;
 }
 
 
 /*------------------------------------------------------------------------*/
 /*------------------------------------------------------------------------*/
-FILE *c_fopen_w (const char *s)
+FILE *c_fopen_r (const char *s)
 {
-  int i, j;
+  cfile_t *c;
+  FILE *fp;
+  byte hdr[3];
+  int n;
 
-  initialize_func ();
-  
-  if ((i = new_slot()) == -1) {
-    printf ("Warning: c_openwrite: Too many open files. Maximum allowed: %d\n",
-	    MAX_OPEN_FILES);
+  if (!(fp = fopen (s, "rb"))) {
+    printf ("Warning: c_fopen_r: Could not open file [%s] for reading.\n",
+	    s);
     return NULL;
   }
-  used[i] = True;
-  cbuf[i] = (Table *)malloc(sizeof(Table));
-  if (!cbuf[i]) {
-	printf ("MALLOC FAILED. size=%lu\n", sizeof(Table));
-	exit (1);
+  /* the LZW reader starts with a 3-byte block; that is enough to
+     check for the gzip magic number too */
+  n = fread (hdr, 1, 3, fp);
+
+  NEW (c, cfile_t);
+  c->read = True;
+  c->t = NULL;
+  c->gz = NULL;
+  c->gr = NULL;
+
+  if (n >= 2 && hdr[0] == GZIP_MAGIC0 && hdr[1] == GZIP_MAGIC1) {
+    c->fmt = C_FMT_GZIP;
+    c->gr = gz_open_r (fp, hdr, n);
+  }
+  else {
+    c->fmt = C_FMT_LZW;
+    c->t = lzw_open_r (fp, hdr, n);
   }
-  if (!(cbuf[i]->fp = fopen(s, "wb"))) {
-    printf ("Warning: c_openwrite: Could not open file [%s] for writing.\n",
+  if (!c->t && !c->gr) {
+    printf ("Warning: c_fopen_r: Could not open file [%s] for reading.\n",
 	    s);
+    fclose (fp);
+    FREE (c);
     return NULL;
   }
-  cbuf[i]->read = False;
-  for (j=0; j < 256; j++) {
-    cbuf[i]->tab[j] = j;
-    cbuf[i]->u.c.forw[j] = NULL;
+  return (FILE *)c;
+}
+
+
+/*------------------------------------------------------------------------*/
+/*------------------------------------------------------------------------*/
+FILE *c_fopen_w_fmt (const char *s, int fmt)
+{
+  cfile_t *c;
+
+  NEW (c, cfile_t);
+  c->fmt = fmt;
+  c->read = False;
+  c->t = NULL;
+  c->gz = NULL;
+  c->gr = NULL;
+
+  if (fmt == C_FMT_GZIP) {
+    /* level 1: favor throughput over compression ratio */
+    c->gz = gzopen (s, "wb1");
+    if (c->gz) {
+      gzbuffer (c->gz, 128*1024);
+    }
+  }
+  else if (fmt == C_FMT_LZW) {
+    c->t = lzw_open_w (s);
+  }
+  else {
+    fatal_error ("c_fopen_w_fmt: unknown format %d", fmt);
   }
-  cbuf[i]->size = 256;
-  cbuf[i]->empty = True;
-  cbuf[i]->start = True;
-  cbuf[i]->eof = False;
-  cbuf[i]->u.c.location = -1;
+  if (!c->t && !c->gz) {
+    printf ("Warning: c_fopen_w: Could not open file [%s] for writing.\n",
+	    s);
+    FREE (c);
+    return NULL;
+  }
+  return (FILE *)c;
+}
 
-  return (FILE*) (unsigned long) (i+1);
+FILE *c_fopen_w (const char *s)
+{
+  return c_fopen_w_fmt (s, C_FMT_DEFAULT);
+}
+
+
+/*------------------------------------------------------------------------
+  Returns the format of an open stream
+------------------------------------------------------------------------*/
+int c_fformat (FILE *fp)
+{
+  return _cfile (fp, "c_fformat")->fmt;
 }
 
 
 /*------------------------------------------------------------------------
   Puts a 12-bit value into the output buffer/file.
-  entry - pointer to the compression table.
+  t     - pointer to the compression table.
   val   - value to be written out.
 ------------------------------------------------------------------------*/
-static void put12 (int entry, int val)
+static void put12 (Table *t, int val)
 {
-  if (cbuf[entry]->empty) {
+  if (t->empty) {
     /* empty */
-    cbuf[entry]->iobuf[0] = val%256;
-    cbuf[entry]->iobuf[1] = val/256;
-    cbuf[entry]->empty = False;
+    t->iobuf[0] = val%256;
+    t->iobuf[1] = val/256;
+    t->empty = False;
   }
   else {
     int i, x;
 
     /* half-full */
-    cbuf[entry]->iobuf[1] |= ((val/256) << 4);
-    cbuf[entry]->iobuf[2] = val%256;
+    t->iobuf[1] |= ((val/256) << 4);
+    t->iobuf[2] = val%256;
 
     i = 0;
     do {
-      x = fwrite (cbuf[entry]->iobuf + i, 1, 3-i, cbuf[entry]->fp);
+      x = fwrite (t->iobuf + i, 1, 3-i, t->fp);
       if (x+i != 3) {
 	printf ("lzw.c:put12: fwrite failed, retrying...\n");
 	sleep (5);
@@ -255,92 +421,93 @@ static void put12 (int entry, int val)
 	x = 0;
       }
     } while (x+i != 3);
-    cbuf[entry]->empty = True;
+    t->empty = True;
   }
 }
 
 
 /*------------------------------------------------------------------------
   Reads in a 12-bit value into *val.
-  entry - pointer to the compression table.
+  t      - pointer to the compression table.
   *val   - value to be read in.
 ------------------------------------------------------------------------*/
-static void get12 (int entry, int *val)
+static void get12 (Table *t, int *val)
 {
   int i;
-  if (cbuf[entry]->eof && cbuf[entry]->empty) {
+  if (t->eof && t->empty) {
     *val = -1;
   }
   else {
-    if (!cbuf[entry]->empty) {
+    if (!t->empty) {
       /* full */
-      *val = cbuf[entry]->iobuf[0];
-      *val += 256*(cbuf[entry]->iobuf[1] & 0x0F);
-      cbuf[entry]->empty = True;
+      *val = t->iobuf[0];
+      *val += 256*(t->iobuf[1] & 0x0F);
+      t->empty = True;
     }
     else {
       /* half-full */
-      *val = cbuf[entry]->iobuf[2];
-      *val += 256*(cbuf[entry]->iobuf[1] >> 4);
-      if ((i = fread (cbuf[entry]->iobuf, 1, 3, cbuf[entry]->fp)) != 3)
+      *val = t->iobuf[2];
+      *val += 256*(t->iobuf[1] >> 4);
+      if ((i = fread (t->iobuf, 1, 3, t->fp)) != 3)
 	if (i != 0) {
-	  cbuf[entry]->eof = True;
-	  cbuf[entry]->empty = False;
+	  t->eof = True;
+	  t->empty = False;
 	}
 	else {
-	  cbuf[entry]->eof = True;
-	  cbuf[entry]->empty = True;
+	  t->eof = True;
+	  t->empty = True;
 	}
       else
-	cbuf[entry]->empty = False;
+	t->empty = False;
     }
   }
-}  
- 
+}
+
 
 /*------------------------------------------------------------------------*/
 /*------------------------------------------------------------------------*/
+static void lzw_close (Table *t)
+{
+  int i;
+
+  if (!t->read && (t->u.c.location != -1)) {
+    put12 (t, t->u.c.location);
+    if (!t->empty)
+      fwrite (t->iobuf, 1, 2, t->fp);
+  }
+  fclose (t->fp);
+  if (!t->read)
+    for (i=0; i < t->size; i++)
+      avl_free (t->u.c.forw[i]);
+  FREE (t);
+}
+
 void c_fclose (FILE *fp)
 {
-  int i, f;
-  
-  f = ((unsigned long) fp) - 1;
-
-  Assert ((f >= 0) && (f < MAX_OPEN_FILES), "c_fclose: Invalid file handle.");
-  Assert (used[f], "c_close: Invalid file handle.");
-  if (!cbuf[f]->read && (cbuf[f]->u.c.location != -1)) {
-    put12 (f, cbuf[f]->u.c.location);
-    if (!cbuf[f]->empty)
-      fwrite (cbuf[f]->iobuf, 1, 2, cbuf[f]->fp);
+  cfile_t *c = _cfile (fp, "c_fclose");
+
+  if (c->gr) {
+    gz_close_r (c->gr);
   }
-  fclose (cbuf[f]->fp);
-  used[f] = False;
-  if (!cbuf[f]->read)
-    for (i=0; i < cbuf[f]->size; i++)
-      avl_free (cbuf[f]->u.c.forw[i]);
-  free (cbuf[f]);
+  else if (c->gz) {
+    gzclose (c->gz);
+  }
+  else {
+    lzw_close (c->t);
+  }
+  FREE (c);
 }
 
 
 /*------------------------------------------------------------------------*/
 /*------------------------------------------------------------------------*/
-int c_fwrite (char *buf, int sz, int n, FILE *fp)
+static int lzw_write (Table *t, char *buf, int sz, int n)
 {
   int i;
   int st;
   int pos;
-  int f;
-  Table *t;
-
-  f = ((unsigned long)fp) - 1;
 
-  Assert ((f >= 0) && (f < MAX_OPEN_FILES), 
-	  "c_fwrite: Invalid file handle.");
-  Assert (used[f], "c_fwrite: Invalid file handle.");
-  Assert (cbuf[f]->read == False, 
-	  "c_fwrite: Specified file was opened for reading.");
   /* hmm... check special case for startup */
-  t = cbuf[f];
   st = 0;
   if (t->start) {
     t->start = False;
@@ -350,25 +517,25 @@ int c_fwrite (char *buf, int sz, int n, FILE *fp)
   /* hmm... */
   /* do compression stuff */
   for (i=st; i < sz*n; i++) {
-    if ((pos = (long)avl_search (t->u.c.forw[t->u.c.location],(int)buf[i]))) 
+    if ((pos = (long)avl_search (t->u.c.forw[t->u.c.location],(int)buf[i])))
       t->u.c.location = pos-1;
     else {
       if (t->size < (MAX_TABLE_SIZE-1)) {
 	t->tab[t->size] = buf[i];
 	if (!t->u.c.forw[t->u.c.location])
-	  t->u.c.forw[t->u.c.location] = 
+	  t->u.c.forw[t->u.c.location] =
 	    avl_new ((int)buf[i],(void*)(unsigned long)(t->size+1));
 	else
 	  avl_insert (t->u.c.forw[t->u.c.location], (int)buf[i],
 		      (void*)(unsigned long)(t->size+1));
 	t->u.c.forw[t->size] = NULL;
 	t->size++;
-	
-	put12 (f, t->u.c.location);
+
+	put12 (t, t->u.c.location);
 
 	if (t->size == (MAX_TABLE_SIZE-1)) {
 	  int j;
-	  put12 (f, MAX_TABLE_SIZE-1);
+	  put12 (t, MAX_TABLE_SIZE-1);
 	  for (j=0; j < t->size; j++) {
 	    avl_free (t->u.c.forw[j]);
 	    t->u.c.forw[j] = NULL;
@@ -384,33 +551,37 @@ int c_fwrite (char *buf, int sz, int n, FILE *fp)
   return n;
 }
 
+int c_fwrite (char *buf, int sz, int n, FILE *fp)
+{
+  cfile_t *c = _cfile (fp, "c_fwrite");
+
+  Assert (c->read == False,
+	  "c_fwrite: Specified file was opened for reading.");
+
+  if (sz*n == 0) return 0;
+
+  if (c->fmt == C_FMT_GZIP) {
+    return gzwrite (c->gz, buf, sz*n)/sz;
+  }
+  return lzw_write (c->t, buf, sz, n);
+}
+
 
 /*------------------------------------------------------------------------*/
 /*------------------------------------------------------------------------*/
-int c_fread (char *buf, int sz, int n, FILE *fp)
+static int lzw_read (Table *t, char *buf, int sz, int n)
 {
-  int i, st;
+  int st;
   int bufpos;
   int count;
-  Table *t;
-  int f;
-
-  f = ((long)fp)-1;
 
-  Assert ((f >= 0) && (f < MAX_OPEN_FILES), 
-	  "c_read: Invalid file handle.");
-  Assert (used[f], "c_read: Invalid file handle.");
-  Assert (cbuf[f]->read == True, 
-	  "c_read: Specified file was opened for writing.");
-
-  t = cbuf[f];
   st = 0;
   bufpos = 0;
   count = 0;
   if (t->start) {
     t->start = False;
 
-    get12 (f, &t->u.d.code);
+    get12 (t, &t->u.d.code);
     if (t->u.d.code == -1) return 0;
     t->u.d.oldcode = t->u.d.code;
     buf[0] = t->tab[t->u.d.code];
@@ -438,7 +609,7 @@ int c_fread (char *buf, int sz, int n, FILE *fp)
     if (st == n) return st;
 
     /* do one step */
-    get12 (f, &t->u.d.code);
+    get12 (t, &t->u.d.code);
 
 #define PUTBACK					\
     do {					\
@@ -456,13 +627,13 @@ int c_fread (char *buf, int sz, int n, FILE *fp)
 
     if (t->u.d.code == (MAX_TABLE_SIZE-1)) {
       t->size = 256;
-      get12 (f, &t->u.d.code);
+      get12 (t, &t->u.d.code);
       t->u.d.oldcode = t->u.d.code;
       if (t->u.d.code == -1) {
 	PUTBACK;
 	return st;
       }
-      
+
       buf[bufpos++] = t->tab[t->u.d.code];
       count++;
       if (count == sz) {
@@ -493,6 +664,34 @@ int c_fread (char *buf, int sz, int n, FILE *fp)
   return st;
 }
 
+int c_fread (char *buf, int sz, int n, FILE *fp)
+{
+  cfile_t *c = _cfile (fp, "c_fread");
+
+  Assert (c->read == True,
+	  "c_fread: Specified file was opened for writing.");
+
+  if (sz*n == 0) return 0;
+
+  if (c->fmt == C_FMT_GZIP) {
+    int x = 0, k;
+    while (x < sz*n && (k = gz_fill (c->gr)) > 0) {
+      if (k > sz*n - x) {
+	k = sz*n - x;
+      }
+      memcpy (buf + x, c->gr->out + c->gr->outpos, k);
+      c->gr->outpos += k;
+      x += k;
+    }
+    if (x % sz != 0) {
+      warning ("c_fread: file ends in the middle of an item (%d of %d bytes)",
+	       x % sz, sz);
+    }
+    return x/sz;
+  }
+  return lzw_read (c->t, buf, sz, n);
+}
+
 
 
 /*------------------------------------------------------------------------
@@ -501,13 +700,28 @@ int c_fread (char *buf, int sz, int n, FILE *fp)
  */
 char *c_fgets (char *buf, int len, FILE *fp)
 {
+  cfile_t *c = _cfile (fp, "c_fgets");
   char *s = buf;
   int flag = 0;
 
+  if (c->fmt == C_FMT_GZIP) {
+    GzRead *g = c->gr;
+    int i = 0;
+
+    while (i < len-1 && gz_fill (g) > 0) {
+      buf[i] = g->out[g->outpos++];
+      if (buf[i++] == '\n') {
+	break;
+      }
+    }
+    buf[i] = '\0';
+    return (i == 0 ? NULL : buf);
+  }
+
   buf[len-1] = '\0';
   len--;
   while (len--) {
-    if (c_fread (buf, 1, 1, fp) == 1) {
+    if (lzw_read (c->t, buf, 1, 1) == 1) {
       flag = 1;
       if (*buf == '\n' && len > 0) {
 	buf[1] = '\0';
@@ -31,19 +31,29 @@ extern "C" {
 #endif
 
 /******************************************************************************
- * #defines that you might want to modify.
+ * Stream formats.
  *
- *  MAX_OPEN_FILES:
- *       The maximum number of files that can be open at one time.
+ *  C_FMT_LZW:     the original 12-bit LZW format
+ *  C_FMT_GZIP:    gzip stream (zlib)
+ *  C_FMT_DEFAULT: format used by c_fopen_w()
+ *
+ *  The default stays LZW so that files remain readable by older
+ *  tools; use c_fopen_w_fmt() to write gzip. c_fopen_r() detects the
+ *  format of an existing file automatically.
  *
  *****************************************************************************/
-#define MAX_OPEN_FILES 256	/* maximum number of open files */
+#define C_FMT_LZW     0
+#define C_FMT_GZIP    1
+
+#define C_FMT_DEFAULT C_FMT_LZW
 
 /**** Compressed I/O Routine Declarations ****/
 
 FILE *c_fopen_r (const char *s);
 FILE *c_fopen_w (const char *s);
+FILE *c_fopen_w_fmt (const char *s, int fmt);
 void c_fclose (FILE *fp);
+int c_fformat (FILE *fp);
 
 int c_fwrite (char *buf, int sz, int n, FILE *fp);
 int c_fread (char *buf, int sz, int n, FILE *fp);
@@ -22,17 +22,23 @@
  **************************************************************************
  */
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "mem.h"
 #include "misc.h"
 #include "sim.h"
 #include "thread.h"
 
-#define CHUNK_SIZE 16384
-#define CHUNK_THRESHOLD 16 /* gc threshold */
-static int adj_merge_size = 16384;
-#define ADJ_LIMIT 1024*32
+#define MEM_LEVEL_MASK ((1UL << MEM_LEVEL_BITS)-1)
 
-#define DOUBLE_THRESHOLD (1024*1024*256)
+/* number of pages that can be addressed */
+#define MEM_MAXPAGE (1ULL << (64 - MEM_ALIGN - MEM_PAGE_BITS))
+
+/* hex digits in a data value/address */
+#define MEM_HEXDIGITS (2 << MEM_ALIGN)
 
 #ifndef MIN
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
@@ -41,22 +47,36 @@ static int adj_merge_size = 16384;
 /*
  * free memory image
  */
-void Mem::freemem (void)
+void Mem::_freetree (void **t, int level)
 {
-  int i;
+  unsigned long i;
+
+  if (level < MEM_LEVELS-1) {
+    for (i=0; i <= MEM_LEVEL_MASK; i++)
+      if (t[i])
+	_freetree ((void **)t[i], level+1);
+  }
+  else {
+    for (i=0; i <= MEM_LEVEL_MASK; i++)
+      if (t[i])
+	FREE (t[i]);
+  }
+  FREE (t);
+}
 
+void Mem::freemem (void)
+{
   context_disable ();
 
-  if (chunks > 0) {
-    for (i=0; i < chunks; i++)
-      FREE (mem[i]);
-    FREE (mem);
-    FREE (mem_len);
-    FREE (mem_addr);
-    chunks = 0;
-    numchunks = 0;
-    last_chunk_collect = 0;
+  if (root) {
+    _freetree (root, 0);
+    root = NULL;
   }
+  npages = 0;
+  last_page = MEM_MAXPAGE;
+  last_data = NULL;
+  last_leaf = MEM_MAXPAGE;
+  last_leafp = NULL;
 
   context_enable ();
 }
@@ -68,194 +88,114 @@ Mem::~Mem (void)
 
 Mem::Mem (void)
 {
-  chunks = 0;
-  numchunks = 0;
-  last_chunk_collect = 0;
+  root = NULL;
+  npages = 0;
+  last_page = MEM_MAXPAGE;
+  last_data = NULL;
+  last_leaf = MEM_MAXPAGE;
+  last_leafp = NULL;
 }
 
-/*
- * add one more slot to memory array
- */
-void Mem::get_more (int ch, long long num, int merging)
+static void **_newtable (void)
 {
-  long long newnum;
-  unsigned long long t;
-  if (num <= 0) return;
-  
-  if (!merging) {
-    Assert ((ch == chunks - 1) ||
-	    (mem_len[ch] + num + mem_addr[ch] - 1 < mem_addr[ch+1]),
-	    "Overlap violation");
-
-    if (mem_len[ch] < DOUBLE_THRESHOLD)
-      newnum = mem_len[ch];
-    else 
-      newnum = CHUNK_SIZE;
-
-    if (newnum < num)
-      newnum = num;
-
-    if (ch < chunks - 1) {
-      /* double if possible */
-      if (mem_addr[ch] + mem_len[ch] + newnum - 1 < mem_addr[ch+1]) {
-	num = newnum;
-      }
-      else {
-	num = mem_addr[ch+1] - mem_addr[ch] - mem_len[ch];
-      }
-    }
-    else {
-      num = newnum;
-    }
-    mem_len[ch] += num;
-    REALLOC (mem[ch], LL, mem_len[ch]);
-    for (t=mem_len[ch]-1;t>=mem_len[ch]-num;t--) {
-       mem[ch][t] = MEM_BAD;
-    }
-    return;
-  }
-  /* merging */
-  if (mem_len[ch] == 0) {
-    mem_len[ch] = num;
-    MALLOC (mem[ch], LL, mem_len[ch]);
-    for (t=0;t<=mem_len[ch]-1;t++) {
-       mem[ch][t] = MEM_BAD;
-    }
-  }
-  else {
-    mem_len[ch] += num;
-    REALLOC (mem[ch], LL, mem_len[ch]);
-    for (t=mem_len[ch]-1;t>=mem_len[ch]-num;t--) {
-       mem[ch][t] = MEM_BAD;
-    }
-  }
+  void **t;
+  unsigned long i;
+
+  MALLOC (t, void *, MEM_LEVEL_MASK+1);
+  for (i=0; i <= MEM_LEVEL_MASK; i++)
+    t[i] = NULL;
+  return t;
 }
 
 /*
- * create new chunk, at position "chunks-1"
- *
- * Return values:
- *
- *   1  => created a new chunk at array position "chunks-1"
- *   0  => resized array at position ch
+ * find page number "page"; allocate it (filled with MEM_BAD) if
+ * create is set, otherwise return NULL if it doesn't exist
  */
-int Mem::create_new_chunk (LL addr, int ch)
+inline LL *Mem::_getpage (LL page, int create)
 {
-  int i, gap;
-  static int last_create = -1;
-
-  if (chunks == numchunks) {
-    if (numchunks == 0) {
-      numchunks = 4;
-      MALLOC (mem, LL *, numchunks);
-      MALLOC (mem_len, unsigned long, numchunks);
-      MALLOC (mem_addr, LL, numchunks);
-    }
-    else {
-      numchunks *= 2;
-      REALLOC (mem, LL *, numchunks);
-      REALLOC (mem_len, unsigned long, numchunks);
-      REALLOC (mem_addr, LL, numchunks);
-    }
+  void **t;
+  unsigned long i;
+  int l;
+
+  if (page == last_page)
+    return last_data;
+
+  if ((page >> MEM_LEVEL_BITS) == last_leaf) {
+    t = last_leafp;
+    goto leaf;
   }
-  if (0 <= ch && ch < chunks) {
-    /* the new chunk is right next to "ch" */
-    if (mem_addr[ch] - addr >= CHUNK_SIZE)
-      mem_len[chunks] = CHUNK_SIZE;
-    else {
-      /* next chunk is close by, we need to just adjust the size of
-	 the next chunk by CHUNK_SIZE *backward*
-      */
-      if (ch > 0) {
-	if (last_create == ch) {
-	  adj_merge_size *= 2;
-	  if (adj_merge_size > ADJ_LIMIT)
-	    adj_merge_size = ADJ_LIMIT;
-	}
-	last_create = ch;
-	
-	gap = mem_addr[ch] - mem_len[ch-1] - mem_addr[ch-1];
-	gap = MIN (gap, adj_merge_size);
-	REALLOC (mem[ch], LL, mem_len[ch] + gap);
-	for (i=mem_len[ch]-1; i >= 0; i--) {
-	  mem[ch][i+gap] = mem[ch][i];
-	}
-	for (i=0; i < gap; i++) {
-	  mem[ch][i] = MEM_BAD;
-	}
-	mem_addr[ch] = mem_addr[ch] - gap;
-	mem_len[ch] = mem_len[ch] + gap;
-	return 0;
-      }
-      mem_len[chunks] = mem_addr[ch] - addr;
-    }
-    Assert (mem_len[chunks] > 0, "What?");
+
+  if (!root) {
+    if (!create) return NULL;
+    context_disable ();
+    root = _newtable ();
+    context_enable ();
   }
-  else {
-    mem_len[chunks] = CHUNK_SIZE;
+  t = root;
+  for (l=0; l < MEM_LEVELS-1; l++) {
+    i = (page >> ((MEM_LEVELS-1-l)*MEM_LEVEL_BITS)) & MEM_LEVEL_MASK;
+    if (!t[i]) {
+      if (!create) return NULL;
+      context_disable ();
+      t[i] = _newtable ();
+      context_enable ();
+    }
+    t = (void **)t[i];
   }
-  MALLOC (mem[chunks], LL, mem_len[chunks]);
-  mem_addr[chunks] = 0;
-  for (i=0;i<=mem_len[chunks]-1;i++) {
-     mem[chunks][i] = MEM_BAD;
+  last_leaf = page >> MEM_LEVEL_BITS;
+  last_leafp = t;
+
+ leaf:
+  i = page & MEM_LEVEL_MASK;
+  if (!t[i]) {
+    LL *data;
+    unsigned long j;
+
+    if (!create) return NULL;
+    context_disable ();
+    MALLOC (data, LL, MEM_PAGE_SIZE);
+    for (j=0; j < MEM_PAGE_SIZE; j++)
+      data[j] = MEM_BAD;
+    t[i] = data;
+    npages++;
+    context_enable ();
   }
-  chunks++;
-  return 1;
+  last_page = page;
+  last_data = (LL *)t[i];
+  return last_data;
 }
 
-inline int Mem::_binsearch (LL addr)
+/*
+ * find the first allocated page >= *page, and set *page to its
+ * number. Returns NULL if there isn't one.
+ */
+LL *Mem::_nextpage (void **t, int level, LL prefix, LL *page)
 {
-  int i, j, m;
-  
-  if (chunks == 0) return -1;
-  
-  i = 0; j = chunks;
-
-  while ((i+1) != j) {
-    m = (i+j)/2;
-    if (mem_addr[m] > addr)
-      j = m;
-    else
-      i = m;
-  }
-  if (mem_addr[i] <= addr && addr < mem_addr[i] + mem_len[i])
-    return i;
-  else {
-    return -1;
+  int shift = (MEM_LEVELS-1-level)*MEM_LEVEL_BITS;
+  unsigned long i;
+  LL *r;
+
+  if ((*page >> shift) >> MEM_LEVEL_BITS == prefix)
+    i = (*page >> shift) & MEM_LEVEL_MASK;
+  else
+    i = 0;
+  for (; i <= MEM_LEVEL_MASK; i++) {
+    if (!t[i]) continue;
+    if (level == MEM_LEVELS-1) {
+      *page = (prefix << MEM_LEVEL_BITS) | i;
+      return (LL *)t[i];
+    }
+    r = _nextpage ((void **)t[i], level+1, (prefix << MEM_LEVEL_BITS) | i,
+		   page);
+    if (r) return r;
   }
+  return NULL;
 }
 
-
-
-inline int Mem::_binsearchw (LL addr)
+LL *Mem::_nextpage (LL *page)
 {
-  int i, j, m;
-  
-  if (chunks == 0) return 0;
-  
-  i = 0; j = chunks;
-
-  while ((i+1) != j) {
-    m = (i+j)/2;
-    if (addr < mem_addr[m])
-      j = m;
-    else
-      i = m;
-  }
-  if (mem_addr[i] <= addr && addr <= mem_addr[i] + mem_len[i]) {
-    if (i > 0 && mem_addr[i-1] + mem_len[i-1] == addr)
-      return i-1;
-    return i;
-  }
-  else {
-    /* not found */
-    if (addr < mem_addr[0])
-      return 0;
-    else if (addr > mem_addr[chunks-1] + mem_len[chunks-1])
-      return chunks;
-    else
-      return i+1;
-  }
+  if (!root || *page >= MEM_MAXPAGE) return NULL;
+  return _nextpage (root, 0, 0, page);
 }
 
 /*
@@ -264,141 +204,145 @@ inline int Mem::_binsearchw (LL addr)
 LL 
 Mem::Read (LL addr)
 {
-  int i, w;
+  LL *data;
 
   addr >>= MEM_ALIGN;
-  w = _binsearch (addr);
-  if (w == -1) {
+  data = _getpage (addr >> MEM_PAGE_BITS, 0);
+  if (!data) {
     return MEM_BAD;
   }
-  else {
-    return mem[w][addr-mem_addr[w]];
-  }
+  return data[addr & (MEM_PAGE_SIZE-1)];
 }
 
-/* merge two chunks */
-void Mem::merge_chunks (int c1, int c2)
+/*
+ * store value at addr
+ */
+void 
+Mem::Write (LL addr, LL val)
 {
-  unsigned long int i;
-
-  Assert (mem_addr[c1]+mem_len[c1] == mem_addr[c2], "What?");
-  Assert (c1 < c2, "Hmm...");
-
-  get_more (c1, mem_len[c2], 1);
-  for (i=0; i < mem_len[c2]; i++) {
-    mem[c1][i+mem_addr[c2]-mem_addr[c1]] = mem[c2][i];
-  }
-  FREE (mem[c2]);
-  for (i=c2; i < chunks-1; i++) {
-    mem[i] = mem[i+1];
-    mem_len[i] = mem_len[i+1];
-    mem_addr[i] = mem_addr[i+1];
-  }
-  mem_len[i] = 0;
-  chunks--;
-
-  return;
+  addr >>= MEM_ALIGN;
+  _getpage (addr >> MEM_PAGE_BITS, 1)[addr & (MEM_PAGE_SIZE-1)] = val;
 }
 
 /*
- *  garbage collect chunks periodically
+ * read/write n values starting at addr
  */
-void Mem::chunk_gc (int force)
+void
+Mem::ReadBlock (LL addr, LL *buf, unsigned long n)
 {
-  int i;
+  LL *data;
+  unsigned long off, k, i;
 
-  if (force || (chunks - last_chunk_collect > CHUNK_THRESHOLD)) {
-    i = 0;
-    while (i < chunks-1) {
-      if (mem_addr[i]+mem_len[i] == mem_addr[i+1])
-	merge_chunks (i, i+1);
-      else
-	i++;
+  addr >>= MEM_ALIGN;
+  while (n > 0) {
+    off = addr & (MEM_PAGE_SIZE-1);
+    k = MIN (n, MEM_PAGE_SIZE - off);
+    data = _getpage (addr >> MEM_PAGE_BITS, 0);
+    if (data) {
+      memcpy (buf, data + off, sizeof (LL)*k);
+    }
+    else {
+      for (i=0; i < k; i++)
+	buf[i] = MEM_BAD;
     }
-    last_chunk_collect = chunks;
+    buf += k;
+    addr += k;
+    n -= k;
   }
 }
 
-
-/*
- * store value at addr
- */
-void 
-Mem::Write (LL addr, LL val)
+void
+Mem::WriteBlock (LL addr, const LL *buf, unsigned long n)
 {
-  int i, j, w;
-  int ch, ret;
-  LL len, sz;
-  LL *data;
+  unsigned long off, k;
 
   addr >>= MEM_ALIGN;
-
-  context_disable ();
-
-  w = _binsearchw (addr);
-  if (w < chunks &&
-      (mem_addr[w] <= addr && addr < mem_addr[w]+mem_len[w])) {
-    mem[w][addr-mem_addr[w]] = val;
-    context_enable ();
-    return;
+  while (n > 0) {
+    off = addr & (MEM_PAGE_SIZE-1);
+    k = MIN (n, MEM_PAGE_SIZE - off);
+    memcpy (_getpage (addr >> MEM_PAGE_BITS, 1) + off, buf, sizeof (LL)*k);
+    buf += k;
+    addr += k;
+    n -= k;
   }
-  i = w;
-
-  if (i < chunks && chunks > 0 && (addr == mem_addr[i] + mem_len[i])) {
-    /* check merging chunks! */
-    if (i < chunks-1 && mem_addr[i+1] == addr) {
-      /* merge two chunks! */
-      merge_chunks (i,i+1);
-      mem[i][addr-mem_addr[i]] = val;
-      context_enable();
-      return;
+}
+
+/*
+ * compare two memories; locations that were never written are
+ * MEM_BAD
+ */
+int
+Mem::Compare (Mem *m, int verbose)
+{
+  LL page, p1, p2, a;
+  LL *d1, *d2, v1, v2;
+  unsigned long j;
+  int count = 10;
+  int k;
+  Mem *x;
+
+  page = 0;
+  while (1) {
+    p1 = page;
+    d1 = _nextpage (&p1);
+    p2 = page;
+    d2 = m->_nextpage (&p2);
+    if (!d1 && !d2) break;
+    if (!d1 || (d2 && p2 < p1)) {
+      page = p2;
+      d1 = NULL;
     }
-    /* extend chunk! */
-    get_more (i, addr-mem_addr[i]-mem_len[i]+1);
-    mem[i][addr-mem_addr[i]] = val;
-    context_enable();
-    return;
-  }
-  /* we need to move other chunks to the end */
-  ch = i;
-  ret = create_new_chunk (addr, ch);
-    
-  if (ret == 1) {
-    /* save data and len */
-    data = mem[chunks-1];
-    len = mem_len[chunks-1];
-
-    /* move other chunks up */
-    for (j = chunks-1; j >= ch+1; j--) {
-      mem_addr[j] = mem_addr[j-1];
-      mem_len[j] = mem_len[j-1];
-      mem[j] = mem[j-1];
+    else {
+      page = p1;
+      if (!d2 || p2 != p1) d2 = NULL;
     }
+    for (j=0; j < MEM_PAGE_SIZE; j++) {
+      v1 = d1 ? d1[j] : MEM_BAD;
+      v2 = d2 ? d2[j] : MEM_BAD;
+      if (v1 != v2) {
+	count--;
+	if (count == 0) goto err;
+	if (verbose) {
+	  a = ((page << MEM_PAGE_BITS) + j) << MEM_ALIGN;
+	  printf ("[0x%08lx%08lx]  0x%08lx%08lx  != 0x%08lx%08lx\n",
+		  (unsigned long)(a >> 32),
+		  (unsigned long)(a & 0xffffffff),
+		  (unsigned long) (v1 >> 32),
+		  (unsigned long) (v1 & 0xffffffff),
+		  (unsigned long) (v2 >> 32),
+		  (unsigned long) (v2 & 0xffffffff));
+	}
+      }
+    }
+    page++;
+  }
+  if (count != 10) goto err;
 
-    /* set chunk info */
-    mem[ch] = data;
-    mem_len[ch] = len;
-    mem_addr[ch] = addr;
+  return 1;
 
-    get_more (ch, addr-mem_addr[ch]-mem_len[ch]+1);
-    mem[ch][0] = val;
-  }
-  else if (ret == 0) {
-    mem[ch][addr - mem_addr[ch]] = val;
-  }
-  else {
-    fatal_error ("Unknown ret value");
+ err:
+  if (verbose) {
+    for (k=0; k < 2; k++) {
+      x = (k == 0) ? this : m;
+      printf ("%s mem:\n", k == 0 ? "First" : "Second");
+      page = 0;
+      while (x->_nextpage (&page)) {
+	a = (page << MEM_PAGE_BITS) << MEM_ALIGN;
+	printf ("\t*0x%08lx%08lx %lu\n",
+		(unsigned long)(a >> 32),
+		(unsigned long)(a & 0xffffffff),
+		(unsigned long)MEM_PAGE_SIZE);
+	page++;
+      }
+    }
   }
-
-  chunk_gc (0);
-  context_enable(); 
-  return;
+  return 0;
 }
 
 /*
  * read memory image from a file
  */
-int 
+long 
 Mem::ReadImage (FILE *fp)
 {
   freemem ();
@@ -408,11 +352,11 @@ Mem::ReadImage (FILE *fp)
 /*
  * read memory image from a file
  */
-int 
+long 
 Mem::ReadImage (const char *s)
 {
   FILE *fp;
-  int i;
+  long i;
 
   if (!s) return 0;
   if (!(fp = fopen (s, "r")))
@@ -427,11 +371,11 @@ Mem::ReadImage (const char *s)
 /*
  * read memory image from a file
  */
-int 
+long 
 Mem::MergeImage (const char *s)
 {
   FILE *fp;
-  int i;
+  long i;
 
   if (!s) return 0;
   if (!(fp = fopen (s, "r")))
@@ -444,47 +388,87 @@ Mem::MergeImage (const char *s)
 
 
 /*
- * read memory image from a file
+ * Parsing helpers for memory images held in a buffer: each takes the
+ * current position and the end of the line.
  */
-int 
-Mem::MergeImage (FILE *fp)
+static LL _gethex (char **s, char *end)
+{
+  LL v = 0;
+  char *p = *s;
+  int d, n;
+
+  while (p < end && (*p == ' ' || *p == '\t')) p++;
+  if (p+1 < end && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) p += 2;
+  for (n=0; p < end && n < MEM_HEXDIGITS; p++, n++) {
+    if ('0' <= *p && *p <= '9') d = *p - '0';
+    else if ('a' <= *p && *p <= 'f') d = *p - 'a' + 10;
+    else if ('A' <= *p && *p <= 'F') d = *p - 'A' + 10;
+    else break;
+    v = (v << 4) | d;
+  }
+  *s = p;
+  return v;
+}
+
+static unsigned long _getnum (char **s, char *end)
+{
+  unsigned long v = 0;
+  char *p = *s;
+
+  while (p < end && (*p == ' ' || *p == '\t')) p++;
+  for (; p < end && '0' <= *p && *p <= '9'; p++)
+    v = v*10 + (*p - '0');
+  *s = p;
+  return v;
+}
+
+static char *_eol (char *s, char *end)
+{
+  char *p = (char *) memchr (s, '\n', end - s);
+  return p ? p : end;
+}
+
+/*
+ * parse memory image in buf..end; returns the number of characters
+ * used (up to and including the '!' line, if any), and adds the
+ * number of locations written to *nloc
+ */
+size_t Mem::_parse (char *buf, char *end, long *nloc)
 {
-  char buf[1024];
-  unsigned long a0,a1,v0,v1;
+  char *s, *e, *t;
   unsigned long len;
-  unsigned long a, v, tmp;
+  LL a, v, tmp;
   int endian;
+  long n = 0;
 
-  while (fgets (buf, 1024, fp)) {
-    if (buf[0] == '!') {
+  for (s = buf; s < end; s = e + (e < end ? 1 : 0)) {
+    e = _eol (s, end);
+    t = s+1;
+    if (s[0] == '!') {
+      s = e + (e < end ? 1 : 0);
       break;
     }
-    if (buf[0] == '\n') continue;
-    if (buf[0] == '#') continue;
-    if (buf[0] == '@') {
+    if (s[0] == '\n') continue;
+    if (s[0] == '#') continue;
+    if (s[0] == '@') {
       /*
 	Format: @address data length:
 
 	 "length" data items starting at "address" all contain
 	 "data"
       */
-#if MEM_ALIGN == 3
-      sscanf (buf+1, "0x%8lx%8lx 0x%8lx%8lx %lu", &a0, &a1, &v0, &v1, &len);
-      a = ((LL)a0 << 32) | (LL)a1;
-      v = ((LL)v0 << 32) | (LL)v1;
-#elif MEM_ALIGN == 2
-      sscanf (buf+1, "0x%8lx 0x%8lx %lu", &a, &v, &len);
-#else
-#error Unknown memory format
-#endif
+      a = _gethex (&t, e);
+      v = _gethex (&t, e);
+      len = _getnum (&t, e);
       while (len > 0) {
 	Write (a, v);
 	a += (1 << MEM_ALIGN);
 	len--;
+	n++;
       }
       continue;
     }
-    else if (buf[0] == '*') {
+    else if (s[0] == '*') {
       /*
 	Format: *address length
 	        <list of data>
@@ -492,33 +476,24 @@ Mem::MergeImage (FILE *fp)
 	 "length" locations starting at "address" contain the data
 	 specified in the following "length" lines.
       */
-#if MEM_ALIGN == 3
-      sscanf (buf+1, "0x%8lx%8lx %lu", &a0, &a1, &len);
-      a = ((LL)a0 << 32) | (LL)a1;
-#elif MEM_ALIGN == 2
-      sscanf (buf+1, "0x%8lx %lu", &a, &len);
-#else
-#error Unknown memory format
-#endif
-      while (len > 0 && fgets (buf, 1024, fp)) {
-#if MEM_ALIGN == 3
-	sscanf (buf, "0x%8lx%8lx", &v0, &v1);
-	v = ((LL)v0 << 32) | (LL)v1;
-#elif MEM_ALIGN == 2
-	sscanf (buf, "0x%8lx", &v);
-#else
-#error Unknown memory format
-#endif
+      a = _gethex (&t, e);
+      len = _getnum (&t, e);
+      while (len > 0 && e < end) {
+	s = e + 1;
+	e = _eol (s, end);
+	t = s;
+	v = _gethex (&t, e);
 	Write (a, v);
 	a += (1 << MEM_ALIGN);
 	len--;
+	n++;
       }
       if (len != 0) {
 	fatal_error ("Memory format error, *0xaddr len format ends prematurely");
       }
       continue;
     }
-    else if (buf[0] == '+' || buf[0] == '-') {
+    else if (s[0] == '+' || s[0] == '-') {
       /* 
 	 Handle non-aligned data
 
@@ -534,27 +509,17 @@ Mem::MergeImage (FILE *fp)
 	      +  means big-endian
 	      -  means little-endian
       */
-      if (buf[0] == '+')
+      if (s[0] == '+')
 	endian = 1; /* big-endian */
       else
 	endian = 0; /* little-endian */
-#if MEM_ALIGN == 3
-      sscanf (buf+1, "0x%8lx%8lx %lu", &a0, &a1, &len);
-      a = ((LL)a0 << 32) | (LL)a1;
-#elif MEM_ALIGN == 2
-      sscanf (buf+1, "0x%8lx %lu", &a, &len);
-#else
-#error Unknown memory format
-#endif
-      while (len > 0 && fgets (buf, 1024, fp)) {
-#if MEM_ALIGN == 3
-	sscanf (buf, "0x%2lx", &v0);
-	v = v0;
-#elif MEM_ALIGN == 2
-	sscanf (buf, "0x%2lx", &v);
-#else
-#error Unknown memory format
-#endif
+      a = _gethex (&t, e);
+      len = _getnum (&t, e);
+      while (len > 0 && e < end) {
+	s = e + 1;
+	e = _eol (s, end);
+	t = s;
+	v = _gethex (&t, e) & 0xff;
 	tmp = Read (a);
 	/* write the byte! */
 	if (endian) {
@@ -566,88 +531,176 @@ Mem::MergeImage (FILE *fp)
 	Write (a, tmp);
 	a += 1;
 	len--;
+	n++;
       }
       if (len != 0) {
 	fatal_error ("Memory format error, *0xaddr len format ends prematurely");
       }
       continue;
     }
-#if MEM_ALIGN == 3
-    sscanf (buf, "0x%8lx%8lx 0x%8lx%8lx", &a0, &a1, &v0, &v1);
-    a = ((LL)a0 << 32) | (LL)a1;
-    v = ((LL)v0 << 32) | (LL)v1;
-#elif MEM_ALIGN == 2
-    sscanf (buf, "0x%8lx 0x%8lx", &a, &v);
-#else
-#error Unknown memory format
-#endif
+    t = s;
+    a = _gethex (&t, e);
+    v = _gethex (&t, e);
     Write (a, v);
+    n++;
   }
+  *nloc += n;
+  return s - buf;
+}
 
-  a = 0;
-  for (a1=0; a1 < chunks; a1++)
-    a += mem_len[a1];
+/*
+ * read memory image from a file. Regular files are mapped into
+ * memory; for anything else, lines are collected up to the end
+ * marker.
+ */
+long 
+Mem::MergeImage (FILE *fp)
+{
+  struct stat st;
+  off_t start;
+  char *base;
+  size_t len, sz;
+  char *buf;
+  long nloc = 0;
+
+  start = ftello (fp);
+  if (start >= 0 && fstat (fileno (fp), &st) == 0 && S_ISREG (st.st_mode)) {
+    if (st.st_size > start) {
+      base = (char *) mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+			    fileno (fp), 0);
+      if (base == MAP_FAILED) {
+	fatal_error ("Mem::MergeImage: mmap failed");
+      }
+      len = _parse (base + start, base + st.st_size, &nloc);
+      munmap (base, st.st_size);
+      fseeko (fp, start + (off_t)len, SEEK_SET);
+    }
+  }
+  else {
+    sz = 1024;
+    len = 0;
+    MALLOC (buf, char, sz);
+    while (fgets (buf + len, (int)(sz - len), fp)) {
+      if (buf[len] == '!') {
+	len += strlen (buf + len);
+	break;
+      }
+      len += strlen (buf + len);
+      if (sz - len < 1024) {
+	sz *= 2;
+	REALLOC (buf, char, sz);
+      }
+    }
+    _parse (buf, buf + len, &nloc);
+    FREE (buf);
+  }
+  return nloc;
+}
+
+/*
+ * Output buffer for DumpImage
+ */
+#define MEM_OUTBUF 65536
+
+struct mem_outbuf {
+  FILE *fp;
+  int n;
+  char buf[MEM_OUTBUF];
+};
+
+static void _out_flush (struct mem_outbuf *o)
+{
+  fwrite (o->buf, 1, o->n, o->fp);
+  o->n = 0;
+}
+
+static void _out_hex (struct mem_outbuf *o, LL v)
+{
+  static const char hex[] = "0123456789abcdef";
+  int i;
 
-  return a;
+  o->buf[o->n++] = '0';
+  o->buf[o->n++] = 'x';
+  for (i=MEM_HEXDIGITS-1; i >= 0; i--) {
+    o->buf[o->n+i] = hex[v & 0xf];
+    v >>= 4;
+  }
+  o->n += MEM_HEXDIGITS;
 }
 
 /* Dump memory image */
 void 
 Mem::DumpImage (FILE *fp)
 {
-  int i, j, k;
-  LL addr, data;
-  unsigned long len;
-
-  chunk_gc (1);
-
-  for (i=0; i < chunks; i++) {
-    fprintf (fp, "# Chunk %d of %d\n", i, chunks);
-    addr = mem_addr[i] << MEM_ALIGN;
+  struct mem_outbuf *o;
+  LL page, p, addr;
+  LL *data, *d;
+  unsigned long len, j;
+  int i, nruns, same;
+
+  /* count runs of consecutive pages */
+  nruns = 0;
+  page = 0;
+  while (_nextpage (&page)) {
+    nruns++;
+    while (page+1 < MEM_MAXPAGE && _getpage (page+1, 0))
+      page++;
+    page++;
+  }
 
-    for (j=0; j < mem_len[i]; j++)
-      if (mem[i][j] != mem[i][0])
-	break;
-    if (j == mem_len[i]) {
-      data = mem[i][0];
-      len = mem_len[i];
-#if MEM_ALIGN == 3
-      fprintf (fp, "@0x%08lx%08lx 0x%08lx%08lx %lu\n",
-	       (unsigned long)(addr >> 32),
-	       (unsigned long)(addr & 0xffffffff),
-	       (unsigned long)(data >> 32),
-	       (unsigned long)(data & 0xffffffff), len);
-#elif MEM_ALIGN == 2
-      fprintf (fp, "@0x%08lx 0x%08lx %lu\n", (unsigned long)addr,
-	       (unsigned long) data, len);
-#else
-#error What?
-#endif
+  NEW (o, struct mem_outbuf);
+  o->fp = fp;
+  o->n = 0;
+
+  i = 0;
+  page = 0;
+  while ((data = _nextpage (&page))) {
+    /* find the end of the run, and check if it is a constant */
+    same = 1;
+    for (p = page; p < MEM_MAXPAGE && (d = _getpage (p, 0)); p++) {
+      for (j=0; same && j < MEM_PAGE_SIZE; j++)
+	if (d[j] != data[0])
+	  same = 0;
     }
-    else {
-#if MEM_ALIGN == 3
-	fprintf (fp, "*0x%08lx%08lx %lu\n",
-		 (unsigned long)(addr >> 32),
-		 (unsigned long)(addr & 0xffffffff),
-		 (unsigned long) mem_len[i]);
-#elif MEM_ALIGN == 2
-	fprintf (fp, "*0x%08lx 0x%08lx\n", (unsigned long)addr,
-		 (unsigned long) mem_len[i]);
-#else
-#error Unknown mem format
-#endif
-	for (j=0; j < mem_len[i]; j++) {
-	  data = mem[i][j];
-#if MEM_ALIGN == 3
-	fprintf (fp, "0x%08lx%08lx\n",
-		 (unsigned long)(data >> 32),
-		 (unsigned long)(data & 0xffffffff));
-#elif MEM_ALIGN == 2
-	fprintf (fp, "0x%08lx\n", (unsigned long) data);
-#else
-#error Unknown mem format
-#endif
+    len = (p - page)*MEM_PAGE_SIZE;
+    addr = (page << MEM_PAGE_BITS) << MEM_ALIGN;
+
+    o->n += sprintf (o->buf + o->n, "# Chunk %d of %d\n", i, nruns);
+    o->buf[o->n++] = same ? '@' : '*';
+    _out_hex (o, addr);
+    if (same) {
+      o->buf[o->n++] = ' ';
+      _out_hex (o, data[0]);
+    }
+    o->n += sprintf (o->buf + o->n, " %lu\n", len);
+
+    if (!same) {
+      for (; page < p; page++) {
+	d = _getpage (page, 0);
+	for (j=0; j < MEM_PAGE_SIZE; j++) {
+	  if (o->n > MEM_OUTBUF - 64)
+	    _out_flush (o);
+	  _out_hex (o, d[j]);
+	  o->buf[o->n++] = '\n';
 	}
+      }
     }
+    page = p;
+    i++;
+    if (o->n > MEM_OUTBUF - 256)
+      _out_flush (o);
   }
+  _out_flush (o);
+  FREE (o);
+}
+
+void 
+Mem::DumpImage (const char *s)
+{
+  FILE *fp;
+
+  if (!s || !(fp = fopen (s, "w")))
+    return;
+  DumpImage (fp);
+  fclose (fp);
 }
@@ -39,6 +39,17 @@ typedef unsigned long Word;
 #define MEM_BAD  0x0ULL
 #define MEM_ALIGN 3 /* bottom three bits zero */
 
+/*
+ * Memory is a radix tree of pages of (1 << MEM_PAGE_BITS) locations,
+ * indexed by the location number (addr >> MEM_ALIGN). Each interior
+ * level has (1 << MEM_LEVEL_BITS) entries; pages are only allocated
+ * when written.
+ */
+#define MEM_PAGE_BITS  12
+#define MEM_PAGE_SIZE  (1UL << MEM_PAGE_BITS)
+#define MEM_LEVEL_BITS 10
+#define MEM_LEVELS   ((64 - MEM_ALIGN - MEM_PAGE_BITS + MEM_LEVEL_BITS - 1)/MEM_LEVEL_BITS)
+
 #ifndef MIN
 #define MIN(a,b) (((a) < (b)) ? (a) : (b))
 #endif
@@ -48,10 +59,10 @@ public:
   Mem();
   ~Mem();
 
-  int ReadImage (const char *s);
-  int ReadImage (FILE *fp);	// load fresh memory image
-  int MergeImage (const char *s);
-  int MergeImage (FILE *fp);	// merge image from file with current mem
+  long ReadImage (const char *s);
+  long ReadImage (FILE *fp);	// load fresh memory image
+  long MergeImage (const char *s);
+  long MergeImage (FILE *fp);	// merge image from file with current mem
   void DumpImage (FILE *fp);	// write current mem to file
   
   LL Read (LL addr);
@@ -116,97 +127,35 @@ public:
     return ((LL)val<<((addr & 4)<<3))|(data&~((LL)0xffffffff<<((addr & 4)<<3)));
   };
 
-  void Clear (void) { freemem (); }
-
-  int Compare (Mem *m, int verbose = 1) {
-    int i, j;
-    int count = 10;
-
-    chunk_gc (1);
-    m->chunk_gc (1);
-
-    if (m->chunks != chunks) {
-      goto err;
-    }
-    for (i=0; i < chunks; i++) {
-      if (mem_addr[i] != m->mem_addr[i]) goto err;
-      if (mem_len[i] == m->mem_len[i]) continue;
-      if (mem_len[i] < m->mem_len[i]) {
-	for (j=mem_len[i]; j < m->mem_len[i]; j++)
-	  if (m->mem[i][j] != MEM_BAD)
-	    goto err;
-      }
-      else {
-	for (j=m->mem_len[i]; j < mem_len[i]; j++)
-	  if (mem[i][j] != MEM_BAD)
-	    goto err;
-      }
-    }
-    for (i=0; i < chunks; i++) {
-      for (j=0; j < MIN(mem_len[i],m->mem_len[i]); j++)
-	if (mem[i][j] != m->mem[i][j]) {
-	  count--;
-	  if (count == 0) goto err;
-	  if (verbose) {
-	    printf ("[0x%08lx%08lx]  0x%08lx%08lx  != 0x%08lx%08lx\n",
-		    (unsigned long)(((j+mem_addr[i])<<MEM_ALIGN) >> 32),
-		    (unsigned long)(((j+mem_addr[i])<<MEM_ALIGN) & 0xffffffff),
-		    (unsigned long) (mem[i][j] >> 32),
-		    (unsigned long) (mem[i][j] & 0xffffffff),
-		    (unsigned long) (m->mem[i][j] >> 32),
-		    (unsigned long) (m->mem[i][j] & 0xffffffff));
-	  }
-	}
-    }
-    if (count != 10) goto err;
-
-    return 1;
-
-  err:
-    if (verbose) {
-      printf ("First mem:\n");
-      for (i=0; i < chunks; i++) {
-	printf ("\t*0x%08lx%08lx %lu\n",
-		(unsigned long)((mem_addr[i]<<MEM_ALIGN) >> 32),
-		(unsigned long)((mem_addr[i]<<MEM_ALIGN) & 0xffffffff),
-		(unsigned long)mem_len[i]);
-      }
-      printf ("Second mem:\n");
-      for (i=0; i < m->chunks; i++) {
-	printf ("\t*0x%08lx%08lx %lu\n",
-		(unsigned long)((m->mem_addr[i]<<MEM_ALIGN) >> 32),
-		(unsigned long)((m->mem_addr[i]<<MEM_ALIGN) & 0xffffffff),
-		(unsigned long)m->mem_len[i]);
-      }
-    }
-    return 0;
-  }
+  /*
+   * Bulk access: n aligned locations starting at addr. Locations
+   * that were never written read as MEM_BAD.
+   */
+  void ReadBlock (LL addr, LL *buf, unsigned long n);
+  void WriteBlock (LL addr, const LL *buf, unsigned long n);
 
-private:
-  int chunks;
-  int numchunks;
-  int last_chunk_collect;
+  void DumpImage (const char *s); // write current mem to file
 
-  // array of blocks of memory
-  LL **mem;
+  void Clear (void) { freemem (); }
 
-  // length of each block
-  unsigned long *mem_len;
+  int Compare (Mem *m, int verbose = 1);
 
-  // size of each block
-  // LL *mem_sz;
+private:
+  void **root;
+  unsigned long npages;
 
-  // start address for each block
-  LL *mem_addr;
+  // last page accessed, and the last-level table it was found in
+  LL last_page;
+  LL *last_data;
+  LL last_leaf;
+  void **last_leafp;
 
   void freemem (void);
-  void get_more (int chunkid, long long num, int merging = 0);
-  int  create_new_chunk (LL addr, int ch);
-  void merge_chunks (int chunk1, int chunk2);
-  void chunk_gc (int force);
-
-  inline int _binsearch (LL addr);
-  inline int _binsearchw (LL addr);
+  void _freetree (void **t, int level);
+  LL *_getpage (LL page, int create);
+  LL *_nextpage (LL *page);
+  LL *_nextpage (void **t, int level, LL prefix, LL *page);
+  size_t _parse (char *buf, char *end, long *nloc);
 };
   
 
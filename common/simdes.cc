@@ -19,7 +19,136 @@
  *
  **************************************************************************
  */
+#include <limits.h>
 #include "simdes.h"
+#include "hash.h"
+
+/*
+ * Event heap, ordered by (time, creating partition, sequence number
+ * within that partition), which makes the order of events with the
+ * same time well-defined.
+ */
+struct SimHeap {
+  int sz, max;
+  Event **ev;
+
+  static int before (Event *a, Event *b) {
+    if (a->tm != b->tm) return a->tm < b->tm;
+    if (a->src != b->src) return a->src < b->src;
+    return a->seq < b->seq;
+  }
+};
+
+#define EV_BEFORE(a,b)  SimHeap::before (a, b)
+
+static SimHeap *simheap_new (int sz)
+{
+  SimHeap *h;
+
+  NEW (h, SimHeap);
+  h->sz = 0;
+  h->max = sz;
+  MALLOC (h->ev, Event *, h->max);
+  return h;
+}
+
+static void simheap_free (SimHeap *h)
+{
+  FREE (h->ev);
+  FREE (h);
+}
+
+static void simheap_insert (SimHeap *h, Event *e)
+{
+  int i;
+
+  if (h->sz == h->max) {
+    h->max *= 2;
+    REALLOC (h->ev, Event *, h->max);
+  }
+  i = h->sz++;
+  while (i > 0 && EV_BEFORE (e, h->ev[(i-1)/2])) {
+    h->ev[i] = h->ev[(i-1)/2];
+    i = (i-1)/2;
+  }
+  h->ev[i] = e;
+}
+
+#define simheap_peek(h)  ((h)->sz > 0 ? (h)->ev[0] : (Event *)NULL)
+
+/*
+ * Barrier for the worker threads (pthread_barrier_t is not available
+ * everywhere)
+ */
+struct SimBarrier {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int n;			// number of threads
+  int count;			// threads still to arrive
+  unsigned long gen;		// generation, to tell rounds apart
+};
+
+static SimBarrier *simbarrier_new (int n)
+{
+  SimBarrier *b;
+
+  NEW (b, SimBarrier);
+  pthread_mutex_init (&b->lock, NULL);
+  pthread_cond_init (&b->cond, NULL);
+  b->n = n;
+  b->count = n;
+  b->gen = 0;
+  return b;
+}
+
+static void simbarrier_free (SimBarrier *b)
+{
+  pthread_mutex_destroy (&b->lock);
+  pthread_cond_destroy (&b->cond);
+  FREE (b);
+}
+
+static void simbarrier_wait (SimBarrier *b)
+{
+  unsigned long gen;
+
+  pthread_mutex_lock (&b->lock);
+  gen = b->gen;
+  if (--b->count == 0) {
+    b->count = b->n;
+    b->gen++;
+    pthread_cond_broadcast (&b->cond);
+  }
+  else {
+    while (gen == b->gen) {
+      pthread_cond_wait (&b->cond, &b->lock);
+    }
+  }
+  pthread_mutex_unlock (&b->lock);
+}
+
+static Event *simheap_remove_min (SimHeap *h)
+{
+  Event *ret, *e;
+  int i, c;
+
+  if (h->sz == 0) {
+    return NULL;
+  }
+  ret = h->ev[0];
+  e = h->ev[--h->sz];
+  i = 0;
+  while ((c = 2*i+1) < h->sz) {
+    if (c+1 < h->sz && EV_BEFORE (h->ev[c+1], h->ev[c])) {
+      c++;
+    }
+    if (!EV_BEFORE (h->ev[c], e)) break;
+    h->ev[i] = h->ev[c];
+    i = c;
+  }
+  h->ev[i] = e;
+  return ret;
+}
 
 /* globals for sim object */
 int SimDES::initialized_sim = 0;
@@ -27,21 +156,65 @@ int SimDES::initialized_sim = 0;
 int SimDES::_interrupt = 0;
 
 /* globals for events */
-Heap *SimDES::all = NULL;
+SimHeap *SimDES::all = NULL;
+unsigned long long SimDES::ext_seq = 0;
+struct iHashtable *SimDES::part_seqs = NULL;
+pthread_mutex_t SimDES::part_lock = PTHREAD_MUTEX_INITIALIZER;
 unsigned long SimDES::tm_offset[SIM_TIME_SIZE];
-unsigned long SimDES::curtime = 0;
-Event *Event::ev_queue = NULL;
-SimDES *SimDES::curobj = NULL;
+thread_local unsigned long SimDES::curtime = 0;
+thread_local Event *Event::ev_queue = NULL;
+thread_local SimDES *SimDES::curobj = NULL;
+
+/* globals for parallel simulation */
+int SimDES::nworkers = 1;
+unsigned long SimDES::lookahead = 0;
+thread_local int SimDES::cur_part = -1;
+SimHeap **SimDES::pheap = NULL;
+SimHeap **SimDES::outbox = NULL;
+unsigned long SimDES::window_id = 0;
+unsigned long *SimDES::part_time = NULL;
+unsigned long SimDES::window_end = 0;
+int SimDES::workers_done = 0;
+pthread_t *SimDES::workers = NULL;
+SimBarrier *SimDES::wstart = NULL;
+SimBarrier *SimDES::wfinish = NULL;
+
+/*
+ * Event counter for partition p. Counters are shared by all objects
+ * in the partition, and only the worker that runs the partition
+ * updates it.
+ */
+unsigned long long *SimDES::_part_seq (int p)
+{
+  ihash_bucket_t *b;
+  unsigned long long *x;
+
+  pthread_mutex_lock (&part_lock);
+  if (!part_seqs) {
+    part_seqs = ihash_new (4);
+  }
+  b = ihash_lookup (part_seqs, p);
+  if (!b) {
+    b = ihash_add (part_seqs, p);
+    NEW (x, unsigned long long);
+    *x = 0;
+    b->v = x;
+  }
+  pthread_mutex_unlock (&part_lock);
+  return (unsigned long long *)b->v;
+}
 
 /* create and destroy */
 SimDES::SimDES ()
 {
   break_point = 0;
   flags = 0;
+  part = 0;
+  pseq = _part_seq (0);
 
   if (!all) {
     /* first time I'm here */
-    all = heap_new (32);
+    all = simheap_new (32);
   }
 
   if (!initialized_sim) {
@@ -59,6 +232,18 @@ void SimDES::Init()
   }
   SimDES::curtime = 0;
   initialized_sim = 1;
+
+  /* restart event numbering */
+  ext_seq = 0;
+  if (part_seqs) {
+    ihash_iter_t it;
+    ihash_bucket_t *b;
+
+    ihash_iter_init (part_seqs, &it);
+    while ((b = ihash_iter_next (part_seqs, &it))) {
+      *((unsigned long long *)b->v) = 0;
+    }
+  }
 }
 
 /*
@@ -67,48 +252,76 @@ void SimDES::Init()
 SimDES::~SimDES ()
 { }
 
+/*
+ * Move the time reference forward by tm: subtract tm from the current
+ * time and all pending events, and add it to tm_offset[]. Called
+ * outside parallel windows only.
+ */
+void SimDES::_rebase_time (unsigned long tm)
+{
+  int i, j;
+
+  /* adjust curtime by tm, and add tm in to the tm_offset[] array */
+  curtime = curtime - tm;
+
+  if (tm_offset[0] + tm < tm_offset[0]) {
+    /* time rolled over at 0, do the carries */
+    for (i=1; i < SIM_TIME_SIZE; i++) {
+      tm_offset[i]++;
+      if (tm_offset[i] != 0) {
+	break;
+      }
+    }
+  }
+  tm_offset[0] = tm_offset[0] + tm;
+
+  /* subtracting the same amount keeps the heap order */
+  for (i=0; i < all->sz; i++) {
+    all->ev[i]->tm -= tm;
+  }
+  if (pheap) {
+    for (j=0; j < nworkers; j++) {
+      for (i=0; i < pheap[j]->sz; i++) {
+	pheap[j]->ev[i]->tm -= tm;
+      }
+    }
+  }
+}
+
 /*
  * Create a new event, insert into the queue
  */
 Event::Event (SimDES *s, int event_type, int delay)
 {
+  obj = s;
+  ev_type = event_type;
+  kill = 0;
+
+  if (SimDES::cur_part >= 0) {
+    /* created by a worker thread within a parallel window */
+    SimDES::_insert_parallel (this, delay);
+    return;
+  }
+
   /* check to see if the delay would cause "curtime" to roll over */
   while (((unsigned long)~0UL - SimDES::curtime) < (unsigned)delay) {
     /* let's walk through the heap to see if I can change the current
        time reference */
-    int i;
     unsigned long tm;
+    Event *e = simheap_peek (SimDES::all);
 
-    tm = heap_peek_minkey (SimDES::all);
+    tm = e ? e->tm : 0;
     /* the earliest time of all pending events is now tm */
 
     if (tm == 0) {
       fatal_error ("The dynamic range of time in the pending event list is too large to represent.\n");
     }
-
-    /* adjust curtime by tm, and add tm in to the tm_offset[] array */
-    SimDES::curtime = SimDES::curtime - tm;
-
-    if (SimDES::tm_offset[0] + tm < SimDES::tm_offset[0]) {
-      /* time rolled over at 0, do the carries */
-      for (i=1; i < SIM_TIME_SIZE; i++) {
-	SimDES::tm_offset[i]++;
-	if (SimDES::tm_offset[i] != 0) {
-	  break;
-	}
-      }
-    }
-    SimDES::tm_offset[0] = SimDES::tm_offset[0] + tm;
-      
-    for (i=0; i < SimDES::all->sz; i++) {
-      SimDES::all->key[i] -= tm;
-    }
+    SimDES::_rebase_time (tm);
   }
 
-  obj = s;
-  ev_type = event_type;
-  kill = 0;
-  heap_insert (SimDES::all, SimDES::curtime + delay, this);
+  tm = SimDES::curtime + delay;
+  SimDES::_number (this);
+  simheap_insert (SimDES::all, this);
 }
 
 Event::~Event () { } 
@@ -133,14 +346,15 @@ unsigned long SimDES::CurTimeLo()
 Event *SimDES::Run ()
 {
   Event *ev;
-  unsigned long tm;
-  unsigned long long tm2;
+
+  if (nworkers > 1) {
+    return _run_parallel (0, 0);
+  }
   
   /* process all events in global time order */
-  while ((ev = (Event *)heap_remove_min_key (all, &tm2))) {
-    tm = tm2;
+  while ((ev = simheap_remove_min (all))) {
     /* current time needs to advance */
-    curtime = tm;
+    curtime = ev->tm;
 
     /* execute event */
     if (!ev->kill) {
@@ -149,6 +363,7 @@ Event *SimDES::Run ()
       }
       curobj = ev->obj;
       ev->obj->Step (ev->ev_type);
+      curobj = NULL;
     }
     delete ev;
     if (_interrupt) {
@@ -166,22 +381,20 @@ Event *SimDES::Run ()
 Event *SimDES::Advance (int n)
 {
   Event *ev;
-  unsigned long tm;
-  unsigned long long tm2;
 
   /* process all events in global time order */
-  while (n && (ev = (Event *)heap_remove_min_key (all, &tm2))) {
-    tm = tm2;
-    curtime = tm;
+  while (n && (ev = simheap_remove_min (all))) {
+    curtime = ev->tm;
     /* current time needs to advance */
     if (!ev->kill) {
       if (IS_A_BREAKPOINT(ev)) {
 	/* put the event back */
-	heap_insert (all, tm, ev);
+	simheap_insert (all, ev);
 	break;
       }
       curobj = ev->obj;
       ev->obj->Step (ev->ev_type);
+      curobj = NULL;
     }
     delete ev;
     n--;
@@ -204,13 +417,20 @@ Event *SimDES::AdvanceTime (int delay)
   Event *ev;
   unsigned long tm;
 
+  if (nworkers > 1) {
+    if (delay < 0) {
+      return NULL;
+    }
+    return _run_parallel (1, curtime + delay);
+  }
+
   /* process all events in global time order */
   do {
-    if (heap_peek_min (all) == NULL) {
+    if (simheap_peek (all) == NULL) {
       /* nothing in the heap */
       return NULL;
     }
-    tm = heap_peek_minkey (all);
+    tm = simheap_peek (all)->tm;
     
     if (delay < (tm - curtime)) {
       /* I'm out of time, return */
@@ -220,23 +440,302 @@ Event *SimDES::AdvanceTime (int delay)
       delay = delay - (tm - curtime);
     }
 
-    ev = (Event *) heap_remove_min (all);
+    ev = simheap_remove_min (all);
 
     /* current time needs to advance */
     curtime = tm;
     if (!ev->kill) {
       if (IS_A_BREAKPOINT(ev)) {
-	heap_insert (all, tm, ev);
+	simheap_insert (all, ev);
 	break;
       }
       curobj = ev->obj;
       ev->obj->Step (ev->ev_type);
+      curobj = NULL;
     }
     delete ev;
   } while (1);
   return ev;
 }
 
+/*------------------------------------------------------------------------
+ *
+ *  Parallel simulation
+ *
+ *------------------------------------------------------------------------
+ */
+
+/*
+ * Set the number of worker threads and the lookahead. Must be called
+ * between simulation runs.
+ */
+void SimDES::SetParallel (int n, unsigned long la)
+{
+  int i;
+
+  if (n < 1) {
+    n = 1;
+  }
+  if (n > 1 && la == 0) {
+    fatal_error ("SimDES::SetParallel: parallel simulation needs a non-zero lookahead");
+  }
+  
+  /* shut down existing workers */
+  if (workers) {
+    workers_done = 1;
+    simbarrier_wait (wstart);
+    for (i=1; i < nworkers; i++) {
+      pthread_join (workers[i], NULL);
+    }
+    FREE (workers);
+    workers = NULL;
+    workers_done = 0;
+    simbarrier_free (wstart);
+    simbarrier_free (wfinish);
+  }
+  if (pheap) {
+    for (i=0; i < nworkers; i++) {
+      Assert (pheap[i]->sz == 0, "Pending events in partition?");
+      simheap_free (pheap[i]);
+    }
+    FREE (pheap);
+    for (i=0; i < nworkers*nworkers; i++) {
+      simheap_free (outbox[i]);
+    }
+    FREE (outbox);
+    FREE (part_time);
+    pheap = NULL;
+  }
+
+  nworkers = n;
+  lookahead = la;
+
+  if (nworkers == 1) {
+    return;
+  }
+
+  MALLOC (pheap, SimHeap *, nworkers);
+  MALLOC (part_time, unsigned long, nworkers);
+  for (i=0; i < nworkers; i++) {
+    pheap[i] = simheap_new (32);
+  }
+  MALLOC (outbox, SimHeap *, nworkers*nworkers);
+  for (i=0; i < nworkers*nworkers; i++) {
+    outbox[i] = simheap_new (4);
+  }
+
+  /* worker 0 is the calling thread */
+  wstart = simbarrier_new (nworkers);
+  wfinish = simbarrier_new (nworkers);
+  MALLOC (workers, pthread_t, nworkers);
+  for (i=1; i < nworkers; i++) {
+    if (pthread_create (&workers[i], NULL, SimDES::_worker,
+			(void *)(long)i) != 0) {
+      fatal_error ("SimDES::SetParallel: could not create worker thread");
+    }
+  }
+}
+
+void SimDES::SetPartition (int p)
+{
+  if (p < 0) {
+    fatal_error ("SimDES::SetPartition: `%s' has negative partition %d",
+		 Name(), p);
+  }
+  part = p;
+  pseq = _part_seq (p);
+}
+
+/*
+ * Number a new event: by the partition of the object being stepped,
+ * or as an external event
+ */
+void SimDES::_number (Event *ev)
+{
+  if (curobj) {
+    ev->src = curobj->part;
+    ev->seq = (*curobj->pseq)++;
+  }
+  else {
+    ev->src = -1;
+    ev->seq = ext_seq++;
+  }
+}
+
+/*
+ * Insert an event created within a parallel window. Events for the
+ * current partition go into its heap; others are buffered and merged
+ * at the end of the window.
+ */
+void SimDES::_insert_parallel (Event *ev, int delay)
+{
+  int p = ev->obj->part % nworkers;
+
+  /* _run_parallel() moves the time reference so that any delay fits
+     in a window; this can only fail if the lookahead itself is too
+     large */
+  if (((unsigned long)~0UL - curtime) < (unsigned)delay) {
+    fatal_error ("The dynamic range of time in the pending event list is too large to represent.\n");
+  }
+  ev->tm = curtime + delay;
+  _number (ev);
+  if (p == cur_part) {
+    simheap_insert (pheap[p], ev);
+  }
+  else {
+    if ((unsigned long)delay < lookahead) {
+      fatal_error ("Event for `%s' from another partition has delay %d, below the lookahead (%lu)", ev->obj->Name(), delay, lookahead);
+    }
+    simheap_insert (outbox[cur_part*nworkers + p], ev);
+  }
+}
+
+/*
+ * Move pending events from the global heap to the partition heaps,
+ * and back. Events keep their time and sequence number.
+ */
+void SimDES::_scatter ()
+{
+  Event *ev;
+
+  while ((ev = simheap_remove_min (all))) {
+    simheap_insert (pheap[ev->obj->part % nworkers], ev);
+  }
+}
+
+void SimDES::_gather ()
+{
+  Event *ev;
+
+  for (int i=0; i < nworkers; i++) {
+    while ((ev = simheap_remove_min (pheap[i]))) {
+      simheap_insert (all, ev);
+    }
+  }
+}
+
+/*
+ * Run all events for partition w that fall in the current window
+ */
+void SimDES::_run_window (int w)
+{
+  SimHeap *h = pheap[w];
+  Event *ev;
+
+  while (h->sz > 0 && simheap_peek (h)->tm < window_end) {
+    ev = simheap_remove_min (h);
+    curtime = ev->tm;
+    if (!ev->kill) {
+      curobj = ev->obj;
+      ev->obj->Step (ev->ev_type);
+      curobj = NULL;
+    }
+    delete ev;
+  }
+  part_time[w] = curtime;
+}
+
+void *SimDES::_worker (void *arg)
+{
+  int w = (int)(long)arg;
+
+  cur_part = w;
+  while (1) {
+    simbarrier_wait (wstart);
+    if (workers_done) {
+      break;
+    }
+    _run_window (w);
+    simbarrier_wait (wfinish);
+  }
+  return NULL;
+}
+
+/*
+ * Run the simulation in conservative windows; if use_limit is set,
+ * stop once all events with time <= limit have been executed.
+ */
+Event *SimDES::_run_parallel (int use_limit, unsigned long limit)
+{
+  int i, j;
+  unsigned long tm, end, room;
+
+  _scatter ();
+
+  while (1) {
+    /* earliest pending event */
+    end = 0;
+    for (i=0; i < nworkers; i++) {
+      if (pheap[i]->sz > 0) {
+	tm = simheap_peek (pheap[i])->tm;
+	if (end == 0 || tm < end - 1) {
+	  end = tm + 1;
+	}
+      }
+    }
+    if (end == 0) {
+      break;
+    }
+    tm = end - 1;
+    if (use_limit && tm > limit) {
+      break;
+    }
+
+    /* an event in this window may be created with any int delay;
+       move the time reference if that could overflow */
+    room = (unsigned long)~0UL - tm;
+    if (tm > 0 && (room < (unsigned long)INT_MAX ||
+		   room - (unsigned long)INT_MAX < lookahead)) {
+      _rebase_time (tm);
+      if (use_limit) {
+	limit -= tm;
+      }
+      tm = 0;
+    }
+
+    if ((unsigned long)~0UL - tm < lookahead) {
+      window_end = (unsigned long)~0UL;
+    }
+    else {
+      window_end = tm + lookahead;
+    }
+    if (use_limit && window_end > limit + 1) {
+      window_end = limit + 1;
+    }
+
+    for (i=0; i < nworkers; i++) {
+      part_time[i] = curtime;
+    }
+
+    window_id++;
+    cur_part = 0;
+    simbarrier_wait (wstart);
+    _run_window (0);
+    simbarrier_wait (wfinish);
+    cur_part = -1;
+
+    /* merge cross-partition events; their sequence numbers fix the
+       order */
+    for (i=0; i < nworkers; i++) {
+      if (part_time[i] > curtime) {
+	curtime = part_time[i];
+      }
+      for (j=0; j < nworkers; j++) {
+	SimHeap *h = outbox[i*nworkers + j];
+	for (int k=0; k < h->sz; k++) {
+	  simheap_insert (pheap[j], h->ev[k]);
+	}
+	h->sz = 0;
+      }
+    }
+    if (_interrupt) {
+      break;
+    }
+  }
+  _gather ();
+  return NULL;
+}
+
 void SimDES::Pause (int delay)
 {
   /* create an event */
@@ -251,11 +750,36 @@ Condition::Condition ()
 {
   /* initialize waiting object list */
   waiting_objects = list_new ();
+  pthread_mutex_init (&lock, NULL);
+  claim_window = 0;
+  claim_part = -1;
 }
 
 Condition::~Condition () 
 {
   list_free (waiting_objects);
+  pthread_mutex_destroy (&lock);
+}
+
+/*
+ * In a parallel window, only one partition may use a condition: the
+ * result would otherwise depend on which worker got there first.
+ */
+void Condition::Claim ()
+{
+  if (SimDES::cur_part < 0) {
+    return;
+  }
+  pthread_mutex_lock (&lock);
+  if (claim_window != SimDES::window_id) {
+    claim_window = SimDES::window_id;
+    claim_part = SimDES::cur_part;
+  }
+  else if (claim_part != SimDES::cur_part) {
+    pthread_mutex_unlock (&lock);
+    fatal_error ("Condition used by partitions %d and %d in the same parallel window (time %lu); cross-partition conditions need at least the lookahead between uses", claim_part, SimDES::cur_part, SimDES::CurTimeLo());
+  }
+  pthread_mutex_unlock (&lock);
 }
     
 /*
@@ -263,6 +787,7 @@ Condition::~Condition ()
  */
 void Condition::AddObject (SimDES *s)
 {
+  Claim ();
   list_append (waiting_objects, s);
 }
 
@@ -274,6 +799,7 @@ void Condition::DelObject (SimDES *s)
 {
   listitem_t *li, *prev;
   prev = NULL;
+  Claim ();
   for (li = list_first (waiting_objects); li; li = list_next (li)) {
     if (s == (SimDES *) list_value (li)) {
       list_delete_next (waiting_objects, prev);
@@ -289,6 +815,7 @@ void Condition::Wakeup (int ev_type, int delay)
 {
   SimDES *s;
 
+  Claim ();
   while (!list_isempty (waiting_objects)) {
     s = (SimDES *)list_delete_tail (waiting_objects);
     new Event (s, SIM_EV_MKTYPE (ev_type,SIM_EV_FLAG_WAKEUP), delay);
@@ -351,6 +878,7 @@ WaitForAll::~WaitForAll ()
  */
 int WaitForAll::Notify (int ev_type, int n)
 {
+  Claim ();
   if (!bitset_tst (slot_state, n)) {
     bitset_set (slot_state, n);
     num--;
@@ -372,6 +900,7 @@ int WaitForAll::Notify (int ev_type, int n)
  */
 int WaitForAll::NotifyAny (int ev_type)
 {
+  Claim ();
   num--;
   if (num == 0) {
     /* let all the waiting objects know we're ready to go */
@@ -437,6 +966,7 @@ WaitForOne::~WaitForOne ()
  */
 int WaitForOne::Notify (int ev_type)
 {
+  Claim ();
   /* let all the waiting objects know we're ready to go */
   Wakeup (ev_type, delay);
   ReInit ();
@@ -47,8 +47,36 @@
  *           processed.
  *
  *
+ *   Parallel simulation:
+ *
+ *   SimDES::SetParallel (n, lookahead) runs Run() and AdvanceTime()
+ *   on n worker threads. Objects are assigned to partitions with
+ *   SetPartition(); each partition has its own event heap, and is
+ *   processed by one worker.
+ *
+ *   Simulation proceeds in conservative time windows: if T is the
+ *   earliest pending event, all events with time < T + lookahead are
+ *   executed concurrently. Hence every event created for an object in
+ *   a different partition (including Condition wakeups) must have a
+ *   delay of at least "lookahead"; this is checked at runtime.
+ *
+ *   Events with the same time are run in the order of the partition
+ *   of the object that created them (events created outside Step()
+ *   come first), and then in the order that partition created them.
+ *   A partition runs its events in the same order whether or not the
+ *   simulation is parallel, so a parallel run executes exactly the
+ *   events of a sequential run, independent of thread timing.
+ *
+ *   Objects in different partitions may only interact through
+ *   events. A Condition may be used from several partitions, but in
+ *   any one window only a single partition may call AddObject(),
+ *   DelObject() or Notify() on it; this is checked at runtime.
+ *   Break-points are ignored by the parallel Run(); Advance() always
+ *   runs sequentially.
+ *
  */
 #include <stdio.h>
+#include <pthread.h>
 #include "misc.h"
 #include "heap.h"
 #include "list.h"
@@ -56,6 +84,8 @@
 #include "sim.h"
 
 class SimDES;
+struct SimHeap;
+struct SimBarrier;
 
 /*
  * Events: used to make forward progress in the simulation
@@ -105,11 +135,16 @@ private:
 
   SimDES *obj;		// information about the event (see above)
 
-  /* allocated event queue */
-  static Event *ev_queue;
+  unsigned long tm;		// time of the event
+  int src;			// partition that created the event, or -1
+  unsigned long long seq;	// order among events from src
+
+  /* allocated event queue, one per worker thread */
+  static thread_local Event *ev_queue;
   Event *next;               // queue of events
 
   friend class SimDES;
+  friend struct SimHeap;
 };
 
 /*
@@ -155,6 +190,17 @@ class SimDES {
 
 
   static int isEmpty() { return initialized_sim ? 0 : 1; }
+
+  /*-- parallel simulation --*/
+
+  static void SetParallel (int nworkers, unsigned long lookahead);
+				// use nworkers threads (1 = sequential)
+
+  static int NumWorkers () { return nworkers; }
+
+  void SetPartition (int p);	// partition for this object, >= 0
+  int Partition () { return part; }
+
   /*
     The current time is represented in the simulation by an array of
     SIM_TIME_SIZE 64-bit values.
@@ -177,7 +223,10 @@ protected:
   unsigned int flags:8;		// available flags
 
 private:
-  static SimDES *curobj;	// current object being stepped
+  int part;			// partition for parallel simulation
+  unsigned long long *pseq;	// events created by partition "part"
+
+  static thread_local SimDES *curobj; // current object being stepped
 
   /*-- object management --*/
   static int initialized_sim;   // global check
@@ -197,10 +246,42 @@ private:
      offset into the current time
   */
 
-  static unsigned long curtime;	// current time
-  static Heap *all;		// all events
+  static thread_local unsigned long curtime;	// current time
+  static SimHeap *all;		// all events
+  static unsigned long long ext_seq; // events created outside Step()
+  static struct iHashtable *part_seqs; // partition -> event count
+  static pthread_mutex_t part_lock;
+
+  static unsigned long long *_part_seq (int p);
+  static void _number (Event *ev);
+
+  static void _rebase_time (unsigned long tm);
+
+  /*-- parallel runtime --*/
+
+  static int nworkers;		// number of worker threads
+  static unsigned long lookahead; // minimum cross-partition delay
+  static thread_local int cur_part; // partition being run by this
+				    // thread, -1 outside a window
+  static SimHeap **pheap;	// per-partition event heaps
+  static SimHeap **outbox;	// cross-partition events produced in
+				// this window: outbox[src*n+dst]
+  static unsigned long window_id; // current window number
+  static unsigned long *part_time; // last event time per partition
+  static unsigned long window_end; // run events with time < window_end
+  static int workers_done;	// signal workers to exit
+  static pthread_t *workers;
+  static SimBarrier *wstart, *wfinish;
+
+  static void _insert_parallel (Event *ev, int delay);
+  static void _scatter ();
+  static void _gather ();
+  static void _run_window (int w);
+  static void *_worker (void *);
+  static Event *_run_parallel (int use_limit, unsigned long limit);
 
   friend class Event;
+  friend class Condition;
 };
 
 class Condition {
@@ -232,8 +313,19 @@ public:
 protected:
   void Wakeup (int ev_type, int delay = 0);
 
+  /*
+   * Called on entry to Notify() implementations: in a parallel
+   * window, reports an error if another partition has already used
+   * this condition in the same window.
+   */
+  void Claim ();
+
 private:
   list_t *waiting_objects;
+
+  pthread_mutex_t lock;
+  unsigned long claim_window;	// last parallel window that used this
+  int claim_part;		// partition that used it in that window
 };
 
 class WaitForAll : public Condition {
@@ -0,0 +1,289 @@
+/*************************************************************************
+ *
+ *  Channel tests
+ *
+ *  Copyright (c) 2019 Rajit Manohar
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301, USA.
+ *
+ **************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "thread.h"
+#include "channel.h"
+
+/*
+  Usage:
+     test-chan             run the channel tests
+     test-chan -b N        time N messages sent one at a time and in
+                           batches
+*/
+
+#define NMSG 1000
+
+typedef struct {
+  int v;
+  char pad[5];
+} msg_t;
+
+static ch_t *cm;		/* msg_t messages, slack 4 */
+static ch_t *cu;		/* unsigned long messages, slack 8 */
+static ch_t *c0;		/* slack 0 */
+static FILE *trace_fp;
+
+static int errors = 0;
+static unsigned long usum = 0;
+
+static void timed_phase (void);
+
+/* print channel statistics without the channel address */
+static void print_stats (const char *nm, ch_t *c)
+{
+  char buf[1024];
+  FILE *fp = tmpfile ();
+  char *s;
+
+  if (!fp) {
+    fprintf (stderr, "tmpfile() failed\n");
+    exit (1);
+  }
+  ch_stats (fp, c);
+  rewind (fp);
+  if (!fgets (buf, 1024, fp)) {
+    buf[0] = '\0';
+  }
+  fclose (fp);
+  s = strchr (buf, ':');
+  printf ("%s%s", nm, s ? s : buf);
+}
+
+static void producer (void)
+{
+  msg_t m[7];
+  unsigned long u[16];
+  unsigned long one;
+  int i, j, k;
+
+  /* batches that straddle the slack of the channel */
+  k = 0;
+  while (k < NMSG) {
+    for (j=0; j < 7 && k < NMSG; j++, k++) {
+      memset (&m[j], 0, sizeof (msg_t));
+      m[j].v = k;
+    }
+    ch_send_n (cm, m, j);
+  }
+
+  /* slack 8, one batch of 8: must complete without blocking */
+  for (i=0; i < 8; i++) {
+    u[i] = 100 + i;
+  }
+  ch_send_n (cu, u, 8);
+  /* mix single and batched sends */
+  one = 108;
+  ch_send (cu, &one);
+  for (i=0; i < 16; i++) {
+    u[i] = 109 + i;
+  }
+  ch_send_n (cu, u, 16);
+
+  for (i=0; i < 10; i++) {
+    ch_send_n (c0, &i, 1);
+  }
+}
+
+static void consumer (void)
+{
+  msg_t m[5];
+  unsigned long u[25];
+  int i, j, k, x;
+
+  k = 0;
+  while (k < NMSG) {
+    ch_recv_n (cm, m, 5);
+    for (j=0; j < 5; j++, k++) {
+      if (m[j].v != k) {
+	errors++;
+      }
+    }
+  }
+
+  /* wait for the producer to fill the slack */
+  thread_idle ();
+  ch_recv_n (cu, u, 3);
+  ch_recv (cu, &u[3]);
+  ch_recv_n (cu, u+4, 21);
+  for (i=0; i < 25; i++) {
+    if (u[i] != 100 + i) {
+      errors++;
+    }
+    usum += u[i];
+  }
+
+  for (i=0; i < 5; i++) {
+    ch_recv_n (c0, &x, 1);
+    if (x != 2*i) errors++;
+    ch_recv (c0, &x);
+    if (x != 2*i+1) errors++;
+  }
+
+  printf ("messages: %d errors, sum %lu\n", errors, usum);
+  print_stats ("slack 4", cm);
+  print_stats ("slack 8", cu);
+  print_stats ("slack 0", c0);
+  ch_free (cm);
+  ch_free (cu);
+  ch_free (c0);
+
+  timed_phase ();
+}
+
+/*
+  With tracing on, batched calls go through the timed send/receive
+  and the throughput is reported when the channel is freed
+*/
+static ch_t *ct;
+
+static void tproducer (void)
+{
+  int v[20];
+  int i;
+
+  for (i=0; i < 20; i++) {
+    v[i] = i;
+  }
+  ch_send_n (ct, v, 20);
+}
+
+static void tconsumer (void)
+{
+  char buf[1024];
+  int v[20];
+  int i, n;
+
+  ch_recv_n (ct, v, 20);
+  for (i=0; i < 20; i++) {
+    if (v[i] != i) errors++;
+  }
+  printf ("timed: %d errors, time ", errors);
+  time_print (stdout, CurrentTime ());
+  printf ("\n");
+  print_stats ("timed", ct);
+  ch_free (ct);
+
+  rewind (trace_fp);
+  n = 0;
+  while (fgets (buf, 1024, trace_fp)) {
+    n++;
+  }
+  printf ("trace lines: %d\n", n);
+}
+
+static void timed_phase (void)
+{
+  trace_fp = tmpfile ();
+  if (!trace_fp) {
+    fprintf (stderr, "tmpfile() failed\n");
+    exit (1);
+  }
+  ch_trace (trace_fp);
+  ct = ch_newl (2, sizeof (int), 3, 5);
+  thread_new (tproducer, 0);
+  thread_new (tconsumer, 0);
+}
+
+static int bench_n;
+static ch_t *cb;
+static struct timeval start;
+
+static void bench_send (void)
+{
+  unsigned long u[16];
+  int i, j;
+
+  for (i=0; i < bench_n; i++) {
+    u[0] = i;
+    ch_send (cb, &u[0]);
+  }
+  for (i=0; i < bench_n; i += 16) {
+    for (j=0; j < 16; j++) {
+      u[j] = i + j;
+    }
+    ch_send_n (cb, u, 16);
+  }
+}
+
+static double elapsed (void)
+{
+  struct timeval end;
+
+  gettimeofday (&end, NULL);
+  return (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec)/1e6;
+}
+
+static void bench_recv (void)
+{
+  unsigned long u[16];
+  thread_stats_t s0, s1;
+  int i;
+
+  thread_get_stats (&s0);
+  gettimeofday (&start, NULL);
+  for (i=0; i < bench_n; i++) {
+    ch_recv (cb, &u[0]);
+  }
+  thread_get_stats (&s1);
+  printf ("single:  %.3f s, %lu switches\n", elapsed (),
+	  s1.switches - s0.switches);
+
+  s0 = s1;
+  gettimeofday (&start, NULL);
+  for (i=0; i < bench_n; i += 16) {
+    ch_recv_n (cb, u, 16);
+  }
+  thread_get_stats (&s1);
+  printf ("batched: %.3f s, %lu switches\n", elapsed (),
+	  s1.switches - s0.switches);
+}
+
+int main (int argc, char **argv)
+{
+  /* no time-slice preemption: keeps the output deterministic */
+  context_unfair ();
+
+  if (argc == 3 && argv[1][0] == '-' && argv[1][1] == 'b') {
+    bench_n = (atoi (argv[2]) + 15) & ~15;
+    cb = ch_new (16, sizeof (unsigned long));
+    thread_new (bench_send, 0);
+    thread_new (bench_recv, 0);
+    simulate (NULL);
+  }
+  else if (argc != 1) {
+    fprintf (stderr, "Usage: %s [-b <messages>]\n", argv[0]);
+    return 1;
+  }
+
+  cm = ch_new (4, sizeof (msg_t));
+  cu = ch_new (8, sizeof (unsigned long));
+  c0 = ch_new (0, sizeof (int));
+  thread_new (producer, 0);
+  thread_new (consumer, 0);
+  simulate (NULL);
+  return 0;
+}
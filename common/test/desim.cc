@@ -0,0 +1,141 @@
+/*************************************************************************
+ *
+ *  Parallel SimDES tests
+ *
+ *  Copyright (c) 2019 Rajit Manohar
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301, USA.
+ *
+ **************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "simdes.h"
+
+/*
+  Objects send each other events with equal times. Each object keeps
+  a hash of the sequence of events it sees. Every parallel run must
+  produce the same hashes as the sequential run, whatever the thread
+  timing.
+
+  Partition 0 also owns a WaitForAll condition that wakes up objects in
+  the other partitions.
+*/
+
+#define NOBJ 16
+#define NPART 4
+#define LOOKAHEAD 10
+#define NSTEPS 400
+
+class Node;
+
+static Node *nodes[NOBJ];
+static WaitForAll *barrier;
+static int barrier_slot = 0;
+
+class Node : public SimDES {
+public:
+  Node (int _id) {
+    id = _id;
+    steps = 0;
+    hash = 5381;
+    SetPartition (id % NPART);
+  }
+
+  void Step (int ev_type) {
+    int src = SIM_EV_TYPE (ev_type);
+
+    hash = hash*33 + (CurTimeLo() << 8) + (ev_type & 0xff);
+    steps++;
+    if (steps > NSTEPS) {
+      return;
+    }
+    if (SIM_EV_FLAGS (ev_type) == SIM_EV_FLAG_WAKEUP) {
+      return;
+    }
+
+    /* equal-time events to two other objects */
+    new Event (nodes[(id + 1 + src) % NOBJ],
+	       SIM_EV_MKTYPE (1 + id % 20, 0), LOOKAHEAD);
+    new Event (nodes[(id + 5) % NOBJ], SIM_EV_MKTYPE (1 + id % 20, 0),
+	       LOOKAHEAD);
+    if (steps % 3 == 0) {
+      new Event (nodes[(id + 7) % NOBJ], SIM_EV_MKTYPE (21 + id % 10, 0),
+		 2*LOOKAHEAD);
+    }
+
+    /* objects in partition 0 drive the condition */
+    if (id % NPART == 0 && barrier_slot < 4) {
+      if (barrier_slot == 0) {
+	barrier->AddObject (nodes[3]);
+	barrier->AddObject (nodes[6]);
+      }
+      if (barrier->NotifyAny (31)) {
+	barrier_slot++;
+      }
+    }
+  }
+
+  int id;
+  int steps;
+  unsigned long hash;
+};
+
+static unsigned long run (int nworkers)
+{
+  unsigned long h = 0;
+  int i;
+
+  SimDES::Init ();
+  SimDES::SetParallel (nworkers, LOOKAHEAD);
+  barrier = new WaitForAll (3, LOOKAHEAD);
+  barrier_slot = 0;
+  for (i=0; i < NOBJ; i++) {
+    nodes[i] = new Node (i);
+  }
+  for (i=0; i < NOBJ; i++) {
+    new Event (nodes[i], SIM_EV_MKTYPE (i % 4, 0), 1 + i % 2);
+  }
+  SimDES::Run ();
+  for (i=0; i < NOBJ; i++) {
+    h = h*1000003 + nodes[i]->hash;
+    delete nodes[i];
+  }
+  delete barrier;
+  SimDES::SetParallel (1, 0);
+  return h;
+}
+
+int main (int argc, char **argv)
+{
+  unsigned long h, h0;
+  int i, same;
+
+  h0 = run (1);
+  printf ("sequential: %016lx\n", h0);
+
+  same = 1;
+  for (i=0; i < 20; i++) {
+    h = run (NPART);
+    if (h != h0) {
+      printf ("parallel run %d: %016lx\n", i, h);
+      same = 0;
+    }
+  }
+  printf ("parallel: %s\n", same ? "all runs match sequential" :
+	  "runs differ from sequential");
+  return 0;
+}
@@ -0,0 +1,238 @@
+/*************************************************************************
+ *
+ *  Memory model tests
+ *
+ *  Copyright (c) 2019 Rajit Manohar
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301, USA.
+ *
+ **************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "mem.h"
+
+/*
+  Usage:
+     test-mem              run the memory model tests
+     test-mem -b N         time N sequential and N random accesses
+*/
+
+#define NLOC 50000
+#define SPAN (1ULL << 24)	/* random addresses in the tests */
+#define BENCH_SPAN (1ULL << 27)	/* ... and in the benchmark */
+
+/* reproducible addresses: 64-bit LCG */
+static LL seed;
+
+static LL rnd (void)
+{
+  seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+  return seed >> 11;
+}
+
+static LL rnd_addr (LL span)
+{
+  return (rnd () % span) & ~((1ULL << MEM_ALIGN)-1);
+}
+
+static LL value (LL a)
+{
+  return (a * 0x9e3779b97f4a7c15ULL) | 1;
+}
+
+static int check_random (Mem *m, int n)
+{
+  int i, bad = 0;
+  LL a;
+
+  seed = 1;
+  for (i=0; i < n; i++) {
+    a = rnd_addr (SPAN);
+    if (m->Read (a) != value (a)) bad++;
+  }
+  return bad;
+}
+
+/* read an image back through a pipe, so it is not mapped */
+static long merge_pipe (Mem *m, const char *s)
+{
+  int fd[2];
+  FILE *fp;
+  long n;
+
+  if (pipe (fd) != 0) {
+    return -1;
+  }
+  if (write (fd[1], s, strlen (s)) < 0) {
+    return -1;
+  }
+  close (fd[1]);
+  fp = fdopen (fd[0], "r");
+  n = m->MergeImage (fp);
+  fclose (fp);
+  return n;
+}
+
+static void run_tests (void)
+{
+  Mem *m, *m2;
+  LL a, buf[3000];
+  FILE *fp;
+  long n;
+  int i, bad;
+
+  m = new Mem();
+
+  /* sparse random writes */
+  seed = 1;
+  for (i=0; i < NLOC; i++) {
+    a = rnd_addr (SPAN);
+    m->Write (a, value (a));
+  }
+  printf ("random: %d bad\n", check_random (m, NLOC));
+  printf ("unwritten: 0x%llx\n", m->Read (SPAN + 8));
+
+  /* block access across page boundaries */
+  for (i=0; i < 3000; i++) {
+    buf[i] = value (i);
+  }
+  a = (1ULL << 50) + (MEM_PAGE_SIZE - 1000)*8;
+  m->WriteBlock (a, buf, 3000);
+  bad = 0;
+  for (i=0; i < 3000; i++) {
+    if (m->Read (a + 8*i) != value (i)) bad++;
+  }
+  memset (buf, 0, sizeof (buf));
+  m->ReadBlock (a - 8*10, buf, 3000);
+  for (i=0; i < 10; i++) {
+    if (buf[i] != MEM_BAD) bad++;
+  }
+  for (i=10; i < 3000; i++) {
+    if (buf[i] != value (i-10)) bad++;
+  }
+  printf ("block: %d bad\n", bad);
+
+  /* dump and reload through a regular file */
+  fp = tmpfile ();
+  m->DumpImage (fp);
+  fprintf (fp, "!\n0x8 0x1\n");
+  rewind (fp);
+  m2 = new Mem();
+  n = m2->ReadImage (fp);
+  printf ("reload: %ld locations, %s\n", n,
+	  m2->Compare (m, 0) ? "same" : "different");
+  /* the image stops at the end marker */
+  printf ("after marker: %s\n", ftell (fp) > 0 && fgetc (fp) == '0'
+	  ? "ok" : "wrong position");
+  fclose (fp);
+  delete m2;
+
+  /* a short image; the count is the locations in the image */
+  m2 = new Mem();
+  n = merge_pipe (m2,
+		  "# comment\n"
+		  "0x0000000000000010 0x0000000000000005\n"
+		  "@0x0000000000000100 0x0000000000000007 3\n"
+		  "*0x0000000000000200 2\n"
+		  "0x0000000000000001\n"
+		  "0x0000000000000002\n"
+		  "+0x0000000000000300 2\n"
+		  "0xab\n"
+		  "0xcd\n"
+		  "!\n");
+  printf ("merge: %ld locations, 0x%llx 0x%llx 0x%llx 0x%llx 0x%llx\n", n,
+	  m2->Read (0x10), m2->Read (0x110), m2->Read (0x208),
+	  m2->Read (0x300), m2->Read (0x118));
+  delete m2;
+
+  m->Clear ();
+  printf ("clear: %s\n",
+	  check_random (m, NLOC) == NLOC ? "empty" : "not empty");
+  delete m;
+}
+
+static double elapsed (struct timeval *start)
+{
+  struct timeval end;
+
+  gettimeofday (&end, NULL);
+  return (end.tv_sec - start->tv_sec)
+    + (end.tv_usec - start->tv_usec)/1e6;
+}
+
+static void run_bench (int n)
+{
+  struct timeval start;
+  Mem *m;
+  LL a, sum;
+  double t;
+  int i;
+
+  m = new Mem();
+
+  gettimeofday (&start, NULL);
+  for (i=0; i < n; i++) {
+    m->Write ((LL)i << MEM_ALIGN, i);
+  }
+  t = elapsed (&start);
+  printf ("sequential write: %.1f ns/access\n", t*1e9/n);
+
+  gettimeofday (&start, NULL);
+  sum = 0;
+  for (i=0; i < n; i++) {
+    sum += m->Read ((LL)i << MEM_ALIGN);
+  }
+  t = elapsed (&start);
+  printf ("sequential read: %.1f ns/access (%llx)\n", t*1e9/n, sum);
+
+  seed = 1;
+  gettimeofday (&start, NULL);
+  for (i=0; i < n; i++) {
+    a = rnd_addr (BENCH_SPAN);
+    m->Write (a, a);
+  }
+  t = elapsed (&start);
+  printf ("random write: %.1f ns/access\n", t*1e9/n);
+
+  seed = 1;
+  gettimeofday (&start, NULL);
+  sum = 0;
+  for (i=0; i < n; i++) {
+    sum += m->Read (rnd_addr (BENCH_SPAN));
+  }
+  t = elapsed (&start);
+  printf ("random read: %.1f ns/access (%llx)\n", t*1e9/n, sum);
+
+  delete m;
+}
+
+int main (int argc, char **argv)
+{
+  if (argc == 3 && strcmp (argv[1], "-b") == 0) {
+    run_bench (atoi (argv[2]));
+    return 0;
+  }
+  if (argc != 1) {
+    fprintf (stderr, "Usage: %s [-b <accesses>]\n", argv[0]);
+    return 1;
+  }
+  run_tests ();
+  return 0;
+}
@@ -0,0 +1,51 @@
+#!/bin/sh
+
+echo
+echo "************************************************************************"
+echo "*               Testing common: simulation library                     *"
+echo "************************************************************************"
+echo
+
+ARCH=`$VLSI_TOOLS_SRC/scripts/getarch`
+OS=`$VLSI_TOOLS_SRC/scripts/getos`
+EXT=${ARCH}_${OS}
+
+TESTS="threads swap chan desim mem"
+
+fail=0
+
+if [ ! -d runs ]
+then
+	mkdir runs
+fi
+
+for i in $TESTS
+do
+	echo " [$i]"
+	./test-$i.$EXT > runs/$i.t.stdout 2> runs/$i.t.stderr
+	if ! cmp runs/$i.t.stdout runs/$i.stdout >/dev/null 2>/dev/null
+	then
+		echo "** FAILED TEST $i: stdout **"
+		fail=`expr $fail + 1`
+	fi
+	if [ -s runs/$i.t.stderr ]
+	then
+		echo "** FAILED TEST $i: stderr **"
+		fail=`expr $fail + 1`
+	fi
+done
+
+if [ $fail -ne 0 ]
+then
+	if [ $fail -eq 1 ]
+	then
+		echo "--- Summary: 1 test failed ---"
+	else
+		echo "--- Summary: $fail tests failed ---"
+	fi
+	exit 1
+else
+	echo
+	echo "SUCCESS! All tests passed."
+fi
+echo
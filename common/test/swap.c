@@ -0,0 +1,176 @@
+/*************************************************************************
+ *
+ *  Context switch tests
+ *
+ *  Copyright (c) 2019 Rajit Manohar
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301, USA.
+ *
+ **************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "thread.h"
+
+/*
+  Usage:
+     test-swap             run the context switch tests
+     test-swap -b N        time N switches between two threads
+     test-swap -t N        time N threads that each switch once
+
+  bench-swap-sj is the same program built with the setjmp backend.
+*/
+
+#define NSWAP 6
+
+static char trace[4*NSWAP+1];
+static int tpos = 0;
+
+/* two threads that take turns; floating-point state must survive */
+static double fsum[2];
+
+static void pingpong (void)
+{
+  int me = thread_id () % 2;
+  double x = 1.0 + me;
+  int i;
+
+  for (i=0; i < NSWAP; i++) {
+    trace[tpos++] = "ab"[me];
+    trace[tpos++] = '0' + i;
+    x = x*1.5 + 0.25;
+    thread_idle ();
+  }
+  fsum[me] = x;
+}
+
+/* recursion on a large stack: pages are committed as they are touched */
+static long deep (int n)
+{
+  volatile char buf[1024];
+  int i;
+
+  for (i=0; i < 1024; i++) {
+    buf[i] = n + i;
+  }
+  if (n == 0) {
+    thread_idle ();
+    return buf[7];
+  }
+  return buf[n % 1024] + deep (n-1);
+}
+
+static long deep_sum;
+
+static void deep_thread (void)
+{
+  deep_sum = deep (700);
+}
+
+static int nidle = 0;
+
+static void idler (void)
+{
+  thread_idle ();
+  nidle++;
+}
+
+static int bench_n;
+static struct timeval start;
+
+static void bench_pingpong (void)
+{
+  int i;
+
+  for (i=0; i < bench_n; i++) {
+    thread_idle ();
+  }
+}
+
+static double elapsed (void)
+{
+  struct timeval end;
+
+  gettimeofday (&end, NULL);
+  return (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec)/1e6;
+}
+
+static void report_tests (void)
+{
+  trace[tpos] = '\0';
+  printf ("switch order: %s\n", trace);
+  printf ("fp state: %g %g\n", fsum[0], fsum[1]);
+  printf ("deep stack: %ld\n", deep_sum);
+  printf ("threads: %d\n", nidle);
+}
+
+static void report_switch (void)
+{
+  double t = elapsed ();
+
+  printf ("%d switches: %.3f s, %.1f ns/switch\n", 2*bench_n, t,
+	  t*1e9/(2.0*bench_n));
+}
+
+static void report_spawn (void)
+{
+  struct rusage r;
+  double t = elapsed ();
+
+  getrusage (RUSAGE_SELF, &r);
+  printf ("%d threads: %.3f s, max rss %ld MB\n", nidle, t,
+	  r.ru_maxrss/1024);
+}
+
+int main (int argc, char **argv)
+{
+  int i;
+
+  /* no time-slice preemption: keeps the output deterministic */
+  context_unfair ();
+
+  if (argc == 3 && argv[1][0] == '-') {
+    bench_n = atoi (argv[2]);
+    if (argv[1][1] == 'b') {
+      thread_new (bench_pingpong, 0);
+      thread_new (bench_pingpong, 0);
+      gettimeofday (&start, NULL);
+      simulate (report_switch);
+    }
+    else if (argv[1][1] == 't') {
+      gettimeofday (&start, NULL);
+      for (i=0; i < bench_n; i++) {
+	thread_new (idler, 0);
+      }
+      simulate (report_spawn);
+    }
+  }
+  if (argc != 1) {
+    fprintf (stderr, "Usage: %s [-b <switches> | -t <threads>]\n", argv[0]);
+    return 1;
+  }
+
+  thread_new (pingpong, 0);
+  thread_new (pingpong, 0);
+  thread_new (deep_thread, 1 << 20);
+  for (i=0; i < 5000; i++) {
+    thread_new (idler, 0);
+  }
+  simulate (report_tests);
+  return 0;
+}
@@ -0,0 +1,161 @@
+/*************************************************************************
+ *
+ *  Thread library tests
+ *
+ *  Copyright (c) 2019 Rajit Manohar
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301, USA.
+ *
+ **************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "thread.h"
+#include "count.h"
+
+/*
+  Usage:
+     test-threads             run the timer queue tests
+     test-threads -b N T      time a pipeline of N threads passing T
+                              tokens
+*/
+
+#define NWAKE 24
+
+static int wake_order[NWAKE];
+static Time_t wake_time[NWAKE];
+static int nwake = 0;
+static int next_id = 0;
+static int next_stage = 0;
+
+/*
+  Each thread sleeps for 10, 20, or 30 ticks. Threads that wake up at
+  the same time must be released in the order they went to sleep.
+*/
+static void sleeper (void)
+{
+  int id = next_id++;
+
+  thread_pause (10*(1 + (id*7) % 3));
+  wake_order[nwake] = id;
+  wake_time[nwake] = CurrentTime ();
+  nwake++;
+}
+
+static int stages;
+static int tokens;
+static countw_t **cnt;
+static unsigned long checksum = 0;
+
+/*
+  Pipeline stage i waits for a token from stage i-1. The stages start
+  at staggered times, so every stage is on the timer queue at once.
+*/
+static void stage (void)
+{
+  int i = next_stage++;
+  int k;
+
+  thread_pause (1 + (i*7919L) % stages);
+  for (k=1; k <= tokens; k++) {
+    if (i > 0) {
+      count_await (cnt[i-1], k);
+    }
+    thread_pause (1 + (i % 3));
+    count_advance (cnt[i]);
+  }
+  checksum += CurrentTime ();
+}
+
+static struct timeval start;
+
+static void report_tests (void)
+{
+  thread_stats_t s;
+  int i;
+
+  printf ("wakeup order:");
+  for (i=0; i < nwake; i++) {
+    printf (" %d@", wake_order[i]);
+    time_print (stdout, wake_time[i]);
+  }
+  printf ("\n");
+  printf ("pipeline: %d stages, %d tokens, checksum %lu\n", stages, tokens,
+	  checksum);
+  thread_get_stats (&s);
+  printf ("timer inserts: %lu, wakeups: %lu, depth: %d\n",
+	  s.timer_inserts, s.timer_wakeups, s.timer_depth);
+}
+
+static void report_bench (void)
+{
+  struct timeval end;
+  thread_stats_t s;
+
+  gettimeofday (&end, NULL);
+  thread_get_stats (&s);
+  printf ("pipeline: %d stages, %d tokens, checksum %lu\n", stages, tokens,
+	  checksum);
+  printf ("switches: %lu, timer inserts: %lu, batches: %lu, max batch: %d, max depth: %d\n", s.switches, s.timer_inserts, s.timer_batches, s.max_batch,
+	  s.timer_max_depth);
+  printf ("time: %.3f s\n", (end.tv_sec - start.tv_sec) +
+	  (end.tv_usec - start.tv_usec)/1e6);
+}
+
+static void mk_pipeline (int n, int t)
+{
+  int i;
+
+  stages = n;
+  tokens = t;
+  cnt = (countw_t **) malloc (sizeof (countw_t *)*n);
+  if (!cnt) {
+    fprintf (stderr, "malloc failed\n");
+    exit (1);
+  }
+  for (i=0; i < n; i++) {
+    cnt[i] = count_new (0);
+  }
+  for (i=0; i < n; i++) {
+    thread_new (stage, 0);
+  }
+}
+
+int main (int argc, char **argv)
+{
+  int i;
+
+  /* no time-slice preemption: keeps the output deterministic */
+  context_unfair ();
+
+  if (argc == 4 && argv[1][0] == '-' && argv[1][1] == 'b') {
+    mk_pipeline (atoi (argv[2]), atoi (argv[3]));
+    gettimeofday (&start, NULL);
+    simulate (report_bench);
+  }
+  else if (argc != 1) {
+    fprintf (stderr, "Usage: %s [-b <stages> <tokens>]\n", argv[0]);
+    return 1;
+  }
+
+  for (i=0; i < NWAKE; i++) {
+    thread_new (sleeper, 0);
+  }
+  mk_pipeline (500, 8);
+  simulate (report_tests);
+  return 0;
+}
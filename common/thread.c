@@ -44,8 +44,72 @@ void (*thread_cleanup)(void) = NULL;
 
 static Time_t inconsistent_timer = 0;
 
-lthread_t *timerQh = NULL;
-lthread_t *timerQt = NULL;
+/*
+  The timer queue: a binary heap of threads keyed by (wakeup time,
+  insertion order). The sequence number keeps threads with the same
+  wakeup time in FIFO order, as the old sorted list did.
+*/
+typedef struct {
+  Time_t tm;
+  unsigned long seq;
+  lthread_t *t;
+} timer_ent_t;
+
+static timer_ent_t *timerQ = NULL;
+static int timerQ_sz = 0;
+static int timerQ_max = 0;
+static unsigned long timer_seq = 0;
+
+#define TIMER_LT(a,b) ((a).tm < (b).tm || ((a).tm == (b).tm && (a).seq < (b).seq))
+
+/* queue statistics */
+static thread_stats_t tstats;
+
+static void timer_heap_insert (lthread_t *t, Time_t tm)
+{
+  timer_ent_t e;
+  int i;
+
+  if (timerQ_sz == timerQ_max) {
+    timerQ_max = timerQ_max ? 2*timerQ_max : 128;
+    timerQ = (timer_ent_t *) realloc (timerQ, sizeof (timer_ent_t)*timerQ_max);
+    if (!timerQ) {
+      fprintf (stderr, "thread: out of memory for the timer queue\n");
+      exit (1);
+    }
+  }
+  e.tm = tm;
+  e.seq = timer_seq++;
+  e.t = t;
+
+  i = timerQ_sz++;
+  while (i > 0 && TIMER_LT (e, timerQ[(i-1)/2])) {
+    timerQ[i] = timerQ[(i-1)/2];
+    i = (i-1)/2;
+  }
+  timerQ[i] = e;
+}
+
+static lthread_t *timer_heap_remove_min (void)
+{
+  lthread_t *t;
+  timer_ent_t e;
+  int i, c;
+
+  t = timerQ[0].t;
+  e = timerQ[--timerQ_sz];
+  i = 0;
+  while ((c = 2*i+1) < timerQ_sz) {
+    if (c+1 < timerQ_sz && TIMER_LT (timerQ[c+1], timerQ[c])) {
+      c++;
+    }
+    if (!TIMER_LT (timerQ[c], e)) break;
+    timerQ[i] = timerQ[c];
+    i = c;
+  }
+  timerQ[i] = e;
+  return t;
+}
 
 /*------------------------------------------------------------------------
  *
@@ -56,33 +120,61 @@ lthread_t *timerQt = NULL;
  */
 static void thread_insert_timer (lthread_t *t, Time_t tm)
 {
-  lthread_t *x;
+  if (t->time >= tm) {
+    /* nothing to wait for */
+    t->in_readyq = 1;
+    q_ins (readyQh, readyQt, t);
+    return;
+  }
+  t->time = tm;
+  timer_heap_insert (t, tm);
 
-  if (t->time >= tm) return;
+  tstats.timer_inserts++;
+  if (timerQ_sz > tstats.timer_max_depth) {
+    tstats.timer_max_depth = timerQ_sz;
+  }
+}
 
-  t->time = tm;
+/*------------------------------------------------------------------------
+ *
+ *   Move every thread whose wakeup time has been reached into the
+ *   ready queue in one batch.
+ *
+ *------------------------------------------------------------------------
+ */
+static void thread_release_timers (void)
+{
+  lthread_t *x;
+  int n;
 
-  for (x = timerQh; x; x = x->next) {
-    if (x->time > tm)
-      break;
+  n = 0;
+  while (timerQ_sz > 0 && inconsistent_timer >= timerQ[0].tm) {
+    x = timer_heap_remove_min ();
+    x->in_readyq = 1;
+    q_ins (readyQh, readyQt, x);
+    n++;
   }
-  if (!x) {
-    if (timerQh) {
-      timerQt->next = t;
-    }
-    else {
-      timerQh = t;
+  if (n > 0) {
+    tstats.timer_wakeups += n;
+    tstats.timer_batches++;
+    if (n > tstats.max_batch) {
+      tstats.max_batch = n;
     }
-    timerQt = t;
-  }
-  else {
-    t->next = x->next;
-    x->next = t;
-    if (!t->next)
-      timerQt = t;
   }
 }
 
+/*------------------------------------------------------------------------
+ *
+ *   Return a snapshot of the scheduler queue statistics
+ *
+ *------------------------------------------------------------------------
+ */
+void thread_get_stats (thread_stats_t *s)
+{
+  *s = tstats;
+  s->timer_depth = timerQ_sz;
+}
+
 void thread_pause (int delay)
 {
   context_disable ();
@@ -157,11 +249,16 @@ void context_destroy (lthread_t *t)
   if (t->file) free ((void *)t->file);
 #endif /* DEBUG_MODE */
   if (t->c.sz == DEFAULT_STACK_SIZE) {
+    /* keep the stack around for the next thread */
     t->next = thread_freeq;
     thread_freeq = t;
   }
-  else
+  else {
+#ifdef CONTEXT_MMAP_STACK
+    context_stack_free (t->c.stack, t->c.sz);
+#endif
     free (t);
+  }
 }
 
 
@@ -185,13 +282,18 @@ void context_timeout (void)
 
 lthread_t* context_select (void)
 {
-  lthread_t *t, *x;
+  lthread_t *t;
 
 #ifdef CLASS_HACKERY_NONDET
   if (!readyQh) {
     ch_update_readyQ ();
   }
 #endif
+  if (!readyQh && timerQ_sz > 0) {
+    /* everyone is asleep: advance time to the earliest wakeup */
+    inconsistent_timer = time_max (inconsistent_timer, timerQ[0].tm);
+    thread_release_timers ();
+  }
   q_del (readyQh, readyQt, t);
   if (!t) {
     context_cleanup ();
@@ -202,12 +304,9 @@ lthread_t* context_select (void)
     exit (0);
   }
   t->in_readyq = 0;
+  tstats.switches++;
   inconsistent_timer = time_max (inconsistent_timer, t->time);
-  while (timerQh && inconsistent_timer >= timerQh->time) {
-    q_del (timerQh, timerQl, x);
-    x->in_readyq = 1;
-    q_ins (readyQh, readyQt, x);
-  }
+  thread_release_timers ();
   return t;
 }
 
@@ -241,17 +340,38 @@ _thread_new (void (*f)(void), int stksz, const char *name, int ready,
       t = thread_freeq;
       thread_freeq = thread_freeq->next;
     }
-    else
+    else {
       t = (lthread_t*)malloc(sizeof(lthread_t));
+#ifdef CONTEXT_MMAP_STACK
+      if (t) t->c.stack = NULL;
+#endif
+    }
   }
-  else
+  else {
+#ifdef CONTEXT_MMAP_STACK
+    t = (lthread_t*)malloc(sizeof(lthread_t));
+    if (t) t->c.stack = NULL;
+#else
     t = (lthread_t*)malloc(sizeof(lthread_t)-DEFAULT_STACK_SIZE+stksz);
+#endif
+  }
+#ifdef CONTEXT_MMAP_STACK
+  if (t && !t->c.stack) {
+    /* records on the free list keep their stack */
+    if (!(t->c.stack = context_stack_alloc (stksz))) {
+      free (t);
+      t = NULL;
+    }
+  }
+#endif
   if (!t) {
     printf ("Thread allocation failed, stack size=%d\n",stksz);
     exit (1);
   }
   t->sz = stksz;
+#ifndef CONTEXT_MMAP_STACK
   t->c.stack = (char*) t->s;
+#endif
   t->c.sz = stksz;
   t->tid = tid++;
   t->line = line;
@@ -45,10 +45,12 @@ struct process_record {
   int color;			/* odd/even queue setup */
   int in_readyq;		/* 1 if in the readyq */
   struct process_record *next;
+#ifndef CONTEXT_MMAP_STACK
   double s[(DEFAULT_STACK_SIZE+sizeof(double)-1)/sizeof(double)]; 
          /* stack; this crazy construct is to make the "s" field aligned
 	    properly on a sparc
          */
+#endif
 };
 
 typedef struct process_record lthread_t;
@@ -99,6 +101,19 @@ Time_t CurrentTime ();
 
 int thread_id (void);
 
+  /* scheduler queue statistics */
+typedef struct {
+  unsigned long switches;	/* number of context_select() calls */
+  unsigned long timer_inserts;	/* threads suspended on the timer queue */
+  unsigned long timer_wakeups;	/* threads released from the timer queue */
+  unsigned long timer_batches;	/* number of batched releases */
+  int max_batch;		/* largest number of threads released at once */
+  int timer_depth;		/* current timer queue depth */
+  int timer_max_depth;		/* maximum timer queue depth */
+} thread_stats_t;
+
+void thread_get_stats (thread_stats_t *s);
+
   /* thread save/restore functions */
 void thread_write (FILE *fp, lthread_t *t, int save_ctxt);
 void thread_read (FILE *fp, lthread_t *t, int save_ctxt);  
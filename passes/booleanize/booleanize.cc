@@ -30,14 +30,10 @@
 
 /*-- variables --*/
 
-static act_booleanized_var_t *var_alloc (act_boolean_netlist_t *n,
-					 act_connection *c)
+static void var_init (act_booleanized_var_t *v, act_connection *c)
 {
-  act_booleanized_var_t *v;
-  
   Assert (c == c->primary(), "What?");
 
-  NEW (v, act_booleanized_var_t);
   v->id = c;
   v->input = 0;
   v->output = 0;
@@ -55,9 +51,13 @@ static act_booleanized_var_t *var_alloc (act_boolean_netlist_t *n,
   v->extra = NULL;
   v->width = 1;
   v->w2 = 0;
-  return v;
 }
 
+/*
+ * Returns the variable for c, creating it if necessary. Variables
+ * live in n->vars[], so the pointer is only valid until the next
+ * variable is created.
+ */
 static act_booleanized_var_t *_var_lookup (act_boolean_netlist_t *n,
 					  act_connection *c)
 {
@@ -67,12 +67,15 @@ static act_booleanized_var_t *_var_lookup (act_boolean_netlist_t *n,
 
   c = c->primary();
 
-  b = phash_lookup (n->cH, c);
+  b = phash_lookup (n->cidx, c);
   if (!b) {
     act_booleanized_var_t *v;
-    b = phash_add (n->cH, c);
-    v = var_alloc (n, c);
-    b->v = v;
+    b = phash_add (n->cidx, c);
+    b->i = A_LEN (n->vars);
+    A_NEW (n->vars, act_booleanized_var_t);
+    v = &A_NEXT (n->vars);
+    A_INC (n->vars);
+    var_init (v, c);
     if (c->isglobal()) {
       v->isglobal = 1;
     }
@@ -92,7 +95,7 @@ static act_booleanized_var_t *_var_lookup (act_boolean_netlist_t *n,
     delete xit;
     delete tmp;
   }
-  return (act_booleanized_var_t *)b->v;
+  return &n->vars[b->i];
 }
 
 static act_booleanized_var_t *raw_lookup (act_boolean_netlist_t *n,
@@ -104,11 +107,11 @@ static act_booleanized_var_t *raw_lookup (act_boolean_netlist_t *n,
 
   c = c->primary();
 
-  b = phash_lookup (n->cH, c);
+  b = phash_lookup (n->cidx, c);
   if (!b) {
     return NULL;
   }
-  return (act_booleanized_var_t *)b->v;
+  return &n->vars[b->i];
 }
 
 
@@ -726,9 +729,9 @@ static act_dynamic_var_t *get_dynamic_id (act_boolean_netlist_t *N,
   act_connection *c = tmp->Canonical (N->cur);
   delete tmp;
 
-  b = phash_lookup (N->cdH, c);
+  b = phash_lookup (N->cdidx, c);
   if (b) {
-    return (act_dynamic_var_t *)b->v;
+    return &N->dvars[b->i];
   }
   else {
     return NULL;
@@ -753,7 +756,7 @@ static void _add_dynamic_id (act_boolean_netlist_t *N, ActId *id)
 
   phash_bucket_t *b;
 
-  b = phash_lookup (N->cdH, c);
+  b = phash_lookup (N->cdidx, c);
   if (b) {
     delete tmp;
     delete it;
@@ -761,8 +764,11 @@ static void _add_dynamic_id (act_boolean_netlist_t *N, ActId *id)
   }
   else {
     act_dynamic_var_t *v;
-    b = phash_add (N->cdH, c);
-    NEW (v, act_dynamic_var_t);
+    b = phash_add (N->cdidx, c);
+    b->i = A_LEN (N->dvars);
+    A_NEW (N->dvars, act_dynamic_var_t);
+    v = &A_NEXT (N->dvars);
+    A_INC (N->dvars);
     v->id = c;
     v->aid = tmp;
     v->width = 1;
@@ -775,7 +781,6 @@ static void _add_dynamic_id (act_boolean_netlist_t *N, ActId *id)
     }
     Assert (it->arrayInfo(), "What?");
     v->a = it->arrayInfo();
-    b->v = v;
   }
   delete it;
   return;
@@ -1440,13 +1445,16 @@ static act_boolean_netlist_t *process_local_lang (Act *a, Process *proc)
   A_INIT (N->instports);
   A_INIT (N->instchpports);
   A_INIT (N->nets);
+  A_INIT (N->pins);
   A_INIT (N->used_globals);
+  A_INIT (N->vars);
+  A_INIT (N->dvars);
   
   N->p = proc;
   N->cur = cur;
   N->visited = 0;
-  N->cH = phash_new (32);
-  N->cdH = phash_new (4);
+  N->cidx = phash_new (32);
+  N->cdidx = phash_new (4);
   N->isempty = 1;
 
   
@@ -1495,15 +1503,12 @@ act_boolean_netlist_t *ActBooleanizePass::_create_local_bools (Process *p)
   /*--
     Check that dynamic bits are valid
     --*/
-  phash_iter_t iter;
-  phash_bucket_t *b;
-  phash_iter_init (n->cdH, &iter);
   fail = 0;
-  while ((b = phash_iter_next (n->cdH, &iter))) {
+  for (int k=0; k < A_LEN (n->dvars); k++) {
     act_dynamic_var_t *v;
     act_connection *c;
     ValueIdx *vx;
-    v = (act_dynamic_var_t *) b->v;
+    v = &n->dvars[k];
     int newfail = 0;
 
     if (v->id->isglobal()) {
@@ -1556,13 +1561,18 @@ act_boolean_netlist_t *ActBooleanizePass::_create_local_bools (Process *p)
 
   /*-- create elaborated port list --*/
   if (p) {
+    _portH = phash_new (8);
+    _chpportH = phash_new (8);
     flatten_ports_to_bools (n, NULL, sc, p, 0);
+    phash_free (_portH);
+    phash_free (_chpportH);
+    _portH = NULL;
+    _chpportH = NULL;
   }
 
   /*-- collect globals --*/
-  phash_iter_init (n->cH, &iter);
-  while ((b = phash_iter_next (n->cH, &iter))) {
-    act_booleanized_var_t *v = (act_booleanized_var_t *)b->v;
+  for (int k=0; k < A_LEN (n->vars); k++) {
+    act_booleanized_var_t *v = &n->vars[k];
     if (!v->output) {
       /* if a channel isn't properly defined, no flags might be set
 	 for a chp variable 
@@ -1582,7 +1592,7 @@ act_boolean_netlist_t *ActBooleanizePass::_create_local_bools (Process *p)
     }
 
     /*-- now check if this is fragmented --*/
-    act_connection *c = (act_connection *)b->key;
+    act_connection *c = v->id;
     if (!c->hasSubconnections()) {
       v->isfragmented = 0;
     }
@@ -1612,6 +1622,12 @@ act_boolean_netlist_t *ActBooleanizePass::_create_local_bools (Process *p)
     n->isempty = 0;
   }
 
+  /*-- all variables have been created; trim the variable table --*/
+  if (A_LEN (n->vars) > 0 && A_LEN (n->vars) < A_MAX (n->vars)) {
+    REALLOC (n->vars, act_booleanized_var_t, A_LEN (n->vars));
+    A_MAX (n->vars) = A_LEN (n->vars);
+  }
+
   return n;
 }
 
@@ -1718,8 +1734,26 @@ void ActBooleanizePass::append_base_port (act_boolean_netlist_t *n,
 					  act_connection *c, Type *t,
 					  int mode)
 {
-  int i;
   int dir = c->getDir();
+  int seen = 0, chpseen = 0;
+
+  /* duplicates in the port list are omitted */
+  if (mode != 2) {
+    if (phash_lookup (_portH, c)) {
+      seen = 1;
+    }
+    else {
+      phash_add (_portH, c);
+    }
+  }
+  if (mode != 1) {
+    if (phash_lookup (_chpportH, c)) {
+      chpseen = 1;
+    }
+    else {
+      phash_add (_chpportH, c);
+    }
+  }
 
   if (mode != 2) {
     A_NEWM (n->ports, struct netlist_bool_port);
@@ -1769,10 +1803,8 @@ void ActBooleanizePass::append_base_port (act_boolean_netlist_t *n,
 
   int bool_done = 0;
   int chp_done = 0;
-  phash_bucket_t *b;
-  b = phash_lookup (n->cH, c);
-  if (b) {
-    act_booleanized_var_t *v = (act_booleanized_var_t *)b->v;
+  act_booleanized_var_t *v = raw_lookup (n, c);
+  if (v) {
     if (!v->used) {
       if (mode != 2) {
 	A_LAST (n->ports).omit = 1;
@@ -1820,26 +1852,14 @@ void ActBooleanizePass::append_base_port (act_boolean_netlist_t *n,
     return;
   }
 
-  if (!bool_done && mode != 2) {
-    for (i=0; i < A_LEN (n->ports)-1; i++) {
-      /* check to see if this is already in the port list;
-	 make this faster with a map if necessary since it is O(n^2) */
-      if (c == n->ports[i].c) {
-	A_LAST (n->ports).omit = 1;
-	return;
-      }
-    }
+  if (!bool_done && mode != 2 && seen) {
+    A_LAST (n->ports).omit = 1;
+    return;
   }
 
-  if (!chp_done && mode != 1) {
-    for (i=0; i < A_LEN (n->chpports)-1; i++) {
-      /* check to see if this is already in the port list;
-	 make this faster with a map if necessary since it is O(n^2) */
-      if (c == n->chpports[i].c) {
-	A_LAST (n->chpports).omit = 1;
-	return;
-      }
-    }
+  if (!chp_done && mode != 1 && chpseen) {
+    A_LAST (n->chpports).omit = 1;
+    return;
   }
 }
 
@@ -2234,30 +2254,25 @@ void ActBooleanizePass::update_used_flags (act_boolean_netlist_t *n,
 void ActBooleanizePass::free_local (void *v)
 {
   act_boolean_netlist_t *n = (act_boolean_netlist_t *)v;
-  int i;
-  phash_bucket_t *b;
-  phash_iter_t iter;
   
   if (!n) return;
 
-  Assert (n->cH, "Hmm");
+  Assert (n->cidx, "Hmm");
 
-  phash_iter_init (n->cH, &iter);
-  while ((b = phash_iter_next (n->cH, &iter))) {
-    act_booleanized_var_t *v = (act_booleanized_var_t *) b->v;
-    FREE (v);
+  for (int i=0; i < A_LEN (n->dvars); i++) {
+    delete n->dvars[i].aid;
   }
-  phash_iter_init (n->cdH, &iter);
-  while ((b = phash_iter_next (n->cdH, &iter))) {
-    act_dynamic_var_t *v = (act_dynamic_var_t *) b->v;
-    delete v->aid;
-    FREE (v);
-  }
-  phash_free (n->cH);
-  phash_free (n->cdH);
+  A_FREE (n->vars);
+  A_FREE (n->dvars);
+  phash_free (n->cidx);
+  phash_free (n->cdidx);
   A_FREE (n->ports);
+  A_FREE (n->chpports);
   A_FREE (n->instports);
+  A_FREE (n->instchpports);
+  A_FREE (n->used_globals);
   A_FREE (n->nets);
+  A_FREE (n->pins);
   FREE (n);
 }
 
@@ -2271,10 +2286,15 @@ ActBooleanizePass::ActBooleanizePass(Act *a) : ActPass(a, "booleanize")
     black_box_mode = 1;
     config_set_default_int ("net.black_box_mode", 1);
   }
+  _portH = NULL;
+  _chpportH = NULL;
+  _netH = NULL;
+  A_INIT (_pinnet);
 }
 
 ActBooleanizePass::~ActBooleanizePass()
 {
+  A_FREE (_pinnet);
 }
 
 
@@ -2299,8 +2319,16 @@ void ActBooleanizePass::_createNets (Process *p)
   act_boolean_netlist_t *n = (act_boolean_netlist_t *) getMap (p);
   Assert (n, "What?");
 
+  if (A_LEN (n->nets) > 0) {
+    /* already created */
+    return;
+  }
+
   ActInstiter i(p ? p->CurScope() : a->Global()->CurScope());
 
+  _netH = phash_new (8);
+  A_LEN (_pinnet) = 0;
+
   int iport = 0;
   for (i = i.begin(); i != i.end(); i++) {
     ValueIdx *vx = (*i);
@@ -2335,7 +2363,7 @@ void ActBooleanizePass::_createNets (Process *p)
 	    addPin (n, netid, vx->getName(), tmpa, sub->ports[j].c);
 	  }
 	  else {
-	    importPins (n, netid, vx->getName(), tmpa,
+	    importPins (n, netid, vx->getName(), tmpa, sub,
 			&sub->nets[sub->ports[j].netid]);
 	  }
 	  for (int k=0; k < A_LEN (n->ports); k++) {
@@ -2357,7 +2385,7 @@ void ActBooleanizePass::_createNets (Process *p)
 	  if (k == A_LEN (sub->ports)) {
 	    /* global net, not in port list */
 	    int netid = addNet (n, sub->nets[j].net);
-	    importPins (n, netid, vx->getName(), tmpa, &sub->nets[j]);
+	    importPins (n, netid, vx->getName(), tmpa, sub, &sub->nets[j]);
 	    sub->nets[j].skip = 1;
 	  }
 	}
@@ -2377,6 +2405,29 @@ void ActBooleanizePass::_createNets (Process *p)
       n->nets[n->ports[i].netid].port = 1;
     }
   }
+
+  /*-- group the pins by net --*/
+  if (A_LEN (n->pins) > 0) {
+    act_local_pin_t *tmp;
+    int pos = 0;
+
+    for (int i=0; i < A_LEN (n->nets); i++) {
+      n->nets[i].pin = pos;
+      pos += n->nets[i].npins;
+      n->nets[i].npins = 0;
+    }
+    MALLOC (tmp, act_local_pin_t, A_LEN (n->pins));
+    for (int i=0; i < A_LEN (n->pins); i++) {
+      act_local_net_t *net = &n->nets[_pinnet[i]];
+      tmp[net->pin + net->npins] = n->pins[i];
+      net->npins++;
+    }
+    FREE (n->pins);
+    n->pins = tmp;
+    A_MAX (n->pins) = A_LEN (n->pins);
+  }
+  phash_free (_netH);
+  _netH = NULL;
 }
 
 void ActBooleanizePass::createNets (Process *p)
@@ -2387,15 +2438,21 @@ void ActBooleanizePass::createNets (Process *p)
 
 int ActBooleanizePass::addNet (act_boolean_netlist_t *n, act_connection *c)
 {
-  int i;
-  for (i=0; i < A_LEN (n->nets); i++) {
-    if (n->nets[i].net == c) return i;
+  phash_bucket_t *b;
+
+  b = phash_lookup (_netH, c);
+  if (b) {
+    return b->i;
   }
+  b = phash_add (_netH, c);
+  b->i = A_LEN (n->nets);
+  
   A_NEW (n->nets, act_local_net_t);
   A_NEXT (n->nets).net = c;
   A_NEXT (n->nets).skip = 0;
   A_NEXT (n->nets).port = 0;
-  A_INIT (A_NEXT (n->nets).pins);
+  A_NEXT (n->nets).pin = 0;
+  A_NEXT (n->nets).npins = 0;
   A_INC (n->nets);
   return A_LEN (n->nets)-1;
 }
@@ -2407,33 +2464,45 @@ void ActBooleanizePass::addPin (act_boolean_netlist_t *n,
 {
   Assert (0 <= netid && netid < A_LEN (n->nets), "What?");
 
-  A_NEWM (n->nets[netid].pins, act_local_pin_t);
+  /* pins are appended in creation order, and grouped by net once
+     all the nets have been created */
+  A_NEW (n->pins, act_local_pin_t);
+  A_NEW (_pinnet, int);
 
   ActId *inst = new ActId (name);
   inst->setArray (a);
-  A_NEXT (n->nets[netid].pins).inst = inst;
-  A_NEXT (n->nets[netid].pins).pin = pin;
-  A_INC (n->nets[netid].pins);
+  A_NEXT (n->pins).inst = inst;
+  A_NEXT (n->pins).pin = pin;
+  A_INC (n->pins);
+  A_NEXT (_pinnet) = netid;
+  A_INC (_pinnet);
+  n->nets[netid].npins++;
 }
 
 void ActBooleanizePass::importPins (act_boolean_netlist_t *n,
 				    int netid,
 				    const char *name, Array *a,
+				    act_boolean_netlist_t *sub,
 				    act_local_net_t *net)
 {
   Assert (0 <= netid && netid < A_LEN (n->nets), "What?");
 
-  for (int i=0; i < A_LEN (net->pins); i++) {
+  for (int i=0; i < net->npins; i++) {
+    act_local_pin_t *pin = &sub->pins[net->pin + i];
     ActId *inst;
     /* orig name becomes <name>.<orig> */
-    A_NEW (n->nets[netid].pins, act_local_pin_t);
+    A_NEW (n->pins, act_local_pin_t);
+    A_NEW (_pinnet, int);
 
     inst = new ActId (name);
     inst->setArray (a);
-    inst->Append (net->pins[i].inst);
-    A_NEXT (n->nets[netid].pins).inst = inst;
-    A_NEXT (n->nets[netid].pins).pin = net->pins[i].pin;
-    A_INC (n->nets[netid].pins);
+    inst->Append (pin->inst);
+    A_NEXT (n->pins).inst = inst;
+    A_NEXT (n->pins).pin = pin->pin;
+    A_INC (n->pins);
+    A_NEXT (_pinnet) = netid;
+    A_INC (_pinnet);
+    n->nets[netid].npins++;
   }
 }
 
@@ -2456,8 +2525,8 @@ act_dynamic_var_t *ActBooleanizePass::isDynamicRef (act_boolean_netlist_t *n,
     c = c->primary();
   } while (c->parent);
   
-  if ((b = phash_lookup (n->cdH, c))) {
-    return (act_dynamic_var_t *) b->v;
+  if ((b = phash_lookup (n->cdidx, c))) {
+    return &n->dvars[b->i];
   }
   return NULL;
 }
@@ -2477,3 +2546,55 @@ act_dynamic_var_t *ActBooleanizePass::isDynamicRef (act_boolean_netlist_t *n,
   }
   return ActBooleanizePass::isDynamicRef (n, cx);
 }
+
+
+act_booleanized_var_t *ActBooleanizePass::getVar (act_boolean_netlist_t *n,
+						  act_connection *c)
+{
+  int idx = getVarIdx (n, c);
+  if (idx == -1) {
+    return NULL;
+  }
+  return &n->vars[idx];
+}
+
+int ActBooleanizePass::getVarIdx (act_boolean_netlist_t *n,
+				  act_connection *c)
+{
+  phash_bucket_t *b;
+
+  if (!c) {
+    return -1;
+  }
+  b = phash_lookup (n->cidx, c->primary());
+  if (!b) {
+    return -1;
+  }
+  return b->i;
+}
+
+act_dynamic_var_t *ActBooleanizePass::getDynVar (act_boolean_netlist_t *n,
+						 act_connection *c)
+{
+  phash_bucket_t *b;
+
+  if (!c) {
+    return NULL;
+  }
+  b = phash_lookup (n->cdidx, c->primary());
+  if (!b) {
+    return NULL;
+  }
+  return &n->dvars[b->i];
+}
+
+act_local_pin_t *ActBooleanizePass::getPins (act_boolean_netlist_t *n,
+					     int netid, int *num)
+{
+  Assert (0 <= netid && netid < A_LEN (n->nets), "Invalid net id");
+  *num = n->nets[netid].npins;
+  if (n->nets[netid].npins == 0) {
+    return NULL;
+  }
+  return &n->pins[n->nets[netid].pin];
+}
@@ -103,7 +103,7 @@ typedef struct {
   act_connection *net; // this could be a global
   unsigned int skip:1; // skip this net
   unsigned int port:1; // is a port
-  A_DECL (act_local_pin_t, pins);
+  int pin, npins;      // pins[pin ... pin+npins-1] in the netlist
 } act_local_net_t;
 
 
@@ -114,8 +114,17 @@ typedef struct {
   unsigned int visited:1;	/* flags */
   unsigned int isempty:1;	/* check if this is empty! */
 
-  struct pHashtable *cH;   /* connection hash table (map to var)  */
-  struct pHashtable *cdH;  /* connection hash table for dynamic vars */
+  /*
+    Variables are numbered densely, and stored contiguously in vars[]
+    and dvars[]. The hash tables map a primary connection pointer to
+    its index (b->i); use ActBooleanizePass::getVar() and friends
+    rather than the hash tables directly.
+  */
+  A_DECL (act_booleanized_var_t, vars);
+  A_DECL (act_dynamic_var_t, dvars);
+
+  struct pHashtable *cidx;  /* connection -> index in vars[] */
+  struct pHashtable *cdidx; /* connection -> index in dvars[] */
 
   A_DECL (struct netlist_bool_port, chpports);
   A_DECL (struct netlist_bool_port, ports);
@@ -124,6 +133,7 @@ typedef struct {
   A_DECL (act_connection *, used_globals);
 
   A_DECL (act_local_net_t, nets); // nets
+  A_DECL (act_local_pin_t, pins); // pins for all the nets, by net
 
 } act_boolean_netlist_t;
 
@@ -166,6 +176,28 @@ class ActBooleanizePass : public ActPass {
 					  act_connection *);
   static act_dynamic_var_t *isDynamicRef (act_boolean_netlist_t *,
 					  ActId *);
+
+  /**
+   * Variable lookup.
+   *  @return the variable for connection c (which need not be
+   *  primary), or NULL/-1 if there isn't one
+   */
+  static act_booleanized_var_t *getVar (act_boolean_netlist_t *n,
+					act_connection *c);
+  static int getVarIdx (act_boolean_netlist_t *n, act_connection *c);
+
+  /**
+   * Dynamic variable lookup, by the connection for the array.
+   */
+  static act_dynamic_var_t *getDynVar (act_boolean_netlist_t *n,
+				       act_connection *c);
+
+  /**
+   * Pins of a net: returns a pointer to the first pin, and sets *num
+   * to the number of pins
+   */
+  static act_local_pin_t *getPins (act_boolean_netlist_t *n, int netid,
+				   int *num);
   
   /*-- internal data structures and functions --*/
  private:
@@ -195,7 +227,13 @@ class ActBooleanizePass : public ActPass {
   void _createNets (Process *p);
   int addNet (act_boolean_netlist_t *n, act_connection *c);
   void addPin (act_boolean_netlist_t *n, int netid, const char *name, Array *a, act_connection *pin);
-  void importPins (act_boolean_netlist_t *n, int netid, const char *name, Array *a, act_local_net_t *net);
+  void importPins (act_boolean_netlist_t *n, int netid, const char *name, Array *a, act_boolean_netlist_t *sub, act_local_net_t *net);
+
+  /*-- scratch space while creating port lists and nets --*/
+  struct pHashtable *_portH;	// connections in the port list
+  struct pHashtable *_chpportH;	// connections in the chp port list
+  struct pHashtable *_netH;	// connection -> net id
+  A_DECL (int, _pinnet);	// net id for each pin, in creation order
 
 };
 
@@ -27,7 +27,27 @@
 #include "config.h"
 #include <act/iter.h>
 
-#define VINF(x) ((struct act_varinfo *)((x)->extra))
+#define VINF(x) ((struct act_nl_varinfo *)((x)->extra))
+
+/*
+ * Print the mangled name of a connection. Connections that have a
+ * node in the netlist use the cached node name.
+ */
+static void emit_conn (Act *a, netlist_t *n, act_connection *c, FILE *fp)
+{
+  act_booleanized_var_t *v = ActBooleanizePass::getVar (n->bN, c);
+
+  if (v && v->id == c && VINF(v) && VINF(v)->n) {
+    fputs (ActNetlistPass::nodeName (n, VINF(v)->n, 1), fp);
+  }
+  else {
+    ActId *id = c->toid();
+    char buf[10240];
+    id->sPrint (buf, 10240);
+    a->mfprintf (fp, "%s", buf);
+    delete id;
+  }
+}
 
 
 void ActNetlistPass::emit_netlist (Process *p, FILE *fp)
@@ -86,11 +106,8 @@ void ActNetlistPass::emit_netlist (Process *p, FILE *fp)
   int out = 0;
   for (int k=0; k < A_LEN (n->bN->ports); k++) {
     if (n->bN->ports[k].omit) continue;
-    ActId *id = n->bN->ports[k].c->toid();
-    char buf[10240];
-    id->sPrint (buf, 10240);
-    a->mfprintf (fp, " %s", buf);
-    delete id;
+    fprintf (fp, " ");
+    emit_conn (a, n, n->bN->ports[k].c, fp);
     out = 1;
   }
 
@@ -109,12 +126,9 @@ void ActNetlistPass::emit_netlist (Process *p, FILE *fp)
     fprintf (fp, "*.PININFO");
     for (int k=0; k < A_LEN (n->bN->ports); k++) {
       if (n->bN->ports[k].omit) continue;
-      ActId *id = n->bN->ports[k].c->toid();
-      char buf[10240];
-      id->sPrint (buf, 10240);
-      a->mfprintf (fp, " %s", buf);
+      fprintf (fp, " ");
+      emit_conn (a, n, n->bN->ports[k].c, fp);
       fprintf (fp, ":%c", n->bN->ports[k].input ? 'I' : 'O');
-      delete id;
     }
     if (n->weak_supply_vdd > 0) {
       fprintf (fp, " #%d:I", n->nid_wvdd);
@@ -175,15 +189,11 @@ void ActNetlistPass::emit_netlist (Process *p, FILE *fp)
   for (x = n->hd; x; x = x->next) {
     if (!x->v) continue;
     if (!x->v->v->output) continue;
-    ActId *id = x->v->v->id->toid();
-    char buf[10240];
-    id->sPrint (buf, 10240);
-    delete id;
     if (!out) {
       fprintf (fp, "*\n* --- node flags ---\n*\n");
       out = 1;
     }
-    a->mfprintf (fp, "* %s ", buf);
+    a->mfprintf (fp, "* %s ", nodeName (n, x));
     if (x->v->stateholding) {
       fprintf (fp, "(state-holding): pup_reff=%g; pdn_reff=%g\n",
 	       x->reff[EDGE_PFET], x->reff[EDGE_NFET]);
@@ -444,16 +454,11 @@ void ActNetlistPass::emit_netlist (Process *p, FILE *fp)
 	    a->mfprintf (fp, "x%s%s", vx->getName(), str);
 	    FREE (str);
 	    for (int i=0; i < A_LEN (sub->bN->ports); i++) {
-	      ActId *id;
-	      char buf[10240];
 	      if (sub->bN->ports[i].omit) continue;
 
 	      Assert (iport < A_LEN (n->bN->instports), "Hmm");
-	      id = n->bN->instports[iport]->toid();
 	      fprintf (fp, " ");
-	      id->sPrint (buf, 10240);
-	      a->mfprintf (fp, "%s", buf);
-	      delete id;
+	      emit_conn (a, n, n->bN->instports[iport], fp);
 	      iport++;
 	    }
 
@@ -476,16 +481,11 @@ void ActNetlistPass::emit_netlist (Process *p, FILE *fp)
 	else {
 	  a->mfprintf (fp, "x%s", vx->getName ());
 	  for (int i =0; i < A_LEN (sub->bN->ports); i++) {
-	    ActId *id;
-	    char buf[10240];
 	    if (sub->bN->ports[i].omit) continue;
 	  
 	    Assert (iport < A_LEN (n->bN->instports), "Hmm");
-	    id = n->bN->instports[iport]->toid();
 	    fprintf (fp, " ");
-	    id->sPrint (buf, 10240);
-	    a->mfprintf (fp, "%s", buf);
-	    delete id;
+	    emit_conn (a, n, n->bN->instports[iport], fp);
 	    iport++;
 	  }
 
@@ -168,11 +168,8 @@ static void compute_max_reff (netlist_t *N, int type)
   list_free (l);
 
   /* for each variable v, compute reff as the max of all paths */
-  ihash_bucket_t *b;
-  ihash_iter_t iter;
-  ihash_iter_init (N->bN->cH, &iter);
-  while ((b = ihash_iter_next (N->bN->cH, &iter))) {
-    act_booleanized_var_t *v = (act_booleanized_var_t *)b->v;
+  for (int vi=0; vi < A_LEN (N->bN->vars); vi++) {
+    act_booleanized_var_t *v = &N->bN->vars[vi];
 
     /* some variables are only there for connecting to sub-circuits */
     if (!VINF(v)) continue;
@@ -240,6 +237,8 @@ static node_t *node_alloc (netlist_t *n, struct act_nl_varinfo *vi)
 
   x->reff_set[0] = 0;
   x->reff_set[1] = 0;
+  x->name = NULL;
+  x->mname = NULL;
   x->cap = 0;
   x->resis = 0;
   x->next = NULL;
@@ -279,16 +278,12 @@ static void *varinfo_alloc (netlist_t *n, act_booleanized_var_t *v)
 
 static act_booleanized_var_t *var_lookup (netlist_t *n, act_connection *c)
 {
-  phash_bucket_t *b;
   act_booleanized_var_t *v;
 
   if (!c) return NULL;
 
-  c = c->primary();
-
-  b = phash_lookup (n->bN->cH, c);
-  Assert (b, "What?!");
-  v = (act_booleanized_var_t *) b->v;
+  v = ActBooleanizePass::getVar (n->bN, c);
+  Assert (v, "What?!");
   if (!v->extra) {
     v->extra = varinfo_alloc (n, v);
   }
@@ -306,13 +301,12 @@ static act_booleanized_var_t *var_lookup (netlist_t *n, ActId *id)
 
 static node_t *node_lookup (netlist_t *n, act_connection *c)
 {
-  phash_bucket_t *b;
+  act_booleanized_var_t *v;
   
   if (!c) return NULL;
-  c = c->primary();
-  b = phash_lookup (n->bN->cH, c);
-  if (b) {
-    return VINF(((act_booleanized_var_t *)b->v))->n;
+  v = ActBooleanizePass::getVar (n->bN, c);
+  if (v) {
+    return VINF(v)->n;
   }
   else {
     return NULL;
@@ -1291,7 +1285,8 @@ node_t *ActNetlistPass::string_to_node (netlist_t *N, char *s)
   return n;
 }
 
-void ActNetlistPass::sprint_node (char *buf, int sz, netlist_t *N, node_t *n)
+/* compute the printed name of a node */
+void ActNetlistPass::name_node (char *buf, int sz, netlist_t *N, node_t *n)
 {
   if (n->v) {
     ActId *id = n->v->v->id->toid();
@@ -1364,16 +1359,32 @@ void ActNetlistPass::sprint_node (char *buf, int sz, netlist_t *N, node_t *n)
   }
 }
 
-void ActNetlistPass::emit_node (netlist_t *N, FILE *fp, node_t *n, int mangle)
+const char *ActNetlistPass::nodeName (netlist_t *N, node_t *n, int mangle)
 {
-  char buf[10240];
-  sprint_node (buf, 10240, N, n);
-  if (mangle) {
-    ActNetlistPass::current_act->mfprintf (fp, "%s", buf);
+  if (!n->name) {
+    char buf[10240];
+    name_node (buf, 10240, N, n);
+    n->name = Strdup (buf);
   }
-  else {
-    fprintf (fp, "%s", buf);
+  if (!mangle) {
+    return n->name;
+  }
+  if (!n->mname) {
+    char buf[20480];
+    ActNetlistPass::current_act->msnprintf (buf, 20480, "%s", n->name);
+    n->mname = Strdup (buf);
   }
+  return n->mname;
+}
+
+void ActNetlistPass::sprint_node (char *buf, int sz, netlist_t *N, node_t *n)
+{
+  snprintf (buf, sz, "%s", nodeName (N, n));
+}
+
+void ActNetlistPass::emit_node (netlist_t *N, FILE *fp, node_t *n, int mangle)
+{
+  fputs (nodeName (N, n, mangle), fp);
 }
 
 static void tree_compute_sharing (netlist_t *N, node_t *power,
@@ -2228,6 +2239,12 @@ static void free_nl (netlist_t *n)
     if (prev->v) {
       FREE (prev->v);
     }
+    if (prev->name) {
+      FREE (prev->name);
+    }
+    if (prev->mname) {
+      FREE (prev->mname);
+    }
     /* free edge the second time you see it */
     for (listitem_t *li = list_first (prev->e); li; li = list_next (li)) {
       edge_t *e = (edge_t *) list_value (li);
@@ -105,6 +105,9 @@ typedef struct node {
   double cap;			/* cap to GND on the node */
   double resis;			/* output resistance of the node */
 
+  char *name, *mname;		/* cached printed name, and its
+				   mangled version; NULL until used */
+
   struct node *next;		/* global list of nodes for the
 				   Netlist */
 } node_t;
@@ -195,6 +198,14 @@ class ActNetlistPass : public ActPass {
   static void sprint_node (char *buf, int sz, netlist_t *N, node_t *n);
   static void emit_node (netlist_t *N, FILE *fp, node_t *n, int mangle = 0);
 
+  /**
+   * The printed name of a node. The name is computed on first use
+   * and cached in the node, so repeated printing is cheap.
+   *  @param mangle is 1 if the mangled version is needed
+   *  @return the name; valid for the lifetime of the netlist
+   */
+  static const char *nodeName (netlist_t *N, node_t *n, int mangle = 0);
+
   static void spice_to_act_name (char *s, char *t, int sz, int xconv);
 
   static int getGridsPerLambda() { return grids_per_lambda; }
@@ -276,6 +287,8 @@ class ActNetlistPass : public ActPass {
 			  act_prs_expr_t *e, node_t *right, int sense);
   
   void emit_netlist (Process *p, FILE *fp);
+
+  static void name_node (char *buf, int sz, netlist_t *N, node_t *n);
 };
 
 
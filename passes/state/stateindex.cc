@@ -0,0 +1,1280 @@
+/*************************************************************************
+ *
+ *  This file is part of the ACT library
+ *
+ *  Copyright (c) 2020 Rajit Manohar
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301, USA.
+ *
+ **************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <act/passes/statepass.h>
+
+/*
+ * Index layout. Everything lives in one buffer: a header followed by
+ * the sections below, each 8-byte aligned. All references between
+ * sections are indices, so the buffer can be written out and mapped
+ * back in anywhere.
+ */
+#define SIDX_MAGIC "ACTSIDX1"
+#define SIDX_VERSION 1
+
+#define SIDX_NONE 0xffffffffU
+
+enum {
+  SEC_STR,			/* string table */
+  SEC_TYPE,			/* act_sidx_type */
+  SEC_VAR,			/* act_sidx_var, sorted by name per type */
+  SEC_REV,			/* per type: var index sorted by (kind,off) */
+  SEC_IPORT,			/* per type: var index for each instance port */
+  SEC_INST,			/* act_sidx_inst, in pre-order */
+  SEC_CHILD,			/* children of an instance, sorted by name */
+  SEC_PRS,			/* act_sidx_reg per region, sorted by base */
+  SEC_CHP,
+  SEC_INT,
+  SEC_CHAN,
+  SEC_GLOB,			/* global vars, sorted by (region,off) */
+  SEC_NUM
+};
+
+/* kinds of variables */
+enum {
+  SIDX_BOOL = 0,		/* local prs bool */
+  SIDX_CHPBOOL = 1,		/* local chp bool */
+  SIDX_INT = 2,			/* local int */
+  SIDX_CHAN = 3,		/* local channel */
+  SIDX_PORT = 4,		/* port; off = # in non-omitted ports */
+  SIDX_CHPPORT = 5,		/* chp port; off = # in non-omitted chpports */
+  SIDX_GLOBAL = 6		/* global; off = flat offset */
+};
+
+struct act_sidx_hdr {
+  char magic[8];
+  uint32_t version;
+  uint32_t nsec;
+  uint64_t size;		/* total size in bytes */
+  uint64_t nbools, nints, nchans; /* size of the flat spaces */
+  uint64_t prs, chp;		/* bools: prs and chp region sizes */
+  uint64_t ints, chans;		/* non-global ints and chans */
+  uint64_t off[SEC_NUM];	/* byte offset of each section */
+  uint64_t cnt[SEC_NUM];	/* # of entries in each section */
+};
+
+struct act_sidx_type {
+  uint32_t name;		/* process name */
+  uint32_t var, nvar;		/* variables */
+  uint32_t rev, nrev;		/* local state, for reverse lookups */
+  uint32_t iport, niport;	/* ports of sub-instances */
+  uint32_t ichp, nichp;		/* chp ports of sub-instances */
+  uint32_t pad;
+};
+
+struct act_sidx_var {
+  uint64_t off;			/* see kinds above */
+  uint32_t name;		/* name in the process */
+  uint32_t size;		/* # elements for dynamic arrays, else 0 */
+  uint32_t width;
+  uint8_t kind;
+  uint8_t type;			/* as in getTypeOffset() */
+  uint8_t alias;		/* 1 if not the canonical name */
+  uint8_t pad;
+};
+
+struct act_sidx_inst {
+  uint64_t base[4];		/* flat offset of local state per region */
+  uint32_t parent, type, name;	/* name is relative to the parent */
+  uint32_t iport, ichp;		/* first entry in parent's port tables */
+  uint32_t child, nchild;
+  uint32_t pad;
+};
+
+struct act_sidx_reg {
+  uint64_t base;
+  uint32_t inst;
+  uint32_t count;
+};
+
+
+/*------------------------------------------------------------------------
+ *
+ *  Construction
+ *
+ *------------------------------------------------------------------------
+ */
+
+struct sidx_build {
+  ActStatePass *sp;
+  struct Hashtable *strH;	/* interned strings */
+  struct iHashtable *tH;	/* Process * -> type index */
+  struct iHashtable *gH;	/* global connection -> flat offset */
+  int root_type;		/* type index for a NULL root process */
+
+  uint64_t prs, chp, ints, chans;
+
+  A_DECL (char, str);
+  A_DECL (struct act_sidx_type, types);
+  A_DECL (struct act_sidx_var, vars);
+  A_DECL (unsigned int, rev);
+  A_DECL (unsigned int, iports);
+  A_DECL (struct act_sidx_inst, insts);
+  A_DECL (unsigned int, child);
+  struct {
+    A_DECL (struct act_sidx_reg, g);
+  } reg[4];			/* per region */
+  A_DECL (unsigned int, glob);
+};
+
+/* variable while a type is being built */
+struct sidx_tmpvar {
+  struct act_sidx_var v;
+  char *name;
+  act_connection *c;
+};
+
+static unsigned int _intern (struct sidx_build *B, const char *s)
+{
+  hash_bucket_t *b;
+
+  b = hash_lookup (B->strH, s);
+  if (b) {
+    return b->i;
+  }
+  b = hash_add (B->strH, s);
+  b->i = A_LEN (B->str);
+  A_NEWP (B->str, char, strlen (s) + 1);
+  strcpy (B->str + A_LEN (B->str), s);
+  A_LEN (B->str) += strlen (s) + 1;
+  return b->i;
+}
+
+static char *_idname (ActId *id)
+{
+  char buf[10240];
+  id->sPrint (buf, 10240);
+  return Strdup (buf);
+}
+
+static void _vtype (act_booleanized_var_t *v, int *type, int *width)
+{
+  if (!v) {
+    *type = 0;
+    *width = 1;
+  }
+  else if (v->ischan) {
+    *type = v->input ? 2 : 3;
+    *width = v->width;
+  }
+  else if (v->isint) {
+    *type = 1;
+    *width = v->width;
+  }
+  else {
+    *type = 0;
+    *width = 1;
+  }
+}
+
+static int _cmp_tmpvar (const void *a, const void *b)
+{
+  return strcmp (((struct sidx_tmpvar *)a)->name,
+		 ((struct sidx_tmpvar *)b)->name);
+}
+
+static struct act_sidx_var *_sort_vars;
+
+static int _region_of (struct act_sidx_var *v)
+{
+  if (v->kind == SIDX_GLOBAL) {
+    if (v->type == 0) return 0;
+    if (v->type == 1) return 2;
+    return 3;
+  }
+  return v->kind;
+}
+
+static int _cmp_rev (const void *a, const void *b)
+{
+  struct act_sidx_var *x = &_sort_vars[*(unsigned int *)a];
+  struct act_sidx_var *y = &_sort_vars[*(unsigned int *)b];
+  int rx = _region_of (x);
+  int ry = _region_of (y);
+  if (rx != ry) {
+    return rx < ry ? -1 : 1;
+  }
+  if (x->off != y->off) {
+    return x->off < y->off ? -1 : 1;
+  }
+  return 0;
+}
+
+static char *_sort_str;
+static struct act_sidx_inst *_sort_insts;
+
+static int _cmp_child (const void *a, const void *b)
+{
+  return strcmp (_sort_str + _sort_insts[*(unsigned int *)a].name,
+		 _sort_str + _sort_insts[*(unsigned int *)b].name);
+}
+
+static void _addvar (list_t *l, act_connection *c, const char *name,
+		     int kind, int type, int width, int size, uint64_t off)
+{
+  struct sidx_tmpvar *tv;
+
+  NEW (tv, struct sidx_tmpvar);
+  tv->v.off = off;
+  tv->v.name = 0;
+  tv->v.size = size;
+  tv->v.width = width;
+  tv->v.kind = kind;
+  tv->v.type = type;
+  tv->v.alias = 0;
+  tv->v.pad = 0;
+  tv->c = c;
+  if (name) {
+    tv->name = Strdup (name);
+  }
+  else {
+    ActId *id = c->toid();
+    tv->name = _idname (id);
+    delete id;
+  }
+  list_append (l, tv);
+}
+
+/*
+ * Variables of a process: the ports, in port-list order, and then
+ * all the state that getTypeOffset() knows about. Black boxes only
+ * get their ports, so that names can be resolved through them.
+ */
+static int _mktype (struct sidx_build *B, Process *p)
+{
+  ihash_bucket_t *tb;
+  stateinfo_t *si;
+  act_boolean_netlist_t *bnl;
+  struct iHashtable *cH;
+  list_t *l;
+  listitem_t *li;
+  int k, n;
+
+  if (p) {
+    tb = ihash_lookup (B->tH, (long)p);
+    if (tb) {
+      return tb->i;
+    }
+  }
+  else if (B->root_type != -1) {
+    return B->root_type;
+  }
+
+  si = B->sp->getStateInfo (p);
+  bnl = B->sp->getBNL (p);
+  Assert (bnl, "No booleanized netlist?");
+
+  l = list_new ();
+  cH = ihash_new (8);
+
+  /*-- ports --*/
+  n = 0;
+  for (k=0; k < A_LEN (bnl->ports); k++) {
+    int type, width;
+    if (bnl->ports[k].omit) continue;
+    _vtype (ActBooleanizePass::getVar (bnl, bnl->ports[k].c), &type, &width);
+    if (!ihash_lookup (cH, (long)bnl->ports[k].c)) {
+      ihash_add (cH, (long)bnl->ports[k].c);
+      _addvar (l, bnl->ports[k].c, NULL, SIDX_PORT, type, width, 0, n);
+    }
+    n++;
+  }
+  n = 0;
+  for (k=0; k < A_LEN (bnl->chpports); k++) {
+    int type, width;
+    if (bnl->chpports[k].omit) continue;
+    if (!ihash_lookup (cH, (long)bnl->chpports[k].c)) {
+      _vtype (ActBooleanizePass::getVar (bnl, bnl->chpports[k].c),
+	      &type, &width);
+      ihash_add (cH, (long)bnl->chpports[k].c);
+      _addvar (l, bnl->chpports[k].c, NULL, SIDX_CHPPORT, type, width, 0, n);
+    }
+    n++;
+  }
+
+  /*-- local state and globals --*/
+  if (si) {
+    for (int pass=0; pass < 2; pass++) {
+      int nv = (pass == 0 ? A_LEN (bnl->dvars) : A_LEN (bnl->vars));
+      for (int vi=0; vi < nv; vi++) {
+	act_connection *c;
+	int off, type, width, size;
+
+	if (pass == 0) {
+	  c = bnl->dvars[vi].id;
+	  size = bnl->dvars[vi].a->size();
+	}
+	else {
+	  act_booleanized_var_t *v = &bnl->vars[vi];
+	  if (!v->used && !v->usedchp) continue;
+	  c = v->id;
+	  size = 0;
+	}
+	if (ihash_lookup (cH, (long)c)) continue;
+	if (!B->sp->getTypeOffset (si, c, &off, &type, &width)) continue;
+
+	ihash_add (cH, (long)c);
+	if (B->sp->isGlobalOffset (off)) {
+	  ihash_bucket_t *gb = ihash_lookup (B->gH, (long)c);
+	  if (!gb) continue;
+	  _addvar (l, c, NULL, SIDX_GLOBAL, type, width, size,
+		   (uint64_t)gb->l);
+	}
+	else if (B->sp->isPortOffset (off)) {
+	  /* ports were added above */
+	  continue;
+	}
+	else if (type == 0) {
+	  if (off < si->all.numBools()) {
+	    _addvar (l, c, NULL, SIDX_BOOL, type, width, size, off);
+	  }
+	  else {
+	    _addvar (l, c, NULL, SIDX_CHPBOOL, type, width, size,
+		     off - si->all.numBools());
+	  }
+	}
+	else if (type == 1) {
+	  _addvar (l, c, NULL, SIDX_INT, type, width, size, off);
+	}
+	else {
+	  _addvar (l, c, NULL, SIDX_CHAN, type, width, size, off);
+	}
+      }
+    }
+  }
+
+  /*-- names directly connected to the canonical one --*/
+  Scope *sc = p ? p->CurScope() : ActNamespace::Global()->CurScope();
+  n = list_length (l);
+  li = list_first (l);
+  for (k=0; k < n; k++, li = list_next (li)) {
+    struct sidx_tmpvar *tv = (struct sidx_tmpvar *) list_value (li);
+    act_connection *tmp;
+
+    if (tv->v.size > 0 || !tv->c->next) continue;
+    for (tmp = tv->c->next; tmp != tv->c; tmp = tmp->next) {
+      ActId *id = tmp->toid();
+      ValueIdx *vx = sc->LookupVal (id->getName());
+      /* names through sub-instances are resolved by walking down */
+      if (!vx || !TypeFactory::isProcessType (vx->t)) {
+	char *s = _idname (id);
+	if (strcmp (s, tv->name) != 0) {
+	  _addvar (l, tmp, s, tv->v.kind, tv->v.type, tv->v.width, 0,
+		   tv->v.off);
+	  ((struct sidx_tmpvar *)list_value (list_tail (l)))->v.alias = 1;
+	}
+	FREE (s);
+      }
+      delete id;
+    }
+  }
+
+  /*-- sort by name, and record the type --*/
+  struct sidx_tmpvar *tvs;
+  struct act_sidx_type t;
+  int idx;
+
+  n = list_length (l);
+  MALLOC (tvs, struct sidx_tmpvar, (n > 0 ? n : 1));
+  k = 0;
+  for (li = list_first (l); li; li = list_next (li)) {
+    struct sidx_tmpvar *tv = (struct sidx_tmpvar *) list_value (li);
+    tvs[k++] = *tv;
+    FREE (tv);
+  }
+  list_free (l);
+  qsort (tvs, n, sizeof (struct sidx_tmpvar), _cmp_tmpvar);
+
+  t.name = _intern (B, p ? p->getName() : "-toplevel-");
+  t.var = A_LEN (B->vars);
+  t.nvar = 0;
+  ihash_clear (cH);
+  for (k=0; k < n; k++) {
+    if (k > 0 && strcmp (tvs[k].name, tvs[k-1].name) == 0) {
+      /* duplicate alias */
+      FREE (tvs[k].name);
+      continue;
+    }
+    tvs[k].v.name = _intern (B, tvs[k].name);
+    if (!tvs[k].v.alias) {
+      ihash_bucket_t *xb = ihash_add (cH, (long)tvs[k].c);
+      xb->i = A_LEN (B->vars);
+    }
+    A_APPEND (B->vars, struct act_sidx_var, tvs[k].v);
+    t.nvar++;
+    FREE (tvs[k].name);
+  }
+  FREE (tvs);
+
+  t.rev = A_LEN (B->rev);
+  for (k=0; k < (int)t.nvar; k++) {
+    struct act_sidx_var *v = &B->vars[t.var + k];
+    if (!v->alias && v->kind <= SIDX_CHAN) {
+      A_APPEND (B->rev, unsigned int, t.var + k);
+    }
+  }
+  t.nrev = A_LEN (B->rev) - t.rev;
+  _sort_vars = B->vars;
+  qsort (B->rev + t.rev, t.nrev, sizeof (unsigned int), _cmp_rev);
+
+  /*-- connections to the ports of sub-instances --*/
+  t.iport = A_LEN (B->iports);
+  t.niport = 0;
+  t.ichp = 0;
+  t.nichp = 0;
+  if (si) {
+    for (k=0; k < A_LEN (bnl->instports); k++) {
+      ihash_bucket_t *xb = ihash_lookup (cH, (long)bnl->instports[k]);
+      A_APPEND (B->iports, unsigned int, xb ? xb->i : SIDX_NONE);
+    }
+    t.niport = A_LEN (bnl->instports);
+    t.ichp = A_LEN (B->iports);
+    for (k=0; k < A_LEN (bnl->instchpports); k++) {
+      ihash_bucket_t *xb = ihash_lookup (cH, (long)bnl->instchpports[k]);
+      A_APPEND (B->iports, unsigned int, xb ? xb->i : SIDX_NONE);
+    }
+    t.nichp = A_LEN (bnl->instchpports);
+  }
+  t.pad = 0;
+  ihash_free (cH);
+
+  idx = A_LEN (B->types);
+  A_APPEND (B->types, struct act_sidx_type, t);
+  if (p) {
+    tb = ihash_add (B->tH, (long)p);
+    tb->i = idx;
+  }
+  else {
+    B->root_type = idx;
+  }
+  return idx;
+}
+
+/* # of non-omitted ports; chp = 1 for the chp port list */
+static int _numports (act_boolean_netlist_t *n, int chp)
+{
+  int cnt = 0;
+  if (chp) {
+    for (int i=0; i < A_LEN (n->chpports); i++) {
+      if (!n->chpports[i].omit) cnt++;
+    }
+  }
+  else {
+    for (int i=0; i < A_LEN (n->ports); i++) {
+      if (!n->ports[i].omit) cnt++;
+    }
+  }
+  return cnt;
+}
+
+/*
+ * Add an instance and everything below it. Sub-instances are
+ * visited in the same order as ActStatePass::countLocalState(), so
+ * the bases match its instance offsets.
+ */
+static unsigned int _mkinst (struct sidx_build *B, Process *p,
+			     unsigned int parent, const char *name,
+			     uint64_t *base, unsigned int iport,
+			     unsigned int ichp)
+{
+  struct act_sidx_inst x;
+  stateinfo_t *si;
+  unsigned int idx;
+
+  si = B->sp->getStateInfo (p);
+
+  for (int r=0; r < 4; r++) {
+    x.base[r] = base[r];
+  }
+  x.parent = parent;
+  x.type = _mktype (B, p);
+  x.name = _intern (B, name);
+  x.iport = iport;
+  x.ichp = ichp;
+  x.child = 0;
+  x.nchild = 0;
+  x.pad = 0;
+
+  idx = A_LEN (B->insts);
+  A_APPEND (B->insts, struct act_sidx_inst, x);
+
+  if (!si) {
+    /* black box */
+    return idx;
+  }
+
+  uint64_t cnt[4];
+  cnt[0] = si->local.numBools();
+  cnt[1] = si->local.numCHPBools();
+  cnt[2] = si->local.numInts();
+  cnt[3] = si->local.numChans();
+  for (int r=0; r < 4; r++) {
+    if (cnt[r] > 0) {
+      struct act_sidx_reg rg;
+      rg.base = base[r];
+      rg.inst = idx;
+      rg.count = cnt[r];
+      A_APPEND (B->reg[r].g, struct act_sidx_reg, rg);
+    }
+  }
+
+  A_DECL (unsigned int, kids);
+  A_INIT (kids);
+
+  ActInstiter i(p ? p->CurScope() : ActNamespace::Global()->CurScope());
+  unsigned int ip = 0, ic = 0;
+
+  for (i = i.begin(); i != i.end(); i++) {
+    ValueIdx *vx = *i;
+    if (!TypeFactory::isProcessType (vx->t)) continue;
+
+    Process *sub = dynamic_cast<Process *>(vx->t->BaseType());
+    if (!sub->isExpanded()) continue;
+
+    stateinfo_t *subsi = B->sp->getStateInfo (sub);
+    act_boolean_netlist_t *subnl = B->sp->getBNL (sub);
+    int np = _numports (subnl, 0);
+    int nc = _numports (subnl, 1);
+    Arraystep *as;
+
+    if (vx->t->arrayInfo()) {
+      as = vx->t->arrayInfo()->stepper();
+    }
+    else {
+      as = NULL;
+    }
+    if (!as || !as->isend()) {
+      do {
+	uint64_t cbase[4];
+	unsigned int c;
+	char *nm;
+
+	if (as) {
+	  ActId *id = new ActId (vx->getName());
+	  Array *t = as->toArray();
+	  id->setArray (t);
+	  nm = _idname (id);
+	  id->setArray (NULL);
+	  delete t;
+	  delete id;
+	}
+	else {
+	  nm = Strdup (vx->getName());
+	}
+	cbase[0] = base[0] + cnt[0];
+	cbase[1] = base[1] + cnt[1];
+	cbase[2] = base[2] + cnt[2];
+	cbase[3] = base[3] + cnt[3];
+
+	c = _mkinst (B, sub, idx, nm, cbase, ip, ic);
+	FREE (nm);
+	A_APPEND (kids, unsigned int, c);
+
+	ip += np;
+	ic += nc;
+	if (subsi) {
+	  cnt[0] += subsi->all.numBools();
+	  cnt[1] += subsi->all.numCHPBools();
+	  cnt[2] += subsi->all.numInts();
+	  cnt[3] += subsi->all.numChans();
+	}
+	if (as) {
+	  as->step();
+	}
+      } while (as && !as->isend());
+    }
+    if (as) {
+      delete as;
+    }
+  }
+
+  B->insts[idx].child = A_LEN (B->child);
+  B->insts[idx].nchild = A_LEN (kids);
+  for (int k=0; k < A_LEN (kids); k++) {
+    A_APPEND (B->child, unsigned int, kids[k]);
+  }
+  _sort_str = B->str;
+  _sort_insts = B->insts;
+  qsort (B->child + B->insts[idx].child, A_LEN (kids),
+	 sizeof (unsigned int), _cmp_child);
+  A_FREE (kids);
+
+  return idx;
+}
+
+#define SIDX_ALIGN(x) (((x) + 7) & ~(uint64_t)7)
+
+ActStateIndex::ActStateIndex (ActStatePass *sp, Process *root)
+{
+  struct sidx_build B;
+  stateinfo_t *rsi;
+  act_boolean_netlist_t *nl;
+  state_counts g;
+
+  _buf = NULL;
+  _sz = 0;
+  _mapped = 0;
+
+  B.sp = sp;
+  B.strH = hash_new (64);
+  B.tH = ihash_new (16);
+  B.gH = ihash_new (4);
+  B.root_type = -1;
+  A_INIT (B.str);
+  A_INIT (B.types);
+  A_INIT (B.vars);
+  A_INIT (B.rev);
+  A_INIT (B.iports);
+  A_INIT (B.insts);
+  A_INIT (B.child);
+  for (int r=0; r < 4; r++) {
+    A_INIT (B.reg[r].g);
+  }
+  A_INIT (B.glob);
+
+  rsi = sp->getStateInfo (root);
+  if (rsi) {
+    B.prs = rsi->all.numBools();
+    B.chp = rsi->all.numCHPBools();
+    B.ints = rsi->all.numInts();
+    B.chans = rsi->all.numChans();
+  }
+  else {
+    B.prs = 0;
+    B.chp = 0;
+    B.ints = 0;
+    B.chans = 0;
+  }
+
+  /*-- globals go after everything else, in used_globals order --*/
+  nl = sp->getBNL (root);
+  for (int i=0; rsi && i < A_LEN (nl->used_globals); i++) {
+    act_connection *c = nl->used_globals[i];
+    act_dynamic_var_t *dv;
+    ihash_bucket_t *gb;
+    int sz = 1;
+
+    gb = ihash_add (B.gH, (long)c);
+    dv = ActBooleanizePass::getDynVar (nl, c);
+    if (dv) {
+      sz = dv->a->size();
+      if (dv->isint) {
+	gb->l = B.ints + g.numInts();
+	g.addInt (sz);
+      }
+      else {
+	gb->l = B.prs + B.chp + g.numBools();
+	g.addBool (sz);
+      }
+    }
+    else {
+      act_booleanized_var_t *v = ActBooleanizePass::getVar (nl, c);
+      Assert (v, "What?");
+      if (v->ischan) {
+	gb->l = B.chans + g.numChans();
+	g.addChan ();
+      }
+      else if (v->isint) {
+	gb->l = B.ints + g.numInts();
+	g.addInt ();
+      }
+      else {
+	gb->l = B.prs + B.chp + g.numBools();
+	g.addBool ();
+      }
+    }
+  }
+
+  /*-- the instance tree --*/
+  uint64_t base[4];
+  base[0] = 0;
+  base[1] = B.prs;
+  base[2] = 0;
+  base[3] = 0;
+  _mkinst (&B, root, SIDX_NONE, "", base, 0, 0);
+
+  /*-- globals, for reverse lookups --*/
+  if (rsi) {
+    struct act_sidx_type *t = &B.types[B.insts[0].type];
+    for (unsigned int k=0; k < t->nvar; k++) {
+      if (B.vars[t->var + k].kind == SIDX_GLOBAL &&
+	  !B.vars[t->var + k].alias) {
+	A_APPEND (B.glob, unsigned int, t->var + k);
+      }
+    }
+    _sort_vars = B.vars;
+    qsort (B.glob, A_LEN (B.glob), sizeof (unsigned int), _cmp_rev);
+  }
+
+  /*-- pack --*/
+  uint64_t off[SEC_NUM], cnt[SEC_NUM], esz[SEC_NUM];
+  void *src[SEC_NUM];
+
+  cnt[SEC_STR] = A_LEN (B.str);  esz[SEC_STR] = 1;  src[SEC_STR] = B.str;
+#define SEC(n,a,t) cnt[n] = A_LEN (a); esz[n] = sizeof (t); src[n] = a
+  SEC (SEC_TYPE, B.types, struct act_sidx_type);
+  SEC (SEC_VAR, B.vars, struct act_sidx_var);
+  SEC (SEC_REV, B.rev, unsigned int);
+  SEC (SEC_IPORT, B.iports, unsigned int);
+  SEC (SEC_INST, B.insts, struct act_sidx_inst);
+  SEC (SEC_CHILD, B.child, unsigned int);
+  SEC (SEC_PRS, B.reg[0].g, struct act_sidx_reg);
+  SEC (SEC_CHP, B.reg[1].g, struct act_sidx_reg);
+  SEC (SEC_INT, B.reg[2].g, struct act_sidx_reg);
+  SEC (SEC_CHAN, B.reg[3].g, struct act_sidx_reg);
+  SEC (SEC_GLOB, B.glob, unsigned int);
+#undef SEC
+
+  uint64_t sz = SIDX_ALIGN (sizeof (struct act_sidx_hdr));
+  for (int k=0; k < SEC_NUM; k++) {
+    off[k] = sz;
+    sz = SIDX_ALIGN (sz + cnt[k]*esz[k]);
+  }
+
+  MALLOC (_buf, char, sz);
+  memset (_buf, 0, sz);
+  _sz = sz;
+
+  struct act_sidx_hdr *h = (struct act_sidx_hdr *)_buf;
+  memcpy (h->magic, SIDX_MAGIC, 8);
+  h->version = SIDX_VERSION;
+  h->nsec = SEC_NUM;
+  h->size = sz;
+  h->prs = B.prs;
+  h->chp = B.chp;
+  h->ints = B.ints;
+  h->chans = B.chans;
+  h->nbools = B.prs + B.chp + g.numBools();
+  h->nints = B.ints + g.numInts();
+  h->nchans = B.chans + g.numChans();
+  for (int k=0; k < SEC_NUM; k++) {
+    h->off[k] = off[k];
+    h->cnt[k] = cnt[k];
+    if (cnt[k] > 0) {
+      memcpy (_buf + off[k], src[k], cnt[k]*esz[k]);
+    }
+  }
+
+  A_FREE (B.str);
+  A_FREE (B.types);
+  A_FREE (B.vars);
+  A_FREE (B.rev);
+  A_FREE (B.iports);
+  A_FREE (B.insts);
+  A_FREE (B.child);
+  for (int r=0; r < 4; r++) {
+    A_FREE (B.reg[r].g);
+  }
+  A_FREE (B.glob);
+  hash_free (B.strH);
+  ihash_free (B.tH);
+  ihash_free (B.gH);
+
+  _attach (_buf, _sz);
+}
+
+ActStateIndex::ActStateIndex ()
+{
+  _buf = NULL;
+  _sz = 0;
+  _mapped = 0;
+  _h = NULL;
+}
+
+ActStateIndex::~ActStateIndex ()
+{
+  if (_buf) {
+    if (_mapped) {
+      munmap (_buf, _sz);
+    }
+    else {
+      FREE (_buf);
+    }
+  }
+}
+
+
+/*------------------------------------------------------------------------
+ *
+ *  Files
+ *
+ *------------------------------------------------------------------------
+ */
+
+/* set up section pointers; returns 0 if the buffer is not an index */
+int ActStateIndex::_attach (char *buf, uint64_t sz)
+{
+  static const uint64_t esz[SEC_NUM] = {
+    1, sizeof (struct act_sidx_type), sizeof (struct act_sidx_var),
+    sizeof (unsigned int), sizeof (unsigned int),
+    sizeof (struct act_sidx_inst), sizeof (unsigned int),
+    sizeof (struct act_sidx_reg), sizeof (struct act_sidx_reg),
+    sizeof (struct act_sidx_reg), sizeof (struct act_sidx_reg),
+    sizeof (unsigned int)
+  };
+  struct act_sidx_hdr *h = (struct act_sidx_hdr *)buf;
+
+  if (sz < sizeof (struct act_sidx_hdr) ||
+      memcmp (h->magic, SIDX_MAGIC, 8) != 0 ||
+      h->version != SIDX_VERSION || h->nsec != SEC_NUM || h->size != sz) {
+    return 0;
+  }
+  for (int k=0; k < SEC_NUM; k++) {
+    if (h->off[k] > sz || h->cnt[k] > (sz - h->off[k])/esz[k]) {
+      return 0;
+    }
+  }
+  if (h->cnt[SEC_INST] == 0) {
+    return 0;
+  }
+  _h = h;
+  _str = buf + h->off[SEC_STR];
+  _types = (struct act_sidx_type *)(buf + h->off[SEC_TYPE]);
+  _vars = (struct act_sidx_var *)(buf + h->off[SEC_VAR]);
+  _rev = (unsigned int *)(buf + h->off[SEC_REV]);
+  _iports = (unsigned int *)(buf + h->off[SEC_IPORT]);
+  _insts = (struct act_sidx_inst *)(buf + h->off[SEC_INST]);
+  _child = (unsigned int *)(buf + h->off[SEC_CHILD]);
+  for (int r=0; r < 4; r++) {
+    _reg[r] = (struct act_sidx_reg *)(buf + h->off[SEC_PRS + r]);
+  }
+  _glob = (unsigned int *)(buf + h->off[SEC_GLOB]);
+  return 1;
+}
+
+int ActStateIndex::Write (const char *file)
+{
+  FILE *fp;
+
+  fp = fopen (file, "w");
+  if (!fp) {
+    warning ("Could not open state index `%s' for writing", file);
+    return 0;
+  }
+  if (fwrite (_buf, 1, _sz, fp) != _sz) {
+    warning ("Error writing state index `%s'", file);
+    fclose (fp);
+    return 0;
+  }
+  fclose (fp);
+  return 1;
+}
+
+ActStateIndex *ActStateIndex::Read (const char *file)
+{
+  FILE *fp;
+  struct stat st;
+  char *base;
+  ActStateIndex *x;
+
+  fp = fopen (file, "r");
+  if (!fp) {
+    return NULL;
+  }
+  if (fstat (fileno (fp), &st) != 0 || !S_ISREG (st.st_mode) ||
+      st.st_size == 0) {
+    fclose (fp);
+    return NULL;
+  }
+  base = (char *) mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+			fileno (fp), 0);
+  fclose (fp);
+  if (base == MAP_FAILED) {
+    return NULL;
+  }
+  x = new ActStateIndex ();
+  x->_buf = base;
+  x->_sz = st.st_size;
+  x->_mapped = 1;
+  if (!x->_attach (base, st.st_size)) {
+    warning ("`%s' is not a state index", file);
+    delete x;
+    return NULL;
+  }
+  return x;
+}
+
+
+/*------------------------------------------------------------------------
+ *
+ *  Lookups
+ *
+ *------------------------------------------------------------------------
+ */
+
+uint64_t ActStateIndex::numBools () { return _h->nbools; }
+uint64_t ActStateIndex::numInts () { return _h->nints; }
+uint64_t ActStateIndex::numChans () { return _h->nchans; }
+
+int ActStateIndex::numInstances () { return _h->cnt[SEC_INST]; }
+
+uint64_t ActStateIndex::instBase (int inst, int region)
+{
+  Assert (0 <= inst && inst < numInstances(), "Invalid instance");
+  Assert (0 <= region && region < 4, "Invalid region");
+  return _insts[inst].base[region];
+}
+
+int ActStateIndex::instParent (int inst)
+{
+  Assert (0 <= inst && inst < numInstances(), "Invalid instance");
+  if (_insts[inst].parent == SIDX_NONE) {
+    return -1;
+  }
+  return _insts[inst].parent;
+}
+
+/* child of inst named s[0..len-1], or -1 */
+int ActStateIndex::_findchild (unsigned int inst, const char *s, int len)
+{
+  struct act_sidx_inst *x = &_insts[inst];
+  int lo = 0, hi = x->nchild - 1;
+
+  while (lo <= hi) {
+    int mid = (lo + hi)/2;
+    unsigned int c = _child[x->child + mid];
+    const char *nm = _str + _insts[c].name;
+    int r = strncmp (nm, s, len);
+    if (r == 0 && nm[len] != '\0') {
+      r = 1;
+    }
+    if (r == 0) {
+      return c;
+    }
+    if (r < 0) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid - 1;
+    }
+  }
+  return -1;
+}
+
+/*
+ * variable s in the process of instance inst; *k is set to the
+ * element for a dynamic array reference. Returns the var index or -1
+ */
+int ActStateIndex::_findvar (unsigned int inst, const char *s, uint64_t *k)
+{
+  struct act_sidx_type *t = &_types[_insts[inst].type];
+  int len = strlen (s);
+
+  *k = 0;
+  for (int pass=0; pass < 2; pass++) {
+    int lo = 0, hi = t->nvar - 1;
+    while (lo <= hi) {
+      int mid = (lo + hi)/2;
+      struct act_sidx_var *v = &_vars[t->var + mid];
+      const char *nm = _str + v->name;
+      int r = strncmp (nm, s, len);
+      if (r == 0 && nm[len] != '\0') {
+	r = 1;
+      }
+      if (r == 0) {
+	if (pass == 0 ? v->size == 0 : v->size > *k) {
+	  return t->var + mid;
+	}
+	return -1;
+      }
+      if (r < 0) {
+	lo = mid + 1;
+      }
+      else {
+	hi = mid - 1;
+      }
+    }
+    /* try name[k] as an element of a dynamic array */
+    if (len < 3 || s[len-1] != ']') {
+      return -1;
+    }
+    int j = len - 2;
+    while (j > 0 && s[j] >= '0' && s[j] <= '9') {
+      j--;
+    }
+    if (s[j] != '[' || j == len - 2 || j == 0) {
+      return -1;
+    }
+    *k = strtoull (s + j + 1, NULL, 10);
+    len = j;
+  }
+  return -1;
+}
+
+/* follow ports up the hierarchy to the flat offset */
+int ActStateIndex::_resolve (unsigned int inst, struct act_sidx_var *v,
+			     uint64_t k, uint64_t *off)
+{
+  while (1) {
+    struct act_sidx_inst *x = &_insts[inst];
+    struct act_sidx_type *pt;
+    uint64_t idx;
+    unsigned int vi;
+
+    switch (v->kind) {
+    case SIDX_BOOL:
+    case SIDX_CHPBOOL:
+    case SIDX_INT:
+    case SIDX_CHAN:
+      *off = x->base[v->kind] + v->off + k;
+      return 1;
+
+    case SIDX_GLOBAL:
+      *off = v->off + k;
+      return 1;
+
+    case SIDX_PORT:
+    case SIDX_CHPPORT:
+      if (x->parent == SIDX_NONE) {
+	return 0;
+      }
+      pt = &_types[_insts[x->parent].type];
+      if (v->kind == SIDX_PORT) {
+	idx = x->iport + v->off;
+	if (idx >= pt->niport) return 0;
+	vi = _iports[pt->iport + idx];
+      }
+      else {
+	idx = x->ichp + v->off;
+	if (idx >= pt->nichp) return 0;
+	vi = _iports[pt->ichp + idx];
+      }
+      if (vi == SIDX_NONE) {
+	return 0;
+      }
+      v = &_vars[vi];
+      inst = x->parent;
+      break;
+
+    default:
+      return 0;
+    }
+  }
+}
+
+int ActStateIndex::findInstance (const char *name)
+{
+  unsigned int inst = 0;
+  const char *s = name;
+
+  while (*s) {
+    int depth = 0;
+    int len = 0;
+    int c;
+    while (s[len] && (depth > 0 || s[len] != '.')) {
+      if (s[len] == '[') depth++;
+      if (s[len] == ']') depth--;
+      len++;
+    }
+    c = _findchild (inst, s, len);
+    if (c == -1) {
+      return -1;
+    }
+    inst = c;
+    s += len;
+    if (*s == '.') {
+      s++;
+    }
+  }
+  return inst;
+}
+
+int ActStateIndex::getOffset (const char *name, uint64_t *off, int *type,
+			      int *width)
+{
+  unsigned int inst = 0;
+  const char *s = name;
+  uint64_t k;
+  int vi;
+
+  /* walk down the instance hierarchy */
+  while (1) {
+    int depth = 0;
+    int len = 0;
+    int c;
+    while (s[len] && (depth > 0 || s[len] != '.')) {
+      if (s[len] == '[') depth++;
+      if (s[len] == ']') depth--;
+      len++;
+    }
+    if (s[len] != '.') break;
+    c = _findchild (inst, s, len);
+    if (c == -1) break;
+    inst = c;
+    s += len + 1;
+  }
+
+  vi = _findvar (inst, s, &k);
+  if (vi == -1) {
+    return 0;
+  }
+  if (!_resolve (inst, &_vars[vi], k, off)) {
+    return 0;
+  }
+  if (type) {
+    *type = _vars[vi].type;
+  }
+  if (width) {
+    *width = _vars[vi].width;
+  }
+  return 1;
+}
+
+/* hierarchical name for var in inst; k >= 0 is a dynamic array index */
+char *ActStateIndex::_path (unsigned int inst, const char *var, long k)
+{
+  int len = strlen (var) + 24;
+  int depth = 0;
+  unsigned int x;
+  unsigned int *chain;
+  char *buf;
+
+  for (x = inst; _insts[x].parent != SIDX_NONE; x = _insts[x].parent) {
+    len += strlen (_str + _insts[x].name) + 1;
+    depth++;
+  }
+  MALLOC (chain, unsigned int, depth + 1);
+  depth = 0;
+  for (x = inst; _insts[x].parent != SIDX_NONE; x = _insts[x].parent) {
+    chain[depth++] = x;
+  }
+  MALLOC (buf, char, len);
+  buf[0] = '\0';
+  while (depth > 0) {
+    depth--;
+    strcat (buf, _str + _insts[chain[depth]].name);
+    if (depth > 0 || *var) {
+      strcat (buf, ".");
+    }
+  }
+  FREE (chain);
+  strcat (buf, var);
+  if (k >= 0) {
+    sprintf (buf + strlen (buf), "[%ld]", k);
+  }
+  return buf;
+}
+
+char *ActStateIndex::instName (int inst)
+{
+  Assert (0 <= inst && inst < numInstances(), "Invalid instance");
+  return _path (inst, "", -1);
+}
+
+char *ActStateIndex::getName (int type, uint64_t off)
+{
+  int r;
+  uint64_t nlocal;
+
+  if (type == 0) {
+    if (off < _h->prs) {
+      r = ActStateIndex::PRS;
+    }
+    else {
+      r = ActStateIndex::CHP;
+    }
+    nlocal = _h->prs + _h->chp;
+    if (off >= _h->nbools) return NULL;
+  }
+  else if (type == 1) {
+    r = ActStateIndex::INT;
+    nlocal = _h->ints;
+    if (off >= _h->nints) return NULL;
+  }
+  else {
+    r = ActStateIndex::CHAN;
+    nlocal = _h->chans;
+    if (off >= _h->nchans) return NULL;
+  }
+
+  if (off >= nlocal) {
+    /* global */
+    int lo = 0, hi = _h->cnt[SEC_GLOB] - 1;
+    if (r == ActStateIndex::CHP) {
+      r = ActStateIndex::PRS;
+    }
+    while (lo <= hi) {
+      int mid = (lo + hi)/2;
+      struct act_sidx_var *v = &_vars[_glob[mid]];
+      int vr = (v->type == 0 ? 0 : (v->type == 1 ? 2 : 3));
+      uint64_t sz = v->size > 0 ? v->size : 1;
+      if (vr < r || (vr == r && v->off + sz <= off)) {
+	lo = mid + 1;
+      }
+      else if (vr > r || v->off > off) {
+	hi = mid - 1;
+      }
+      else {
+	return _path (0, _str + v->name, v->size > 0 ? off - v->off : -1);
+      }
+    }
+    return NULL;
+  }
+
+  /* owning instance */
+  struct act_sidx_reg *g = _reg[r];
+  int lo = 0, hi = _h->cnt[SEC_PRS + r] - 1;
+  int found = -1;
+  while (lo <= hi) {
+    int mid = (lo + hi)/2;
+    if (g[mid].base <= off) {
+      found = mid;
+      lo = mid + 1;
+    }
+    else {
+      hi = mid - 1;
+    }
+  }
+  if (found == -1 || off >= g[found].base + g[found].count) {
+    return NULL;
+  }
+
+  unsigned int inst = g[found].inst;
+  struct act_sidx_type *t = &_types[_insts[inst].type];
+  uint64_t loc = off - g[found].base;
+
+  lo = 0;
+  hi = t->nrev - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi)/2;
+    struct act_sidx_var *v = &_vars[_rev[t->rev + mid]];
+    uint64_t sz = v->size > 0 ? v->size : 1;
+    if (v->kind < r || (v->kind == r && v->off + sz <= loc)) {
+      lo = mid + 1;
+    }
+    else if (v->kind > r || v->off > loc) {
+      hi = mid - 1;
+    }
+    else {
+      return _path (inst, _str + v->name, v->size > 0 ? loc - v->off : -1);
+    }
+  }
+  return NULL;
+}
@@ -28,18 +28,61 @@
 #include <config.h>
 #include <act/passes/statepass.h>
 
-static act_connection *_inv_hash (struct pHashtable *H, int idx)
+/*
+ * Inverse of the local state map: the connection for each local bool
+ * (bc[0..nb-1]) and each local chp variable (cc[0..nc-1]). The two
+ * index spaces overlap in the map, so the variable type is used to
+ * tell them apart.
+ */
+static void _inv_map (act_boolean_netlist_t *b, struct pHashtable *H,
+		      int nb, act_connection **bc,
+		      int nc, act_connection **cc)
 {
-  phash_iter_t iter;
-  phash_bucket_t *ib;
-  
-  phash_iter_init (H, &iter);
-  while ((ib = phash_iter_next (H, &iter))) {
-    if (ib->i == idx) {
-      return (act_connection *)ib->key;
+  phash_bucket_t *x;
+
+  for (int i=0; i < nb; i++) {
+    bc[i] = NULL;
+  }
+  for (int i=0; i < nc; i++) {
+    cc[i] = NULL;
+  }
+  for (int vi=0; vi < A_LEN (b->dvars); vi++) {
+    act_dynamic_var_t *dv = &b->dvars[vi];
+    int n = dv->isint ? nc : nb;
+    act_connection **m = dv->isint ? cc : bc;
+
+    x = phash_lookup (H, dv->id);
+    if (!x) continue;
+    for (int i=0; i < dv->a->size(); i++) {
+      if (0 <= x->i + i && x->i + i < n) {
+	m[x->i + i] = dv->id;
+      }
+    }
+  }
+  for (int vi=0; vi < A_LEN (b->vars); vi++) {
+    act_booleanized_var_t *v = &b->vars[vi];
+    act_dynamic_var_t *dv;
+    int n;
+    act_connection **m;
+
+    x = phash_lookup (H, v->id);
+    if (!x) continue;
+    if ((dv = ActBooleanizePass::isDynamicRef (b, v->id))) {
+      n = dv->isint ? nc : nb;
+      m = dv->isint ? cc : bc;
+    }
+    else if (v->used) {
+      n = nb;
+      m = bc;
+    }
+    else {
+      n = nc;
+      m = cc;
+    }
+    if (0 <= x->i && x->i < n) {
+      m[x->i] = v->id;
     }
   }
-  return NULL;
 }
 
 void *ActStatePass::local_op (Process *p, int mode)
@@ -77,15 +120,15 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
     return NULL;
   }
 
-  Assert (b->cH, "Hmm");
-  Assert (b->cdH, "Hmm...");
+  Assert (b->cidx, "Hmm");
+  Assert (b->cdidx, "Hmm...");
 
   /* 
      The booleanized vars come in two flavors:
       - the raw booleans
       - the chp booleans
 
-     1. b->cH->n == local variables used + global bools used in this process
+     1. A_LEN (b->vars) == local variables used + global bools used in this process
      2. port list: variables that are out of consideration
 
      Once we have the set of variables, then we need state only for
@@ -100,15 +143,10 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
   /* count non-global variables that are used */
   state_counts alt_port;
   
-  phash_bucket_t *hb;
-  phash_iter_t iter;
-
   /*-- dynamic bools are assumed to be used in both chp and non-chp --*/
   /* dynamic bools cannot be in ports, so these must be local */
-  phash_iter_init (b->cdH, &iter);
-  while ((hb = phash_iter_next (b->cdH, &iter))) {
-    act_dynamic_var_t *v;
-    v = (act_dynamic_var_t *)hb->v;
+  for (int vi=0; vi < A_LEN (b->dvars); vi++) {
+    act_dynamic_var_t *v = &b->dvars[vi];
     if (v->isint) {
       chp_count += v->a->size();
     }
@@ -117,9 +155,8 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
     }
   }
   
-  phash_iter_init (b->cH, &iter);
-  while ((hb = phash_iter_next (b->cH, &iter))) {
-    act_booleanized_var_t *v = (act_booleanized_var_t *)hb->v;
+  for (int vi=0; vi < A_LEN (b->vars); vi++) {
+    act_booleanized_var_t *v = &b->vars[vi];
 
     if (ActBooleanizePass::isDynamicRef (b, v->id)) {
       /*-- already counted --*/
@@ -226,20 +263,17 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
   /*
     Start with dynamic arrays. These are always local.
   */
-  phash_bucket_t *pb;
-
-  phash_iter_init (b->cdH, &iter);
-  while ((pb = ihash_iter_next (b->cdH, &iter))) {
+  for (int vi=0; vi < A_LEN (b->dvars); vi++) {
     /*---
       XXX: what if a process has a dynamic array in CHP and then a
       static array in the prs?
       UNHANDLED SITUATION.
       ---*/
 
-    act_dynamic_var_t *v = (act_dynamic_var_t *) pb->v;
+    act_dynamic_var_t *v = &b->dvars[vi];
     phash_bucket_t *x;
     if (v->isint) {
-      x = phash_add (si->map, pb->key);
+      x = phash_add (si->map, v->id);
       x->i = chpidx;
       Assert (v->a, "Huh?");
       chpidx += v->a->size();
@@ -256,7 +290,7 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
       }
     }
     else {
-      x = phash_add (si->map, pb->key);
+      x = phash_add (si->map, v->id);
       x->i = idx;
       idx += v->a->size();
       for (int i=0; i < v->a->size(); i++) {
@@ -266,16 +300,15 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
 	else {
 	  bitset_set (tmpbits, idx - 1 - i);
 	}
-	/* XXX: check if this index is actually in the cH hash; if so, we
+	/* XXX: check if this index is actually in the cidx hash; if so, we
 	   have a problem */
       }
     }
   }
 
-  phash_iter_init (b->cH, &iter);
-  while ((pb = phash_iter_next (b->cH, &iter))) {
+  for (int vi=0; vi < A_LEN (b->vars); vi++) {
     int found = 0;
-    act_booleanized_var_t *v = (act_booleanized_var_t *) pb->v;
+    act_booleanized_var_t *v = &b->vars[vi];
     act_dynamic_var_t *dv;
     int ocount = 0;
 
@@ -291,13 +324,13 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
       }
 
       if (dv->isint) {
-	phash_bucket_t *x = phash_add (si->map, pb->key);
+	phash_bucket_t *x = phash_add (si->map, v->id);
 	phash_bucket_t *y = phash_lookup (si->map, dv->id);
 	Assert (y, "what?!");
 	x->i = y->i + ocount; /* offset */
       }
       else {
-	phash_bucket_t *x = phash_add (si->map, pb->key);
+	phash_bucket_t *x = phash_add (si->map, v->id);
 	phash_bucket_t *y = phash_lookup (si->map, dv->id);
 	Assert (y, "what?!");
 	x->i = y->i + ocount; /* offset */
@@ -311,21 +344,21 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
 	/*-- in the port list; so port state, not local state --*/
 	for (int k=0; k < A_LEN (b->ports); k++) {
 	  if (b->ports[k].omit) continue;
-	  if (pb->key == (unsigned long)b->ports[k].c) {
+	  if (v->id == b->ports[k].c) {
 	    found = 1;
 	    break;
 	  }
 	  ocount++;
 	}
 	Assert (found, "What?");
-	phash_bucket_t *x = ihash_add (si->map, pb->key);
+	phash_bucket_t *x = phash_add (si->map, v->id);
 
 	/* port index is a negative value */
 	x->i = ocount - si->ports.numBools();
       }
       else if (!v->isglobal) {
 	/*-- globals not handled here --*/
-	phash_bucket_t *x = phash_add (si->map, pb->key);
+	phash_bucket_t *x = phash_add (si->map, v->id);
 	x->i = idx++;
 	ocount = x->i + si->ports.numBools();
       }
@@ -337,7 +370,7 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
       */
 
 #if 0
-      ActId *id = ((act_connection *)pb->key)->toid();
+      ActId *id = v->id->toid();
       printf ("   var: ");
       id->Print (stdout);
       printf (" [out=%d]", v->output ? 1 : 0);
@@ -373,13 +406,13 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
       if (v->ischpport) {
 	for (int k=0; k < A_LEN (b->chpports); k++) {
 	  if (b->chpports[k].omit) continue;
-	  if (pb->key == (long)b->chpports[k].c) {
+	  if (v->id == b->chpports[k].c) {
 	    found = 1;
 	    break;
 	  }
 	  {
-	    phash_bucket_t *xb = phash_lookup (b->cH, b->chpports[k].c);
-	    act_booleanized_var_t *xv = (act_booleanized_var_t *)xb->v;
+	    act_booleanized_var_t *xv =
+	      ActBooleanizePass::getVar (b, b->chpports[k].c);
 	    if (!xv->used) {
 	      /* if it is used in the boolean pass, it's already
 		 counted there */
@@ -390,7 +423,7 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
 	Assert (found, "What?");
       }
       else if (!v->isglobal) {
-	phash_bucket_t *x = phash_add (si->map, pb->key);
+	phash_bucket_t *x = phash_add (si->map, v->id);
 	x->i = chpidx++;
 	ocount = x->i + nportchptot;
 
@@ -406,7 +439,7 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
       }
 
 #if 0
-      ActId *id = ((act_connection *)pb->key)->toid();
+      ActId *id = v->id->toid();
       printf ("   var: ");
       id->Print (stdout);
       printf (" [out=%d]", v->output ? 1 : 0);
@@ -622,9 +655,8 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
 	      /* -- ignore globals -- */
 	      if (c->isglobal()) continue;
 
-	      phash_bucket_t *xb = phash_lookup (b->cH, c);
-	      if (xb) {
-		act_booleanized_var_t *xv = (act_booleanized_var_t *) xb->v;
+	      act_booleanized_var_t *xv = ActBooleanizePass::getVar (b, c);
+	      if (xv) {
 		if (xv->used) {
 		/* handled in earlier pass */
 		  continue;
@@ -680,12 +712,19 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
 
   if (Act::no_local_driver) {
     int err_ctxt = 0;
+    act_connection **boolc = NULL, **chpc = NULL;
+    
     /* now check if there is some local state that is actually never
        driven! */
     for (int i=0; i < si->local.numBools(); i++) {
       if (bitset_tst (inpbits, i + si->ports.numBools()) &&
 	  !bitset_tst (tmpbits, i + si->ports.numBools())) {
-	act_connection *tmpc = _inv_hash (si->map, i);
+	if (!boolc) {
+	  MALLOC (boolc, act_connection *, si->local.numBools() + 1);
+	  MALLOC (chpc, act_connection *, localchp + 1);
+	  _inv_map (b, si->map, si->local.numBools(), boolc, localchp, chpc);
+	}
+	act_connection *tmpc = boolc[i];
 	Assert (tmpc, "How did we get here?");
 	ActId *tmpid = tmpc->toid();
 	if (!err_ctxt) {
@@ -703,7 +742,12 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
     for (int i=0; i < localchp; i++) {
       if (bitset_tst (inpchp, i + nportchptot) &&
 	  !bitset_tst (tmpchp, i + nportchptot)) {
-	act_connection *tmpc = _inv_hash (si->map, i);
+	if (!boolc) {
+	  MALLOC (boolc, act_connection *, si->local.numBools() + 1);
+	  MALLOC (chpc, act_connection *, localchp + 1);
+	  _inv_map (b, si->map, si->local.numBools(), boolc, localchp, chpc);
+	}
+	act_connection *tmpc = chpc[i];
 	Assert (tmpc, "How did we get here?");
 	ActId *tmpid = tmpc->toid();
 	if (!err_ctxt) {
@@ -717,6 +761,10 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
 	delete tmpid;
       }
     }
+    if (boolc) {
+      FREE (boolc);
+      FREE (chpc);
+    }
   }
   
   if (tmpbits) {
@@ -734,12 +782,11 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
 
   state_counts c_idx;
 
-  phash_iter_init (b->cdH, &iter);
-  while ((pb = ihash_iter_next (b->cdH, &iter))) {
-    act_dynamic_var_t *v = (act_dynamic_var_t *) pb->v;
+  for (int vi=0; vi < A_LEN (b->dvars); vi++) {
+    act_dynamic_var_t *v = &b->dvars[vi];
     phash_bucket_t *x;
     if (v->isint) {
-      x = phash_lookup (si->map, pb->key);
+      x = phash_lookup (si->map, v->id);
       Assert (x, "What?");
       x->i = c_idx.numInts();
       c_idx.addInt (v->a->size());
@@ -749,10 +796,9 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
     }
   }
 
-  phash_iter_init (b->cH, &iter);
-  while ((pb = phash_iter_next (b->cH, &iter))) {
+  for (int vi=0; vi < A_LEN (b->vars); vi++) {
     int found = 0;
-    act_booleanized_var_t *v = (act_booleanized_var_t *) pb->v;
+    act_booleanized_var_t *v = &b->vars[vi];
     int ocount = 0;
 
     if (v->used) {
@@ -765,13 +811,13 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
       if (v->ischpport) {
 	for (int k=0; k < A_LEN (b->chpports); k++) {
 	  if (b->chpports[k].omit) continue;
-	  if (pb->key == (unsigned long)b->chpports[k].c) {
+	  if (v->id == b->chpports[k].c) {
 	    found = 1;
 	    break;
 	  }
 	  {
-	    phash_bucket_t *xb = phash_lookup (b->cH, b->chpports[k].c);
-	    act_booleanized_var_t *xv = (act_booleanized_var_t *)xb->v;
+	    act_booleanized_var_t *xv =
+	      ActBooleanizePass::getVar (b, b->chpports[k].c);
 	    if (!xv->used) {
 	      /* if it is used in the boolean pass, it's already
 		 counted there */
@@ -792,7 +838,7 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
 	  }
 	}
 	Assert (found, "What?");
-	phash_bucket_t *x = phash_add (si->map, pb->key);
+	phash_bucket_t *x = phash_add (si->map, v->id);
 	Assert (x, "What?");
 	if (v->ischan) {
 	  x->i = ocount - si->ports.numChans();
@@ -805,7 +851,7 @@ stateinfo_t *ActStatePass::countLocalState (Process *p)
 	}
       }
       else if (!v->isglobal) {
-	phash_bucket_t *x = phash_lookup (si->map, pb->key);
+	phash_bucket_t *x = phash_lookup (si->map, v->id);
 	if (v->ischan) {
 	  x->i = c_idx.numChans();
 	  c_idx.addChan();
@@ -854,6 +900,8 @@ ActStatePass::ActStatePass (Act *a, int inst_offset) : ActPass (a, "collect_stat
 
   _black_box_mode = config_get_int ("net.black_box_mode");
   _inst_offsets = inst_offset;
+  _root_proc = NULL;
+  _index = NULL;
 }
 
 void ActStatePass::free_local (void *v)
@@ -874,8 +922,14 @@ int ActStatePass::run (Process *p)
 {
   int res = ActPass::run (p);
 
+  if (_index) {
+    delete _index;
+    _index = NULL;
+  }
+
   /*-- set root stateinfo for global variables --*/
   _root_si = getStateInfo (p);
+  _root_proc = p;
 
   /*-- compute global sizes and add mapping to top-level state table --*/
 
@@ -886,9 +940,8 @@ int ActStatePass::run (Process *p)
     act_dynamic_var_t *dv;
     phash_bucket_t *b;
 
-    b = phash_lookup (nl->cdH, nl->used_globals[i]);
-    if (b) {
-      dv = (act_dynamic_var_t *) b->v;
+    dv = ActBooleanizePass::getDynVar (nl, nl->used_globals[i]);
+    if (dv) {
       if (dv->isint) {
 	_globals.addInt (dv->a->size());
       }
@@ -897,9 +950,7 @@ int ActStatePass::run (Process *p)
       }
     }
     else {
-      b = phash_lookup (nl->cH, nl->used_globals[i]);
-      Assert (b, "What?");
-      v = (act_booleanized_var_t *) b->v;
+      v = ActBooleanizePass::getVar (nl, nl->used_globals[i]);
       Assert (v, "What?");
       if (v->ischan) { 
 	_globals.addChan();
@@ -921,9 +972,8 @@ int ActStatePass::run (Process *p)
     act_dynamic_var_t *dv;
     phash_bucket_t *b;
 
-    b = phash_lookup (nl->cdH, nl->used_globals[i]);
-    if (b) {
-      dv = (act_dynamic_var_t *) b->v;
+    dv = ActBooleanizePass::getDynVar (nl, nl->used_globals[i]);
+    if (dv) {
       b = phash_add (_root_si->map, nl->used_globals[i]);
       if (dv->isint) {
 	b->i = idx.numInts() - _globals.numInts();
@@ -935,9 +985,7 @@ int ActStatePass::run (Process *p)
       }
     }
     else {
-      b = phash_lookup (nl->cH, nl->used_globals[i]);
-      Assert (b, "What?");
-      v = (act_booleanized_var_t *) b->v;
+      v = ActBooleanizePass::getVar (nl, nl->used_globals[i]);
       Assert (v, "What?");
       b = phash_add (_root_si->map, nl->used_globals[i]);
       if (v->ischan) {
@@ -1030,9 +1078,8 @@ int ActStatePass::getTypeOffset (stateinfo_t *si, act_connection *c,
   Assert (si && c && offset, "What?");
 
   /*-- check if this is a dynamic array --*/
-  b = phash_lookup (si->bnl->cdH, c);
-  if (b) {
-    act_dynamic_var_t *dv = (act_dynamic_var_t *)b->v;
+  act_dynamic_var_t *dv = ActBooleanizePass::getDynVar (si->bnl, c);
+  if (dv) {
     b = phash_lookup (si->map, c);
     Assert (b, "What?");
     if (dv->isint) {
@@ -1058,9 +1105,8 @@ int ActStatePass::getTypeOffset (stateinfo_t *si, act_connection *c,
 
   /*-- otherwise... --*/
 
-  b = phash_lookup (si->bnl->cH, c);
-  Assert (b, "No connection in conn hash?");
-  act_booleanized_var_t *v =  (act_booleanized_var_t *)b->v;
+  act_booleanized_var_t *v = ActBooleanizePass::getVar (si->bnl, c);
+  Assert (v, "No connection in conn hash?");
 
   /* set type and width */
   if (type) {
@@ -1172,12 +1218,10 @@ act_connection *ActStatePass::getConnFromOffset (stateinfo_t *si, int off, int t
 	c = (act_connection *)b->key;
 	
 	/* check if c has the right type! */
-	phash_bucket_t *xb;
 	act_booleanized_var_t *v;
-	xb = phash_lookup (si->bnl->cH, c);
+	v = ActBooleanizePass::getVar (si->bnl, c);
 
-	if (xb) {
-	  v = (act_booleanized_var_t *)xb->v;
+	if (v) {
 	  if (v->isint && type == 1) {
 	    return c;
 	  }
@@ -1191,9 +1235,8 @@ act_connection *ActStatePass::getConnFromOffset (stateinfo_t *si, int off, int t
 	}
 	else {
 	  act_dynamic_var_t *dv;
-	  xb = phash_lookup (si->bnl->cdH, c);
-	  Assert (xb, "What?!");
-	  dv = (act_dynamic_var_t *)xb->v;
+	  dv = ActBooleanizePass::getDynVar (si->bnl, c);
+	  Assert (dv, "What?!");
 	  if (type == 1 && dv->isint) {
 	    *doff = 0;
 	    return c;
@@ -1208,10 +1251,9 @@ act_connection *ActStatePass::getConnFromOffset (stateinfo_t *si, int off, int t
     }
 
     /* -- search dynamic info -- */
-    phash_iter_init (si->bnl->cdH, &bi);
-    while ((b = phash_iter_next (si->bnl->cdH, &bi))) {
-      act_dynamic_var_t *dv = (act_dynamic_var_t *)b->v;
-      act_connection *c = (act_connection *)b->key;
+    for (int vi=0; vi < A_LEN (si->bnl->dvars); vi++) {
+      act_dynamic_var_t *dv = &si->bnl->dvars[vi];
+      act_connection *c = dv->id;
       phash_bucket_t *xb = phash_lookup (si->map, c);
       Assert (xb, "What?");
       if (xb->i < off && off < xb->i + dv->a->size()) {
@@ -1229,7 +1271,22 @@ act_connection *ActStatePass::getConnFromOffset (stateinfo_t *si, int off, int t
   }  
 }
 
+ActStateIndex *ActStatePass::globalIndex ()
+{
+  if (!completed()) {
+    warning ("ActStatePass::globalIndex() called without pass being run");
+    return NULL;
+  }
+  if (!_index) {
+    _index = new ActStateIndex (this, _root_proc);
+  }
+  return _index;
+}
+
 ActStatePass::~ActStatePass()
 {
   /* free stuff */
+  if (_index) {
+    delete _index;
+  }
 }
@@ -25,6 +25,7 @@
 #define __ACT_PASS_STATE_H__
 
 #include <map>
+#include <stdint.h>
 #include <act/act.h>
 #include <act/iter.h>
 #include <act/passes/booleanize.h>
@@ -128,6 +129,8 @@ typedef struct {
   
 } stateinfo_t;
 
+class ActStateIndex;
+
 class ActStatePass : public ActPass {
 public:
   ActStatePass (Act *a, int inst_offset = 0);
@@ -189,6 +192,10 @@ public:
 
   int instOffsets () { return _inst_offsets; }
 
+  /* flat index for the design rooted at the process the pass was run
+     on; built on first use, owned by the pass */
+  ActStateIndex *globalIndex ();
+
 private:
   void *local_op (Process *p, int mode = 0);
   void free_local (void *);
@@ -199,7 +206,10 @@ private:
   int _inst_offsets;
 
   stateinfo_t *_root_si;	// top-level state info
+  Process *_root_proc;		// process the pass was run on
   state_counts _globals;
+
+  ActStateIndex *_index;	// flat index, if requested
   
   ActBooleanizePass *bp;
   FILE *_fp;
@@ -208,5 +218,85 @@ private:
 
 
 
+/*
+ * Flat global index of all the state in a design.
+ *
+ * Every bool, int, and channel in the design gets a 64-bit offset in
+ * one of three flat spaces:
+ *
+ *   bools : [ prs bools of all instances | chp bools | global bools ]
+ *   ints  : [ ints of all instances | global ints ]
+ *   chans : [ chans of all instances | global chans ]
+ *
+ * Each instance owns a contiguous block of each region, and an
+ * instance's block is followed by the blocks of its sub-instances
+ * (pre-order), using the same per-process numbering as
+ * getTypeOffset(). Ports have no state of their own; they resolve to
+ * the state they are connected to in the parent.
+ *
+ * The index is a single position-independent buffer, and Write()
+ * saves it as-is so that Read() can mmap it back in (native byte
+ * order). Lookups by hierarchical name cost O(depth) binary searches;
+ * reverse lookups are a binary search on the region table followed
+ * by one on the owning process.
+ */
+struct act_sidx_hdr;
+struct act_sidx_type;
+struct act_sidx_var;
+struct act_sidx_inst;
+struct act_sidx_reg;
+
+class ActStateIndex {
+public:
+  ActStateIndex (ActStatePass *sp, Process *root);
+  ~ActStateIndex ();
+
+  /* region numbers for instBase() */
+  enum region { PRS = 0, CHP = 1, INT = 2, CHAN = 3 };
+
+  static ActStateIndex *Read (const char *file); // NULL on error
+  int Write (const char *file);			 // 1 on success
+
+  uint64_t numBools ();
+  uint64_t numInts ();
+  uint64_t numChans ();
+
+  int numInstances ();
+  int findInstance (const char *name); // -1 if not found; "" is the root
+  char *instName (int inst);	       // malloc'ed
+  uint64_t instBase (int inst, int region);
+  int instParent (int inst);	       // -1 for the root
+
+  /* type: 0 = bool, 1 = int, 2 = chan-in, 3 = chan-not-in, as in
+     getTypeOffset(). Return 0 on error, 1 on success */
+  int getOffset (const char *name, uint64_t *off, int *type, int *width);
+
+  /* canonical hierarchical name (malloc'ed), or NULL */
+  char *getName (int type, uint64_t off);
+
+private:
+  ActStateIndex ();
+  int _attach (char *buf, uint64_t sz);
+  int _resolve (unsigned int inst, struct act_sidx_var *v, uint64_t k,
+		uint64_t *off);
+  int _findvar (unsigned int inst, const char *s, uint64_t *k);
+  int _findchild (unsigned int inst, const char *s, int len);
+  char *_path (unsigned int inst, const char *var, long k);
+
+  char *_buf;			// the index
+  uint64_t _sz;			// size of the buffer
+  int _mapped;			// 1 if mmap'ed
+
+  struct act_sidx_hdr *_h;
+  const char *_str;
+  struct act_sidx_type *_types;
+  struct act_sidx_var *_vars;
+  unsigned int *_rev;
+  unsigned int *_iports;
+  struct act_sidx_inst *_insts;
+  unsigned int *_child;
+  struct act_sidx_reg *_reg[4];
+  unsigned int *_glob;
+};
 
 #endif /* __ACT_PASS_STATE_H__ */
@@ -27,6 +27,13 @@
 #include <assert.h>
 #include "math.h"
 #include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #define MAX_NAME_LENGTH 300
 
@@ -39,6 +46,21 @@ typedef enum {
 	VAL_FROM_SIM_NEUTRAL, VAL_FROM_SIM_ERROR, VAL_FROM_SIM_VALID
 } ValFromSimType;
 
+// A binary token file, mapped into memory.
+struct chan_bin {
+	char *name;
+	unsigned char *base;	// mapped file
+	size_t len;		// file size
+	size_t pos;		// offset of the next value
+	int words;		// words per value
+	int masked;		// values are preceded by a valid word
+	int loop;
+	int linenum;		// number of values read
+};
+
+// Size of the stdio buffer for binary dump files
+#define CHAN_BIN_DUMPBUF (1 << 20)
+
 //-----------------------------------------------------------------------------
 // Called by the outside world...
 
@@ -49,10 +71,24 @@ typedef enum {
 // Returns whether or not it was successful
 //static int channel_getValueFromInjectFile(PrsChannel *, unsigned int *);
 
-static int channel_getValueFromFile (int *, FILE *, int , char *, int *);
+static int channel_getValueFromFile (int *, FILE *, int , char *, unsigned int *, int, int *);
+static void channel_closeInject (PrsChannel *);
+static void channel_closeExpect (PrsChannel *);
 	
 static ValFromSimType channel_getValueFromSim (Prs *, PrsChannel *, unsigned int *);
 
+// Binary token files
+static void channel_binSeek (struct chan_bin *, unsigned long);
+static int channel_binOpen (PrsChannel *, FILE *, char *, int, int, struct chan_bin **);
+static int channel_getValueFromBin (struct chan_bin *, unsigned int *, int *);
+static void channel_binClose (struct chan_bin *);
+
+// Report a mismatch between the simulation and an expect file
+static void channel_mismatch (PrsChannel *, unsigned int *, int);
+
+// Print a (multi-word) channel value
+static void channel_printValue (FILE *, unsigned int *, int);
+
 // Get a value from the simulator and dump it to a file
 static void channel_dumpValue (Prs *, PrsChannel * );
 
@@ -63,7 +99,7 @@ static void channel_expectValue (Prs *, PrsChannel *);
 static void channel_makeNeutral(Prs *, PrsChannel *);
 
 // Will raise the appropriate data rails to drive this value on the channel
-static void channel_driveValue(Prs *, PrsChannel *, unsigned int);
+static void channel_driveValue(Prs *, PrsChannel *, unsigned int *);
 
 // Util function to print out all of the channels.
 static void channel_printChannels(Prs *, struct Channel *);
@@ -84,17 +120,13 @@ static void channel_logValue (Prs *, PrsChannel *);
 // Used to convert between PRS_VAL_BLAH and a character for printfs.
 char valString[] = { '1', '0', 'X' };
 
-// Utility functions for moving between decimal values in files and
-// representations are easier to deal with internally.
-
-// Input is a decimal value.  Fill up array bin with 1's and 0's.  bin[0] is
-// value of bit0.  Zero-pad for n bits.
-static void convert_dec2base2array(unsigned int , int *, int );
+// Values are kept as arrays of 32-bit words, least significant word
+// first. Get/put the n-bit digit at position i.
+#define VAL_DIGIT(v,i,n)  (((v)[((i)*(n))>>5] >> (((i)*(n))&31)) & ((1U<<(n))-1))
+#define VAL_SETDIGIT(v,i,n,d) ((v)[((i)*(n))>>5] |= (d) << (((i)*(n))&31))
 
-// Same as above but does base4	
-static void convert_dec2base4array(unsigned int , int *, int );
-
-static void convert_baseNarray2dec(int *, int , unsigned int *, int );
+// Check that value v has no bits set at or above bit nbits
+static int channel_valueFits(unsigned int *, int, int);
 
 //-----------------------------------------------------------------------------
 // Add a channel name to the hChannels hashtable in Prs
@@ -251,8 +283,23 @@ void create_channel(Prs *P, struct Channel *C, char *sChannelType, int size, cha
 	chan->size = size;
 	chan->name = sChannelName;
 	chan->fpInject = chan->fpDump = chan->fpExpect = NULL;
+	chan->sInject = chan->sDump = chan->sExpect = NULL;
 	chan->isInject = chan->isDump = chan->isExpect = 0;
 	chan->isFirstEnableTransition = 1;
+	chan->binInject = chan->binExpect = NULL;
+	chan->binDump = 0;
+	chan->summaryExpect = 0;
+	chan->numExpect = chan->numMismatch = chan->firstMismatch = 0;
+
+	if (chan->type == CHAN_e1ofN) {
+		chan->words = 1;
+	} else if (chan->type == CHAN_eMx1of4) {
+		chan->words = (2*size + 31)/32;
+	} else {
+		chan->words = (size + 31)/32;
+	}
+	// chan->val holds the channel value, followed by the file value
+	MALLOC(chan->val, unsigned int, 2*chan->words);
 
 	assert (!chan->fpInject);	
 
@@ -295,9 +342,10 @@ void channel_injectfile(Prs *P, struct Channel *C, char *sChanName, char *sFileN
 		DBG("Got channel named %s.\n", chan->name);
 	}
 
-	if (chan->fpInject) {
+	if (chan->fpInject || chan->binInject) {
 		printf("WARNING: Injecting file for %s when that channel already has an injectfile open (%s).\n", sChanName, chan->sInject);
 	}
+	channel_closeInject(chan);
 
 	chan->fpInject = fopen(sFileName, "r");
 	MALLOC(chan->sInject, char, MAX_NAME_LENGTH);	
@@ -307,6 +355,16 @@ void channel_injectfile(Prs *P, struct Channel *C, char *sChanName, char *sFileN
 		chan->fpInject = NULL;
 		return;
 	}
+	// Binary files are mapped into memory instead
+	if (!channel_binOpen (chan, chan->fpInject, chan->sInject, isLoop, 0, &chan->binInject)) {
+		fclose(chan->fpInject);
+		chan->fpInject = NULL;
+		return;
+	}
+	if (chan->binInject) {
+		fclose(chan->fpInject);
+		chan->fpInject = NULL;
+	}
 
 	chan->isInject = 1;
 	chan->linenumInject = 0;
@@ -319,7 +377,7 @@ void channel_injectfile(Prs *P, struct Channel *C, char *sChanName, char *sFileN
 
 //-----------------------------------------------------------------------------
 // Check values on this channel against those in this file.
-void channel_expectfile(Prs *P, struct Channel *C, char *sChanName, char *sFileName, int isLoop) {
+void channel_expectfile(Prs *P, struct Channel *C, char *sChanName, char *sFileName, int isLoop, int isSummary) {
 	PrsChannel *chan;
 	unsigned int val;
 	int i;
@@ -333,9 +391,10 @@ void channel_expectfile(Prs *P, struct Channel *C, char *sChanName, char *sFileN
 		DBG("Got channel named %s.\n", chan->name);
 	}
 
-	if (chan->fpExpect) {
+	if (chan->fpExpect || chan->binExpect) {
 		printf("WARNING: expectfile for %s when that channel already has an expectfile open (%s).\n", sChanName, chan->sExpect);
 	}
+	channel_closeExpect(chan);
 
 	chan->fpExpect = fopen(sFileName, "r");
 	MALLOC(chan->sExpect, char, MAX_NAME_LENGTH);	
@@ -345,9 +404,21 @@ void channel_expectfile(Prs *P, struct Channel *C, char *sChanName, char *sFileN
 		chan->fpExpect = NULL;
 		return;
 	}
+	// Binary files are mapped into memory instead
+	if (!channel_binOpen (chan, chan->fpExpect, chan->sExpect, isLoop, 1, &chan->binExpect)) {
+		fclose(chan->fpExpect);
+		chan->fpExpect = NULL;
+		return;
+	}
+	if (chan->binExpect) {
+		fclose(chan->fpExpect);
+		chan->fpExpect = NULL;
+	}
 
 	chan->isExpect = 1;
 	chan->linenumExpect = 0;
+	chan->summaryExpect = isSummary ? 1 : 0;
+	chan->numExpect = chan->numMismatch = chan->firstMismatch = 0;
 	if (isLoop) {
 		chan->loopExpect = 1;
 	} else {
@@ -361,7 +432,7 @@ void channel_expectfile(Prs *P, struct Channel *C, char *sChanName, char *sFileN
 
 //-----------------------------------------------------------------------------
 // Put values from this channel into a file.
-void channel_dumpfile(Prs *P, struct Channel *C, char *sChanName, char *sFileName) {
+void channel_dumpfile(Prs *P, struct Channel *C, char *sChanName, char *sFileName, int isBin) {
 	PrsChannel *chan;
 	unsigned int val;
 	int i;
@@ -378,6 +449,14 @@ void channel_dumpfile(Prs *P, struct Channel *C, char *sChanName, char *sFileNam
 	if (chan->fpDump) {
 		printf("WARNING: dumpfile for %s when that channel already has a dumpfile open (%s).\n", sChanName, chan->sDump);
 	}
+	if (chan->fpDump) {
+		fclose(chan->fpDump);
+		chan->fpDump = NULL;
+	}
+	if (chan->sDump) {
+		FREE(chan->sDump);
+		chan->sDump = NULL;
+	}
 
 	chan->fpDump = fopen(sFileName, "w");
 	MALLOC(chan->sDump, char, MAX_NAME_LENGTH);	
@@ -390,6 +469,18 @@ void channel_dumpfile(Prs *P, struct Channel *C, char *sChanName, char *sFileNam
 
 	chan->isDump = 1;
 	chan->linenumDump = 0;
+	chan->binDump = isBin ? 1 : 0;
+	if (isBin) {
+		unsigned int hdr[4];
+
+		// Values are not flushed one at a time, so use a big buffer
+		setvbuf(chan->fpDump, NULL, _IOFBF, CHAN_BIN_DUMPBUF);
+		hdr[0] = CHAN_BIN_MAGIC;
+		hdr[1] = CHAN_BIN_VERSION;
+		hdr[2] = chan->words;
+		hdr[3] = 0;
+		fwrite(hdr, sizeof(unsigned int), 4, chan->fpDump);
+	}
 
 	if (chan->enable->val == PRS_VAL_T) {
 		printf("WARNING: Enable was already high when you did dumpfile.  You may miss the first value.  You should apply dumpfile before reset.\n");
@@ -496,14 +587,19 @@ void channel_resetSwitched(Prs *P, struct Channel *C) {
 //-----------------------------------------------------------------------------
 // Action depends on whether this file is inject, expect, or dump
 static void channel_enableRaised(Prs *P, PrsChannel *chan) {
-	 int val;
+	 int ok;
 	 DBG("* in channel_enableRaised %s\n", chan->name);
 	if (chan->isInject) {
 		DBG("* Channel %s is an injectfile channel\n", chan->name);
-		if (!channel_getValueFromFile (&chan->linenumInject, chan->fpInject, chan->loopInject, chan->sInject, &val)) {
+		if (chan->binInject) {
+			ok = channel_getValueFromBin (chan->binInject, chan->val, NULL);
+		} else {
+			ok = channel_getValueFromFile (&chan->linenumInject, chan->fpInject, chan->loopInject, chan->sInject, chan->val, chan->words, NULL);
+		}
+		if (!ok) {
 			DBG("Got NULL from inject file...\n");
 		} else {
-			channel_driveValue (P, chan, val);
+			channel_driveValue (P, chan, chan->val);
 		}
 		// Have to do a quick check here to reset any data rails that need it.
 		channel_resetXRails (P, chan);
@@ -579,35 +675,210 @@ static int channel_getValueFromInjectFile(PrsChannel *chan, unsigned int *val) {
 */
 
 //-----------------------------------------------------------------------------
-// Read a value from the inject file.
+// Read a value from a text inject/expect file: a decimal number, or a hex
+// number (0x...) for values that don't fit in a word, as written by dumpfile.
+// valid (if not NULL) is set to 0 for the value -1, which is not checked;
+// otherwise -1 is an error.
 // If we're doing a loop-injectfile, start over when done with the file.
 static int channel_getValueFromFile
-	(int *linenum, FILE *fp, int loop, char *sName, int *val) {
-	int result;
+	(int *linenum, FILE *fp, int loop, char *sName, unsigned int *val,
+	 int words, int *valid) {
+	char *buf, *end;
+	int c, len, max, i, d;
+	long long x;
 
 	(*linenum)++;
 
-	result = fscanf(fp, "%d", val);
-	if (result == 1) {
-		return 1;
-	} else if (result == EOF) {
+	do {
+		c = getc(fp);
+	} while (c != EOF && isspace(c));
+	if (c == EOF) {
 		if (loop) {
 			rewind(fp);
-			return channel_getValueFromFile(linenum, fp, loop, sName, val);
+			return channel_getValueFromFile(linenum, fp, loop, sName, val, words, valid);
 		} else {
 			printf("Out of values for %s.\n", sName);
 			return 0;
 		}
-	} else if (result == 0) {
-		printf("ERORR: Problem reading file %s (line %d), aborting", sName, *linenum);
-		fclose(fp);
-		//chan->fpInject = NULL;
-		//chan->sInject = NULL;
+	}
+
+	// longest value: 0x followed by 8 digits per word
+	max = 8*words + 3;
+	MALLOC(buf, char, max + 1);
+	len = 0;
+	while (c != EOF && !isspace(c) && len < max) {
+		buf[len++] = c;
+		c = getc(fp);
+	}
+	buf[len] = '\0';
+	if (c != EOF && !isspace(c)) {
+		len = 0;
+	}
+
+	memset(val, 0, sizeof(unsigned int)*words);
+	if (valid) {
+		*valid = 1;
+	}
+	if (len > 2 && buf[0] == '0' && (buf[1] == 'x' || buf[1] == 'X')) {
+		if (len - 2 > 8*words) {
+			len = 0;
+		}
+		for (i = 0; len > 0 && i < len - 2; i++) {
+			c = buf[len-1-i];
+			if (!isxdigit(c)) {
+				len = 0;
+				break;
+			}
+			d = isdigit(c) ? c - '0' : tolower(c) - 'a' + 10;
+			val[i/8] |= (unsigned int)d << (4*(i%8));
+		}
+	} else if (len > 0) {
+		x = strtoll(buf, &end, 10);
+		if (*end != '\0') {
+			len = 0;
+		} else if (x == -1 && valid) {
+			*valid = 0;
+		} else if (x < 0 || x > UINT_MAX) {
+			len = 0;
+		} else {
+			val[0] = (unsigned int)x;
+		}
+	}
+	FREE(buf);
+	if (len == 0) {
+		printf("ERROR: Problem reading file %s (line %d)\n", sName, *linenum);
 		return 0;
-	} else {
-		DBG("Not sure wtf is going on here... result of fscanf = %d (line #%d)\n", result, *linenum);
+	}
+	return 1;
+}
+
+//-----------------------------------------------------------------------------
+// Check if fp (just opened as sName) is a binary token file. If it is, map
+// it into memory and return it in *bin; text files return *bin = NULL.
+// Returns 0 if the file is not usable.
+static int channel_binOpen
+	(PrsChannel *chan, FILE *fp, char *sName, int loop, int isExpect,
+	 struct chan_bin **bin) {
+	unsigned int hdr[4];
+	struct stat st;
+	struct chan_bin *b;
+	size_t sz;
+	void *base;
+
+	*bin = NULL;
+	if (fread(hdr, sizeof(unsigned int), 4, fp) != 4 || hdr[0] != CHAN_BIN_MAGIC) {
+		// Text file
+		rewind(fp);
+		return 1;
+	}
+	if (hdr[1] != CHAN_BIN_VERSION) {
+		printf("ERROR: Binary channel file %s has unknown version %u\n", sName, hdr[1]);
+		return 0;
+	}
+	if (hdr[2] != chan->words) {
+		printf("ERROR: Binary channel file %s has %u-word values, but channel %s needs %d\n", sName, hdr[2], chan->name, chan->words);
+		return 0;
+	}
+	if ((hdr[3] & CHAN_BIN_MASKED) && !isExpect) {
+		printf("ERROR: Binary channel file %s has masked values; only expect files can skip values\n", sName);
+		return 0;
+	}
+	sz = sizeof(unsigned int)*(hdr[2] + ((hdr[3] & CHAN_BIN_MASKED) ? 1 : 0));
+	if (fstat(fileno(fp), &st) != 0 || (st.st_size - sizeof(hdr)) % sz != 0) {
+		printf("ERROR: Binary channel file %s is truncated\n", sName);
 		return 0;
 	}
+	base = NULL;
+	if (st.st_size > sizeof(hdr)) {
+		base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+		if (base == MAP_FAILED) {
+			printf("ERROR: Could not map '%s'\n", sName);
+			return 0;
+		}
+	}
+	NEW(b, struct chan_bin);
+	b->name = sName;
+	b->base = (unsigned char *)base;
+	b->len = st.st_size;
+	b->pos = sizeof(hdr);
+	b->words = hdr[2];
+	b->masked = (hdr[3] & CHAN_BIN_MASKED) ? 1 : 0;
+	b->loop = loop;
+	b->linenum = 0;
+	*bin = b;
+	return 1;
+}
+
+//-----------------------------------------------------------------------------
+// Read the next value from a binary token file. valid (if not NULL) is set to
+// 0 for values that should not be checked.
+// If we're looping, start over when done with the file.
+static int channel_getValueFromBin (struct chan_bin *b, unsigned int *val, int *valid) {
+	unsigned int tag;
+
+	if (b->pos == b->len) {
+		if (b->loop && b->len > 4*sizeof(unsigned int)) {
+			b->pos = 4*sizeof(unsigned int);
+		} else {
+			printf("Out of values for %s.\n", b->name);
+			return 0;
+		}
+	}
+	b->linenum++;
+	tag = 1;
+	if (b->masked) {
+		memcpy(&tag, b->base + b->pos, sizeof(unsigned int));
+		b->pos += sizeof(unsigned int);
+	}
+	memcpy(val, b->base + b->pos, sizeof(unsigned int)*b->words);
+	b->pos += sizeof(unsigned int)*b->words;
+	if (valid) {
+		*valid = (tag != 0);
+	}
+	return 1;
+}
+
+//-----------------------------------------------------------------------------
+// Unmap a binary token file.
+static void channel_binClose (struct chan_bin *b) {
+	if (b->base) {
+		munmap(b->base, b->len);
+	}
+	FREE(b);
+}
+
+//-----------------------------------------------------------------------------
+// Close the inject/expect file of a channel, text or binary.
+static void channel_closeInject (PrsChannel *chan) {
+	if (chan->fpInject) {
+		fclose(chan->fpInject);
+		chan->fpInject = NULL;
+	}
+	if (chan->binInject) {
+		channel_binClose(chan->binInject);
+		chan->binInject = NULL;
+	}
+	if (chan->sInject) {
+		FREE(chan->sInject);
+		chan->sInject = NULL;
+	}
+	chan->isInject = 0;
+}
+
+static void channel_closeExpect (PrsChannel *chan) {
+	if (chan->fpExpect) {
+		fclose(chan->fpExpect);
+		chan->fpExpect = NULL;
+	}
+	if (chan->binExpect) {
+		channel_binClose(chan->binExpect);
+		chan->binExpect = NULL;
+	}
+	if (chan->sExpect) {
+		FREE(chan->sExpect);
+		chan->sExpect = NULL;
+	}
+	chan->isExpect = 0;
 }
 
 
@@ -628,88 +899,58 @@ static void channel_makeNeutral(Prs *P, PrsChannel *chan) {
 
 //-----------------------------------------------------------------------------
 // Raise the appropriate data rails to send a value on a channel
-static void channel_driveValue(Prs *P, PrsChannel *chan, unsigned int val) {
-	int i, b;
-	int numRails;
-	int *valArray;
-	int raised;
+static void channel_driveValue(Prs *P, PrsChannel *chan, unsigned int *val) {
+	int b;
 	DBG("** in channel_driveValue()\n");
 	switch (chan->type) {
 		case CHAN_e1ofN:
 			DBG("* e1ofN channel\n");
-			numRails = chan->size;
-			if (val > numRails) {
-				printf("ERROR: Cannot assign value %d to channel %s, which is e1of%d.\n", val, chan->name, chan->size);
+			if (val[0] >= chan->size) {
+				printf("ERROR: Cannot assign value %u to channel %s, which is e1of%d.\n", val[0], chan->name, chan->size);
 				INTERRUPT;
 				return;
 			}
-			if (chan->dataRails[val]->val == PRS_VAL_T) {
+			if (chan->dataRails[val[0]]->val == PRS_VAL_T) {
 				printf("Something fishy is going on...\n");
 				INTERRUPT;
 				return;
 			}
 			
-			DBG("* Raising rail %s.d[%d].\n", chan->name, val);
-			prs_set_node (P, chan->dataRails[val], PRS_VAL_T);
+			DBG("* Raising rail %s.d[%d].\n", chan->name, val[0]);
+			prs_set_node (P, chan->dataRails[val[0]], PRS_VAL_T);
 			break;
 
 
 	        case CHAN_eDx1of2:
 		case CHAN_eMx1of2:
 			DBG("* eMx1of2 channel\n");
-			MALLOC(valArray, int, chan->size);
 			// Make sure val is small enough (< 2**chan_size)
-			if (val >= pow(2,chan->size)) {
-				printf("ERROR: Value %u is too big for channel %s (e%dx1of2)\n",
-					val, chan->name, chan->size);
+			if (!channel_valueFits(val, chan->words, chan->size)) {
+				printf("ERROR: Value ");
+				channel_printValue(stdout, val, chan->words);
+				printf(" is too big for channel %s (e%dx1of2)\n",
+					chan->name, chan->size);
 				exit(1);
 			}
-			// Convert to array of 1's and 0's
-			convert_dec2base2array(val, valArray, chan->size);
 			for (b = 0; b < chan->size; b++) {
-				if (valArray[b] == 0) {
-				  prs_set_node (P, chan->dataRails[b*2], PRS_VAL_T);
-				} else if (valArray[b] == 1) {
-				  prs_set_node (P, chan->dataRails[b*2+1], PRS_VAL_T);
-				} else {
-					printf("Looks like there's a bug in driveValue() for Mx1of2...\n");
-					exit(1);
-				}
+				prs_set_node (P, chan->dataRails[b*2+VAL_DIGIT(val,b,1)], PRS_VAL_T);
 			}
-			FREE(valArray);
 			break;
 
 
 		case CHAN_eMx1of4:
 			DBG("* eMx1of4 channel\n");
-			MALLOC(valArray, int, chan->size);
-
 			// Make sure val is small enough (< 4**chan_size)
-			if (val >= pow(4,chan->size)) {
-				printf("ERROR: Value %u is too big for channel %s (e%dx1of4)\n",
-					val, chan->name, chan->size);
+			if (!channel_valueFits(val, chan->words, 2*chan->size)) {
+				printf("ERROR: Value ");
+				channel_printValue(stdout, val, chan->words);
+				printf(" is too big for channel %s (e%dx1of4)\n",
+					chan->name, chan->size);
 				exit(1);
 			}
-			// Convert to array of (0,1,2,3)...
-			convert_dec2base4array(val, valArray, chan->size);
 			for (b = 0; b < chan->size; b++) {
-				raised = 0;
-				for (i = 0; i < 4; i++) {
-					if (valArray[b] == i) {
-						if (!raised) {
-						  prs_set_node (P, chan->dataRails[b*4+i], PRS_VAL_T);
-							raised = 1;
-						} else {
-							printf("Looks like there's a bug in driveValue() for Mx1of4...\n");
-						}
-					}
-				}
-				if (!raised) {
-					printf("Didn't raise any rails for %s.b[%d]...\n", chan->name, b);
-					printf("valArray[%d] = %d.\n", b, valArray[b]);
-				}
+				prs_set_node (P, chan->dataRails[b*4+VAL_DIGIT(val,b,2)], PRS_VAL_T);
 			}
-			FREE(valArray);
 			break;
 		default:
 			printf("ERROR: Channel %s has unknown type!\n", chan->name);
@@ -722,11 +963,10 @@ static void channel_driveValue(Prs *P, PrsChannel *chan, unsigned int val) {
 //-----------------------------------------------------------------------------
 // Enable was lowered, get value and dump to file
 static void channel_dumpValue (Prs *P, PrsChannel *chan ) {
-	unsigned int chanVal;
 	ValFromSimType result;
 
 	// Get the value of the channel
-	result = channel_getValueFromSim (P, chan, &chanVal);
+	result = channel_getValueFromSim (P, chan, chan->val);
 	if (result == VAL_FROM_SIM_ERROR) {
 		printf("ERROR: Problem getting value for channel %s from simulation!\n", chan->name);
 		INTERRUPT;
@@ -740,8 +980,13 @@ static void channel_dumpValue (Prs *P, PrsChannel *chan ) {
 		return;
 	}
 
-	fprintf(chan->fpDump, "%d\n", chanVal);
-	fflush (chan->fpDump);
+	if (chan->binDump) {
+		fwrite(chan->val, sizeof(unsigned int), chan->words, chan->fpDump);
+	} else {
+		channel_printValue(chan->fpDump, chan->val, chan->words);
+		fprintf(chan->fpDump, "\n");
+		fflush (chan->fpDump);
+	}
 }
 
 
@@ -749,12 +994,14 @@ static void channel_dumpValue (Prs *P, PrsChannel *chan ) {
 // Enable was lowered, check that the value on the channel matches that in the
 // file.
 static void channel_expectValue (Prs *P, PrsChannel *chan ) {
-	unsigned int chanVal;
-	int fileVal;
+	unsigned int *chanVal, *fileWords;
+	int valid, ok;
 	ValFromSimType result;
 
 	// Get the value of the channel
-	result = channel_getValueFromSim (P, chan, &chanVal);
+	chanVal = chan->val;
+	fileWords = chan->val + chan->words;
+	result = channel_getValueFromSim (P, chan, chanVal);
 	if (result == VAL_FROM_SIM_ERROR) {
 		printf("ERROR: Problem getting value for channel %s from simulation!\n", chan->name);
 		INTERRUPT;
@@ -769,21 +1016,50 @@ static void channel_expectValue (Prs *P, PrsChannel *chan ) {
 		return;
 	}
 
-	// Get the value from the file
-	if (!channel_getValueFromFile(&chan->linenumExpect, chan->fpExpect, chan->loopExpect, chan->sExpect, &fileVal)) {
+	// Get the value from the file, and compare
+	if (chan->binExpect) {
+		ok = channel_getValueFromBin(chan->binExpect, fileWords, &valid);
+	} else {
+		ok = channel_getValueFromFile(&chan->linenumExpect, chan->fpExpect, chan->loopExpect, chan->sExpect, fileWords, chan->words, &valid);
+	}
+	if (ok) {
+		chan->numExpect++;
+		if (!valid) {
+			DBG("Ignoring value for %s\n", chan->name);
+		} else if (memcmp(chanVal, fileWords, sizeof(unsigned int)*chan->words) == 0) {
+			DBG("Good!  Values match for %s!!!!\n", chan->name);
+		} else {
+			channel_mismatch(chan, fileWords, chan->binExpect ? chan->binExpect->linenum : chan->linenumExpect);
+		}
+	}
+	if (!ok) {
 		printf("ERROR: Problem getting value for channel %s from file!\n", chan->name);
 		INTERRUPT;
 		return;
 	}
+}
 
-	if (fileVal == -1) {
-		DBG("Ignoring value for %s\n", chan->name);
-	} else if (chanVal == fileVal) {
-		DBG("Good!  Values match for %s!!!!\n", chan->name);
+//-----------------------------------------------------------------------------
+// The channel value (in chan->val) does not match fileVal, at line/value
+// number linenum of the expect file. Stop the simulation, unless the expect
+// file is in summary mode; in that case only the first mismatch is printed.
+static void channel_mismatch (PrsChannel *chan, unsigned int *fileVal, int linenum) {
+	chan->numMismatch++;
+	if (chan->summaryExpect) {
+		if (chan->numMismatch > 1) {
+			return;
+		}
+		chan->firstMismatch = linenum;
+	}
+	printf("ERROR: Mismatch in values for %s.  Prsim has ", chan->name);
+	channel_printValue(stdout, chan->val, chan->words);
+	printf(" but file says ");
+	channel_printValue(stdout, fileVal, chan->words);
+	printf(" (line number %d).\n", linenum);
+	if (chan->summaryExpect) {
+		printf("\t(counting further mismatches for %s; see expect-summary)\n", chan->name);
 	} else {
-		printf("ERROR: Mismatch in values for %s.  Prsim has %d but file says %d (line number %d).\n", chan->name, chanVal, fileVal, chan->linenumExpect);
 		INTERRUPT;
-		//exit(1);
 	}
 }
 
@@ -795,7 +1071,7 @@ static void channel_expectValue (Prs *P, PrsChannel *chan ) {
 // warning anyways and return -1;
 static ValFromSimType channel_getValueFromSim (Prs *P, PrsChannel *chan, unsigned int *val) {
 	int railval, i, b;
-	int *valArray;
+	int digit;
 	int allNeutral, bitNeutral;
 	railval = -1;
 	// Whether none of the rails for the entire channel were high
@@ -803,6 +1079,7 @@ static ValFromSimType channel_getValueFromSim (Prs *P, PrsChannel *chan, unsigne
 	// Whether there was a bit/quad that was valid
 	bitNeutral = -1;
 	
+	memset(val, 0, sizeof(unsigned int)*chan->words);
 
 	switch (chan->type) {
 		case CHAN_e1ofN:
@@ -827,7 +1104,7 @@ static ValFromSimType channel_getValueFromSim (Prs *P, PrsChannel *chan, unsigne
 				//INTERRUPT;
 				return VAL_FROM_SIM_NEUTRAL;
 			} else {
-				*val = (unsigned int)railval;
+				val[0] = (unsigned int)railval;
 				allNeutral = 0;
 				return VAL_FROM_SIM_VALID;
 			}
@@ -835,13 +1112,11 @@ static ValFromSimType channel_getValueFromSim (Prs *P, PrsChannel *chan, unsigne
 
 		case CHAN_eMx1of2:
 		case CHAN_eDx1of2:
-			MALLOC(valArray, int, chan->size);
 			for (i = 0; i < chan->size; i++) {
 				if (chan->dataRails[i*2]->val == PRS_VAL_T) {
-					valArray[i] = 0;
 					allNeutral = 0;	
 				} else if (chan->dataRails[i*2+1]->val == PRS_VAL_T) {
-					valArray[i] = 1;
+					VAL_SETDIGIT(val, i, 1, 1U);
 					allNeutral = 0;	
 				} else {
 					bitNeutral = i;
@@ -856,37 +1131,30 @@ static ValFromSimType channel_getValueFromSim (Prs *P, PrsChannel *chan, unsigne
 			} else if (allNeutral == 1) {
 				return VAL_FROM_SIM_NEUTRAL;
 			}
-
-			// Need to convert valArray into a real number
-			{ unsigned int rv;
-			convert_baseNarray2dec(valArray, chan->size, &rv, 2);
-			railval = rv;
-			}
-			FREE(valArray);
-			*val = railval;
 			return VAL_FROM_SIM_VALID;
 			break;
 
 		case CHAN_eMx1of4:
-			MALLOC(valArray, int, chan->size);
 			for (b = 0; b < chan->size; b++) {
-				valArray[b] = -1;
+				digit = -1;
 				for (i = 0; i < 4; i++) {
 					if (chan->dataRails[b*4+i]->val == PRS_VAL_T) {
-						if (valArray[b] == -1) {
-							//DBG("valArray[%d] = %d\n", b, i);
-							valArray[b] = i;
+						if (digit == -1) {
+							//DBG("digit %d = %d\n", b, i);
+							digit = i;
 							allNeutral = 0;
 						} else {
 							printf("ERROR: Multiple rails high for channel %s.b[%d].\n", chan->name, b);
 						}
 					}
 				}
-				if (valArray[b] == -1) {
+				if (digit == -1) {
 					bitNeutral = b;
 					//printf("ERROR: %s.e is low but no rail in %s.b[%d] is high!\n", chan->name, b);
 					// INTERRUPT;
 					//return;
+				} else {
+					VAL_SETDIGIT(val, b, 2, (unsigned int)digit);
 				}
 			}
 
@@ -896,19 +1164,10 @@ static ValFromSimType channel_getValueFromSim (Prs *P, PrsChannel *chan, unsigne
 			} else if (allNeutral == 1) {
 				return VAL_FROM_SIM_NEUTRAL;
 			}
-
-			// Need to convert valArray into a real number
-			{
-			  unsigned int rv;
-			  convert_baseNarray2dec(valArray, chan->size, &rv, 4);
-			  railval = rv;
-			}
-			FREE(valArray);
-			*val = railval;
 			return VAL_FROM_SIM_VALID;
 			break;
 	}
-
+	return VAL_FROM_SIM_ERROR;
 }
 
 //-----------------------------------------------------------------------------
@@ -931,49 +1190,72 @@ static void channel_printChannels(Prs *P, struct Channel *C) {
 
 
 //-----------------------------------------------------------------------------
-// Utility functions for moving between decimal values in files and
-// representations are easier to deal with internally.
+// Utility functions for multi-word channel values.
 
-// Input is a decimal value.  Fill up array bin with 1's and 0's.  bin[0] is
-// value of bit0.  Zero-pad for n bits.
-static void convert_dec2base2array(unsigned int dec, int *bin, int n) {
+static int channel_valueFits(unsigned int *val, int words, int nbits) {
 	int i;
 
-	// Just get the lsb of dec and then shift right by one
-	for (i = 0; i < n; i++) {
-		bin[i] = dec & 1;
-		dec = dec >> 1;
+	if (nbits >= 32*words) {
+		return 1;
 	}
+	if (val[nbits/32] >> (nbits%32)) {
+		return 0;
+	}
+	for (i = nbits/32 + 1; i < words; i++) {
+		if (val[i]) {
+			return 0;
+		}
+	}
+	return 1;
 }
 
-static void convert_dec2base4array(unsigned int dec, int *quat, int n) {
+// Values that fit in a word are printed in decimal, others in hex.
+static void channel_printValue(FILE *fp, unsigned int *val, int words) {
 	int i;
 
-	// Just get the two least-sig bits of dec and then shift right by two
-	for (i = 0; i < n; i++) {
-		quat[i] = dec & 3;
-		dec = dec >> 2;
+	if (channel_valueFits(val, words, 32)) {
+		fprintf(fp, "%u", val[0]);
+		return;
+	}
+	for (i = words-1; i > 0 && val[i] == 0; i--)
+		;
+	fprintf(fp, "0x%x", val[i]);
+	for (i--; i >= 0; i--) {
+		fprintf(fp, "%08x", val[i]);
 	}
 }
 
-static void convert_baseNarray2dec(int *a, int length, unsigned int *dec, int base) {
-	int i,j;
-	int base2i;
-	//DBG("Converting to base %d\n", base);
-	*dec = 0;
-	for (i = 0; i < length; i++) {
-		//base2i = pow((double)base,(double)i);
-		// Normal pow(double, double) was giving me some *really* fucked up results, so I'm just going to do this the hard way....).
-		//base2i = 1;
-		//for (j = 0; j < i; j++) {
-			//base2i *= base;
-		//}
-		base2i = pow(base, i);
-		//DBG("a[%d] = %d, base=%d, i=%d, base**i=%d\n", i, a[i], base, i, base2i);
-		//*dec += (unsigned int) (a[i] * pow(base,i));
-		*dec += (unsigned int) (a[i] * base2i);
-		//DBG("dec = %u\n", *dec);
-	}
+static void channel_binSeek (struct chan_bin *b, unsigned long loc)
+{
+  size_t sz;
+
+  sz = sizeof(unsigned int)*(b->words + b->masked);
+  if (loc < 4*sizeof(unsigned int) || loc > b->len ||
+      (loc - 4*sizeof(unsigned int)) % sz != 0) {
+    fatal_error ("Invalid checkpoint location %lu for %s", loc, b->name);
+  }
+  b->pos = loc;
+  b->linenum = (loc - 4*sizeof(unsigned int))/sz;
+}
+
+void channel_expectsummary (struct Channel *C, char *name)
+{
+  int i;
+  hash_bucket_t *b;
+  PrsChannel *pc;
+
+  for (i=0; i < C->hChannels->size; i++) {
+    for (b = C->hChannels->head[i]; b; b = b->next) { 
+      pc = (PrsChannel *)b->v;
+      if (!pc->isExpect || (name && strcmp (name, pc->name) != 0)) continue;
+      printf ("%s: %lu values checked, %lu mismatches", pc->name,
+	      pc->numExpect, pc->numMismatch);
+      if (pc->numMismatch > 0 && pc->summaryExpect) {
+	printf (" (first at line %lu)", pc->firstMismatch);
+      }
+      printf ("\n");
+    }
+  }
 }
 
 struct prs_node_extra *prs_node_extra_init (void)
@@ -1002,9 +1284,18 @@ void channel_checkpoint (struct Channel *C, FILE *fp)
       if (pc->fpInject) {
 	fprintf (fp, "%lu ", ftell (pc->fpInject));
       }
+      else if (pc->binInject) {
+	fprintf (fp, "%lu ", (unsigned long)pc->binInject->pos);
+      }
       if (pc->fpExpect) {
 	fprintf (fp, "%lu ", ftell (pc->fpExpect));
       }
+      else if (pc->binExpect) {
+	fprintf (fp, "%lu ", (unsigned long)pc->binExpect->pos);
+      }
+      if (pc->binDump) {
+	fflush (pc->fpDump);
+      }
       fprintf (fp, "\n");
     }
   }
@@ -1032,9 +1323,17 @@ void channel_restore (struct Channel *C, FILE *fp)
       if (fscanf (fp, "%lu", &loc) != 1) Assert (0, "Checkpoint read error");
       fseek (pc->fpInject, loc, SEEK_SET);
     }
+    else if (pc->binInject) {
+      if (fscanf (fp, "%lu", &loc) != 1) Assert (0, "Checkpoint read error");
+      channel_binSeek (pc->binInject, loc);
+    }
     if (pc->fpExpect) {
       if (fscanf (fp, "%lu", &loc) != 1) Assert (0, "Checkpoint read error");
       fseek (pc->fpExpect, loc, SEEK_SET);
     }
+    else if (pc->binExpect) {
+      if (fscanf (fp, "%lu", &loc) != 1) Assert (0, "Checkpoint read error");
+      channel_binSeek (pc->binExpect, loc);
+    }
   }
 }
@@ -31,6 +31,24 @@ extern "C" {
 struct prs_channel;
 typedef struct prs_channel PrsChannel;
 
+struct chan_bin;
+
+/*
+  Binary channel token files (injectfile/expectfile detect them by the
+  magic number, dumpfile writes them with the :bin option).
+
+  Header: four 32-bit words in host byte order
+      CHAN_BIN_MAGIC, CHAN_BIN_VERSION, words, flags
+  followed by the values. Each value is <words> 32-bit words, least
+  significant word first; words must match the channel's value width
+  (1 for e1ofN, ceil(M/32) for eMx1of2/eDx1of2, ceil(2M/32) for
+  eMx1of4). With CHAN_BIN_MASKED (expect files only), each value is
+  preceded by one more word; if it is zero, the value is not checked.
+*/
+#define CHAN_BIN_MAGIC   0x4e414843	/* "CHAN" */
+#define CHAN_BIN_VERSION 1
+#define CHAN_BIN_MASKED  0x1
+
 #define CHINFO(x) ((struct prs_node_extra *)(x)->chinfo)
 #define SPACE(x)  ((struct prs_node_extra *)(x)->chinfo)->morespace
 
@@ -68,6 +86,15 @@ struct prs_channel {
 	// Whether to loop for any of these commands
 	unsigned int loopInject:1, loopExpect:1;
 
+	// Binary inject/expect files (replace fpInject/fpExpect), and
+	// whether fpDump is written in binary
+	struct chan_bin *binInject, *binExpect;
+	unsigned int binDump:1;
+
+	// Count expect mismatches instead of stopping at the first one
+	unsigned int summaryExpect:1;
+	unsigned long numExpect, numMismatch, firstMismatch;
+
 	// For every channel that we're watching (dump or expect), it's okay if
 	// initially the channel's enable is low but the channel is neutral.
 	// Therefore, we keep track of this is the enable's first transition or
@@ -89,6 +116,10 @@ struct prs_channel {
 	// for eMx1of2, eMx1of4, this is M
 	int size;
 
+	// Number of 32-bit words in a value, and space for one value
+	int words;
+	unsigned int *val;
+
 };
 // end CLINT
 
@@ -111,11 +142,15 @@ void create_channel(Prs *, struct Channel *, char *, int , char *);
   /* Drive this channel with values from a file. */
 void channel_injectfile(Prs *, struct Channel *, char *, char *, int );
 
-  /* Check that values on this channel match those in a file */
-void channel_expectfile(Prs *, struct Channel *, char *, char *, int );
+  /* Check that values on this channel match those in a file; with
+     summary set, mismatches are counted instead of stopping */
+void channel_expectfile(Prs *, struct Channel *, char *, char *, int, int);
+
+  /* Put this channel's values into a file (binary if isBin) */ 
+void channel_dumpfile(Prs *,  struct Channel *, char *, char *, int);
 
-  /* Put this channel's values into a file */ 
-void channel_dumpfile(Prs *,  struct Channel *, char *, char *);
+  /* Print the number of values checked/mismatched by expect files */
+void channel_expectsummary(struct Channel *, char *);
 
   /* Called by prsim whenever an enable switches.  Go through all of
      the channels and call appropriate functions for any channels
@@ -1813,8 +1813,9 @@ int process_injectfile (int isLoop, int argc, char **argv)
 
 int process_expectfile (int isLoop, int argc, char **argv)
 {
-  STD_ARG("Usage: [loop-]expectfile channelname file\n");
+  STD_ARG("Usage: [loop-]expectfile channelname file [:summary]\n");
   char *sChanName, *sFileName;
+  int isSummary = 0;
 
   GET_ARG(usage);
   sChanName = s;
@@ -1822,16 +1823,27 @@ int process_expectfile (int isLoop, int argc, char **argv)
   GET_ARG(usage);
   sFileName = s;
 
+  GET_OPTARG;
+  if (s) {
+    if (strcmp (s, ":summary") == 0) {
+      isSummary = 1;
+    }
+    else {
+      iargc--;
+    }
+  }
+
   CHECK_TRAILING(usage);
 
-  channel_expectfile(P, &C, sChanName, sFileName, isLoop);
+  channel_expectfile(P, &C, sChanName, sFileName, isLoop, isSummary);
   RETURN (1);
 }
 
 RET_TYPE process_dumpfile (ARG_LIST)
 {
-  STD_ARG("Usage: dumpfile channelname file\n");
+  STD_ARG("Usage: dumpfile channelname file [:bin]\n");
   char *sChanName, *sFileName;
+  int isBin = 0;
 
   GET_ARG(usage);
   sChanName = s;
@@ -1839,9 +1851,30 @@ RET_TYPE process_dumpfile (ARG_LIST)
   GET_ARG(usage);
   sFileName = s;
 
+  GET_OPTARG;
+  if (s) {
+    if (strcmp (s, ":bin") == 0) {
+      isBin = 1;
+    }
+    else {
+      iargc--;
+    }
+  }
+
+  CHECK_TRAILING(usage);
+
+  channel_dumpfile(P, &C, sChanName, sFileName, isBin);
+  RETURN (1);
+}
+
+RET_TYPE process_expectsummary (ARG_LIST)
+{
+  STD_ARG("Usage: expect-summary [channelname]\n");
+
+  GET_OPTARG;
   CHECK_TRAILING(usage);
 
-  channel_dumpfile(P, &C, sChanName, sFileName);
+  channel_expectsummary(&C, s);
   RETURN (1);
 }
 
@@ -2164,11 +2197,12 @@ struct LispCliCommand Cmds[] = {
   { "vwatch", "vwatch <name> - watch a vector", process_vwatch },
   { "vunwatch", "vunwatch <name> - stop watching a vector", process_vunwatch },
   { "channel", "channel <type> <size> <name> - create channel\n\tExample: channel e1ofN 2 A declares an e1of2 channel called A", process_channel },
-  { "injectfile", "injectfile <name> <file> - inject values in <file> into channel <name>", process_injectfile0 },
+  { "injectfile", "injectfile <name> <file> - inject values in <file> into channel <name>\n\t(text, or binary channel file)", process_injectfile0 },
   { "loop-injectfile", "loop-injectfile <name> <file> - loop injectfile command", process_injectfile1 },
-  { "expectfile", "expectfile <name> <file> - check channel outputs against values in file", process_expectfile0 },
-  { "loop-expectfile", "loop-expectfile <name> <file> - loop expectfile command", process_expectfile1 },
-  { "dumpfile", "dumpfile <name> <file> - dump channel output to file", process_dumpfile }
+  { "expectfile", "expectfile <name> <file> [:summary] - check channel outputs against values in file\n\t:summary counts mismatches instead of stopping", process_expectfile0 },
+  { "loop-expectfile", "loop-expectfile <name> <file> [:summary] - loop expectfile command", process_expectfile1 },
+  { "expect-summary", "expect-summary [<name>] - report values checked/mismatched by expectfile", process_expectsummary },
+  { "dumpfile", "dumpfile <name> <file> [:bin] - dump channel output to file\n\t:bin writes a binary channel file", process_dumpfile }
 };
 
 
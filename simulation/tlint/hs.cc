@@ -26,9 +26,15 @@
 
 */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 #include "misc.h"
 #include "array.h"
 #include "atrace.h"
@@ -471,107 +477,495 @@ static char *name_convert (char *signal)
   return s;
 }
 
-void csv_convert (FILE *fp, const char *output)
-{
+/*------------------------------------------------------------------------
+ *
+ *  CSV input: a header line with `<name> X,<name> Y' column pairs,
+ *  followed by lines of t,v pairs, one per signal.
+ *
+ *  The text is cut into chunks at line boundaries. The chunks of a
+ *  round are parsed in parallel (one thread each) into arrays of
+ *  floats, while the previous round is being written out in order.
+ *
+ *------------------------------------------------------------------------
+ */
+
+#define CSV_CHUNK  (4 << 20)	/* bytes per chunk */
+
+#define CSV_TOO_MUCH    1	/* errors */
+#define CSV_MISSING_ON  2
+#define CSV_MISSING     3
+
+struct csv_chunk {
+  const char *s, *e;		/* complete lines */
+  int nnames;
+  int rows;			/* # of rows parsed */
+  int err;			/* error in the line after the last row */
+  A_DECL (float, val);		/* t,v pairs */
+  pthread_t th;
+};
+
+struct csv_round {
+  int n;			/* # of chunks in use */
+  struct csv_chunk *c;
+};
+
+struct csv_state {
   atrace *A;
-  char *buf;
-  int sz = 10;
-  int first = 1;
   A_DECL (name_t *, names);
-  char *tok;
+  int dups;			/* a node appears in more than one column */
+  int lineno;			/* # of lines written */
 
-  MALLOC (buf, char, sz);
-  buf[sz-1] = '\0';
+  struct csv_round r[2];	/* being parsed / being written */
 
-  A_INIT (names);
+  name_t **bn;			/* batch for the atrace writer */
+  float *bt, *bv;
+  int bnum;
+};
+
+static int hs_threads;		/* # of parser threads */
+static int hs_verbose;		/* report throughput */
+
+static double hs_time (void)
+{
+  struct timeval tv;
 
-  while (fgets (buf, sz, fp)) {
-    /* resize buffer if we didn't get the entire line */
-    while (buf[strlen(buf)-1] != '\n') {
-      int newsz = sz*2;
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+static const double hs_pow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
 
-      REALLOC (buf, char, newsz);
-      buf[newsz-1] = '\0';
-      Assert (fgets (buf+sz-1, sz+1, fp), "EOF without end of line?");
-      sz = newsz;
+/*
+  atof() of the field [s,e). Decimals with at most 15 significant
+  digits and a power of ten up to 10^22 are computed as one
+  multiplication or division of two exact doubles, which is
+  correctly rounded just like strtod(); anything else goes to atof().
+*/
+static double csv_num (const char *s, const char *e)
+{
+  const char *t = s;
+  unsigned long m = 0;
+  int digits = 0, any = 0, exp10 = 0, x = 0, xneg = 0, neg = 0;
+  char buf[64], *tmp;
+  double ret;
+
+  if (t < e && (*t == '-' || *t == '+')) {
+    neg = (*t == '-');
+    t++;
+  }
+  for (; t < e && *t >= '0' && *t <= '9'; t++) {
+    any = 1;
+    if (m || *t != '0') {
+      m = m*10 + (*t - '0');
+      digits++;
     }
-    if (first == 1) {
-      /* get names */
+  }
+  if (t < e && *t == '.') {
+    for (t++; t < e && *t >= '0' && *t <= '9'; t++) {
+      any = 1;
+      if (m || *t != '0') {
+	m = m*10 + (*t - '0');
+	digits++;
+      }
+      exp10--;
+    }
+  }
+  if (any && t < e && (*t == 'e' || *t == 'E')) {
+    t++;
+    if (t < e && (*t == '-' || *t == '+')) {
+      xneg = (*t == '-');
+      t++;
+    }
+    if (t == e || *t < '0' || *t > '9') {
+      any = 0;
+    }
+    for (; t < e && *t >= '0' && *t <= '9' && x < 1000; t++) {
+      x = x*10 + (*t - '0');
+    }
+  }
+  if (any && t == e && digits <= 15) {
+    exp10 += xneg ? -x : x;
+    if (m == 0) {
+      return neg ? -0.0 : 0.0;
+    }
+    if (exp10 >= -22 && exp10 <= 22) {
+      ret = (double)m;
+      if (exp10 < 0) {
+	ret /= hs_pow10[-exp10];
+      }
+      else {
+	ret *= hs_pow10[exp10];
+      }
+      return neg ? -ret : ret;
+    }
+  }
 
-      A = atrace_create (output, ATRACE_DELTA, 1e-9 /* 10ns */ , 1e-12 /* dt */);
+  /* slow path */
+  if (e - s < (int)sizeof (buf)) {
+    tmp = buf;
+  }
+  else {
+    MALLOC (tmp, char, e - s + 1);
+  }
+  memcpy (tmp, s, e - s);
+  tmp[e - s] = '\0';
+  ret = atof (tmp);
+  if (tmp != buf) {
+    FREE (tmp);
+  }
+  return ret;
+}
 
-      tok = strtok (buf, ",\n");
+/* end of the field starting at s in the line ending at e */
+static const char *csv_field (const char *s, const char *e)
+{
+  while (s < e && *s != ',')
+    s++;
+  return s;
+}
 
-      while (tok) {
-	char *nm, *tmp;
-	int l;
-	nm = Strdup (tok);
-	
-	l = strlen (nm);
-	
-	tok = strtok (NULL, ",\n");
+/* skip empty fields, like strtok() */
+static const char *csv_skip (const char *s, const char *e)
+{
+  while (s < e && *s == ',')
+    s++;
+  return s;
+}
 
-	if (strlen (tok) != l) {
-	  printf ("[%s] [%s]\n", nm, tok);
-	  fatal_error ("Assumed that names were `name X' `name Y' pairs\n");
-	}
-	
-	if (l < 2 || nm[l-2] != ' ' || nm[l-1] != 'X' || tok[l-2] != ' ' || tok[l-1] != 'Y') {
-	  printf ("[%s] [%s]\n", nm, tok);
-	  fatal_error ("Names must be [<foo> X] and [<foo> Y]\n");
+static void *csv_parse (void *arg)
+{
+  struct csv_chunk *K = (struct csv_chunk *)arg;
+  const char *s, *e, *t;
+  int i;
+
+  K->rows = 0;
+  K->err = 0;
+  A_LEN (K->val) = 0;
+
+  for (s = K->s; s < K->e; s = e + 1) {
+    e = (const char *) memchr (s, '\n', K->e - s);
+    if (!e) {
+      e = K->e;
+    }
+    if (A_MAX (K->val) < A_LEN (K->val) + 2*K->nnames) {
+      if (A_MAX (K->val) == 0) {
+	A_MAX (K->val) = 2*K->nnames + 1024;
+	MALLOC (K->val, float, A_MAX (K->val));
+      }
+      else {
+	A_MAX (K->val) = 2*A_MAX (K->val) + 2*K->nnames;
+	REALLOC (K->val, float, A_MAX (K->val));
+      }
+    }
+    i = 0;
+    s = csv_skip (s, e);
+    while (s < e) {
+      /* t,v pair */
+      if (i >= K->nnames) {
+	K->err = CSV_TOO_MUCH;
+	return NULL;
+      }
+      t = csv_field (s, e);
+      K->val[A_LEN (K->val) + 2*i] = csv_num (s, t);
+      s = csv_skip (t, e);
+      if (s == e) {
+	K->err = CSV_MISSING_ON;
+	return NULL;
+      }
+      t = csv_field (s, e);
+      K->val[A_LEN (K->val) + 2*i + 1] = csv_num (s, t);
+      s = csv_skip (t, e);
+      i++;
+    }
+    if (i != K->nnames) {
+      K->err = CSV_MISSING;
+      return NULL;
+    }
+    A_LEN (K->val) += 2*i;
+    K->rows++;
+  }
+  return NULL;
+}
+
+static void csv_flush (struct csv_state *C)
+{
+  if (C->bnum > 0) {
+    atrace_signal_changes (C->A, C->bnum, C->bn, C->bt, C->bv);
+    C->bnum = 0;
+  }
+}
+
+/* write out the rows of a parsed chunk */
+static void csv_write (struct csv_state *C, struct csv_chunk *K)
+{
+  float *x;
+  int r, i;
+
+  x = K->val;
+  for (r=0; r < K->rows; r++) {
+    C->lineno++;
+    for (i=0; i < A_LEN (C->names); i++, x += 2) {
+      if (fabs (C->names[i]->v - x[1]) >= 1e-6) {
+	C->bn[C->bnum] = C->names[i];
+	C->bt[C->bnum] = x[0];
+	C->bv[C->bnum] = x[1];
+	C->bnum++;
+	if (C->dups) {
+	  /* the next column may look at this value */
+	  csv_flush (C);
 	}
-	nm[l-2] = '\0';
-	tmp = name_convert (nm);
-	free (nm);
-	nm = tmp;
+      }
+    }
+    csv_flush (C);
+  }
+  switch (K->err) {
+  case CSV_TOO_MUCH:
+    fatal_error ("Too much data on line %d\n", C->lineno+1);
+    break;
+  case CSV_MISSING_ON:
+    fatal_error ("Missing data on line %d\n", C->lineno+1);
+    break;
+  case CSV_MISSING:
+    fatal_error ("Missing data from line %d\n", C->lineno+1);
+    break;
+  default:
+    break;
+  }
+}
 
-	A_NEW (names, name_t *);
-	A_NEXT (names) = atrace_create_node (A, nm);
-	A_INC (names);
+/*
+  Cut a round of chunks from [s,e), and start parsing it. Unless
+  final is set, the text after the last newline is left alone.
+  Returns the start of the rest of the text.
+*/
+static const char *csv_start (struct csv_state *C, struct csv_round *R,
+			      const char *s, const char *e, int final)
+{
+  const char *q;
 
-	free (nm);
-	tok = strtok (NULL, ",\n");
+  R->n = 0;
+  while (R->n < hs_threads && s < e) {
+    if (e - s > CSV_CHUNK) {
+      q = (const char *) memchr (s + CSV_CHUNK, '\n', e - s - CSV_CHUNK);
+      q = q ? q + 1 : e;
+    }
+    else {
+      q = e;
+    }
+    if (q == e && !final) {
+      while (q > s && q[-1] != '\n')
+	q--;
+      if (q == s) break;
+    }
+    R->c[R->n].s = s;
+    R->c[R->n].e = q;
+    R->c[R->n].nnames = A_LEN (C->names);
+    R->n++;
+    s = q;
+  }
+  if (hs_threads > 1) {
+    int i;
+    for (i=0; i < R->n; i++) {
+      if (pthread_create (&R->c[i].th, NULL, csv_parse, &R->c[i]) != 0) {
+	fatal_error ("Could not create thread.");
       }
     }
+  }
+  return s;
+}
+
+static void csv_finish (struct csv_state *C, struct csv_round *R)
+{
+  int i;
+
+  for (i=0; i < R->n; i++) {
+    if (hs_threads > 1) {
+      pthread_join (R->c[i].th, NULL);
+    }
     else {
-      int i;
+      csv_parse (&R->c[i]);
+    }
+  }
+}
 
-      tok = strtok (buf, ",\n");
+/*
+  Convert all complete lines in [s,e), and the trailing partial line
+  as well if final is set. Returns the start of the unconverted text.
+*/
+static const char *csv_lines (struct csv_state *C, const char *s,
+			      const char *e, int final)
+{
+  struct csv_round *R, *W;
+  int i;
 
-      i = 0;
-      while (tok) {
-	float t, v; 
-	/* t,v pair */
+  R = &C->r[0];
+  W = &C->r[1];
+  s = csv_start (C, R, s, e, final);
+  csv_finish (C, R);
+  while (R->n > 0) {
+    /* parse the next round while this one is written */
+    s = csv_start (C, W, s, e, final);
+    for (i=0; i < R->n; i++) {
+      csv_write (C, &R->c[i]);
+    }
+    csv_finish (C, W);
+    R = W;
+    W = (R == &C->r[0]) ? &C->r[1] : &C->r[0];
+  }
+  return s;
+}
 
-	if (i >= A_LEN (names)) {
-	  fatal_error ("Too much data on line %d\n", first);
-	}
+/* header line [s,e): create the trace file and its nodes */
+static void csv_header (struct csv_state *C, const char *output,
+			const char *s, const char *e)
+{
+  char *buf, *tok, *save;
+  int i;
 
-	t = atof (tok);
-	tok = strtok (NULL, ",\n");
-	if (!tok) {
-	  fatal_error ("Missing data on line %d\n", first);
-	}
-	v = atof (tok);
+  MALLOC (buf, char, e - s + 1);
+  memcpy (buf, s, e - s);
+  buf[e - s] = '\0';
 
-	if (first < 2 || (fabs(names[i]->v - v) >= 1e-6)) {
-	  atrace_signal_change (A, names[i], t, v);
-	}
-	tok = strtok (NULL, ",\n");
-	i++;
-      }
-      if (i != A_LEN (names)) {
-	fatal_error ("Missing data from line %d\n", first);
+  C->A = atrace_create (output, ATRACE_DELTA, 1e-9 /* 10ns */ , 1e-12 /* dt */);
+
+  tok = strtok_r (buf, ",\n", &save);
+
+  while (tok) {
+    char *nm, *tmp;
+    int l;
+    name_t *n;
+    nm = Strdup (tok);
+
+    l = strlen (nm);
+
+    tok = strtok_r (NULL, ",\n", &save);
+
+    if (!tok || strlen (tok) != l) {
+      printf ("[%s] [%s]\n", nm, tok ? tok : "");
+      fatal_error ("Assumed that names were `name X' `name Y' pairs\n");
+    }
+
+    if (l < 2 || nm[l-2] != ' ' || nm[l-1] != 'X' || tok[l-2] != ' ' || tok[l-1] != 'Y') {
+      printf ("[%s] [%s]\n", nm, tok);
+      fatal_error ("Names must be [<foo> X] and [<foo> Y]\n");
+    }
+    nm[l-2] = '\0';
+    tmp = name_convert (nm);
+    free (nm);
+    nm = tmp;
+
+    n = atrace_create_node (C->A, nm);
+    for (i=0; i < A_LEN (C->names); i++) {
+      if (C->names[i] == n) {
+	C->dups = 1;
       }
     }
-    first++;
+    A_NEW (C->names, name_t *);
+    A_NEXT (C->names) = n;
+    A_INC (C->names);
+
+    free (nm);
+    tok = strtok_r (NULL, ",\n", &save);
+  }
+  FREE (buf);
+
+  MALLOC (C->bn, name_t *, A_LEN (C->names) + 1);
+  MALLOC (C->bt, float, A_LEN (C->names) + 1);
+  MALLOC (C->bv, float, A_LEN (C->names) + 1);
+  C->lineno = 1;
+}
+
+static void csv_init (struct csv_state *C)
+{
+  int i, j;
+
+  C->A = NULL;
+  A_INIT (C->names);
+  C->dups = 0;
+  C->lineno = 0;
+  C->bn = NULL;
+  C->bt = NULL;
+  C->bv = NULL;
+  C->bnum = 0;
+
+  if (hs_threads < 1) {
+    long n = sysconf (_SC_NPROCESSORS_ONLN);
+    if (n > 8) n = 8;
+    hs_threads = (n < 1) ? 1 : n;
+  }
+  for (i=0; i < 2; i++) {
+    C->r[i].n = 0;
+    MALLOC (C->r[i].c, struct csv_chunk, hs_threads);
+    for (j=0; j < hs_threads; j++) {
+      A_INIT (C->r[i].c[j].val);
+    }
   }
+}
 
-  free (buf);
+static void csv_done (struct csv_state *C, double bytes, double start)
+{
+  int i, j;
 
-  if (first > 1) {
-    atrace_close (A);
+  if (C->A) {
+    atrace_close (C->A);
   }
+  if (hs_verbose) {
+    double tm = hs_time () - start;
+    printf ("Converted %d lines, %.1f MB in %.2f s (%.1f MB/s, %d thread%s)\n",
+	    C->lineno, bytes/1e6, tm, tm > 0 ? bytes/1e6/tm : 0.0,
+	    hs_threads, hs_threads == 1 ? "" : "s");
+  }
+  for (i=0; i < 2; i++) {
+    for (j=0; j < hs_threads; j++) {
+      A_FREE (C->r[i].c[j].val);
+    }
+    FREE (C->r[i].c);
+  }
+  A_FREE (C->names);
+  if (C->bn) {
+    FREE (C->bn);
+    FREE (C->bt);
+    FREE (C->bv);
+  }
+}
+
+void csv_convert (FILE *fp, const char *output)
+{
+  struct csv_state C;
+  struct stat st;
+  const char *s, *e, *t;
+  void *map;
+  double start;
+
+  start = hs_time ();
+  csv_init (&C);
+
+  if (fstat (fileno (fp), &st) != 0) {
+    fatal_error ("Could not stat input file");
+  }
+  map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno (fp), 0);
+  if (map == MAP_FAILED) {
+    fatal_error ("Could not map input file");
+  }
+#ifdef MADV_SEQUENTIAL
+  madvise (map, st.st_size, MADV_SEQUENTIAL);
+#endif
+  s = (const char *)map;
+  e = s + st.st_size;
+
+  t = (const char *) memchr (s, '\n', e - s);
+  if (!t) {
+    t = e;
+  }
+  csv_header (&C, output, s, t);
+  if (t < e) {
+    csv_lines (&C, t + 1, e, 1);
+  }
+  munmap (map, st.st_size);
+  csv_done (&C, st.st_size, start);
   exit (0);
 }
 
@@ -587,6 +981,10 @@ void raw_convert (FILE *fp, const char *output)
   int i;
   double *vals;
   A_DECL (int, skipvars);
+  float *bt, *bv;
+  double start, bytes;
+
+  start = hs_time ();
 
   MALLOC (buf, char, sz);
   buf[sz-1] = '\0';
@@ -629,14 +1027,14 @@ void raw_convert (FILE *fp, const char *output)
   A = atrace_create (output, ATRACE_DELTA, 1e-9 /* 10ns */ , 1e-12 /* dt */);
 
   atrace_filter (A, 0.01, 0.01); /* 1% change, 10mV change */
-  
+
   for (i=0; i < nvars; i++) {
     /* first line must be time */
     Assert (fgets (buf, sz, fp), "Hmm...");
     Assert (buf[sz-1] == '\0' && buf[strlen (buf)-1] == '\n', "Hmm");
 
     tok = strtok (buf, " \t");
- 
+
     Assert (atoi(tok) == i, "Hmm");
     tok = strtok (NULL, " \t");
 
@@ -661,7 +1059,7 @@ void raw_convert (FILE *fp, const char *output)
       else {
 	A_NEXT (skipvars) = 0;
       }
-      
+
       if (A_NEXT (skipvars) == 0) {
 	tmp = name_convert (nm);
 	A_NEW (names, name_t *);
@@ -678,30 +1076,47 @@ void raw_convert (FILE *fp, const char *output)
   if (strcmp (buf, "Binary:\n") != 0) {
     fatal_error ("Expecting `Binary:'");
   }
-  /* now read the file! */
+  /* now read the file, RAW_ROWS points at a time */
+
+#define RAW_ROWS 4096
 
-  MALLOC (vals, double, nvars);
+  MALLOC (vals, double, nvars*RAW_ROWS);
+  MALLOC (bt, float, A_LEN (names) + 1);
+  MALLOC (bv, float, A_LEN (names) + 1);
 
+  bytes = 0;
   while (!feof (fp)) {
     int x;
-    int j;
+    int j, r;
+    double *row;
 
-    x = fread (vals, sizeof (double), nvars, fp);
+    x = fread (vals, sizeof (double), nvars*RAW_ROWS, fp);
     if (x == 0) break;
-    if (x != nvars) {
+    if ((x % nvars) != 0) {
       fatal_error ("File format error");
     }
+    bytes += x*sizeof (double);
 
-    j = 0;
-    for (i=1; i < nvars; i++) {
-      if (skipvars[i]) {
-	continue;
+    for (row = vals, r = 0; r < x/nvars; r++, row += nvars) {
+      j = 0;
+      for (i=1; i < nvars; i++) {
+	if (skipvars[i]) {
+	  continue;
+	}
+	bt[j] = row[0];
+	bv[j] = row[i];
+	j++;
       }
-      atrace_signal_change (A, names[j], vals[0], vals[i]);
-      j++;
+      atrace_signal_changes (A, j, names, bt, bv);
+      lineno++;
     }
   }
   atrace_close (A);
+  if (hs_verbose) {
+    double tm = hs_time () - start;
+    printf ("Converted %d points, %.1f MB in %.2f s (%.1f MB/s)\n",
+	    lineno, bytes/1e6, tm, tm > 0 ? bytes/1e6/tm : 0.0);
+  }
   exit (0);
 }
 
@@ -709,113 +1124,74 @@ void raw_convert (FILE *fp, const char *output)
 
 #include <zlib.h>
 
+#define GZ_BLOCK (64 << 20)
+
 void zcsv_convert (const char *input, const char *output)
 {
-  atrace *A;
+  struct csv_state C;
   char *buf;
-  int sz = 10;
-  int first = 1;
-  A_DECL (name_t *, names);
-  char *tok;
+  const char *s, *t;
+  int sz, len, n, eof;
   gzFile gzf;
-  
+  double start, bytes;
+
+  start = hs_time ();
+
   gzf = gzopen (input, "rb");
   if (gzf == NULL) {
     fatal_error ("Could not open file `%s' for reading", input);
   }
+  gzbuffer (gzf, 1 << 20);
 
-  MALLOC (buf, char, sz);
-  buf[sz-1] = '\0';
+  csv_init (&C);
 
-  A_INIT (names);
-  
-  while (gzgets (gzf, buf, sz)) {
-    /* resize buffer if we didn't get the entire line */
-    while (buf[strlen(buf)-1] != '\n') {
-      int newsz = sz*2;
-
-      REALLOC (buf, char, newsz);
-      buf[newsz-1] = '\0';
-      Assert (gzgets (gzf, buf+sz-1, sz+1), "EOF without end of line?");
-      sz = newsz;
+  sz = GZ_BLOCK;
+  MALLOC (buf, char, sz);
+  len = 0;
+  eof = 0;
+  bytes = 0;
+
+  while (!eof) {
+    n = gzread (gzf, buf + len, sz - len);
+    if (n < 0) {
+      fatal_error ("Error reading `%s'", input);
     }
-    if (first == 1) {
-      /* get names */
-
-      A = atrace_create (output, ATRACE_DELTA, 1e-9 /* 10ns */ , 1e-12 /* dt */);
-
-      tok = strtok (buf, ",\n");
-
-      while (tok) {
-	char *nm, *tmp;
-	int l;
-	nm = Strdup (tok);
-	
-	l = strlen (nm);
-	
-	tok = strtok (NULL, ",\n");
-
-	if (strlen (tok) != l) {
-	  printf ("[%s] [%s]\n", nm, tok);
-	  fatal_error ("Assumed that names were `name X' `name Y' pairs\n");
-	}
-	
-	if (l < 2 || nm[l-2] != ' ' || nm[l-1] != 'X' || tok[l-2] != ' ' || tok[l-1] != 'Y') {
-	  printf ("[%s] [%s]\n", nm, tok);
-	  fatal_error ("Names must be [<foo> X] and [<foo> Y]\n");
-	}
-	nm[l-2] = '\0';
-	tmp = name_convert (nm);
-	free (nm);
-	nm = tmp;
-
-	A_NEW (names, name_t *);
-	A_NEXT (names) = atrace_create_node (A, nm);
-	A_INC (names);
-
-	free (nm);
-	tok = strtok (NULL, ",\n");
-      }
+    if (n == 0) {
+      eof = 1;
     }
-    else {
-      int i;
-
-      tok = strtok (buf, ",\n");
-
-      i = 0;
-      while (tok) {
-	float t, v; 
-	/* t,v pair */
-
-	if (i >= A_LEN (names)) {
-	  fatal_error ("Too much data on line %d\n", first);
-	}
-
-	t = atof (tok);
-	tok = strtok (NULL, ",\n");
-	if (!tok) {
-	  fatal_error ("Missing data on line %d\n", first);
-	}
-	v = atof (tok);
-
-	if (first < 2 || (fabs(names[i]->v - v) >= 1e-6)) {
-	  atrace_signal_change (A, names[i], t, v);
+    len += n;
+    bytes += n;
+
+    s = buf;
+    if (!C.A) {
+      t = (const char *) memchr (buf, '\n', len);
+      if (!t && !eof) {
+	/* header line does not fit */
+	if (len == sz) {
+	  sz *= 2;
+	  REALLOC (buf, char, sz);
 	}
-	tok = strtok (NULL, ",\n");
-	i++;
+	continue;
       }
-      if (i != A_LEN (names)) {
-	fatal_error ("Missing data from line %d\n", first);
+      if (!t) {
+	t = buf + len;
       }
+      csv_header (&C, output, buf, t);
+      s = (t < buf + len) ? t + 1 : t;
+    }
+    s = csv_lines (&C, s, buf + len, eof);
+
+    /* keep the partial line */
+    len = buf + len - s;
+    memmove (buf, s, len);
+    if (len == sz) {
+      sz *= 2;
+      REALLOC (buf, char, sz);
     }
-    first++;
-  }
-
-  free (buf);
-
-  if (first > 1) {
-    atrace_close (A);
   }
+  gzclose (gzf);
+  FREE (buf);
+  csv_done (&C, bytes, start);
   exit (0);
 }
 
@@ -844,22 +1220,32 @@ int main (int argc, char **argv)
   atrace *A;
 
   int raw_fmt = 0;
-
-  if (argc != 3 && argc != 4) {
-    fatal_error ("Usage: %s [-r] <tracefile> <atrace file>\n", argv[0]);
-  }
-  if (argc == 4) {
-    if (strcmp (argv[1], "-r") != 0) {
-      fatal_error ("Usage: %s [-r] <tracefile> <atrace file>\n", argv[0]);
+  int ch;
+
+  while ((ch = getopt (argc, argv, "rvj:")) != -1) {
+    switch (ch) {
+    case 'r':
+      raw_fmt = 1;
+      break;
+    case 'v':
+      hs_verbose = 1;
+      break;
+    case 'j':
+      hs_threads = atoi (optarg);
+      if (hs_threads < 1) {
+	fatal_error ("Usage: %s [-r] [-v] [-j threads] <tracefile> <atrace file>\n", argv[0]);
+      }
+      break;
+    default:
+      fatal_error ("Usage: %s [-r] [-v] [-j threads] <tracefile> <atrace file>\n", argv[0]);
+      break;
     }
-    raw_fmt = 1;
-    fileName = argv[2];
-    outfile = argv[3];
   }
-  else {
-    fileName = argv[1];
-    outfile = argv[2];
+  if (optind != argc-2) {
+    fatal_error ("Usage: %s [-r] [-v] [-j threads] <tracefile> <atrace file>\n", argv[0]);
   }
+  fileName = argv[optind];
+  outfile = argv[optind+1];
   
   f = fopen(fileName, "rb");	/* open file */
   if(f == NULL) {
@@ -28,6 +28,7 @@
 #include <ctype.h>
 #include <math.h>
 #include <time.h>
+#include <pthread.h>
 
 #include <sys/types.h>
 #include <regex.h>
@@ -67,6 +68,9 @@ double skip_initial_time;	/* no errors reported before this time
 
 double delta_t;			/* computed */
 
+int lint_threads;		/* 0 = time-major analysis, otherwise
+				   node-major with this many threads */
+
 
 char *prs_file_name;		/* prs file name */
 
@@ -121,6 +125,7 @@ static void usage (char *s)
   fprintf (stderr, "-o <digital> : digital trace file output\n");
   fprintf (stderr, "-p <prs> : validate against prs file (requires -o)\n");
   fprintf (stderr, "-r time : synchronize initial state with prs at <time> seconds\n");
+  fprintf (stderr, "-j num : analyze nodes independently using <num> threads\n");
   exit (1);
 }
 
@@ -163,6 +168,7 @@ static void display_options (void)
   printf ("\tfilter_results = `%s'\n", filter_results);
   printf ("\tskip_initial_time = `%g'\n", skip_initial_time);
   printf ("\treset_sync_time = `%g'\n", reset_sync_time);
+  printf ("\tthreads = %d\n", lint_threads);
   printf ("----\n");
 }
 
@@ -261,7 +267,7 @@ int main (int argc, char **argv)
   /* two pass getopt... that way any config file specified will be
      overridden by command line arguments */
 
-#define GETOPT_STRING "fvm:S:F:h:t:p:o:r:"
+#define GETOPT_STRING "fvm:S:F:h:t:p:o:r:j:"
 
   while ((ch = getopt (argc, eargv, GETOPT_STRING)) != -1) {
     switch (ch) {
@@ -299,6 +305,7 @@ int main (int argc, char **argv)
   hysteresis = config_get_real ("lint.hysteresis");
   skip_initial_time = config_get_real ("lint.skip_initial_time");
   reset_sync_time = config_get_real ("lint.reset_sync_time");
+  lint_threads = config_get_int ("lint.threads");
 
   if (config_exists ("net.mangle_string")) {
     act_global->mangle (config_get_string ("net.mangle_string"));
@@ -326,6 +333,12 @@ int main (int argc, char **argv)
     case 'r':
       sscanf (optarg, "%lg", &reset_sync_time);
       break;
+    case 'j':
+      lint_threads = atoi (optarg);
+      if (lint_threads < 0) {
+	usage (argv[0]);
+      }
+      break;
     case 'h':
       sscanf (optarg, "%lg", &hysteresis);
       break;
@@ -922,12 +935,796 @@ int is_reordered_buf (PrsNode *n, int val, double tm)
 }
 
 
+#define PREV 0
+#define EARLIER 1
+
+/*------------------------------------------------------------------------
+ *
+ *  Analysis of a single node change. This only touches the history of
+ *  node j, so nodes can be analyzed independently of each other.
+ *
+ *------------------------------------------------------------------------
+ */
+
+struct node_err {
+  int step, pos;		/* sample that produced the error */
+  int seq;			/* order within the sample */
+  enum err_type t;
+  int num;
+  double tm, val;
+};
+
+struct node_ev {
+  int step, pos;		/* sample that produced the event */
+  int num;			/* node */
+  int v;			/* new digital value */
+};
+
+struct node_log {
+  int step, pos;		/* current sample */
+  A_DECL (struct node_err, err);
+  A_DECL (struct node_ev, ev);
+};
+
+/*
+  Record an error: straight into the error log for the time-major
+  analysis (L == NULL), or into L to be merged later.
+*/
+static void log_err (struct node_log *L, enum err_type t, int num,
+		     double tm, double val)
+{
+  if (!L) {
+    add_err_log (t, num, tm, val);
+    return;
+  }
+  A_NEW (L->err, struct node_err);
+  A_NEXT (L->err).step = L->step;
+  A_NEXT (L->err).pos = L->pos;
+  A_NEXT (L->err).seq = A_LEN (L->err);
+  A_NEXT (L->err).t = t;
+  A_NEXT (L->err).num = num;
+  A_NEXT (L->err).tm = tm;
+  A_NEXT (L->err).val = val;
+  A_INC (L->err);
+}
+
+/*
+  Node j changed to analog value v at time curt; dig is the digital
+  value after hysteresis. Updates the history of the node, and
+  returns the value to be sent to the digital side (0/1) if the node
+  just left a valid digital value, -1 otherwise.
+
+  *special_shift is set by a transition so fast that it skipped X,
+  and then drops the earlier history of the node. The time-major
+  analysis keeps the flag for the rest of the time step, so it also
+  drops the history of the nodes that follow in the change list; the
+  node-major analysis can only apply it to the node itself, and
+  checks afterwards that this made no difference.
+*/
+static int analyze_change (node_info_t *ni, int j, float v, int dig,
+			   float curt, struct node_log *L,
+			   int *special_shift)
+{
+  int ret = -1;
+
+  if (dig == ni->hist_dig[PREV]) {
+    /* same old, nothing to do */
+    if (dig == -1) /* X */ {
+      if (v > ni->max_val)
+	ni->max_val = v;
+      if (v < ni->min_val)
+	ni->min_val = v;
+    }
+    return -1;
+  }
+
+  /* if v is X now, or if we don't have enough history, nothing
+     to do */
+  if (ni->hist_dig[EARLIER] != -2 && dig != -1) {
+    if (dig == ni->hist_dig[EARLIER]) {
+      float bump;
+      /* charge sharing! */
+      if (dig == 0) {
+	bump = ni->max_val;
+      }
+      else {
+	Assert (dig == 1, "Eh?");
+	bump = ni->min_val-Vdd;
+      }
+      if (fabs (bump) >= (Vdd/2)) {
+	if (!ni->skip)
+	  log_err (L, INCOMPLETE_TRANSITION, j, curt, bump);
+      }
+      else {
+	if (!ni->skip) {
+	  log_err (L, CHG_SHARING, j, curt, bump);
+	}
+      }
+    }
+    else {
+      double slew, aslew;
+
+      /* slew rate check */
+      if ((dig == 1 && ni->hist_dig[PREV] == 0) ||
+	  (dig == 0 && ni->hist_dig[PREV] == 1)) {
+	/* transition so fast we didn't go through X */
+	slew = (v - ni->hist_val[PREV])/((curt-ni->hist_tm[PREV])*1e9);
+
+	if (!ni->skip) {
+	  log_err (L, FAST_TRANSITION, j, curt, slew);
+	}
+	*special_shift = 1;
+      }
+      else if (dig == 0 || dig == 1) {
+	Assert (ni->hist_dig[PREV] == -1, "Hmm...");
+	Assert (ni->hist_dig[EARLIER] != dig, "Hmmmm.");
+	slew = (v - ni->hist_val[PREV])/(1e9*(curt-ni->hist_tm[PREV]));
+	aslew = fabs (slew);
+	if (aslew <= slewrate_slow_threshold) {
+	  if (!ni->skip) {
+	    log_err (L, SLOW_TRANSITION, j, ni->hist_tm[PREV], slew);
+	  }
+	}
+	if (aslew >= slewrate_fast_threshold) {
+	  if (!ni->skip) {
+	    log_err (L, FAST_TRANSITION, j, ni->hist_tm[PREV], slew);
+	  }
+	}
+      }
+    }
+  }
+
+  if (ni->hist_dig[PREV] == 0 && dig == -1) {
+    /* 0 -> X */
+    ret = 1;
+  }
+  else if (ni->hist_dig[PREV] == 1 && dig == -1) {
+    /* 1 -> X */
+    ret = 0;
+  }
+
+  /* shift it over */
+  ni->hist_val[EARLIER] = ni->hist_val[PREV];
+  ni->hist_tm[EARLIER] = ni->hist_tm[PREV];
+  ni->hist_dig[EARLIER] = ni->hist_dig[PREV];
+
+  ni->hist_val[PREV] = v;
+  ni->hist_tm[PREV] = curt;
+  ni->hist_dig[PREV] = dig;
+
+  if (*special_shift) {
+    ni->hist_dig[EARLIER] = -2;
+  }
+
+  if (dig == -1) { /* it's X now---reset max/min */
+    ni->max_val = ni->min_val = ni->hist_val[PREV];
+  }
+  else {
+    if (ni->tm_first_nonX == -2) {
+      ni->tm_first_nonX = -1;
+    }
+    else {
+      if (ni->tm_first_nonX == -1) {
+	ni->first_nonX = dig;
+	ni->tm_first_nonX = curt;
+	ni->tm_last_nonX = curt;
+	ni->count = 0;
+      }
+      else if (ni->first_nonX == dig) {
+	ni->tm_last_nonX = curt;
+	ni->count++;
+      }
+    }
+  }
+  return ret;
+}
+
+/*------------------------------------------------------------------------
+ *
+ *  Digital side: prsim time keeping and reset synchronization
+ *
+ *------------------------------------------------------------------------
+ */
+static void prs_step_begin (Prs *p, int i)
+{
+  int ii;
+
+  if (!p) return;
+
+  if (p->time != i-1) {
+    printf ("time not consistent?!\n");
+  }
+
+  /* push everything on the prsim heap forward one time unit! */
+  for (ii=0; ii < p->eventQueue->sz; ii++) {
+    p->eventQueue->key[ii]++;
+  }
+}
+
+static void prs_step_end (Prs *p)
+{
+  int ii;
+
+  if (!p) return;
+
+  p->time++;
+  for (ii=0; ii < p->eventQueue->sz; ii++) {
+    if (p->eventQueue->key[ii] <= (1+p->time)) {
+      break;
+    }
+  }
+  if (ii != p->eventQueue->sz) {
+    for (ii=0; ii < p->eventQueue->sz; ii++) {
+      p->eventQueue->key[ii]++;
+    }
+  }
+}
+
+static void digital_change (atrace *a, atrace *new_a, Prs *p,
+			    node_info_t *n, int j, int i, int v)
+{
+  if (verbose > 2) {
+    printf ("[%.4g] change from %d, signal %s\n", i*a->dt*1e9, 1-v,
+	    ATRACE_GET_NAME(a, j));
+  }
+  process_signal_change (new_a, p, &n[j], i*a->dt, v);
+}
+
+/*
+  Verify that the prs state matches the analog values. vals[] holds
+  the value of each node, or is NULL to use the current trace values.
+*/
+static void reset_sync (atrace *a, Prs *p, node_info_t *n, int Nnodes,
+			float *vals)
+{
+  int j, v;
+
+  for (j=0; j < Nnodes; j++) {
+    if (n[j].skip) continue;
+    if (n[j].pn) {
+      v = raw_analog2digital (vals ? vals[j] : a->N[j]->v);
+      if (n[j].pn->val == PRS_VAL_X) {
+	if (v == 0) {
+	  prs_set_node (p, n[j].pn, PRS_VAL_F);
+	  prs_step_cause (p, NULL, NULL);
+	}
+	else if (v == 1) {
+	  prs_set_node (p, n[j].pn, PRS_VAL_T);
+	  prs_step_cause (p, NULL, NULL);
+	}
+      }
+      if (v == 1) {
+	if (n[j].pn->val != PRS_VAL_T) {
+	  printf (" *** initialization error: %s should be 1 (is %c)\n",
+		  prs_nodename (p, n[j].pn), prs_nodechar (n[j].pn->val));
+	}
+      }
+      else if (v == 0) {
+	if (n[j].pn->val != PRS_VAL_F) {
+	  printf (" *** initialization error: %s should be 0 (is %c)\n",
+		  prs_nodename (p, n[j].pn), prs_nodechar (n[j].pn->val));
+	}
+      }
+      else {
+	if (n[j].pn->val != PRS_VAL_X) {
+	  printf (" *** initialization error: %s should be X (is %c)\n",
+		  prs_nodename (p, n[j].pn), prs_nodechar (n[j].pn->val));
+	}
+      }
+    }
+  }
+}
+
+
+/*------------------------------------------------------------------------
+ *
+ *  Time-major analysis: walk the trace one step at a time, updating
+ *  analog and digital state together.
+ *
+ *------------------------------------------------------------------------
+ */
+static void time_major_errs (atrace *a, node_info_t *n, int Nnodes,
+			     int Nsteps, Prs *p, atrace *new_a)
+{
+  int i, j, d;
+  double tm;
+  char buf[1024];
+
+  tm = cputime_msec ();
+
+  buf[0] = '\0';
+  for (i=1; i < Nsteps; i++) {
+    name_t *nm;
+    int special_shift = 0;
+
+    if (verbose > 2) {
+    if ((i % 5000) == 0) {
+      int kk;
+      for (kk=0; kk < strlen (buf); kk++) {
+	printf ("\b \b");
+      }
+      fflush (stdout);
+      tm += cputime_msec();
+      sprintf (buf, "Est. total time: %6.3g mins. [%4.2g%% done]..", tm/1000.0/i/60.0*Nsteps, (i+0.0)/Nsteps*100.0);
+      printf ("%s", buf);
+      fflush (stdout);
+    }
+    }
+
+    if (i == (int) (reset_sync_time/a->dt)) {
+      reset_sync (a, p, n, Nnodes, NULL);
+    }
+
+    if (a->curt < 0) break;
+    atrace_advance_time (a, 1);
+
+    prs_step_begin (p, i);
+
+    for (nm = a->hd_chglist; nm; nm = nm->chg_next) {
+      j = nm->idx;
+
+      if (n[j].hist_val[PREV] == nm->v) {
+	continue;
+      }
+      d = analyze_change (&n[j], j, nm->v,
+			  analog2digital (nm->v, n[j].hist_dig[PREV]),
+			  a->curt, NULL, &special_shift);
+      if (d != -1) {
+	digital_change (a, new_a, p, n, j, i, d);
+      }
+    }
+
+    prs_step_end (p);
+  }
+  if (verbose) {
+    int kk;
+    for (kk=0; kk < strlen (buf); kk++) {
+      printf ("\b \b");
+    }
+    fflush (stdout);
+  }
+}
+
+
+/*------------------------------------------------------------------------
+ *
+ *  Node-major analysis.
+ *
+ *  The trace is read in passes. Each pass gathers the samples that
+ *  the time-major analysis would look at for a batch of nodes,
+ *  holding at most NM_MAX_SAMPLES of them. Each node's waveform is
+ *  then analyzed on its own (in parallel across nodes), and only the
+ *  errors and the digital events are merged back in time order.
+ *
+ *  A transition that skips X also drops the history of the nodes
+ *  that change after it in the same time step (see analyze_change()),
+ *  which a node on its own can't see. If that happens, the results
+ *  are thrown away and the time-major analysis is run instead; so the
+ *  result is always identical to the time-major analysis.
+ *
+ *------------------------------------------------------------------------
+ */
+struct wave_at {
+  int step, pos;		/* time step, position in the change list */
+};
+
+struct node_wave {
+  float last;			/* last value recorded */
+  A_DECL (float, v);
+  A_DECL (struct wave_at, at);
+};
+
+struct lint_worker {
+  pthread_t th;
+  struct node_log L;
+  A_DECL (struct wave_at, shift); /* transitions that skipped X */
+  A_DECL (struct wave_at, moved); /* changes of digital value */
+  signed char *cls, *stable;	/* scratch for classify() */
+  int max;
+};
+
+static node_info_t *nm_info;
+static struct node_wave *nm_wave;
+static float *nm_steptm;
+static int nm_nodes;
+static int nm_next;
+static pthread_mutex_t nm_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define NM_CHUNK 16
+
+/* samples held in memory at once, unless a single node has more */
+#define NM_MAX_SAMPLES (1 << 24)
+
+/*
+  Read the trace, collecting the samples that differ from the
+  previous one for nodes first..*end-1. If they don't fit in
+  NM_MAX_SAMPLES, the batch is cut short by lowering *end. Returns the
+  last step read.
+*/
+static int load_waves (atrace *a, node_info_t *n, int first, int *end,
+		       int Nnodes, int Nsteps, float *snap, int *synced)
+{
+  int i, j, pos, last;
+  long total;
+  name_t *nm;
+
+  for (j=first; j < *end; j++) {
+    nm_wave[j].last = n[j].hist_val[PREV];
+    A_INIT (nm_wave[j].v);
+    A_INIT (nm_wave[j].at);
+  }
+  total = 0;
+
+  *synced = 0;
+  last = 0;
+  for (i=1; i < Nsteps; i++) {
+    if (i == (int) (reset_sync_time/a->dt)) {
+      for (j=0; j < Nnodes; j++) {
+	snap[j] = a->N[j]->v;
+      }
+      *synced = 1;
+    }
+
+    if (a->curt < 0) break;
+    atrace_advance_time (a, 1);
+
+    nm_steptm[i] = a->curt;
+    /* positions in the change list order the samples of one step
+       the same way in every pass */
+    pos = 0;
+    for (nm = a->hd_chglist; nm; nm = nm->chg_next, pos++) {
+      struct node_wave *w;
+
+      if (nm->idx < first || nm->idx >= *end) {
+	continue;
+      }
+      w = &nm_wave[nm->idx];
+      if (w->last == nm->v) {
+	continue;
+      }
+      w->last = nm->v;
+      A_NEW (w->v, float);
+      A_NEXT (w->v) = nm->v;
+      A_INC (w->v);
+      A_NEW (w->at, struct wave_at);
+      A_NEXT (w->at).step = i;
+      A_NEXT (w->at).pos = pos;
+      A_INC (w->at);
+      total++;
+    }
+    while (total > NM_MAX_SAMPLES && *end - first > 1) {
+      (*end)--;
+      total -= A_LEN (nm_wave[*end].v);
+      A_FREE (nm_wave[*end].v);
+      A_FREE (nm_wave[*end].at);
+    }
+    last = i;
+  }
+  return last;
+}
+
+/*
+  Threshold classification of a waveform: raw_analog2digital() of
+  each sample, and whether the hysteresis band around the sample
+  falls in a single region. Branch-free so that it vectorizes.
+*/
+static void classify (const float *v, int len, signed char *cls,
+		      signed char *stable)
+{
+  const double lo = V_low, hi = V_high, h = hysteresis;
+  int k;
+
+#define CLASS(x) (((x) >= hi & !((x) <= lo)) - (!((x) <= lo) & !((x) >= hi)))
+
+  for (k=0; k < len; k++) {
+    double x = v[k];
+    cls[k] = CLASS (x);
+    stable[k] = (CLASS (x - h) == CLASS (x + h));
+  }
+#undef CLASS
+}
+
+static void analyze_wave (struct lint_worker *W, int j)
+{
+  struct node_wave *w = &nm_wave[j];
+  node_info_t *ni = &nm_info[j];
+  int k, d, last;
+  int special_shift;
+
+  if (A_LEN (w->v) == 0) return;
+
+  if (A_LEN (w->v) > W->max) {
+    if (W->max > 0) {
+      FREE (W->cls);
+      FREE (W->stable);
+    }
+    W->max = A_LEN (w->v);
+    MALLOC (W->cls, signed char, W->max);
+    MALLOC (W->stable, signed char, W->max);
+  }
+  classify (w->v, A_LEN (w->v), W->cls, W->stable);
+
+  for (k=0; k < A_LEN (w->v); k++) {
+    /* analog2digital() with hysteresis */
+    last = ni->hist_dig[PREV];
+    if (W->cls[k] == last || W->stable[k]) {
+      last = W->cls[k];
+    }
+    W->L.step = w->at[k].step;
+    W->L.pos = w->at[k].pos;
+    if (last != ni->hist_dig[PREV]) {
+      A_NEW (W->moved, struct wave_at);
+      A_NEXT (W->moved) = w->at[k];
+      A_INC (W->moved);
+    }
+    special_shift = 0;
+    d = analyze_change (ni, j, w->v[k], last, nm_steptm[W->L.step], &W->L,
+			&special_shift);
+    if (special_shift) {
+      A_NEW (W->shift, struct wave_at);
+      A_NEXT (W->shift) = w->at[k];
+      A_INC (W->shift);
+    }
+    if (d != -1) {
+      A_NEW (W->L.ev, struct node_ev);
+      A_NEXT (W->L.ev).step = W->L.step;
+      A_NEXT (W->L.ev).pos = W->L.pos;
+      A_NEXT (W->L.ev).num = j;
+      A_NEXT (W->L.ev).v = d;
+      A_INC (W->L.ev);
+    }
+  }
+  A_FREE (w->v);
+  A_FREE (w->at);
+}
+
+static void *lint_worker (void *arg)
+{
+  struct lint_worker *W = (struct lint_worker *)arg;
+  int j, end;
+
+  while (1) {
+    pthread_mutex_lock (&nm_lock);
+    j = nm_next;
+    nm_next += NM_CHUNK;
+    pthread_mutex_unlock (&nm_lock);
+
+    if (j >= nm_nodes) break;
+    end = j + NM_CHUNK;
+    if (end > nm_nodes) {
+      end = nm_nodes;
+    }
+    for (; j < end; j++) {
+      analyze_wave (W, j);
+    }
+  }
+  return NULL;
+}
+
+static int err_cmp (const void *a, const void *b)
+{
+  const struct node_err *x = (const struct node_err *)a;
+  const struct node_err *y = (const struct node_err *)b;
+
+  if (x->step != y->step) return x->step < y->step ? -1 : 1;
+  if (x->pos != y->pos) return x->pos < y->pos ? -1 : 1;
+  return x->seq - y->seq;
+}
+
+static int ev_cmp (const void *a, const void *b)
+{
+  const struct node_ev *x = (const struct node_ev *)a;
+  const struct node_ev *y = (const struct node_ev *)b;
+
+  if (x->step != y->step) return x->step < y->step ? -1 : 1;
+  return x->pos - y->pos;
+}
+
+static int at_cmp (const void *a, const void *b)
+{
+  const struct wave_at *x = (const struct wave_at *)a;
+  const struct wave_at *y = (const struct wave_at *)b;
+
+  if (x->step != y->step) return x->step < y->step ? -1 : 1;
+  return x->pos - y->pos;
+}
+
+/*
+  Returns 1 if no node changed its digital value after a transition
+  that skipped X in the same time step, so that the node-major
+  analysis matches the time-major one.
+*/
+static int node_major_exact (struct lint_worker *W)
+{
+  A_DECL (struct wave_at, shift);
+  A_DECL (struct wave_at, moved);
+  int i, k, s, ok;
+
+  A_INIT (shift);
+  A_INIT (moved);
+  for (i=0; i < lint_threads; i++) {
+    for (k=0; k < A_LEN (W[i].shift); k++) {
+      A_NEW (shift, struct wave_at);
+      A_NEXT (shift) = W[i].shift[k];
+      A_INC (shift);
+    }
+    for (k=0; k < A_LEN (W[i].moved); k++) {
+      A_NEW (moved, struct wave_at);
+      A_NEXT (moved) = W[i].moved[k];
+      A_INC (moved);
+    }
+  }
+  ok = 1;
+  if (A_LEN (shift) > 0) {
+    qsort (shift, A_LEN (shift), sizeof (struct wave_at), at_cmp);
+    qsort (moved, A_LEN (moved), sizeof (struct wave_at), at_cmp);
+    /* the first transition in each step that skipped X is the one
+       that matters */
+    s = 0;
+    for (k=0; ok && k < A_LEN (moved); k++) {
+      while (s < A_LEN (shift) && shift[s].step < moved[k].step) {
+	s++;
+      }
+      if (s < A_LEN (shift) && shift[s].step == moved[k].step &&
+	  shift[s].pos < moved[k].pos) {
+	ok = 0;
+      }
+    }
+  }
+  A_FREE (shift);
+  A_FREE (moved);
+  return ok;
+}
+
+static void node_major_errs (atrace *a, node_info_t *n, int Nnodes,
+			     int Nsteps, Prs *p, atrace *new_a)
+{
+  struct lint_worker *W;
+  node_info_t *orig;
+  float *snap;
+  int synced, last;
+  int i, k, e, first, end;
+  A_DECL (struct node_err, errs);
+  A_DECL (struct node_ev, evs);
+
+  MALLOC (nm_wave, struct node_wave, Nnodes);
+  MALLOC (nm_steptm, float, Nsteps);
+  MALLOC (snap, float, Nnodes);
+  MALLOC (orig, node_info_t, Nnodes);
+  for (i=0; i < Nnodes; i++) {
+    orig[i] = n[i];
+  }
+  nm_info = n;
+
+  MALLOC (W, struct lint_worker, lint_threads);
+  for (i=0; i < lint_threads; i++) {
+    A_INIT (W[i].L.err);
+    A_INIT (W[i].L.ev);
+    A_INIT (W[i].shift);
+    A_INIT (W[i].moved);
+    W[i].max = 0;
+  }
+
+  last = 0;
+  for (first = 0; first < Nnodes; first = end) {
+    if (first > 0) {
+      atrace_rewind_time (a);
+    }
+    end = Nnodes;
+    last = load_waves (a, n, first, &end, Nnodes, Nsteps, snap, &synced);
+    if (verbose > 1 && (first > 0 || end < Nnodes)) {
+      printf ("Analyzing nodes %d..%d\n", first, end-1);
+    }
+
+    nm_next = first;
+    nm_nodes = end;
+    if (lint_threads == 1) {
+      lint_worker (&W[0]);
+    }
+    else {
+      for (i=0; i < lint_threads; i++) {
+	if (pthread_create (&W[i].th, NULL, lint_worker, &W[i]) != 0) {
+	  fatal_error ("Could not create thread.");
+	}
+      }
+      for (i=0; i < lint_threads; i++) {
+	pthread_join (W[i].th, NULL);
+      }
+    }
+  }
+
+  if (!node_major_exact (W)) {
+    /* start over, one step at a time */
+    if (verbose > 1) {
+      printf ("Transitions that skip X affect other nodes; using the time-major analysis\n");
+    }
+    for (i=0; i < lint_threads; i++) {
+      A_FREE (W[i].L.err);
+      A_FREE (W[i].L.ev);
+      A_FREE (W[i].shift);
+      A_FREE (W[i].moved);
+      if (W[i].max > 0) {
+	FREE (W[i].cls);
+	FREE (W[i].stable);
+      }
+    }
+    FREE (W);
+    for (i=0; i < Nnodes; i++) {
+      n[i] = orig[i];
+    }
+    FREE (orig);
+    FREE (snap);
+    FREE (nm_steptm);
+    FREE (nm_wave);
+    atrace_rewind_time (a);
+    time_major_errs (a, n, Nnodes, Nsteps, p, new_a);
+    return;
+  }
+  FREE (orig);
+
+  /* merge the per-thread logs */
+  A_INIT (errs);
+  A_INIT (evs);
+  for (i=0; i < lint_threads; i++) {
+    for (k=0; k < A_LEN (W[i].L.err); k++) {
+      A_NEW (errs, struct node_err);
+      A_NEXT (errs) = W[i].L.err[k];
+      A_INC (errs);
+    }
+    for (k=0; k < A_LEN (W[i].L.ev); k++) {
+      A_NEW (evs, struct node_ev);
+      A_NEXT (evs) = W[i].L.ev[k];
+      A_INC (evs);
+    }
+    A_FREE (W[i].L.err);
+    A_FREE (W[i].L.ev);
+    A_FREE (W[i].shift);
+    A_FREE (W[i].moved);
+    if (W[i].max > 0) {
+      FREE (W[i].cls);
+      FREE (W[i].stable);
+    }
+  }
+  FREE (W);
+  if (A_LEN (errs) > 0) {
+    qsort (errs, A_LEN (errs), sizeof (struct node_err), err_cmp);
+  }
+  if (A_LEN (evs) > 0) {
+    qsort (evs, A_LEN (evs), sizeof (struct node_ev), ev_cmp);
+  }
+
+  for (k=0; k < A_LEN (errs); k++) {
+    add_err_log (errs[k].t, errs[k].num, errs[k].tm, errs[k].val);
+  }
+
+  /* replay the digital events in time order */
+  e = 0;
+  for (i=1; i < Nsteps; i++) {
+    if (synced && i == (int) (reset_sync_time/a->dt)) {
+      reset_sync (a, p, n, Nnodes, snap);
+    }
+    if (i > last) break;
+
+    prs_step_begin (p, i);
+    for (; e < A_LEN (evs) && evs[e].step == i; e++) {
+      digital_change (a, new_a, p, n, evs[e].num, i, evs[e].v);
+    }
+    prs_step_end (p);
+  }
+
+  A_FREE (errs);
+  A_FREE (evs);
+  FREE (snap);
+  FREE (nm_steptm);
+  FREE (nm_wave);
+}
+
+
 static void compute_errs (atrace *a, int Nnodes, int Nsteps)
 {
-  int i, j;
+  int i;
   node_info_t *n;
   int idx = 0;
-  double tm;
   char buf[10240];
   atrace *new_a = NULL;
   Prs *p = NULL;
@@ -1003,9 +1800,6 @@ static void compute_errs (atrace *a, int Nnodes, int Nsteps)
   }
 
 
-#define PREV 0
-#define EARLIER 1
-
   for (i=0; i < Nnodes; i++) {
     n[i].hist_val[PREV] = a->N[i]->v;
     n[i].hist_tm[PREV] = 0;
@@ -1035,8 +1829,6 @@ static void compute_errs (atrace *a, int Nnodes, int Nsteps)
     }
   }
 
-  tm = cputime_msec ();
-
   if (p) {
     PrsNode *pn;
     int cnt = 0;
@@ -1060,243 +1852,13 @@ static void compute_errs (atrace *a, int Nnodes, int Nsteps)
     p->time = 0;
   }
 
-  buf[0] = '\0';
-  for (i=1; i < Nsteps; i++) {
-    name_t *nm;
-    int special_shift;
-
-    special_shift = 0;
-
-    if (verbose > 2) {
-    if ((i % 5000) == 0) {
-      int kk;
-      for (kk=0; kk < strlen (buf); kk++) {
-	printf ("\b \b");
-      }
-      fflush (stdout);
-      tm += cputime_msec();
-      sprintf (buf, "Est. total time: %6.3g mins. [%4.2g%% done]..", tm/1000.0/i/60.0*Nsteps, (i+0.0)/Nsteps*100.0);
-      printf ("%s", buf);
-      fflush (stdout);
-    }
-    }
-
-    if (i == (int) (reset_sync_time/a->dt)) {
-      /* verify that all nodes match */
-      for (j=0; j < Nnodes; j++) {
-	int v;
-	if (n[j].skip) continue;
-	if (n[j].pn) {
-	  if (n[j].pn->val == PRS_VAL_X) {
-	    v = raw_analog2digital (a->N[j]->v);
-	    if (v == 0) {
-	      prs_set_node (p, n[j].pn, PRS_VAL_F);
-	      prs_step_cause (p, NULL, NULL);
-	    }
-	    else if (v == 1) {
-	      prs_set_node (p, n[j].pn, PRS_VAL_T);
-	      prs_step_cause (p, NULL, NULL);
-	    }
-	  }
-	  if (raw_analog2digital (a->N[j]->v) == 1) {
-	    if (n[j].pn->val != PRS_VAL_T) {
-	      printf (" *** initialization error: %s should be 1 (is %c)\n", 
-		      prs_nodename (p, n[j].pn), prs_nodechar (n[j].pn->val));
-	    }
-	  }
-	  else if (raw_analog2digital (a->N[j]->v) == 0) {
-	    if (n[j].pn->val != PRS_VAL_F) {
-		printf (" *** initialization error: %s should be 0 (is %c)\n", 
-			prs_nodename (p, n[j].pn), prs_nodechar (n[j].pn->val));
-	    }
-	  }
-	  else {
-	    if (n[j].pn->val != PRS_VAL_X) {
-	      printf (" *** initialization error: %s should be X (is %c)\n", 
-		      prs_nodename (p, n[j].pn), prs_nodechar (n[j].pn->val));
-	    }
-	  }
-	}
-      }
-    }
-
-    if (a->curt < 0) break;
-    atrace_advance_time (a, 1);
-
-    if (p) {
-      if (p->time != i-1) {
-	printf ("time not consistent?!\n");
-      }
-
-      /* push everything on the prsim heap forward one time unit! */
-      {
-	int ii;
-	for (ii=0; ii < p->eventQueue->sz; ii++) {
-	  p->eventQueue->key[ii]++;
-	}
-      }
-    }
-
-    nm = a->hd_chglist;
-    while (nm) {
-      int v;
-
-      j = nm->idx;
-
-      /*if (n[j].skip) {
-	goto next;
-	}
-      */
-
-      if (n[j].hist_val[PREV] == nm->v) {
-	goto next;
-      }
-
-      v = analog2digital (nm->v, n[j].hist_dig[PREV]);
-      
-      if (v != n[j].hist_dig[PREV]) {
-	/* if v is X now, or if we don't have enough history, nothing
-	   to do */
-	if (n[j].hist_dig[EARLIER] != -2 && v != -1) {
-	  if (v == n[j].hist_dig[EARLIER]) {
-	    float bump;
-	    /* charge sharing! */
-	    if (v == 0) {
-	      bump = n[j].max_val;
-	    }
-	    else {
-	      Assert (v == 1, "Eh?");
-	      bump = n[j].min_val-Vdd;
-	    }
-	    if (fabs (bump) >= (Vdd/2)) {
-	      if (!n[j].skip)
-		add_err_log (INCOMPLETE_TRANSITION, j, a->curt, bump);
-	    }
-	    else {
-	      if (!n[j].skip) {
-		add_err_log (CHG_SHARING, j, a->curt, bump);
-	      }
-	    }
-	  }
-	  else {
-	    double slew, aslew;
-
-
-	    /* slew rate check */
-	    if ((v == 1 && n[j].hist_dig[PREV] == 0) ||
-		(v == 0 && n[j].hist_dig[PREV] == 1)) {
-	      /* transition so fast we didn't go through X */
-	      slew = (nm->v - n[j].hist_val[PREV])/((a->curt-n[j].hist_tm[PREV])*1e9);
-
-	      if (!n[j].skip) {
-		add_err_log (FAST_TRANSITION, j, a->curt, slew);
-	      }
-	      special_shift = 1;
-	    }
-	    else if (v == 0 || v == 1) {
-	      Assert (n[j].hist_dig[PREV] == -1, "Hmm...");
-	      Assert (n[j].hist_dig[EARLIER] != v, "Hmmmm.");
-	      slew = (nm->v - n[j].hist_val[PREV])/(1e9*(a->curt-n[j].hist_tm[PREV]));
-	      aslew = fabs (slew);
-	      if (aslew <= slewrate_slow_threshold) {
-		if (!n[j].skip) {
-		  add_err_log (SLOW_TRANSITION, j, n[j].hist_tm[PREV], slew);
-		}
-	      }
-	      if (aslew >= slewrate_fast_threshold) {
-		if (!n[j].skip) {
-		  add_err_log (FAST_TRANSITION, j, n[j].hist_tm[PREV], slew);
-		}
-	      }
-	    }
-	  }
-	}
-
-	if (n[j].hist_dig[PREV] != v) {
-	  if (n[j].hist_dig[PREV] == 0 && v == -1) {
-	    if (verbose > 2) {
-	      printf ("[%.4g] change from 0, signal %s\n", i*a->dt*1e9, ATRACE_GET_NAME(a, j));
-	    }
-	    /* 0 -> X */
-	    process_signal_change (new_a, p, &n[j], i*a->dt, 1);
-	  }
-	  else if (n[j].hist_dig[PREV] == 1 && v == -1) {
-	    if (verbose > 2) {
-	      printf ("[%.4g] change from 1, signal %s\n", i*a->dt*1e9, ATRACE_GET_NAME(a, j));
-	    }
-	    /* 1 -> X */
-	    process_signal_change (new_a, p, &n[j], i*a->dt, 0);
-	  }
-	}
-
-	/* shift it over */
-	n[j].hist_val[EARLIER] = n[j].hist_val[PREV];
-	n[j].hist_tm[EARLIER] = n[j].hist_tm[PREV];
-	n[j].hist_dig[EARLIER] = n[j].hist_dig[PREV];
-
-	n[j].hist_val[PREV] = nm->v;
-	n[j].hist_tm[PREV] = a->curt;
-	n[j].hist_dig[PREV] = v;
-
-	if (special_shift) {
-	  n[j].hist_dig[EARLIER] = -2;
-	}
-	
-	if (v == -1) { /* it's X now---reset max/min */
-	  n[j].max_val = n[j].min_val = n[j].hist_val[PREV];
-	}
-	else {
-	  if (n[j].tm_first_nonX == -2) {
-	    n[j].tm_first_nonX = -1;
-	  }
-	  else {
-	    if (n[j].tm_first_nonX == -1) {
-	      n[j].first_nonX = v;
-	      n[j].tm_first_nonX = a->curt;
-	      n[j].tm_last_nonX = a->curt;
-	      n[j].count = 0;
-	    }
-	    else if (n[j].first_nonX == v) {
-	      n[j].tm_last_nonX = a->curt;
-	      n[j].count++;
-	    }
-	  }
-	}
-      }
-      else {
-	/* same old, nothing to do */
-	if (v == -1) /* X */ {
-	  if (nm->v > n[j].max_val)
-	    n[j].max_val = nm->v;
-	  if (nm->v < n[j].min_val)
-	    n[j].min_val = nm->v;
-	}
-      }
-    next:
-      nm = nm->chg_next;
-    }
-    if (p) {
-      int ii;
-      p->time++;
-      for (ii=0; ii < p->eventQueue->sz; ii++) {
-	if (p->eventQueue->key[ii] <= (1+p->time)) {
-	  break;
-	}
-      }
-      if (ii != p->eventQueue->sz) {
-	for (ii=0; ii < p->eventQueue->sz; ii++) {
-	  p->eventQueue->key[ii]++;
-	}
-      }
-    }
+  if (lint_threads > 0) {
+    node_major_errs (a, n, Nnodes, Nsteps, p, new_a);
   }
-  if (verbose) {
-    int kk;
-    for (kk=0; kk < strlen (buf); kk++) {
-      printf ("\b \b");
-    }
-    fflush (stdout);
+  else {
+    time_major_errs (a, n, Nnodes, Nsteps, p, new_a);
   }
+
   for (i=0; i < Nnodes; i++) {
     double my_cycle_time;
     if (n[i].skip) continue;
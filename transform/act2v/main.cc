@@ -188,22 +188,19 @@ void emit_verilog (Act *a, Process *p)
 
   printf ("\n// -- signals ---\n");
   int i;
-  ihash_bucket_t *b;
-  for (i=0; i < n->cH->size; i++) {
-    for (b = n->cH->head[i]; b; b = b->next) {
-      act_booleanized_var_t *v = (act_booleanized_var_t *)b->v;
-      if (!v->used) continue;
-      if (v->id->isglobal()) continue;
-
-      if (v->input && !v->output) {
-	printf ("   wire ");
-      }
-      else {
-	printf ("   reg ");
-      }
-      emit_verilog_id (v->id);
-      printf (";\n");
+  for (i=0; i < A_LEN (n->vars); i++) {
+    act_booleanized_var_t *v = &n->vars[i];
+    if (!v->used) continue;
+    if (v->id->isglobal()) continue;
+
+    if (v->input && !v->output) {
+      printf ("   wire ");
+    }
+    else {
+      printf ("   reg ");
     }
+    emit_verilog_id (v->id);
+    printf (";\n");
   }
 
   int iport = 0;
@@ -312,9 +309,13 @@ int main (int argc, char **argv)
   }
   
   a = new Act (argv[1]);
-  a->Expand ();
 
-  Process *p = a->findProcess (proc);
+  /* expand only what the requested process needs */
+  Process *p = a->Expand (proc);
+  if (!p) {
+    a->Expand ();
+    p = a->findProcess (proc);
+  }
 
   if (!p) {
     fatal_error ("Could not find process `%s' in file `%s'", proc, argv[1]);
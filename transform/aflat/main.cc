@@ -58,6 +58,7 @@ static void print_connect()
 #define EXTRA_ARGS  NULL, (export_format == LVS_FMT ? 1 : 0)
 
 static ActId *current_prefix = NULL;
+static char *current_prefix_str = NULL; /* current_prefix, printed */
 
 static void prefix_id_print (Scope *s, ActId *id, const char *str = "")
 {
@@ -65,7 +66,7 @@ static void prefix_id_print (Scope *s, ActId *id, const char *str = "")
   if (s->Lookup (id, 0)) {
     if (current_prefix) {
       if (id->getName()[0] != ':') {
-	current_prefix->Print (stdout);
+	fputs (current_prefix_str, stdout);
 	printf (".");
       }
     }
@@ -571,11 +572,20 @@ void aflat_body (void *cookie, ActId *prefix, Process *p)
 {
   Assert (p->isExpanded(), "What?");
   current_prefix = prefix;
+  if (prefix) {
+    char buf[10240];
+    prefix->sPrint (buf, 10240);
+    current_prefix_str = Strdup (buf);
+  }
   if (labels) {
     hash_clear (labels);
   }
   aflat_dump (p->CurScope(), p->getprs(), p->getspec());
   current_prefix = NULL;
+  if (current_prefix_str) {
+    FREE (current_prefix_str);
+    current_prefix_str = NULL;
+  }
 }
 
 ActApplyPass *gpass;
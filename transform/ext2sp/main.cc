@@ -20,9 +20,11 @@
  **************************************************************************
  */
 #include <stdio.h>
+#include <stdarg.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "ext.h"
 #include "hash.h"
 #include "array.h"
@@ -35,18 +37,85 @@ static int use_subckt_models = 0;
 const char *gnd_node = "GND";
 static char SEP_CHAR = ':';
 
-L_A_DECL (char *, globals);
 static char **devnames = NULL;
 static int num_devices = 0;
+static int ext_threads = 0;
 
-void addglobal (char *name)
+/*
+  Output buffer for one subcircuit
+*/
+struct spbuf {
+  char *s;
+  size_t n, max;
+};
+
+static void bgrow (struct spbuf *b, size_t len)
+{
+  if (b->n + len + 1 > b->max) {
+    if (b->max == 0) {
+      b->max = 4096;
+    }
+    while (b->n + len + 1 > b->max) {
+      b->max *= 2;
+    }
+    REALLOC (b->s, char, b->max);
+  }
+}
+
+static void bprintf (struct spbuf *b, const char *fmt, ...)
+{
+  va_list ap;
+  int len;
+
+  bgrow (b, 128);
+  va_start (ap, fmt);
+  len = vsnprintf (b->s + b->n, b->max - b->n, fmt, ap);
+  va_end (ap);
+  if (b->n + len + 1 > b->max) {
+    bgrow (b, len);
+    va_start (ap, fmt);
+    vsnprintf (b->s + b->n, b->max - b->n, fmt, ap);
+    va_end (ap);
+  }
+  b->n += len;
+}
+
+static void bputs (struct spbuf *b, const char *str, size_t len)
+{
+  bgrow (b, len);
+  memcpy (b->s + b->n, str, len);
+  b->n += len;
+}
+
+/*
+  One unique subcell. Cells are translated once all their subcells
+  are done, and printed in the order of a depth-first traversal of
+  the hierarchy.
+*/
+struct cell_job {
+  const char *name;
+  struct ext_file *E;
+  int toplevel;
+  struct Hashtable *N;		/* names table */
+
+  A_DECL (struct cell_job *, parents); /* cells that use this one */
+  int pending;			/* # of subcells not yet done */
+  int done;
+
+  A_DECL (char *, globals);	/* globals first seen in this cell */
+  struct spbuf out;
+};
+
+L_A_DECL (struct cell_job *, jobs); /* in depth-first order */
+
+void addglobal (struct cell_job *J, char *name)
 {
-  for (int i=0; i < A_LEN (globals); i++) {
-    if (strcmp (globals[i], name) == 0) return;
+  for (int i=0; i < A_LEN (J->globals); i++) {
+    if (strcmp (J->globals[i], name) == 0) return;
   }
-  A_NEW (globals, char *);
-  A_NEXT (globals) = Strdup (name);
-  A_INC (globals);
+  A_NEW (J->globals, char *);
+  A_NEXT (J->globals) = Strdup (name);
+  A_INC (J->globals);
 }
 
 /*
@@ -95,8 +164,9 @@ char *name_munge (const char *name)
 
 static void usage (char *name)
 {
-  fprintf (stderr, "Usage: %s [act-options] [-c <mincap>] <file.ext>\n", name);
+  fprintf (stderr, "Usage: %s [act-options] [-c <mincap>] [-j <threads>] <file.ext>\n", name);
   fprintf (stderr, " -c <mincap> : filter caps at or below this threshold\n");
+  fprintf (stderr, " -j <threads> : number of cells translated in parallel\n");
   exit (1);
 }
 
@@ -172,13 +242,6 @@ void global_name (const char *name, int *start, int *end)
   *end = e;
 }
 
-void print_substr (const char *name, int s, int e)
-{
-  while (s <= e) {
-    putchar (name[s++]);
-  }
-}
-
 static struct alias_tree *newnode ()
 {
   struct alias_tree *a;
@@ -211,10 +274,12 @@ static int islocal (char *s)
 }
 
 /*
-  name is in the EXT file namespace 
+  name is in the EXT file namespace. Returns the node for name
+  itself; its munged name is only computed once.
 */
-struct alias_tree *getname (struct Hashtable *N, const char *name)
+struct alias_tree *getnode (struct cell_job *J, const char *name)
 {
+  struct Hashtable *N = J->N;
   hash_bucket_t *b;
   struct alias_tree *a;
   int l;
@@ -265,7 +330,7 @@ struct alias_tree *getname (struct Hashtable *N, const char *name)
 	x = newnode ();
 	x->global = 2;
 	x->name = g->key;
-	addglobal (x->name);
+	addglobal (J, x->name);
 	g->v = x;
 	x->b = g;
       }
@@ -274,7 +339,12 @@ struct alias_tree *getname (struct Hashtable *N, const char *name)
       FREE (tmp);
     }
   }
-  return getalias ((struct alias_tree *)b->v);
+  return (struct alias_tree *)b->v;
+}
+
+struct alias_tree *getname (struct cell_job *J, const char *name)
+{
+  return getalias (getnode (J, name));
 }
 
 void mergealias (struct alias_tree *a1, struct alias_tree *a2)
@@ -320,43 +390,20 @@ void mergealias (struct alias_tree *a1, struct alias_tree *a2)
   }
 }
 
-static struct alias_tree *get_cur_node (hash_bucket_t *b, struct Hashtable *cur,
-					char *buf, int l)
-{
-  struct alias_tree *x = (struct alias_tree *)b->v;
-  hash_bucket_t *newb;
-  struct alias_tree *newx;
-  
-  if (x->global == 2) {
-    newb = hash_lookup (cur, b->key);
-    if (!newb) {
-      return NULL;
-    }
-    else {
-      return (struct alias_tree *)newb->v;
-    }
-  }
-  else {
-    sprintf (buf+l+1, "%s", b->key);
-    newb = hash_lookup (cur, buf);
-    if (!newb) {
-      return NULL;
-    }
-    else {
-      return (struct alias_tree *)newb->v;
-    }
-  }
-}
-
-static void import_base_node (hash_bucket_t *b, struct Hashtable *cur,
-			      char *buf, int l)
+/*
+  import node b from a subcell with instance prefix buf[0..l] into the
+  current names table, and return the node
+*/
+static struct alias_tree *import_base_node (hash_bucket_t *b,
+					    struct Hashtable *cur,
+					    char *buf, int l)
 {
   struct alias_tree *x = (struct alias_tree *)b->v;
   int new_node;
   hash_bucket_t *newb;
   struct alias_tree *newx;
 
-  sprintf (buf+l+1, "%s", b->key);
+  strcpy (buf+l+1, b->key);
 
   new_node = 1;
 
@@ -385,6 +432,7 @@ static void import_base_node (hash_bucket_t *b, struct Hashtable *cur,
     newb->v = newx;
     newx->b = newb;
   }
+  return (struct alias_tree *)newb->v;
 }
 
 static void import_subcell_conns (struct Hashtable *N,
@@ -400,7 +448,7 @@ static void import_subcell_conns (struct Hashtable *N,
 
   b = hash_lookup (seen, tname);
   Assert (b, "What?");
-  sub = (struct Hashtable *) b->v;
+  sub = ((struct cell_job *) b->v)->N;
 
   t = 0;
   for (int i=0; i < sub->size; i++) {
@@ -447,22 +495,17 @@ static void import_subcell_conns (struct Hashtable *N,
 	struct alias_tree *x, *x1;
 
 	base = (struct alias_tree *)b->v;
-	import_base_node (b, N, strbuf, l);
 
 	/* x is the current node */
-	x = get_cur_node (b, N, strbuf, l);
+	x = import_base_node (b, N, strbuf, l);
 
 	/* now import connections */
 	if (base->up) {
-	  import_base_node (base->up->b, N, strbuf, l);
-	  x1 = get_cur_node (base->up->b, N, strbuf, l);
-	  Assert (x1, "What?");
+	  x1 = import_base_node (base->up->b, N, strbuf, l);
 	  x->up = x1;
 	}
 	if (base->noglob) {
-	  import_base_node (base->noglob->b, N, strbuf, l);
-	  x1 = get_cur_node (base->noglob->b, N, strbuf, l);
-	  Assert (x1, "What?");
+	  x1 = import_base_node (base->noglob->b, N, strbuf, l);
 	  x->noglob = x1;
 	}
       }
@@ -492,26 +535,75 @@ static void import_subcell_conns (struct Hashtable *N,
   FREE (strbuf);
 }
 
-void ext2spice (const char *name, struct ext_file *E, int toplevel)
+/*
+  Create the jobs for name and all its subcells
+*/
+static struct cell_job *mkjob (const char *name, struct ext_file *E,
+			       int toplevel)
 {
   hash_bucket_t *b;
-  int l;
-  struct Hashtable *N;
-  int devcount = 1;
-  
+  struct cell_job *J, *sub;
+  int i;
+
   b = hash_lookup (seen, name);
   if (b) {
-    return;
+    return (struct cell_job *)b->v;
   }
   b = hash_add (seen, name);
 
+  NEW (J, struct cell_job);
+  J->name = name;
+  J->E = E;
+  J->toplevel = toplevel;
+  J->N = NULL;
+  A_INIT (J->parents);
+  J->pending = 0;
+  J->done = 0;
+  A_INIT (J->globals);
+  J->out.s = NULL;
+  J->out.n = 0;
+  J->out.max = 0;
+  b->v = J;
+
+  for (struct ext_list *lst = E->subcells; lst; lst = lst->next) {
+    sub = mkjob (lst->file, lst->ext, 0);
+    for (i=0; i < A_LEN (sub->parents); i++) {
+      if (sub->parents[i] == J) break;
+    }
+    if (i == A_LEN (sub->parents)) {
+      A_NEW (sub->parents, struct cell_job *);
+      A_NEXT (sub->parents) = J;
+      A_INC (sub->parents);
+      J->pending++;
+    }
+  }
+
+  A_NEW (jobs, struct cell_job *);
+  A_NEXT (jobs) = J;
+  A_INC (jobs);
+
+  return J;
+}
+
+/*
+  Translate one cell into J->out; all its subcells must be done.
+*/
+static void ext2spice (struct cell_job *J)
+{
+  const char *name = J->name;
+  struct ext_file *E = J->E;
+  int toplevel = J->toplevel;
+  struct spbuf *B = &J->out;
+  int l;
+  struct Hashtable *N;
+  int devcount = 1;
+
   /*-- create names table --*/
   N = hash_new (32);
-  b->v = N;
+  J->N = N;
 
   for (struct ext_list *lst = E->subcells; lst; lst = lst->next) {
     int xl, xh, yl, yh;
-    ext2spice (lst->file, lst->ext, 0);
     /* import connections */
     if (lst->xhi < lst->xlo) {
       xl = lst->xhi;
@@ -537,55 +629,44 @@ void ext2spice (const char *name, struct ext_file *E, int toplevel)
     if (l >= 4 && (strcmp (name + l - 4, ".ext") == 0)) {
       l -= 4;
     }
-    printf ("*---------------------------------------------------\n");
-    printf ("* Subcircuit from %s\n", name);
-    printf ("*---------------------------------------------------\n");
-    printf (".subckt ");
-    while (l) {
-      putchar (*name);
-      name++;
-      l--;
-    }
-    printf (" _\n");
+    bprintf (B, "*---------------------------------------------------\n");
+    bprintf (B, "* Subcircuit from %s\n", name);
+    bprintf (B, "*---------------------------------------------------\n");
+    bprintf (B, ".subckt ");
+    bputs (B, name, l);
+    bprintf (B, " _\n");
   }
   else {
-    printf ("*\n");
-    printf ("*---------------------------------------------------\n");
-    printf ("*  Main extract file %s\n", name);
-    printf ("*---------------------------------------------------\n");
-    printf ("*\n");
+    bprintf (B, "*\n");
+    bprintf (B, "*---------------------------------------------------\n");
+    bprintf (B, "*  Main extract file %s\n", name);
+    bprintf (B, "*---------------------------------------------------\n");
+    bprintf (B, "*\n");
   }
 
   if (E->subcells) {
-    printf ("*--- subcircuits ---\n");
+    bprintf (B, "*--- subcircuits ---\n");
     for (struct ext_list *lst = E->subcells; lst; lst = lst->next) {
-      int p = 0;
-      printf ("x%s %s ", lst->id, gnd_node);
+      bprintf (B, "x%s %s ", lst->id, gnd_node);
       l = strlen (lst->file);
       if (l >= 4 && (strcmp (lst->file + l - 4, ".ext") == 0)) {
 	l -= 4;
       }
-      while (l) {
-	putchar (lst->file[p++]);
-	l--;
-      }
-      putchar ('\n');
+      bputs (B, lst->file, l);
+      bputs (B, "\n", 1);
     }
   }
   
   /*-- process aliases --*/
-  printf ("* -- connections ---\n");
+  bprintf (B, "* -- connections ---\n");
   for (struct ext_alias *a = E->aliases; a; a = a->next) {
-    struct alias_tree *t1, *t2;
-    t1 = getname (N, a->n1);
-    t2 = getname (N, a->n2);
+    struct alias_tree *n1, *n2, *t1, *t2;
+    n1 = getnode (J, a->n1);
+    n2 = getnode (J, a->n2);
+    t1 = getalias (n1);
+    t2 = getalias (n2);
     if (t1 != t2) {
-      char *s1, *s2;
-      s1 = name_munge (a->n1);
-      s2 = name_munge (a->n2);
-      printf ("V%d %s %s\n", devcount++, s2, s1);
-      FREE (s1);
-      FREE (s2);
+      bprintf (B, "V%d %s %s\n", devcount++, n2->name, n1->name);
     }
     if (islocal (a->n1)) {
       mergealias (t1, t2);
@@ -597,7 +678,7 @@ void ext2spice (const char *name, struct ext_file *E, int toplevel)
 
   /*-- process area/perim --*/
   for (struct ext_ap *a = E->ap; a; a = a->next) {
-    struct alias_tree *t = getname (N, a->node);
+    struct alias_tree *t = getname (J, a->node);
     for (int i=0; i < num_devices; i++) {
       t->area[i] += a->area[i];
       t->perim[i] += a->perim[i];
@@ -606,61 +687,61 @@ void ext2spice (const char *name, struct ext_file *E, int toplevel)
 
   /*--- now print out fets ---*/
   if (E->fet) {
-    printf ("* -- fets ---\n");
+    bprintf (B, "* -- fets ---\n");
     for (struct ext_fets *fl = E->fet; fl; fl = fl->next) {
       struct alias_tree *tsrc, *tdrain, *t;
       if (use_subckt_models) {
-	printf ("x");
+	bputs (B, "x", 1);
       }
-      printf ("M%d ", devcount++);
-      tdrain = getname (N, fl->t2); /* drain */
-      printf ("%s ", tdrain->name); /* gate */
-      t = getname (N, fl->g);  /* src */
-      printf ("%s ", t->name);
-      tsrc = getname (N, fl->t1);
-      printf ("%s ", tsrc->name);
-      t = getname (N, fl->sub);
-      printf ("%s ", t->name);
+      bprintf (B, "M%d ", devcount++);
+      tdrain = getname (J, fl->t2); /* drain */
+      bprintf (B, "%s ", tdrain->name); /* gate */
+      t = getname (J, fl->g);  /* src */
+      bprintf (B, "%s ", t->name);
+      tsrc = getname (J, fl->t1);
+      bprintf (B, "%s ", tsrc->name);
+      t = getname (J, fl->sub);
+      bprintf (B, "%s ", t->name);
       if (devnames) {
-	printf ("%s ", config_get_string (devnames[fl->type]));
+	bprintf (B, "%s ", devnames[fl->type]);
       }
       else {
 	if (fl->type == EXT_FET_PTYPE) {
-	  printf ("pfet ");
+	  bprintf (B, "pfet ");
 	}
 	else {
-	  printf ("nfet ");
+	  bprintf (B, "nfet ");
 	}
       }
-      printf ("W=%gU L=%gU", fl->width*1e6, fl->length*1e6);
-      printf ("\n+ AS=%gP PS=%gU", tsrc->area[fl->type]*1e12,
+      bprintf (B, "W=%gU L=%gU", fl->width*1e6, fl->length*1e6);
+      bprintf (B, "\n+ AS=%gP PS=%gU", tsrc->area[fl->type]*1e12,
 	      tsrc->perim[fl->type]*1e6);
       tsrc->area[fl->type] = 0;
       tsrc->perim[fl->type] = 0;
-      printf (" AD=%gP PD=%gU", tdrain->area[fl->type]*1e12,
+      bprintf (B, " AD=%gP PD=%gU", tdrain->area[fl->type]*1e12,
 	      tdrain->perim[fl->type]*1e6);
       tdrain->area[fl->type] = 0;
       tdrain->perim[fl->type] = 0;
-      printf ("\n");
+      bputs (B, "\n", 1);
     }
   }
 
   /*-- caps --*/
   if (E->cap) {
-    printf ("* -- caps ---\n");
+    bprintf (B, "* -- caps ---\n");
 
     /*--- collect cap to GND ---*/
     for (struct ext_cap *l = E->cap; l; l = l->next) {
       struct alias_tree *t, *u;
 
-      t = getname (N, l->n1);
+      t = getname (J, l->n1);
       if (l->type == CAP_GND || l->type == CAP_SUBSTRATE) {
 	if (l->type == CAP_GND) {
 	  t->cap_gnd += l->cap;
 	}
       }
       else {
-	u = getname (N, l->n2);
+	u = getname (J, l->n2);
 	if (strcmp (t->name, gnd_node) == 0) {
 	  u->cap_gnd += l->cap;
 	}
@@ -675,8 +756,8 @@ void ext2spice (const char *name, struct ext_file *E, int toplevel)
 
       if (l->type == CAP_GND || l->type == CAP_SUBSTRATE) continue;
     
-      t = getname (N, l->n1);
-      u = getname (N, l->n2);
+      t = getname (J, l->n1);
+      u = getname (J, l->n2);
       if (strcmp (t->name, gnd_node) == 0) {
 	continue;
       }
@@ -686,7 +767,7 @@ void ext2spice (const char *name, struct ext_file *E, int toplevel)
 
       if (l->cap < mincap) continue;
     
-      printf ("C%d %s %s %gF\n", devcount++, t->name, u->name, l->cap*1.0e15);
+      bprintf (B, "C%d %s %s %gF\n", devcount++, t->name, u->name, l->cap*1.0e15);
     }
 
     /* print caps to GND */
@@ -695,7 +776,7 @@ void ext2spice (const char *name, struct ext_file *E, int toplevel)
 	struct alias_tree *t = (struct alias_tree *)b->v;
 	if (t->cap_gnd > 0 && t->cap_gnd >= mincap) {
 	  if (strcmp (t->name, gnd_node) == 0) continue;
-	  printf ("C%d %s %s %gF\n", devcount++, t->name,
+	  bprintf (B, "C%d %s %s %gF\n", devcount++, t->name,
 		  gnd_node, t->cap_gnd*1.0e15);
 	}
       }
@@ -704,14 +785,22 @@ void ext2spice (const char *name, struct ext_file *E, int toplevel)
 
 
   if (!toplevel) {
-    printf (".ends\n");
+    bprintf (B, ".ends\n");
   }
   else {
-    /* print globals! */
-    printf ("*--- inferred globals\n");
-    for (int i=0; i < A_LEN (globals); i++) {
-      printf (".global %s\n", globals[i]);
+    /* print globals! all other cells are done at this point, and
+       cells are visited in the order they are printed */
+    struct Hashtable *G = hash_new (4);
+    bprintf (B, "*--- inferred globals\n");
+    for (int i=0; i < A_LEN (jobs); i++) {
+      for (int j=0; j < A_LEN (jobs[i]->globals); j++) {
+	if (!hash_lookup (G, jobs[i]->globals[j])) {
+	  hash_add (G, jobs[i]->globals[j]);
+	  bprintf (B, ".global %s\n", jobs[i]->globals[j]);
+	}
+      }
     }
+    hash_free (G);
   }
 
 #if 0  
@@ -727,6 +816,106 @@ void ext2spice (const char *name, struct ext_file *E, int toplevel)
 }
 
 
+/*
+  Run the jobs on ext_threads threads, and print them in order
+*/
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_done = PTHREAD_COND_INITIALIZER;
+L_A_DECL (struct cell_job *, ready);
+
+static void *ext2spice_worker (void *arg)
+{
+  struct cell_job *J;
+
+  pthread_mutex_lock (&job_lock);
+  while (1) {
+    while (A_LEN (ready) == 0) {
+      pthread_cond_wait (&job_ready, &job_lock);
+    }
+    J = ready[A_LEN (ready)-1];
+    if (!J) {
+      /* leave the NULL for the other workers */
+      break;
+    }
+    A_LEN (ready)--;
+    pthread_mutex_unlock (&job_lock);
+
+    ext2spice (J);
+
+    pthread_mutex_lock (&job_lock);
+    J->done = 1;
+    for (int i=0; i < A_LEN (J->parents); i++) {
+      J->parents[i]->pending--;
+      if (J->parents[i]->pending == 0) {
+	A_NEW (ready, struct cell_job *);
+	A_NEXT (ready) = J->parents[i];
+	A_INC (ready);
+      }
+    }
+    pthread_cond_broadcast (&job_ready);
+    pthread_cond_signal (&job_done);
+  }
+  pthread_mutex_unlock (&job_lock);
+  return NULL;
+}
+
+static void ext2spice_all (const char *name, struct ext_file *E)
+{
+  pthread_t *th;
+  int i;
+
+  A_INIT (jobs);
+  A_INIT (ready);
+  mkjob (name, E, 1);
+
+  for (i=0; i < A_LEN (jobs); i++) {
+    if (jobs[i]->pending == 0) {
+      A_NEW (ready, struct cell_job *);
+      A_NEXT (ready) = jobs[i];
+      A_INC (ready);
+    }
+  }
+
+  if (ext_threads < 1) {
+    long n = sysconf (_SC_NPROCESSORS_ONLN);
+    if (n > 8) n = 8;
+    ext_threads = (n < 1) ? 1 : n;
+  }
+  if (ext_threads > A_LEN (jobs)) {
+    ext_threads = A_LEN (jobs);
+  }
+  MALLOC (th, pthread_t, ext_threads);
+  for (i=0; i < ext_threads; i++) {
+    pthread_create (&th[i], NULL, ext2spice_worker, NULL);
+  }
+
+  /* print cells as soon as they, and all cells before them, are done */
+  for (i=0; i < A_LEN (jobs); i++) {
+    pthread_mutex_lock (&job_lock);
+    while (!jobs[i]->done) {
+      pthread_cond_wait (&job_done, &job_lock);
+    }
+    pthread_mutex_unlock (&job_lock);
+    fwrite (jobs[i]->out.s, 1, jobs[i]->out.n, stdout);
+    FREE (jobs[i]->out.s);
+    jobs[i]->out.s = NULL;
+  }
+
+  pthread_mutex_lock (&job_lock);
+  A_NEW (ready, struct cell_job *);
+  A_NEXT (ready) = NULL;
+  A_INC (ready);
+  pthread_cond_broadcast (&job_ready);
+  pthread_mutex_unlock (&job_lock);
+  for (i=0; i < ext_threads; i++) {
+    pthread_join (th[i], NULL);
+  }
+  FREE (th);
+  fflush (stdout);
+}
+
+
 int main (int argc, char **argv)
 {
   int ch;
@@ -734,15 +923,16 @@ int main (int argc, char **argv)
   extern char *optarg;
   struct ext_file *E;
 
-  A_INIT (globals);
-
   Act::Init (&argc, &argv);
 
-  while ((ch = getopt (argc, argv, "c:")) != -1) {
+  while ((ch = getopt (argc, argv, "c:j:")) != -1) {
     switch (ch) {
     case 'c':
       mincap = atof (optarg);
       break;
+    case 'j':
+      ext_threads = atoi (optarg);
+      break;
     default:
       usage(argv[0]);
       break;
@@ -767,8 +957,11 @@ int main (int argc, char **argv)
     rawdevs = config_get_table_string ("net.ext_map");
     MALLOC (devnames, char *, num_devices);
     for (j=0; j < num_devices; j++) {
-      MALLOC (devnames[j], char, strlen (rawdevs[j]) + 4 + 1);
-      sprintf (devnames[j], "net.%s", rawdevs[j]);
+      char *tmp;
+      MALLOC (tmp, char, strlen (rawdevs[j]) + 4 + 1);
+      sprintf (tmp, "net.%s", rawdevs[j]);
+      devnames[j] = config_get_string (tmp);
+      FREE (tmp);
     }
   }
   else {
@@ -787,7 +980,8 @@ int main (int argc, char **argv)
     use_subckt_models = config_get_int ("net.use_subckt_models");
   }
 
-  ext2spice (argv[optind], E, 1);
+  setvbuf (stdout, NULL, _IOFBF, 1 << 20);
+  ext2spice_all (argv[optind], E);
 
   return 0;
 }
@@ -52,11 +52,14 @@ int main (int argc, char **argv)
   /* read in the ACT file */
   a = new Act (argv[1]);
 
-  /* expand it */
-  a->Expand ();
- 
-  /* find the process specified on the command line */
-  Process *p = a->findProcess (argv[2]);
+  /* expand the process specified on the command line; this only
+     expands the types it needs. If the name can't be handled that
+     way, expand everything and look it up */
+  Process *p = a->Expand (argv[2]);
+  if (!p) {
+    a->Expand ();
+    p = a->findProcess (argv[2]);
+  }
 
   if (!p) {
     fatal_error ("Could not find process `%s' in file `%s'", argv[2], argv[1]);
@@ -196,7 +196,20 @@ int main (int argc, char **argv)
     a->Merge (cell_file);
   }
   
-  a->Expand ();
+  Process *p;
+
+  if (cell_file) {
+    /* the cell pass needs the full design */
+    a->Expand ();
+    p = NULL;
+  }
+  else {
+    /* expand only what the requested process needs */
+    p = a->Expand (proc);
+    if (!p) {
+      a->Expand ();
+    }
+  }
 
   if (cell_file) {
     ActCellPass *cp = new ActCellPass (a);
@@ -214,7 +227,9 @@ int main (int argc, char **argv)
     a->mangle (config_get_string ("net.mangle_chars"));
   }
 
-  Process *p = a->findProcess (proc);
+  if (!p) {
+    p = a->findProcess (proc);
+  }
 
   if (!p) {
     fatal_error ("Could not find process `%s' in file `%s'", proc, argv[1]);
@@ -22,7 +22,10 @@
  **************************************************************************
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <act/passes.h>
 #include <act/passes/netlist.h>
 #include <act/passes/aflat.h>
@@ -31,7 +34,8 @@
 
 void usage (char *s)
 {
-  fprintf (stderr, "Usage: %s [act-options] <file.act> <simfile>\n", s);
+  fprintf (stderr, "Usage: %s [act-options] [-j <n>] <file.act> <simfile>\n", s);
+  fprintf (stderr, " -j <n>   Use <n> threads to write the .sim file (default: # of CPUs)\n");
   exit (1);
 }
 
@@ -68,73 +72,121 @@ void f (void *x, ActId *one, ActId *two)
 
 static ActNetlistPass *netinfo = NULL;
 
-static void _print_node (netlist_t *N, FILE *fp, ActId *prefix, node_t *n)
+/*
+  The transistors of a netlist are printed once per process, into a
+  template. Every instance of the process is the template with the
+  instance prefix filled into the prefix slots.
+
+  A template is a list of segments; each segment is an optional
+  prefix slot followed by a piece of text.
+*/
+#define SLOT_NONE   0
+#define SLOT_LOCAL  1		/* local name: "<prefix>/", or "/" at
+				   the top level */
+#define SLOT_NODE   2		/* internal node: "<prefix>/", or
+				   nothing at the top level */
+
+struct sim_seg {
+  int slot;
+  int start, len;		/* text[start ... start+len-1] */
+};
+
+struct sim_tmpl {
+  A_DECL (char, text);
+  A_DECL (struct sim_seg, seg);
+};
+
+static struct iHashtable *tmplH = NULL; /* netlist_t * -> template */
+
+static void _tmpl_slot (struct sim_tmpl *t, int slot)
+{
+  A_NEW (t->seg, struct sim_seg);
+  A_NEXT (t->seg).slot = slot;
+  A_NEXT (t->seg).start = A_LEN (t->text);
+  A_NEXT (t->seg).len = 0;
+  A_INC (t->seg);
+}
+
+static void _tmpl_text (struct sim_tmpl *t, const char *s, int slash = 0)
+{
+  int len = strlen (s);
+  if (len == 0) {
+    return;
+  }
+  A_NEWP (t->text, char, len);
+  for (int i=0; i < len; i++) {
+    /* names use '/' as the hierarchy separator */
+    t->text[A_LEN (t->text) + i] = (slash && s[i] == '.') ? '/' : s[i];
+  }
+  A_LEN (t->text) += len;
+  t->seg[A_LEN (t->seg)-1].len += len;
+}
+
+static void _tmpl_node (struct sim_tmpl *t, netlist_t *N, node_t *n)
 {
   if (n->v) {
-    ActId *tmp = n->v->v->id->toid();
     if (!n->v->v->id->isglobal()) {
-      idprint (fp, prefix);
-      //prefix->Print (fp);
-      //fprintf (fp, ".");
-      fprintf (fp, "/");
+      _tmpl_slot (t, SLOT_LOCAL);
     }
-    //tmp->Print (fp);
-    idprint (fp, tmp);
-    delete tmp;
+    _tmpl_text (t, ActNetlistPass::nodeName (N, n), 1);
   }
   else {
     if (n == N->Vdd) {
-      fprintf (fp, "Vdd");
+      _tmpl_text (t, "Vdd");
     }
     else if (n == N->GND) {
-      fprintf (fp, "GND");
+      _tmpl_text (t, "GND");
     }
     else {
-      if (prefix) {
-	//prefix->Print (fp);
-	//fprintf (fp, ".");
-	idprint (fp, prefix);
-	fprintf (fp, "/");
-      }
-      fprintf (fp, "n#%d", n->i);
+      char buf[32];
+      _tmpl_slot (t, SLOT_NODE);
+      snprintf (buf, 32, "n#%d", n->i);
+      _tmpl_text (t, buf);
     }
   }
 }
 
-void g (void *x, ActId *prefix, Process *p)
+static struct sim_tmpl *_get_tmpl (netlist_t *N)
 {
-  FILE *fp;
-  netlist_t *N;
+  ihash_bucket_t *b;
+  struct sim_tmpl *t;
 
-  N = netinfo->getNL (p);
-  
-  Assert (N, "Hmm");
+  if (!tmplH) {
+    tmplH = ihash_new (32);
+  }
+  b = ihash_lookup (tmplH, (long)N);
+  if (b) {
+    return (struct sim_tmpl *)b->v;
+  }
 
-  fp = (FILE *)x;
+  NEW (t, struct sim_tmpl);
+  A_INIT (t->text);
+  A_INIT (t->seg);
+  _tmpl_slot (t, SLOT_NONE);
 
-  /* now print out the netlist, with all names having the prefix
-     specified */
   node_t *n;
   edge_t *e;
   listitem_t *li;
+  char buf[64];
   for (n = N->hd; n; n = n->next) {
     for (li = list_first (n->e); li; li = list_next (li)) {
       e = (edge_t *) list_value (li);
       if (e->visited) continue;
       /* p <gate> <src> <drain> l w */
       if (e->type == EDGE_NFET) {
-	fprintf (fp, "n ");
+	_tmpl_text (t, "n ");
       }
       else {
-	fprintf (fp, "p ");
+	_tmpl_text (t, "p ");
       }
-      _print_node (N, fp, prefix, e->g);
-      fprintf (fp, " ");
-      _print_node (N, fp, prefix, e->a);
-      fprintf (fp, " ");
-      _print_node (N, fp, prefix, e->b);
-      fprintf (fp, " %d %d\n", e->l/ActNetlistPass::getGridsPerLambda(),
-	       e->w/ActNetlistPass::getGridsPerLambda());
+      _tmpl_node (t, N, e->g);
+      _tmpl_text (t, " ");
+      _tmpl_node (t, N, e->a);
+      _tmpl_text (t, " ");
+      _tmpl_node (t, N, e->b);
+      snprintf (buf, 64, " %d %d\n", e->l/ActNetlistPass::getGridsPerLambda(),
+		e->w/ActNetlistPass::getGridsPerLambda());
+      _tmpl_text (t, buf);
       e->visited = 1;
     }
   }
@@ -145,21 +197,243 @@ void g (void *x, ActId *prefix, Process *p)
       e->visited = 0;
     }
   }
+
+  b = ihash_add (tmplH, (long)N);
+  b->v = t;
+  return t;
+}
+
+/*
+  Instances are queued, and rendered in batches. A batch is split
+  into contiguous shards that are rendered in parallel into memory,
+  and then written out in order.
+*/
+struct sim_job {
+  struct sim_tmpl *t;
+  char *pfx;			/* "<prefix>/", or NULL at top level */
+  int pfxlen;
+};
+
+struct sim_shard {
+  int lo, hi;			/* jobs[lo ... hi-1] */
+  A_DECL (char, buf);
+  pthread_t th;
+};
+
+static int num_threads = 1;
+static struct sim_shard *shards = NULL;
+L_A_DECL (struct sim_job, jobs);
+static long pending_bytes = 0;
+
+#define BATCH_BYTES (1 << 25)
+
+static long _job_size (struct sim_job *j)
+{
+  /* upper bound: every segment has a slot */
+  return A_LEN (j->t->text) +
+    (long)A_LEN (j->t->seg)*(j->pfx ? j->pfxlen : 1);
+}
+
+static void _render (struct sim_shard *sh)
+{
+  long sz = 0;
+
+  for (int i=sh->lo; i < sh->hi; i++) {
+    sz += _job_size (&jobs[i]);
+  }
+  A_LEN (sh->buf) = 0;
+  if (sz == 0) {
+    return;
+  }
+  A_NEWP (sh->buf, char, sz);
+
+  char *out = sh->buf;
+  for (int i=sh->lo; i < sh->hi; i++) {
+    struct sim_tmpl *t = jobs[i].t;
+    for (int k=0; k < A_LEN (t->seg); k++) {
+      struct sim_seg *sg = &t->seg[k];
+      if (sg->slot != SLOT_NONE) {
+	if (jobs[i].pfx) {
+	  memcpy (out, jobs[i].pfx, jobs[i].pfxlen);
+	  out += jobs[i].pfxlen;
+	}
+	else if (sg->slot == SLOT_LOCAL) {
+	  *out++ = '/';
+	}
+      }
+      memcpy (out, t->text + sg->start, sg->len);
+      out += sg->len;
+    }
+  }
+  A_LEN (sh->buf) = out - sh->buf;
+}
+
+static void *_render_thread (void *x)
+{
+  _render ((struct sim_shard *)x);
+  return NULL;
+}
+
+static void flush_jobs (FILE *fp)
+{
+  int nsh;
+  
+  if (A_LEN (jobs) == 0) {
+    return;
+  }
+  if (!shards) {
+    MALLOC (shards, struct sim_shard, num_threads);
+    for (int i=0; i < num_threads; i++) {
+      A_INIT (shards[i].buf);
+    }
+  }
+  nsh = num_threads;
+  if (A_LEN (jobs) < nsh) {
+    nsh = A_LEN (jobs);
+  }
+
+  /* contiguous shards of roughly equal size */
+  long per = pending_bytes/nsh + 1;
+  long acc = 0;
+  int k = 0;
+  shards[0].lo = 0;
+  for (int i=0; i < A_LEN (jobs) && k < nsh-1; i++) {
+    acc += _job_size (&jobs[i]);
+    if (acc >= per*(k+1)) {
+      shards[k].hi = i+1;
+      k++;
+      shards[k].lo = i+1;
+    }
+  }
+  shards[k].hi = A_LEN (jobs);
+  nsh = k+1;
+
+  if (nsh == 1) {
+    _render (&shards[0]);
+  }
+  else {
+    for (int i=0; i < nsh; i++) {
+      if (pthread_create (&shards[i].th, NULL, _render_thread,
+			  &shards[i]) != 0) {
+	fatal_error ("Could not create thread!");
+      }
+    }
+    for (int i=0; i < nsh; i++) {
+      pthread_join (shards[i].th, NULL);
+    }
+  }
+  for (int i=0; i < nsh; i++) {
+    fwrite (shards[i].buf, 1, A_LEN (shards[i].buf), fp);
+  }
+
+  for (int i=0; i < A_LEN (jobs); i++) {
+    if (jobs[i].pfx) {
+      FREE (jobs[i].pfx);
+    }
+  }
+  A_LEN (jobs) = 0;
+  pending_bytes = 0;
+}
+
+static void free_jobs (void)
+{
+  ihash_iter_t it;
+  ihash_bucket_t *b;
+  struct sim_tmpl *t;
+
+  if (tmplH) {
+    ihash_iter_init (tmplH, &it);
+    while ((b = ihash_iter_next (tmplH, &it))) {
+      t = (struct sim_tmpl *)b->v;
+      A_FREE (t->text);
+      A_FREE (t->seg);
+      FREE (t);
+    }
+    ihash_free (tmplH);
+    tmplH = NULL;
+  }
+  if (shards) {
+    for (int i=0; i < num_threads; i++) {
+      A_FREE (shards[i].buf);
+    }
+    FREE (shards);
+    shards = NULL;
+  }
+  A_FREE (jobs);
+}
+
+void g (void *x, ActId *prefix, Process *p)
+{
+  FILE *fp;
+  netlist_t *N;
+
+  N = netinfo->getNL (p);
   
+  Assert (N, "Hmm");
+
+  fp = (FILE *)x;
+
+  A_NEW (jobs, struct sim_job);
+  A_NEXT (jobs).t = _get_tmpl (N);
+  if (prefix) {
+    char buf[10240];
+    int len;
+    prefix->sPrint (buf, 10239);
+    for (len=0; buf[len]; len++) {
+      if (buf[len] == '.') {
+	buf[len] = '/';
+      }
+    }
+    buf[len++] = '/';
+    buf[len] = '\0';
+    A_NEXT (jobs).pfx = Strdup (buf);
+    A_NEXT (jobs).pfxlen = len;
+  }
+  else {
+    A_NEXT (jobs).pfx = NULL;
+    A_NEXT (jobs).pfxlen = 0;
+  }
+  pending_bytes += _job_size (&A_NEXT (jobs));
+  A_INC (jobs);
+
+  if (pending_bytes > BATCH_BYTES) {
+    flush_jobs (fp);
+  }
 }
 
 int main (int argc, char **argv)
 {
   Act *a;
-  char *file;
+  int ch;
+  extern int optind;
+  extern char *optarg;
 
   Act::Init (&argc, &argv);
 
-  if (argc != 3) {
+  num_threads = sysconf (_SC_NPROCESSORS_ONLN);
+  while ((ch = getopt (argc, argv, "j:")) != -1) {
+    switch (ch) {
+    case 'j':
+      num_threads = atoi (optarg);
+      if (num_threads < 1) {
+	fprintf (stderr, "-j requires a positive number of threads\n");
+	usage (argv[0]);
+      }
+      break;
+    default:
+      usage (argv[0]);
+      break;
+    }
+  }
+  if (optind != argc - 2) {
+    fprintf (stderr, "Need an ACT file and a sim file name\n");
     usage (argv[0]);
   }
+  if (num_threads < 1) {
+    num_threads = 1;
+  }
   
-  a = new Act (argv[1]);
+  a = new Act (argv[optind]);
   a->Expand ();
 
   /* generate netlist */
@@ -169,12 +443,12 @@ int main (int argc, char **argv)
   FILE *fps, *fpal;
   char buf[10240];
 
-  sprintf (buf, "%s.sim", argv[2]);
+  sprintf (buf, "%s.sim", argv[optind+1]);
   fps = fopen (buf, "w");
   if (!fps) {
     fatal_error ("Could not open file `%s' for writing", buf);
   }
-  sprintf (buf, "%s.al", argv[2]);
+  sprintf (buf, "%s.al", argv[optind+1]);
   fpal = fopen (buf, "w");
   if (!fpal) {
     fatal_error ("Could not open file `%s' for writing", buf);
@@ -197,6 +471,7 @@ int main (int argc, char **argv)
   app->setInstFn (g);
   app->run ();
   g(fps, NULL, NULL);
+  flush_jobs (fps);
   fclose (fps);
 
   app->setCookie (fpal);
@@ -207,5 +482,7 @@ int main (int argc, char **argv)
   fprintf (fpal, "= GND GND!\n");
   fclose (fpal);
 
+  free_jobs ();
+
   return 0;
 }
@@ -0,0 +1,183 @@
+/*************************************************************************
+ *
+ *  This file is part of the ACT library
+ *
+ *  Copyright (c) 2018-2019 Rajit Manohar
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA  02110-1301, USA.
+ *
+ **************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <act/act.h>
+#include <act/passes.h>
+#include "config.h"
+
+
+static void usage (char *name)
+{
+  fprintf (stderr, "Usage: %s [act-options] <actfile> <process>\n", name);
+  exit (1);
+}
+
+
+static int _cmpstr (const void *a, const void *b)
+{
+  return strcmp (*(char **)a, *(char **)b);
+}
+
+int main (int argc, char **argv)
+{
+  Act *a;
+  char *proc;
+
+  /* initialize ACT library */
+  Act::Init (&argc, &argv);
+
+  /* some usage check */
+  if (argc != 3) {
+    usage (argv[0]);
+  }
+
+  /* read in the ACT file */
+  a = new Act (argv[1]);
+
+  /* expand it */
+  a->Expand ();
+ 
+  /* find the process specified on the command line */
+  Process *p = a->findProcess (argv[2]);
+
+  if (!p) {
+    fatal_error ("Could not find process `%s' in file `%s'", argv[2], argv[1]);
+  }
+
+  if (!p->isExpanded()) {
+    fatal_error ("Process `%s' is not expanded.", argv[2]);
+  }
+
+  ActStatePass *sp = new ActStatePass (a);
+  sp->run (p);
+
+  /* flat index: save it, map it back in, and check every offset
+     survives a round trip through its name */
+  char tmpfile[] = "/tmp/sidxXXXXXX";
+  int fd = mkstemp (tmpfile);
+  if (fd < 0) {
+    fatal_error ("Could not create temporary file");
+  }
+  close (fd);
+  if (!sp->globalIndex()->Write (tmpfile)) {
+    fatal_error ("Could not write state index");
+  }
+  ActStateIndex *ix = ActStateIndex::Read (tmpfile);
+  unlink (tmpfile);
+  if (!ix) {
+    fatal_error ("Could not read state index");
+  }
+
+  printf ("--- State index ---\n");
+  printf ("  bools: %llu, ints: %llu, chans: %llu\n",
+	  (unsigned long long)ix->numBools(),
+	  (unsigned long long)ix->numInts(),
+	  (unsigned long long)ix->numChans());
+  for (int i=0; i < ix->numInstances(); i++) {
+    char *nm = ix->instName (i);
+    printf ("  inst %d <%s>: parent %d, base %llu/%llu/%llu/%llu\n",
+	    i, nm, ix->instParent (i),
+	    (unsigned long long)ix->instBase (i, ActStateIndex::PRS),
+	    (unsigned long long)ix->instBase (i, ActStateIndex::CHP),
+	    (unsigned long long)ix->instBase (i, ActStateIndex::INT),
+	    (unsigned long long)ix->instBase (i, ActStateIndex::CHAN));
+    if (ix->findInstance (nm) != i) {
+      printf ("    ** instance lookup failed\n");
+    }
+    FREE (nm);
+  }
+  /* state numbering depends on hash table order, so print the
+     names sorted */
+  A_DECL (char *, lines);
+  A_INIT (lines);
+  for (int t=0; t < 3; t++) {
+    uint64_t n = (t == 0 ? ix->numBools() :
+		  (t == 1 ? ix->numInts() : ix->numChans()));
+    for (uint64_t off=0; off < n; off++) {
+      char *nm = ix->getName (t, off);
+      char *nm2 = sp->globalIndex()->getName (t, off);
+      uint64_t xoff;
+      int xtype, xw;
+      char buf[1024];
+
+      snprintf (buf, 1024, "  %c %s", "bic"[t], nm ? nm : "-");
+      if (!nm || !nm2 || strcmp (nm, nm2) != 0) {
+	snprintf (buf + strlen (buf), 1024 - strlen (buf),
+		  " ** mismatch with in-memory index");
+      }
+      if (nm) {
+	if (!ix->getOffset (nm, &xoff, &xtype, &xw)) {
+	  snprintf (buf + strlen (buf), 1024 - strlen (buf),
+		    " ** lookup failed");
+	}
+	else if (xoff != off || (xtype > 2 ? 2 : xtype) != t) {
+	  snprintf (buf + strlen (buf), 1024 - strlen (buf),
+		    " ** lookup mismatch");
+	}
+      }
+      A_NEW (lines, char *);
+      A_NEXT (lines) = Strdup (buf);
+      A_INC (lines);
+      if (nm) { FREE (nm); }
+      if (nm2) { FREE (nm2); }
+    }
+  }
+  qsort (lines, A_LEN (lines), sizeof (char *), _cmpstr);
+  for (int i=0; i < A_LEN (lines); i++) {
+    printf ("%s\n", lines[i]);
+    FREE (lines[i]);
+  }
+  A_FREE (lines);
+
+  /* names to look up, if any */
+  char buf[1024];
+  FILE *fp;
+  snprintf (buf, 1024, "%s.names", argv[1]);
+  fp = fopen (buf, "r");
+  if (fp) {
+    while (fgets (buf, 1024, fp)) {
+      uint64_t xoff;
+      int xtype, xw;
+      buf[strcspn (buf, "\n")] = '\0';
+      if (!buf[0]) continue;
+      if (!ix->getOffset (buf, &xoff, &xtype, &xw)) {
+	printf ("  %s: not found\n", buf);
+      }
+      else {
+	char *nm = ix->getName (xtype, xoff);
+	printf ("  %s: %c width %d <%s>\n", buf, "bicc"[xtype], xw,
+		nm ? nm : "-");
+	if (nm) { FREE (nm); }
+      }
+    }
+    fclose (fp);
+  }
+  printf ("--- End State index ---\n");
+  delete ix;
+
+  return 0;
+}
@@ -6,9 +6,15 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "hier.h"
+#include "lvs.h"
 #include "misc.h"
+#include "array.h"
 
 /*------------------------------------------------------------------------*/
 
@@ -62,3 +68,339 @@ hier_notinput_subcell_node (VAR_T *V, char *node, char sep)
   }
   return 0;
 }
+
+
+/*------------------------------------------------------------------------
+ *
+ *  Subcell summaries
+ *
+ *    Every unique subcell that doesn't already have an up-to-date .hxt
+ *    file is checked against its own production rules in a child
+ *    process, and leaves its port summary in the .hxt file next to the
+ *    .ext file. The lvp check state is global, so each cell gets a
+ *    fresh copy of it in its own process.
+ *
+ *    Cells are scheduled bottom-up by height in the cell hierarchy:
+ *    all subcells of a cell have been summarized (or have failed)
+ *    before the cell itself is started, so the child only flattens
+ *    what it has to. Up to hier_jobs cells of the same height are
+ *    checked in parallel. Child output is captured and replayed in
+ *    hierarchy order, so the report does not depend on scheduling.
+ *
+ *------------------------------------------------------------------------
+ */
+struct hier_job {
+  struct ext_file *ext;
+  char *file;			/* .ext file */
+  int height;			/* height in the cell hierarchy */
+  pid_t pid;			/* child process, or 0 */
+  FILE *log;			/* captured output */
+  int ok;			/* summary created */
+};
+
+L_A_DECL (struct hier_job, hjobs);
+static int hier_child = 0;	/* in the child checking one subcell */
+static char *hier_tmp = NULL;	/* summary being written by the child */
+
+/* a child that exits through fatal_error() leaves no partial summary */
+static void _hier_unlink_tmp (void)
+{
+  if (hier_tmp)
+    unlink (hier_tmp);
+}
+
+static int _hier_collect (struct ext_file *ext)
+{
+  struct ext_list *l;
+  int h, ht;
+
+  h = 0;
+  for (l = ext->subcells; l; l = l->next) {
+    if (l->ext->h) continue;	/* already summarized */
+    if (l->ext->mark) {
+      ht = hjobs[l->ext->mark-1].height;
+    }
+    else if (ext_read_summary (l->ext, l->file)) {
+      continue;			/* up-to-date summary on disk */
+    }
+    else {
+      ht = _hier_collect (l->ext);
+      A_NEW (hjobs, struct hier_job);
+      A_NEXT (hjobs).ext = l->ext;
+      A_NEXT (hjobs).file = l->file;
+      A_NEXT (hjobs).height = ht;
+      A_NEXT (hjobs).pid = 0;
+      A_NEXT (hjobs).log = NULL;
+      A_NEXT (hjobs).ok = 0;
+      A_INC (hjobs);
+      l->ext->mark = A_LEN (hjobs);
+    }
+    if (ht + 1 > h)
+      h = ht + 1;
+  }
+  return h;
+}
+
+static char *_hier_swap_suffix (char *file, char *suffix)
+{
+  char *s;
+  int len;
+
+  len = strlen (file);
+  if (len < 4 || strcmp (file + len - 4, ".ext") != 0)
+    return NULL;
+  MALLOC (s, char, len+1);
+  strcpy (s, file);
+  strcpy (s + len - 3, suffix);
+  return s;
+}
+
+/*
+ * Start the check for one subcell. Returns 1 if a child was started.
+ */
+static int _hier_start (struct hier_job *j)
+{
+  char *path, *prs, *hxt, *tmp;
+  FILE *fp, *dmp;
+  int status;
+
+  path = ext_locate (j->file);
+  if (!path) return 0;
+  prs = _hier_swap_suffix (path, "prs");
+  if (!prs || !(fp = fopen (prs, "r"))) {
+    /* no production rules for this cell; flatten it */
+    if (prs) FREE (prs);
+    FREE (path);
+    return 0;
+  }
+  FREE (prs);
+  if (!(j->log = tmpfile ()))
+    fatal_error ("Unable to create log file for subcell `%s'", path);
+
+  if (verbose) {
+    pp_printf (PPout, "Checking subcell `%s'", path);
+    pp_forced (PPout, 0);
+  }
+  pp_flush (PPout);
+  fflush (stdout);
+  fflush (stderr);
+
+  j->pid = fork ();
+  if (j->pid < 0)
+    fatal_error ("fork() failed for subcell `%s'", path);
+
+  if (j->pid == 0) {
+    dup2 (fileno (j->log), 2);
+    hxt = _hier_swap_suffix (path, "hxt");
+    MALLOC (tmp, char, strlen (hxt)+32);
+    sprintf (tmp, "%s.%d", hxt, (int)getpid());
+    if (!(dmp = fopen (tmp, "w")))
+      fatal_error ("Unable to open dump file %s for writing.\n", tmp);
+    hier_tmp = tmp;
+    atexit (_hier_unlink_tmp);
+    exit_status = 0;
+    dump_hier_file = 1;
+    hier_child = 1;		/* subcells have been done already */
+    lvs (path, NULL, fp, NULL, dmp);
+    pp_flush (PPout);
+    /* lvs() may write a summary for a failed cell (wizard mode, or
+       summary-anyway); only a clean check counts */
+    status = (exit_status == 0);
+    fclose (dmp);
+    if (status)
+      rename (tmp, hxt);
+    else
+      unlink (tmp);
+    fflush (stderr);
+    _exit (status ? 0 : 1);
+  }
+  fclose (fp);
+  FREE (path);
+  return 1;
+}
+
+static struct hier_job *_hier_wait (void)
+{
+  pid_t pid;
+  int status;
+  int i;
+
+  while ((pid = wait (&status)) < 0)
+    ;
+  for (i=0; i < A_LEN (hjobs); i++)
+    if (hjobs[i].pid == pid) {
+      hjobs[i].ok = WIFEXITED (status) && WEXITSTATUS (status) == 0;
+      hjobs[i].pid = 0;
+      return &hjobs[i];
+    }
+  fatal_error ("Unexpected child process %d", (int)pid);
+  return NULL;
+}
+
+static void _hier_report (struct hier_job *j)
+{
+  char buf[MAXLINE];
+  size_t n;
+
+  if (!j->log) return;
+  rewind (j->log);
+  while ((n = fread (buf, 1, MAXLINE, j->log)) > 0)
+    fwrite (buf, 1, n, stderr);
+  fclose (j->log);
+  j->log = NULL;
+  if (!j->ok && verbose) {
+    pp_printf (PPout, "Subcell `%s' has errors; flattening it", j->file);
+    pp_forced (PPout, 0);
+    pp_flush (PPout);
+  }
+}
+
+/*
+ * Local name of a node inside subcell instance "id", or NULL if the
+ * node is not in that instance
+ */
+static char *_hier_local_name (char *node, char *id)
+{
+  int len = strlen (id);
+
+  if (strncmp (node, id, len) != 0)
+    return NULL;
+  node += len;
+  if (*node == '[') {
+    while (*node && *node != ']')
+      node++;
+    if (*node) node++;
+  }
+  if (*node != '/')
+    return NULL;
+  return node+1;
+}
+
+/*
+ * Check that "node" in the parent only connects to a port of the
+ * summarized subcell instance "l". Returns 0 if it connects to an
+ * internal node of the subcell.
+ */
+static int _hier_port_ok (char *node, struct ext_list *l)
+{
+  char buf[MAXLINE];
+  dots_t d;
+  char *s;
+
+  s = _hier_local_name (node, l->id);
+  if (!s) return 1;
+  if (s[0] && s[strlen (s)-1] == '!')
+    return 1;			/* global, connected by name */
+  if (strlen (s) >= MAXLINE)
+    return 0;
+  strcpy (buf, s);
+  name_convert (buf, &d);
+  return hash_lookup (l->ext->h, buf) ? 1 : 0;
+}
+
+static char *_hier_bad_conn (struct ext_file *ext, struct ext_list *l)
+{
+  struct ext_alias *a;
+  struct ext_fets *f;
+
+  for (a = ext->aliases; a; a = a->next) {
+    if (!_hier_port_ok (a->n1, l)) return a->n1;
+    if (!_hier_port_ok (a->n2, l)) return a->n2;
+  }
+  for (f = ext->fet; f; f = f->next) {
+    if (!_hier_port_ok (f->g, l)) return f->g;
+    if (!_hier_port_ok (f->t1, l)) return f->t1;
+    if (!_hier_port_ok (f->t2, l)) return f->t2;
+  }
+  return NULL;
+}
+
+/*
+ * A summary only describes the ports of a cell. Where a parent
+ * connects to an internal node of a summarized subcell, the summary
+ * is dropped and the subcell is flattened instead.
+ */
+static void _hier_check_ports (struct ext_file *ext, struct iHashtable *seen)
+{
+  struct ext_list *l;
+  char *node;
+
+  for (l = ext->subcells; l; l = l->next) {
+    if (!l->ext->h) continue;
+    if ((node = _hier_bad_conn (ext, l))) {
+      if (verbose) {
+	pp_printf (PPout, "Subcell `%s' is connected to internal node `%s'; "
+		   "flattening it", l->file, node);
+	pp_forced (PPout, 0);
+	pp_flush (PPout);
+      }
+      ext_free_summary (l->ext);
+    }
+  }
+  for (l = ext->subcells; l; l = l->next) {
+    if (l->ext->h || phash_lookup (seen, l->ext)) continue;
+    phash_add (seen, l->ext);
+    _hier_check_ports (l->ext, seen);
+  }
+}
+
+/*------------------------------------------------------------------------
+ *
+ *  hier_check_subcells --
+ *
+ *    Check every unique subcell of "ext" once, producing a .hxt
+ *    summary for each one that passes, and load the summary into the
+ *    hierarchy so that every instance of the cell uses it instead of
+ *    being flattened. "ext" must have been read with summaries turned
+ *    off (ext_use_summaries()), so that cells whose summary is dropped
+ *    can still be flattened. Cells without a .prs file, cells that
+ *    fail their own check, and cells with a non-hierarchical
+ *    connection to an internal node are flattened as before.
+ *
+ *    Returns the number of new summaries that were created.
+ *
+ *------------------------------------------------------------------------
+ */
+int hier_check_subcells (struct ext_file *ext)
+{
+  int i, h, height;
+  int running;
+  int count;
+  struct iHashtable *seen;
+
+  A_INIT (hjobs);
+  height = _hier_collect (ext);
+  for (i=0; i < A_LEN (hjobs); i++)
+    hjobs[i].ext->mark = 0;
+
+  count = 0;
+  if (hier_child)
+    height = 0;			/* only load existing summaries */
+  for (h=0; h < height; h++) {
+    running = 0;
+    for (i=0; i < A_LEN (hjobs); i++) {
+      if (hjobs[i].height != h) continue;
+      if (running == hier_jobs) {
+	_hier_wait ();
+	running--;
+      }
+      running += _hier_start (&hjobs[i]);
+    }
+    while (running > 0) {
+      _hier_wait ();
+      running--;
+    }
+    for (i=0; i < A_LEN (hjobs); i++)
+      if (hjobs[i].height == h) {
+	_hier_report (&hjobs[i]);
+	if (hjobs[i].ok && ext_read_summary (hjobs[i].ext, hjobs[i].file))
+	  count++;
+      }
+  }
+  A_FREE (hjobs);
+
+  seen = phash_new (8);
+  _hier_check_ports (ext, seen);
+  phash_free (seen);
+  return count;
+}
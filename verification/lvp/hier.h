@@ -31,5 +31,6 @@
 
 char *hier_subcell_node (VAR_T *, char *, var_t **, char sep);
 int hier_notinput_subcell_node (VAR_T *, char *, char sep);
+int hier_check_subcells (struct ext_file *);
 
 #endif /* __HIER_H__ */
@@ -19,6 +19,7 @@
 #include "misc.h"
 #include "bool.h"
 #include "dots.h"
+#include "hier.h"
 
 /*------------------------------------------------------------------------
  *
@@ -487,6 +488,21 @@ lvs (char *name, FILE *sim, FILE *prs, FILE *aliases, FILE *dump)
   int length, width;
   struct ext_file *ext;
   
+  /* read the extract file first, so that subcells are checked before
+     any state is set up for this cell */
+  if (extract_file) {
+    ext_validate_timestamp (name);
+    if (hier_subcells) {
+      /* summaries are loaded by the subcell check */
+      ext_use_summaries (0);
+      ext = ext_read (name);
+      ext_use_summaries (1);
+      hier_check_subcells (ext);
+    }
+    else
+      ext = ext_read (name);
+  }
+
   V = var_init ();
 
   /* parse all production rules for this file */
@@ -498,9 +514,6 @@ lvs (char *name, FILE *sim, FILE *prs, FILE *aliases, FILE *dump)
 
   /* parse extract/sim file */
   if (extract_file) {
-    ext_validate_timestamp (name);
-    //ext = parse_ext_file (sim, NULL, NULL);
-    ext = ext_read (name);
     flatten_ext_file (ext, V);
   }
   else {
@@ -540,5 +553,5 @@ lvs (char *name, FILE *sim, FILE *prs, FILE *aliases, FILE *dump)
     print_aliases (V);
 
   if (dump_hier_file && (exit_status == 0 || generate_summary_anyway() || wizard))
-    save_io_nodes (V, dump, ext->timestamp);
+    save_io_nodes (V, dump, ext->timestamp, ext_content_hash (name));
 }
@@ -90,6 +90,10 @@ extern int no_sneak_path_check;	        /* don't check sneak paths */
 extern int dump_hier_file;	        /* create output dump */
 extern int dump_hier_force;
 
+extern int hier_subcells;	        /* check subcells hierarchically */
+
+extern int hier_jobs;		        /* parallel subcell checks */
+
 extern int connect_globals_in_prs;      /* connect globals in prs file only */
 
 extern int wizard;		        /* wizard */
@@ -130,7 +134,7 @@ extern void array_fixup (char *s);
 extern void validate_name (var_t *, dots_t *);
 extern void check_sneak_paths (VAR_T *);
 extern void check_cap_ratios (VAR_T *);
-extern void save_io_nodes (VAR_T *, FILE *, unsigned long);
+extern void save_io_nodes (VAR_T *, FILE *, unsigned long, unsigned long);
 int generate_summary_anyway (void);
 
 extern int extra_exclhi (var_t *, var_t *);
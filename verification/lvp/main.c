@@ -80,6 +80,10 @@ int no_sneak_path_check;	/* don't check sneak paths */
 int dump_hier_file;		/* create output dump */
 int dump_hier_force;
 
+int hier_subcells;		/* check subcells hierarchically */
+
+int hier_jobs;			/* parallel subcell checks */
+
 int connect_globals_in_prs;     /* connect global names in prs file only */
 
 int wizard;			/* wizard option */
@@ -188,6 +192,7 @@ void usage (void)
     " -g         keep trailing \"!\" for globals; don't strip it [off]",
     " -h         nodes ending in \"&\" are not output nodes [off]",
     " -i         print gate list from Vdd/GND to precharged node [off]",
+    " -j num     check up to \"num\" subcells in parallel with -X [1]",
     " -n         treat named nodes as output nodes [off]",
     " -o ratio   fraction of coupling to take into account [0.25]",
     " -p         print production rules from layout [off]",
@@ -207,6 +212,7 @@ void usage (void)
     " -R         merge _xResety signals with _Reset [off]",
     " -S         don't look for sneak paths [off]",
     " -V name    use \"name\" as Vdd [Vdd]",
+    " -X         check each subcell once and reuse its .hxt summary (requires -sE) [off]",
 #if 0
     " -W         return non-zero exit status on any warnings [off]",
 #endif
@@ -272,6 +278,30 @@ static void do_cmdline_options (void)
   }
 }
 
+/*
+   options that change the contents of a .hxt summary; they are part of
+   the content hash, so summaries from a run with different settings
+   are not reused
+*/
+static void set_summary_options (void)
+{
+  char buf[1024];
+
+  snprintf (buf, 1024, "%s %s %d %d %d %d %d %d %d %d %d %g %g %g %g %g %g %g %g %d",
+	    Vddnode, GNDnode, check_staticizers, strip_by_width, and_hack,
+	    pass_gates, dont_strip_bang, outputs_by_name,
+	    connect_globals_in_prs, digital_only, prefix_reset,
+	    strip_threshold, width_threshold, strength_ratio_up,
+	    strength_ratio_dn, N_P_Ratio, lambda, comb_threshold,
+	    stateholding_threshold, overkill_mode);
+  ext_hash_options (buf);
+  /* the .prs file next to a cell's .ext file is part of its hash;
+     -X always checks subcells against that file. A -H run that reads
+     its rules from stdin or from another file still records the hash
+     of the file next to the .ext file. */
+  ext_hash_inputs ("prs");
+}
+
 static
 void parse_arguments (int argc, char **eargv, char **file1, char **file2)
 {
@@ -327,6 +357,8 @@ void parse_arguments (int argc, char **eargv, char **file1, char **file2)
   no_sneak_path_check = 0;
   dump_hier_file = 0;
   dump_hier_force = 0;
+  hier_subcells = 0;
+  hier_jobs = 1;
   connect_globals_in_prs = 1;
   wizard = 0;
   N_P_Ratio = 0.5;
@@ -354,7 +386,7 @@ void parse_arguments (int argc, char **eargv, char **file1, char **file2)
   prefix_reset = 0;
 
   opterr = 0;
-  while ((ch=getopt (argc,argv,"bHcCEfnBapgRPDz:hvr:w:sV:G:SZo:deKi"))!=-1){
+  while ((ch=getopt (argc,argv,"bHcCEfnBapgRPDz:hvr:w:sV:G:SZo:deKiXj:"))!=-1){
     switch (ch) {
     case 'R':
       prefix_reset = 1;
@@ -382,6 +414,14 @@ void parse_arguments (int argc, char **eargv, char **file1, char **file2)
       if (dump_hier_file) dump_hier_force = 1;
       dump_hier_file = 1;
       break;
+    case 'X':
+      hier_subcells = 1;
+      break;
+    case 'j':
+      sscanf (optarg, "%d", &hier_jobs);
+      if (hier_jobs < 1)
+	fatal_error ("-j requires a positive number of jobs");
+      break;
     case 'S':
       no_sneak_path_check = 1;
       break;
@@ -497,6 +537,7 @@ void parse_arguments (int argc, char **eargv, char **file1, char **file2)
 #ifndef DIGITAL_ONLY
   compute_derived_params ();
 #endif
+  set_summary_options ();
   if (optind < argc-2) {
     usage();
     fatal_error ("Too many arguments.");
@@ -518,14 +559,14 @@ void parse_arguments (int argc, char **eargv, char **file1, char **file2)
     *file2 = argv[optind+1];
   }
   
-  if (dump_hier_file && 
+  if ((dump_hier_file || hier_subcells) && 
       (!extract_file || no_sneak_path_check 
        ||  (!dump_hier_force && connect_globals)
        || !check_staticizers || connect_warn_only || print_only )) {
     usage ();
-    pp_printf (PPout, "-H requires: -sE");
+    pp_printf (PPout, "-H/-X requires: -sE");
     pp_forced (PPout, 0);
-    pp_printf (PPout, "-H excludes: -cBSp");
+    pp_printf (PPout, "-H/-X excludes: -cBSp");
     pp_forced (PPout, 0);
     fatal_error ("Hierarchical analysis incompatible with these options.");
   }
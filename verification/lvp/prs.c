@@ -3779,17 +3779,20 @@ start:
  *  save_io_nodes --
  *
  *    Save a timestamped version of all layout nodes that are only inputs
- *    or only outputs.
+ *    or only outputs. The content hash of the cell is saved along with
+ *    the timestamp, so the summary is reused until the cell changes.
  *
  *------------------------------------------------------------------------
  */
-void save_io_nodes (VAR_T *V, FILE *fp, unsigned long stamp)
+void save_io_nodes (VAR_T *V, FILE *fp, unsigned long stamp,
+		    unsigned long hash)
 {
   var_t *v, *vdd, *gnd, *u;
   int c;
   extern int exports_found;
 
-  fprintf (fp, "timestamp%c %lu\n", dump_hier_force ? 'F' : ' ', stamp);
+  fprintf (fp, "timestamp%c %lu hash %lx\n", dump_hier_force ? 'F' : ' ',
+	   stamp, hash);
 
   vdd = var_locate (V, Vddnode);
   gnd = var_locate (V, GNDnode);
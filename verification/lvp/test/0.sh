@@ -0,0 +1,36 @@
+#
+# A hierarchical design checked flat and with -X must give the same
+# diagnostics, both when the subcell summaries are created and when
+# they are reused from an earlier run. The design is checked as is,
+# with a wrong rule for a node driven by the top cell, and with a
+# connection missing from the layout.
+#
+sed 's/^~"i0\/out" -> out+/~"b0\/a\/in" -> out+/' top.prs > rule.prs
+grep -v '^merge "b1/b/out" "i0/in"' top.ext > conn.ext
+
+check ()
+{
+  echo "=== $1 $2"
+  rm -f *.hxt
+  $LVP -sE -v $1 $2 > flat.out 2>&1
+  echo "exit $?" >> flat.out
+  cat flat.out
+  for run in 1 2
+  do
+    $LVP -sE -X -v $1 $2 > hier.out 2>&1
+    echo "exit $?" >> hier.out
+    echo "-X run $run: `grep -c '^Checking subcell' hier.out` subcells checked"
+    grep -v '^Checking subcell' hier.out > diag.out
+    if cmp -s flat.out diag.out
+    then
+      echo "-X run $run: same diagnostics"
+    else
+      echo "-X run $run: different diagnostics"
+      cat hier.out
+    fi
+  done
+}
+
+check top.ext top.prs
+check top.ext rule.prs
+check conn.ext top.prs
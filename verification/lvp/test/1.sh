@@ -0,0 +1,36 @@
+#
+# A subcell whose production rules or layout change after its summary
+# was written must be checked again, not loaded from the stale .hxt
+# file; a cell whose subcell changed is checked again too.
+#
+$LVP -sE -X -v top.ext top.prs 2>&1
+echo "exit $?"
+
+echo "=== unchanged"
+$LVP -sE -X -v top.ext top.prs 2>&1
+echo "exit $?"
+
+echo "=== wrong pull-up in inv.prs"
+cp inv.prs inv.orig
+sed 's/^~in -> out+/~in -> out-/' inv.orig > inv.prs
+$LVP -sE -X -v top.ext top.prs 2>&1
+echo "exit $?"
+
+echo "=== inv.prs restored"
+cp inv.orig inv.prs
+$LVP -sE -X -v top.ext top.prs 2>&1
+echo "exit $?"
+
+echo "=== inv.ext re-extracted"
+sed 's/^cap "out" "in" .*/cap "out" "in" 70.5/' inv.ext > inv.new
+mv inv.new inv.ext
+$LVP -sE -X -v top.ext top.prs 2>&1
+echo "exit $?"
+
+echo "=== buf.prs without its internal connection"
+cp buf.prs buf.orig
+grep -v '^connect' buf.orig > buf.prs
+$LVP -sE -X -v top.ext top.prs 2>&1
+echo "exit $?"
+# a subcell check that stops with a fatal error leaves no partial summary
+ls *.hxt*
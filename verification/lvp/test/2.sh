@@ -0,0 +1,28 @@
+#
+# Subcells checked one at a time (-j 1) and four at a time (-j 4)
+# must give byte-for-byte the same report and exit status. badinv
+# does not match its own production rules, so its check fails and
+# it is flattened into the parent. With btop.prs the parent passes;
+# with the wrong rule for x0/out in wrong.prs it fails as well.
+#
+sed 's/^~"b0\/b\/out" -> "x0\/out"+/~"b0\/b\/out" -> "x0\/out"-/' btop.prs > wrong.prs
+
+for prs in btop.prs wrong.prs
+do
+  echo "=== $prs"
+  for j in 1 4
+  do
+    rm -f *.hxt
+    $LVP -sE -X -v -j $j btop.ext $prs > j$j.out 2>&1
+    echo "exit $?" >> j$j.out
+    ls *.hxt >> j$j.out
+  done
+  if cmp -s j1.out j4.out
+  then
+    echo "-j 1 and -j 4: same report"
+  else
+    echo "-j 1 and -j 4: different reports"
+    cat j4.out
+  fi
+  cat j1.out
+done